@@ -0,0 +1,299 @@
+/*
+ * Stand-in for the VimbaC API of the Allied Vision Vimba SDK.
+ *
+ * Declares the subset of the API gst-vimba uses, with the same names,
+ * types and values as the SDK headers, so the plugin builds and runs without
+ * the SDK or a camera when configured with --enable-vimba-mock. The
+ * implementation in vimbamock.c generates synthetic frames.
+ */
+#ifndef VIMBAC_H_INCLUDE_
+#define VIMBAC_H_INCLUDE_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define VMB_CALL
+
+/* common types */
+
+typedef signed char         VmbInt8_t;
+typedef unsigned char       VmbUint8_t;
+typedef short               VmbInt16_t;
+typedef unsigned short      VmbUint16_t;
+typedef int                 VmbInt32_t;
+typedef unsigned int        VmbUint32_t;
+typedef long long           VmbInt64_t;
+typedef unsigned long long  VmbUint64_t;
+typedef void*               VmbHandle_t;
+typedef char                VmbBool_t;
+typedef unsigned char       VmbUchar_t;
+
+typedef enum VmbBoolVal {
+    VmbBoolTrue  = 1,
+    VmbBoolFalse = 0
+} VmbBoolVal;
+
+typedef enum VmbErrorType {
+    VmbErrorSuccess         =  0,
+    VmbErrorInternalFault   = -1,
+    VmbErrorApiNotStarted   = -2,
+    VmbErrorNotFound        = -3,
+    VmbErrorBadHandle       = -4,
+    VmbErrorDeviceNotOpen   = -5,
+    VmbErrorInvalidAccess   = -6,
+    VmbErrorBadParameter    = -7,
+    VmbErrorStructSize      = -8,
+    VmbErrorMoreData        = -9,
+    VmbErrorWrongType       = -10,
+    VmbErrorInvalidValue    = -11,
+    VmbErrorTimeout         = -12,
+    VmbErrorOther           = -13,
+    VmbErrorResources       = -14,
+    VmbErrorInvalidCall     = -15,
+    VmbErrorNoTL            = -16,
+    VmbErrorNotImplemented  = -17,
+    VmbErrorNotSupported    = -18,
+    VmbErrorIncomplete      = -19
+} VmbErrorType;
+typedef VmbInt32_t VmbError_t;
+
+typedef VmbUint32_t VmbPixelFormat_t;
+
+#define VmbPixelFormatMono8         0x01080001
+#define VmbPixelFormatBayerGR8      0x01080008
+#define VmbPixelFormatBayerRG8      0x01080009
+#define VmbPixelFormatBayerGB8      0x0108000A
+#define VmbPixelFormatBayerBG8      0x0108000B
+#define VmbPixelFormatRgb8          0x02180014
+#define VmbPixelFormatBgr8          0x02180015
+#define VmbPixelFormatYuv422        0x0210001F
+
+/* cameras */
+
+typedef enum VmbAccessModeType {
+    VmbAccessModeNone   = 0,
+    VmbAccessModeFull   = 1,
+    VmbAccessModeRead   = 2,
+    VmbAccessModeConfig = 4,
+    VmbAccessModeLite   = 8
+} VmbAccessModeType;
+typedef VmbUint32_t VmbAccessMode_t;
+
+typedef struct {
+    const char*     cameraIdString;
+    const char*     cameraName;
+    const char*     modelName;
+    const char*     serialString;
+    VmbAccessMode_t permittedAccess;
+    const char*     interfaceIdString;
+} VmbCameraInfo_t;
+
+/* features */
+
+typedef enum VmbFeatureDataType {
+    VmbFeatureDataUnknown = 0,
+    VmbFeatureDataInt     = 1,
+    VmbFeatureDataFloat   = 2,
+    VmbFeatureDataEnum    = 3,
+    VmbFeatureDataString  = 4,
+    VmbFeatureDataBool    = 5,
+    VmbFeatureDataCommand = 6,
+    VmbFeatureDataRaw     = 7,
+    VmbFeatureDataNone    = 8
+} VmbFeatureDataType;
+typedef VmbUint32_t VmbFeatureData_t;
+
+typedef enum VmbFeatureVisibilityType {
+    VmbFeatureVisibilityUnknown   = 0,
+    VmbFeatureVisibilityBeginner  = 1,
+    VmbFeatureVisibilityExpert    = 2,
+    VmbFeatureVisibilityGuru      = 3,
+    VmbFeatureVisibilityInvisible = 4
+} VmbFeatureVisibilityType;
+typedef VmbUint32_t VmbFeatureVisibility_t;
+
+typedef enum VmbFeatureFlagsType {
+    VmbFeatureFlagsNone       = 0,
+    VmbFeatureFlagsRead       = 1,
+    VmbFeatureFlagsWrite      = 2,
+    VmbFeatureFlagsVolatile   = 8,
+    VmbFeatureFlagsModifyWrite = 16
+} VmbFeatureFlagsType;
+typedef VmbUint32_t VmbFeatureFlags_t;
+
+typedef struct {
+    const char*             name;
+    VmbFeatureData_t        featureDataType;
+    VmbFeatureFlags_t       featureFlags;
+    const char*             category;
+    const char*             displayName;
+    VmbUint32_t             pollingTime;
+    const char*             unit;
+    const char*             representation;
+    VmbFeatureVisibility_t  visibility;
+    const char*             tooltip;
+    const char*             description;
+    const char*             sfncNamespace;
+    VmbBool_t               isStreamable;
+    VmbBool_t               hasAffectedFeatures;
+    VmbBool_t               hasSelectedFeatures;
+} VmbFeatureInfo_t;
+
+typedef enum VmbFeaturePersistType {
+    VmbFeaturePersistAll        = 0,
+    VmbFeaturePersistStreamable = 1,
+    VmbFeaturePersistNoLUT      = 2
+} VmbFeaturePersistType;
+typedef VmbUint32_t VmbFeaturePersist_t;
+
+typedef struct {
+    VmbFeaturePersist_t persistFlag;
+    VmbUint32_t         maxIterations;
+    VmbUint32_t         loggingLevel;
+} VmbFeaturePersistSettings_t;
+
+typedef void (VMB_CALL *VmbInvalidationCallback)(
+    const VmbHandle_t handle, const char* name, void* pUserContext
+);
+
+/* frames */
+
+typedef enum VmbFrameStatusType {
+    VmbFrameStatusComplete   =  0,
+    VmbFrameStatusIncomplete = -1,
+    VmbFrameStatusTooSmall   = -2,
+    VmbFrameStatusInvalid    = -3
+} VmbFrameStatusType;
+typedef VmbInt32_t VmbFrameStatus_t;
+
+typedef enum VmbFrameFlagsType {
+    VmbFrameFlagsNone      = 0,
+    VmbFrameFlagsDimension = 1,
+    VmbFrameFlagsOffset    = 2,
+    VmbFrameFlagsFrameID   = 4,
+    VmbFrameFlagsTimestamp = 8
+} VmbFrameFlagsType;
+typedef VmbUint32_t VmbFrameFlags_t;
+
+typedef struct {
+    void*             buffer;
+    VmbUint32_t       bufferSize;
+    void*             context[4];
+    VmbFrameStatus_t  receiveStatus;
+    VmbFrameFlags_t   receiveFlags;
+    VmbUint32_t       imageSize;
+    VmbUint32_t       ancillarySize;
+    VmbPixelFormat_t  pixelFormat;
+    VmbUint32_t       width;
+    VmbUint32_t       height;
+    VmbUint32_t       offsetX;
+    VmbUint32_t       offsetY;
+    VmbUint64_t       frameID;
+    VmbUint64_t       timestamp;
+} VmbFrame_t;
+
+typedef void (VMB_CALL *VmbFrameCallback)(
+    const VmbHandle_t cameraHandle, VmbFrame_t* pFrame
+);
+
+/* api */
+
+extern const VmbHandle_t gVimbaHandle;
+
+VmbError_t VMB_CALL VmbStartup (void);
+void       VMB_CALL VmbShutdown (void);
+
+VmbError_t VMB_CALL VmbCamerasList (VmbCameraInfo_t* pCameraInfo,
+    VmbUint32_t listLength, VmbUint32_t* pNumFound, VmbUint32_t sizeofCameraInfo);
+VmbError_t VMB_CALL VmbCameraInfoQuery (const char* idString,
+    VmbCameraInfo_t* pInfo, VmbUint32_t sizeofCameraInfo);
+VmbError_t VMB_CALL VmbCameraOpen (const char* idString,
+    VmbAccessMode_t accessMode, VmbHandle_t* pCameraHandle);
+VmbError_t VMB_CALL VmbCameraClose (const VmbHandle_t cameraHandle);
+
+VmbError_t VMB_CALL VmbFeaturesList (VmbHandle_t handle,
+    VmbFeatureInfo_t* pFeatureInfoList, VmbUint32_t listLength,
+    VmbUint32_t* pNumFound, VmbUint32_t sizeofFeatureInfo);
+VmbError_t VMB_CALL VmbFeatureInfoQuery (const VmbHandle_t handle,
+    const char* name, VmbFeatureInfo_t* pFeatureInfo,
+    VmbUint32_t sizeofFeatureInfo);
+VmbError_t VMB_CALL VmbFeatureAccessQuery (const VmbHandle_t handle,
+    const char* name, VmbBool_t* pIsReadable, VmbBool_t* pIsWriteable);
+
+VmbError_t VMB_CALL VmbFeatureIntGet (const VmbHandle_t handle,
+    const char* name, VmbInt64_t* pValue);
+VmbError_t VMB_CALL VmbFeatureIntSet (const VmbHandle_t handle,
+    const char* name, VmbInt64_t value);
+VmbError_t VMB_CALL VmbFeatureIntRangeQuery (const VmbHandle_t handle,
+    const char* name, VmbInt64_t* pMin, VmbInt64_t* pMax);
+VmbError_t VMB_CALL VmbFeatureIntIncrementQuery (const VmbHandle_t handle,
+    const char* name, VmbInt64_t* pValue);
+
+VmbError_t VMB_CALL VmbFeatureFloatGet (const VmbHandle_t handle,
+    const char* name, double* pValue);
+VmbError_t VMB_CALL VmbFeatureFloatSet (const VmbHandle_t handle,
+    const char* name, double value);
+VmbError_t VMB_CALL VmbFeatureFloatRangeQuery (const VmbHandle_t handle,
+    const char* name, double* pMin, double* pMax);
+
+VmbError_t VMB_CALL VmbFeatureEnumGet (const VmbHandle_t handle,
+    const char* name, const char** pValue);
+VmbError_t VMB_CALL VmbFeatureEnumSet (const VmbHandle_t handle,
+    const char* name, const char* value);
+VmbError_t VMB_CALL VmbFeatureEnumRangeQuery (const VmbHandle_t handle,
+    const char* name, const char** pNameArray, VmbUint32_t arrayLength,
+    VmbUint32_t* pNumFilled);
+VmbError_t VMB_CALL VmbFeatureEnumIsAvailable (const VmbHandle_t handle,
+    const char* name, const char* value, VmbBool_t* pIsAvailable);
+
+VmbError_t VMB_CALL VmbFeatureStringGet (const VmbHandle_t handle,
+    const char* name, char* buffer, VmbUint32_t bufferSize,
+    VmbUint32_t* pSizeFilled);
+VmbError_t VMB_CALL VmbFeatureStringSet (const VmbHandle_t handle,
+    const char* name, const char* value);
+
+VmbError_t VMB_CALL VmbFeatureBoolGet (const VmbHandle_t handle,
+    const char* name, VmbBool_t* pValue);
+VmbError_t VMB_CALL VmbFeatureBoolSet (const VmbHandle_t handle,
+    const char* name, VmbBool_t value);
+
+VmbError_t VMB_CALL VmbFeatureCommandRun (const VmbHandle_t handle,
+    const char* name);
+VmbError_t VMB_CALL VmbFeatureCommandIsDone (const VmbHandle_t handle,
+    const char* name, VmbBool_t* pIsDone);
+
+VmbError_t VMB_CALL VmbFeatureInvalidationRegister (VmbHandle_t handle,
+    const char* name, VmbInvalidationCallback callback, void* pUserContext);
+VmbError_t VMB_CALL VmbFeatureInvalidationUnregister (VmbHandle_t handle,
+    const char* name, VmbInvalidationCallback callback);
+
+VmbError_t VMB_CALL VmbFrameAnnounce (VmbHandle_t cameraHandle,
+    const VmbFrame_t* pFrame, VmbUint32_t sizeofFrame);
+VmbError_t VMB_CALL VmbFrameRevoke (VmbHandle_t cameraHandle,
+    const VmbFrame_t* pFrame);
+VmbError_t VMB_CALL VmbFrameRevokeAll (VmbHandle_t cameraHandle);
+VmbError_t VMB_CALL VmbCaptureStart (VmbHandle_t cameraHandle);
+VmbError_t VMB_CALL VmbCaptureEnd (VmbHandle_t cameraHandle);
+VmbError_t VMB_CALL VmbCaptureFrameQueue (VmbHandle_t cameraHandle,
+    const VmbFrame_t* pFrame, VmbFrameCallback callback);
+VmbError_t VMB_CALL VmbCaptureFrameWait (const VmbHandle_t cameraHandle,
+    const VmbFrame_t* pFrame, VmbUint32_t timeout);
+VmbError_t VMB_CALL VmbCaptureQueueFlush (VmbHandle_t cameraHandle);
+
+VmbError_t VMB_CALL VmbAncillaryDataOpen (VmbFrame_t* pFrame,
+    VmbHandle_t* pAncillaryDataHandle);
+VmbError_t VMB_CALL VmbAncillaryDataClose (VmbHandle_t ancillaryDataHandle);
+
+VmbError_t VMB_CALL VmbCameraSettingsSave (const VmbHandle_t handle,
+    const char* fileName, VmbFeaturePersistSettings_t* pSettings,
+    VmbUint32_t sizeofSettings);
+VmbError_t VMB_CALL VmbCameraSettingsLoad (const VmbHandle_t handle,
+    const char* fileName, VmbFeaturePersistSettings_t* pSettings,
+    VmbUint32_t sizeofSettings);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
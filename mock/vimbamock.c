@@ -0,0 +1,1718 @@
+/*
+ * Synthetic implementation of the VimbaC API.
+ *
+ * Provides a configurable number of GigE-like cameras that deliver generated
+ * frames from their own acquisition thread, so the capture path can be run
+ * and measured without the SDK or hardware. Configuration is read from the
+ * environment when VmbStartup is called:
+ *
+ *   VIMBA_MOCK_CAMERAS     number of cameras (1)
+ *   VIMBA_MOCK_WIDTH       sensor width (1920)
+ *   VIMBA_MOCK_HEIGHT      sensor height (1080)
+ *   VIMBA_MOCK_FORMAT      initial PixelFormat (Mono8)
+ *   VIMBA_MOCK_FPS         initial AcquisitionFrameRateAbs (30)
+ *   VIMBA_MOCK_MAX_FPS     upper bound of AcquisitionFrameRateAbs (1000)
+ *   VIMBA_MOCK_INCOMPLETE  probability of an incomplete frame (0)
+ *   VIMBA_MOCK_JITTER      maximum frame period jitter in microseconds (0)
+ *   VIMBA_MOCK_BANDWIDTH   StreamBytesPerSecond (124000000)
+ *   VIMBA_MOCK_UNPLUG_AFTER  frames after which a camera drops off once (0)
+ *   VIMBA_MOCK_UNPLUG_MS   how long a dropped camera stays away (300)
+ *
+ * A camera that dropped off stops delivering and its handle fails every
+ * call, like a GigE camera after a link loss, until it is closed and opened
+ * again after it came back.
+ *
+ * Besides the regular features every camera offers MockTriggerCount,
+ * MockFramesDelivered and MockFramesLost to check what the camera saw.
+ * Setting PtpMode switches the device time to the wall clock, as if every
+ * camera followed the same grandmaster, and PtpStatus follows right away.
+ */
+#include <errno.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "VimbaC.h"
+
+#define MOCK_MAX_CAMERAS   16
+#define MOCK_MAX_FEATURES  96
+#define MOCK_MAX_QUEUED    256
+#define MOCK_NAME_SIZE     64
+#define MOCK_STRING_SIZE   256
+
+typedef enum {
+    MOCK_SYSTEM,
+    MOCK_CAMERA,
+    MOCK_ANCILLARY
+} MockHandleKind;
+
+typedef struct MockListener {
+    VmbInvalidationCallback callback;
+    void*                   context;
+    struct MockListener*    next;
+} MockListener;
+
+typedef struct {
+    char                name[MOCK_NAME_SIZE];
+    VmbFeatureData_t    type;
+    VmbFeatureFlags_t   flags;
+    VmbInt64_t          int_value;
+    VmbInt64_t          int_min;
+    VmbInt64_t          int_max;
+    VmbInt64_t          int_inc;
+    double              float_value;
+    double              float_min;
+    double              float_max;
+    VmbBool_t           bool_value;
+    const char*         enum_value;
+    const char* const*  enum_entries;
+    char                string_value[MOCK_STRING_SIZE];
+    MockListener*       listeners;
+} MockFeature;
+
+typedef struct {
+    MockHandleKind  kind;
+    MockFeature     features[MOCK_MAX_FEATURES];
+    int             feature_count;
+} MockHandle;
+
+typedef struct {
+    VmbFrame_t*       frame;
+    VmbFrameCallback  callback;
+} MockQueued;
+
+/* appended behind the image in chunk mode */
+typedef struct {
+    double      exposure_time;
+    double      gain;
+    VmbInt64_t  frame_counter;
+    VmbInt64_t  line_status;
+} MockChunk;
+
+typedef struct {
+    MockHandle      handle;
+    int             index;
+    char            id[MOCK_NAME_SIZE];
+    char            model[MOCK_NAME_SIZE];
+    char            serial[MOCK_NAME_SIZE];
+    int             open;
+    int             capturing;
+    int             acquiring;
+    pthread_t       thread;
+    int             thread_running;
+    pthread_cond_t  cond;
+    MockQueued      queue[MOCK_MAX_QUEUED];
+    int             queue_head;
+    int             queue_length;
+    int             pending_triggers;
+    VmbUint64_t     frame_id;
+    VmbInt64_t      triggers_received;
+    VmbInt64_t      frames_delivered;
+    VmbInt64_t      frames_lost;
+    unsigned int    seed;
+    /* dropped off the network, back at replug_ns */
+    int             unplugged;
+    int             was_unplugged;
+    VmbUint64_t     replug_ns;
+} MockCamera;
+
+static const char* const pixel_formats[] = {
+    "Mono8", "BayerGR8", "BayerRG8", "BayerGB8", "BayerBG8",
+    "RGB8Packed", "BGR8Packed", "RGBA8Packed", "BGRA8Packed",
+    "YUV411Packed", "YUV422Packed", "YUV444Packed", NULL
+};
+static const char* const acquisition_modes[] = {
+    "Continuous", "SingleFrame", "MultiFrame", NULL
+};
+static const char* const trigger_selectors[] = {
+    "FrameStart", "AcquisitionStart", NULL
+};
+static const char* const trigger_modes[] = { "Off", "On", NULL };
+static const char* const ptp_modes[] = {
+    "Off", "Slave", "Master", "Auto", NULL
+};
+static const char* const ptp_statuses[] = {
+    "Disabled", "Listening", "Syncing", "Slave", "Master", "Error", NULL
+};
+static const char* const trigger_sources[] = {
+    "Freerun", "Software", "Line1", "Line2", "Line3", "Line4",
+    "FixedRate", "Action0", "Action1", NULL
+};
+
+static pthread_mutex_t mock_lock = PTHREAD_MUTEX_INITIALIZER;
+static int             mock_started = 0;
+static MockHandle      mock_system;
+static MockCamera      mock_cameras[MOCK_MAX_CAMERAS];
+static int             mock_camera_count = 0;
+static double          mock_incomplete = 0;
+static long            mock_jitter_us = 0;
+static long            mock_unplug_after = 0;
+static long            mock_unplug_ms = 300;
+static struct timespec mock_epoch;
+
+const VmbHandle_t gVimbaHandle = (VmbHandle_t) &mock_system;
+
+/* helpers */
+
+static long mock_env_long (const char* name, long fallback) {
+    const char* value = getenv(name);
+    return value != NULL && *value != '\0' ? strtol(value, NULL, 0) : fallback;
+}
+
+static double mock_env_double (const char* name, double fallback) {
+    const char* value = getenv(name);
+    return value != NULL && *value != '\0' ? strtod(value, NULL) : fallback;
+}
+
+static VmbUint64_t mock_now_ns (void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (VmbUint64_t) (now.tv_sec - mock_epoch.tv_sec) * 1000000000ULL +
+        (VmbUint64_t) (now.tv_nsec - mock_epoch.tv_nsec);
+}
+
+static int mock_bits_per_pixel (const char* format) {
+    if (strstr(format, "RGBA") || strstr(format, "BGRA")) {
+        return 32;
+    }
+    if (strstr(format, "RGB") || strstr(format, "BGR") ||
+        strcmp(format, "YUV444Packed") == 0) {
+        return 24;
+    }
+    if (strcmp(format, "YUV422Packed") == 0) {
+        return 16;
+    }
+    if (strcmp(format, "YUV411Packed") == 0) {
+        return 12;
+    }
+    return 8;
+}
+
+static VmbPixelFormat_t mock_pixel_format (const char* format) {
+    if (strcmp(format, "BayerGR8") == 0) return VmbPixelFormatBayerGR8;
+    if (strcmp(format, "BayerRG8") == 0) return VmbPixelFormatBayerRG8;
+    if (strcmp(format, "BayerGB8") == 0) return VmbPixelFormatBayerGB8;
+    if (strcmp(format, "BayerBG8") == 0) return VmbPixelFormatBayerBG8;
+    if (strcmp(format, "RGB8Packed") == 0) return VmbPixelFormatRgb8;
+    if (strcmp(format, "BGR8Packed") == 0) return VmbPixelFormatBgr8;
+    if (strcmp(format, "YUV422Packed") == 0) return VmbPixelFormatYuv422;
+    return VmbPixelFormatMono8;
+}
+
+static int mock_is_camera (const VmbHandle_t handle) {
+    int i;
+    for (i = 0; i < mock_camera_count; i++) {
+        if (handle == (VmbHandle_t) &mock_cameras[i]) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/* handles the caller may use, must be called with mock_lock held */
+static MockHandle* mock_handle (const VmbHandle_t handle) {
+    if (!mock_started || handle == NULL) {
+        return NULL;
+    }
+    if (handle == gVimbaHandle) {
+        return &mock_system;
+    }
+    if (mock_is_camera(handle)) {
+        return ((MockCamera*) handle)->open &&
+            !((MockCamera*) handle)->unplugged ? (MockHandle*) handle : NULL;
+    }
+    /* ancillary handles are only known to the caller */
+    if (((MockHandle*) handle)->kind == MOCK_ANCILLARY) {
+        return (MockHandle*) handle;
+    }
+    return NULL;
+}
+
+static MockFeature* mock_feature (MockHandle* handle, const char* name) {
+    int i;
+    if (handle == NULL || name == NULL) {
+        return NULL;
+    }
+    for (i = 0; i < handle->feature_count; i++) {
+        if (strcmp(handle->features[i].name, name) == 0) {
+            return &handle->features[i];
+        }
+    }
+    return NULL;
+}
+
+static MockFeature* mock_add (
+    MockHandle* handle, const char* name, VmbFeatureData_t type
+) {
+    MockFeature* feature = &handle->features[handle->feature_count++];
+    memset(feature, 0, sizeof(MockFeature));
+    strncpy(feature->name, name, MOCK_NAME_SIZE - 1);
+    feature->type = type;
+    feature->flags = VmbFeatureFlagsRead | VmbFeatureFlagsWrite;
+    feature->int_inc = 1;
+    return feature;
+}
+
+static void mock_add_int (
+    MockHandle* handle, const char* name, VmbInt64_t value,
+    VmbInt64_t min, VmbInt64_t max, VmbInt64_t inc
+) {
+    MockFeature* feature = mock_add(handle, name, VmbFeatureDataInt);
+    feature->int_value = value;
+    feature->int_min = min;
+    feature->int_max = max;
+    feature->int_inc = inc;
+}
+
+static void mock_add_float (
+    MockHandle* handle, const char* name, double value, double min, double max
+) {
+    MockFeature* feature = mock_add(handle, name, VmbFeatureDataFloat);
+    feature->float_value = value;
+    feature->float_min = min;
+    feature->float_max = max;
+}
+
+static void mock_add_enum (
+    MockHandle* handle, const char* name, const char* const* entries,
+    const char* value
+) {
+    MockFeature* feature = mock_add(handle, name, VmbFeatureDataEnum);
+    int i;
+    feature->enum_entries = entries;
+    feature->enum_value = entries[0];
+    for (i = 0; value != NULL && entries[i] != NULL; i++) {
+        if (strcmp(entries[i], value) == 0) {
+            feature->enum_value = entries[i];
+        }
+    }
+}
+
+static void mock_add_string (
+    MockHandle* handle, const char* name, const char* value, int writable
+) {
+    MockFeature* feature = mock_add(handle, name, VmbFeatureDataString);
+    strncpy(feature->string_value, value, MOCK_STRING_SIZE - 1);
+    if (!writable) {
+        feature->flags = VmbFeatureFlagsRead;
+    }
+}
+
+static void mock_add_read_only_int (MockHandle* handle, const char* name) {
+    MockFeature* feature = mock_add(handle, name, VmbFeatureDataInt);
+    feature->flags = VmbFeatureFlagsRead | VmbFeatureFlagsVolatile;
+    feature->int_max = INT64_MAX;
+}
+
+static VmbInt64_t mock_int (MockHandle* handle, const char* name) {
+    MockFeature* feature = mock_feature(handle, name);
+    return feature != NULL ? feature->int_value : 0;
+}
+
+static const char* mock_enum (MockHandle* handle, const char* name) {
+    MockFeature* feature = mock_feature(handle, name);
+    return feature != NULL && feature->enum_value ? feature->enum_value : "";
+}
+
+/* device time in ns: monotonic, or wall clock time once PTP is on, as if
+ * all cameras followed the same grandmaster */
+static VmbUint64_t mock_device_ns (MockHandle* handle) {
+    const char* mode = mock_enum(handle, "PtpMode");
+    struct timespec now;
+
+    if (mode[0] == '\0' || strcmp(mode, "Off") == 0) {
+        return mock_now_ns();
+    }
+    clock_gettime(CLOCK_REALTIME, &now);
+    return (VmbUint64_t) now.tv_sec * 1000000000ULL + (VmbUint64_t) now.tv_nsec;
+}
+
+static VmbInt64_t mock_image_size (MockCamera* camera) {
+    MockHandle* handle = &camera->handle;
+    return mock_int(handle, "Width") * mock_int(handle, "Height") *
+        mock_bits_per_pixel(mock_enum(handle, "PixelFormat")) / 8;
+}
+
+/* values that depend on other features, must be called with mock_lock held */
+static void mock_update_dynamic (MockHandle* handle, MockFeature* feature) {
+    MockCamera* camera = (MockCamera*) handle;
+    MockFeature* chunk;
+
+    if (handle->kind != MOCK_CAMERA) {
+        return;
+    }
+    if (strcmp(feature->name, "PayloadSize") == 0) {
+        chunk = mock_feature(handle, "ChunkModeActive");
+        feature->int_value = mock_image_size(camera) +
+            (chunk != NULL && chunk->bool_value ? (VmbInt64_t) sizeof(MockChunk) : 0);
+    } else if (strcmp(feature->name, "MockTriggerCount") == 0) {
+        feature->int_value = camera->triggers_received;
+    } else if (strcmp(feature->name, "MockFramesDelivered") == 0) {
+        feature->int_value = camera->frames_delivered;
+    } else if (strcmp(feature->name, "MockFramesLost") == 0) {
+        feature->int_value = camera->frames_lost;
+    } else if (strcmp(feature->name, "Width") == 0) {
+        feature->int_max = mock_int(handle, "WidthMax") - mock_int(handle, "OffsetX");
+    } else if (strcmp(feature->name, "Height") == 0) {
+        feature->int_max = mock_int(handle, "HeightMax") - mock_int(handle, "OffsetY");
+    } else if (strcmp(feature->name, "OffsetX") == 0) {
+        feature->int_max = mock_int(handle, "WidthMax") - mock_int(handle, "Width");
+    } else if (strcmp(feature->name, "OffsetY") == 0) {
+        feature->int_max = mock_int(handle, "HeightMax") - mock_int(handle, "Height");
+    }
+}
+
+/*
+ * Call the invalidation listeners of a feature and of the features that
+ * depend on it. Must be called without mock_lock held.
+ */
+static void mock_notify (MockHandle* handle, const char* name) {
+    static const char* const geometry[] = {
+        "Width", "Height", "OffsetX", "OffsetY", "PayloadSize", NULL
+    };
+    MockListener calls[32];
+    const char* names[32];
+    int count = 0, i, j;
+    MockFeature* feature;
+    MockListener* listener;
+    const char* related[8];
+    int related_count = 0;
+
+    related[related_count++] = name;
+    if (strcmp(name, "Width") == 0 || strcmp(name, "Height") == 0 ||
+        strcmp(name, "OffsetX") == 0 || strcmp(name, "OffsetY") == 0 ||
+        strcmp(name, "PixelFormat") == 0 ||
+        strcmp(name, "ChunkModeActive") == 0) {
+        for (i = 0; geometry[i] != NULL && related_count < 8; i++) {
+            if (strcmp(geometry[i], name) != 0) {
+                related[related_count++] = geometry[i];
+            }
+        }
+    }
+
+    pthread_mutex_lock(&mock_lock);
+    for (i = 0; i < related_count; i++) {
+        feature = mock_feature(handle, related[i]);
+        if (feature == NULL) {
+            continue;
+        }
+        for (listener = feature->listeners; listener && count < 32;
+            listener = listener->next) {
+            calls[count] = *listener;
+            names[count] = feature->name;
+            count++;
+        }
+    }
+    pthread_mutex_unlock(&mock_lock);
+
+    for (j = 0; j < count; j++) {
+        calls[j].callback((VmbHandle_t) handle, names[j], calls[j].context);
+    }
+}
+
+/* cameras */
+
+static void mock_init_camera (MockCamera* camera, int index) {
+    MockHandle* handle = &camera->handle;
+    long width = mock_env_long("VIMBA_MOCK_WIDTH", 1920);
+    long height = mock_env_long("VIMBA_MOCK_HEIGHT", 1080);
+    const char* format = getenv("VIMBA_MOCK_FORMAT");
+    double fps = mock_env_double("VIMBA_MOCK_FPS", 30);
+    double max_fps = mock_env_double("VIMBA_MOCK_MAX_FPS", 1000);
+    pthread_condattr_t attr;
+
+    memset(camera, 0, sizeof(MockCamera));
+    handle->kind = MOCK_CAMERA;
+    camera->index = index;
+    camera->seed = 0x5eed + index;
+    snprintf(camera->id, MOCK_NAME_SIZE, "DEV_MOCK%04d", index);
+    snprintf(camera->model, MOCK_NAME_SIZE, "Mock GigE %ldx%ld", width, height);
+    snprintf(camera->serial, MOCK_NAME_SIZE, "MOCK%06d", index);
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&camera->cond, &attr);
+    pthread_condattr_destroy(&attr);
+
+    mock_add_int(handle, "WidthMax", width, width, width, 1);
+    mock_add_int(handle, "HeightMax", height, height, height, 1);
+    mock_add_int(handle, "Width", width, 8, width, 8);
+    mock_add_int(handle, "Height", height, 2, height, 2);
+    mock_add_int(handle, "OffsetX", 0, 0, 0, 2);
+    mock_add_int(handle, "OffsetY", 0, 0, 0, 2);
+    mock_add_int(handle, "BinningHorizontal", 1, 1, 4, 1);
+    mock_add_int(handle, "BinningVertical", 1, 1, 4, 1);
+    mock_add_enum(handle, "PixelFormat", pixel_formats, format ? format : "Mono8");
+    mock_add_read_only_int(handle, "PayloadSize");
+    mock_add_enum(handle, "AcquisitionMode", acquisition_modes, "Continuous");
+    mock_add(handle, "AcquisitionStart", VmbFeatureDataCommand);
+    mock_add(handle, "AcquisitionStop", VmbFeatureDataCommand);
+    mock_add_float(handle, "AcquisitionFrameRateAbs", fps, 1, max_fps);
+    mock_add_float(handle, "ExposureTimeAbs", 10000, 10, 10000000);
+    mock_add_float(handle, "Gain", 0, 0, 40);
+    mock_add_enum(handle, "TriggerSelector", trigger_selectors, "FrameStart");
+    mock_add_enum(handle, "TriggerMode", trigger_modes, "Off");
+    mock_add_enum(handle, "TriggerSource", trigger_sources, "Freerun");
+    mock_add(handle, "TriggerSoftware", VmbFeatureDataCommand);
+    mock_add_int(handle, "ActionDeviceKey", 0, 0, UINT32_MAX, 1);
+    mock_add_int(handle, "ActionGroupKey", 0, 0, UINT32_MAX, 1);
+    mock_add_int(handle, "ActionGroupMask", 0, 0, UINT32_MAX, 1);
+    mock_add(handle, "ChunkModeActive", VmbFeatureDataBool);
+    mock_add_int(handle, "StreamBytesPerSecond",
+        mock_env_long("VIMBA_MOCK_BANDWIDTH", 124000000), 1000000, 124000000, 1
+    );
+    mock_add_int(handle, "GevSCPSPacketSize", 1500, 576, 9000, 4);
+    mock_add_int(handle, "GevTimestampTickFrequency",
+        1000000000, 1000000000, 1000000000, 1
+    );
+    mock_add(handle, "GevTimestampControlLatch", VmbFeatureDataCommand);
+    mock_add_int(handle, "GevTimestampValue", 0, 0, INT64_MAX, 1);
+    mock_add_enum(handle, "PtpMode", ptp_modes, "Off");
+    mock_add_enum(handle, "PtpStatus", ptp_statuses, "Disabled");
+    mock_feature(handle, "PtpStatus")->flags =
+        VmbFeatureFlagsRead | VmbFeatureFlagsVolatile;
+    mock_add(handle, "PtpDataSetLatch", VmbFeatureDataCommand);
+    mock_add_read_only_int(handle, "PtpOffsetFromMaster");
+    mock_feature(handle, "PtpOffsetFromMaster")->int_min = INT64_MIN;
+    mock_add_string(handle, "DeviceID", camera->id, 0);
+    mock_add_string(handle, "DeviceModelName", camera->model, 0);
+    mock_add_string(handle, "DeviceSerialNumber", camera->serial, 0);
+    mock_add_string(handle, "DeviceUserID", "", 1);
+    mock_add_read_only_int(handle, "MockTriggerCount");
+    mock_add_read_only_int(handle, "MockFramesDelivered");
+    mock_add_read_only_int(handle, "MockFramesLost");
+}
+
+/* fill and hand out the next queued frame */
+static void mock_deliver (MockCamera* camera) {
+    MockHandle* handle = &camera->handle;
+    MockQueued queued;
+    VmbFrame_t* frame;
+    VmbInt64_t width, height, size, y;
+    MockFeature* chunk_mode;
+    MockChunk chunk;
+    int incomplete, has_chunk;
+    unsigned char* row;
+    VmbInt64_t stride;
+
+    pthread_mutex_lock(&mock_lock);
+    camera->frame_id++;
+    if (camera->queue_length == 0) {
+        camera->frames_lost++;
+        pthread_mutex_unlock(&mock_lock);
+        return;
+    }
+    queued = camera->queue[camera->queue_head];
+    camera->queue_head = (camera->queue_head + 1) % MOCK_MAX_QUEUED;
+    camera->queue_length--;
+
+    frame = queued.frame;
+    width = mock_int(handle, "Width");
+    height = mock_int(handle, "Height");
+    size = mock_image_size(camera);
+    stride = height > 0 ? size / height : 0;
+    chunk_mode = mock_feature(handle, "ChunkModeActive");
+    has_chunk = chunk_mode != NULL && chunk_mode->bool_value;
+    chunk.exposure_time = mock_feature(handle, "ExposureTimeAbs")->float_value;
+    chunk.gain = mock_feature(handle, "Gain")->float_value;
+    chunk.frame_counter = (VmbInt64_t) camera->frame_id;
+    chunk.line_status = (VmbInt64_t) (camera->frame_id & 0x1);
+    incomplete = mock_incomplete > 0 &&
+        (double) rand_r(&camera->seed) / RAND_MAX < mock_incomplete;
+
+    frame->frameID = camera->frame_id;
+    frame->timestamp = mock_device_ns(handle);
+    frame->width = (VmbUint32_t) width;
+    frame->height = (VmbUint32_t) height;
+    frame->offsetX = (VmbUint32_t) mock_int(handle, "OffsetX");
+    frame->offsetY = (VmbUint32_t) mock_int(handle, "OffsetY");
+    frame->pixelFormat = mock_pixel_format(mock_enum(handle, "PixelFormat"));
+    frame->receiveFlags = VmbFrameFlagsDimension | VmbFrameFlagsOffset |
+        VmbFrameFlagsFrameID | VmbFrameFlagsTimestamp;
+    camera->frames_delivered++;
+    if (mock_unplug_after > 0 && !camera->was_unplugged &&
+        camera->frames_delivered >= mock_unplug_after) {
+        camera->unplugged = 1;
+        camera->was_unplugged = 1;
+        camera->replug_ns = mock_now_ns() +
+            (VmbUint64_t) mock_unplug_ms * 1000000ULL;
+    }
+    pthread_mutex_unlock(&mock_lock);
+
+    frame->imageSize = (VmbUint32_t) size;
+    frame->ancillarySize = 0;
+    if ((VmbInt64_t) frame->bufferSize < size) {
+        frame->receiveStatus = VmbFrameStatusTooSmall;
+    } else {
+        /* diagonal gradient that moves with every frame */
+        row = frame->buffer;
+        for (y = 0; y < height; y++, row += stride) {
+            memset(row, (int) ((y + frame->frameID) & 0xff), (size_t) stride);
+        }
+        if (has_chunk &&
+            frame->bufferSize >= size + (VmbInt64_t) sizeof(MockChunk)) {
+            memcpy((unsigned char*) frame->buffer + size, &chunk, sizeof(chunk));
+            frame->ancillarySize = sizeof(MockChunk);
+        }
+        frame->receiveStatus = incomplete
+            ? VmbFrameStatusIncomplete : VmbFrameStatusComplete;
+    }
+
+    if (queued.callback != NULL) {
+        queued.callback((VmbHandle_t) camera, frame);
+    }
+}
+
+static void mock_deadline (struct timespec* deadline, long ns) {
+    deadline->tv_nsec += ns;
+    while (deadline->tv_nsec >= 1000000000L) {
+        deadline->tv_nsec -= 1000000000L;
+        deadline->tv_sec++;
+    }
+}
+
+static void* mock_acquisition (void* data) {
+    MockCamera* camera = data;
+    MockHandle* handle = &camera->handle;
+    struct timespec next;
+    long period, jitter;
+    int triggered;
+
+    clock_gettime(CLOCK_MONOTONIC, &next);
+    pthread_mutex_lock(&mock_lock);
+    while (camera->acquiring) {
+        triggered = strcmp(mock_enum(handle, "TriggerMode"), "On") == 0 &&
+            strncmp(mock_enum(handle, "TriggerSource"), "Line", 4) != 0 &&
+            strcmp(mock_enum(handle, "TriggerSource"), "Freerun") != 0 &&
+            strcmp(mock_enum(handle, "TriggerSource"), "FixedRate") != 0;
+        if (triggered) {
+            /* software and action triggers expose one frame each */
+            if (camera->pending_triggers == 0) {
+                pthread_cond_wait(&camera->cond, &mock_lock);
+                continue;
+            }
+            camera->pending_triggers--;
+            clock_gettime(CLOCK_MONOTONIC, &next);
+        } else {
+            /* free running, or a hardware line toggling at the frame rate */
+            period = (long) (1e9 / mock_feature(handle,
+                "AcquisitionFrameRateAbs")->float_value);
+            jitter = mock_jitter_us > 0
+                ? (long) (rand_r(&camera->seed) % (2 * mock_jitter_us + 1)) -
+                    mock_jitter_us
+                : 0;
+            mock_deadline(&next, period + jitter * 1000L > 0
+                ? period + jitter * 1000L : period
+            );
+            if (pthread_cond_timedwait(&camera->cond, &mock_lock, &next) !=
+                ETIMEDOUT) {
+                /* woken up by a stop or a feature change */
+                if (!camera->acquiring) {
+                    break;
+                }
+                continue;
+            }
+        }
+        if (camera->unplugged) {
+            continue;
+        }
+        pthread_mutex_unlock(&mock_lock);
+        mock_deliver(camera);
+        pthread_mutex_lock(&mock_lock);
+    }
+    pthread_mutex_unlock(&mock_lock);
+    return NULL;
+}
+
+/* must be called with mock_lock held */
+static void mock_start_acquisition (MockCamera* camera) {
+    if (camera->acquiring) {
+        return;
+    }
+    camera->acquiring = 1;
+    camera->pending_triggers = 0;
+    camera->thread_running =
+        pthread_create(&camera->thread, NULL, mock_acquisition, camera) == 0;
+}
+
+/* must be called with mock_lock held, releases it while joining */
+static void mock_stop_acquisition (MockCamera* camera) {
+    if (!camera->acquiring) {
+        return;
+    }
+    camera->acquiring = 0;
+    pthread_cond_broadcast(&camera->cond);
+    if (camera->thread_running) {
+        camera->thread_running = 0;
+        pthread_mutex_unlock(&mock_lock);
+        pthread_join(camera->thread, NULL);
+        pthread_mutex_lock(&mock_lock);
+    }
+}
+
+/* must be called with mock_lock held */
+static void mock_trigger (MockCamera* camera) {
+    camera->triggers_received++;
+    camera->pending_triggers++;
+    pthread_cond_broadcast(&camera->cond);
+}
+
+/* send an action command to all cameras whose keys match */
+static VmbError_t mock_action_command (void) {
+    VmbInt64_t device_key = mock_int(&mock_system, "ActionDeviceKey");
+    VmbInt64_t group_key = mock_int(&mock_system, "ActionGroupKey");
+    VmbInt64_t group_mask = mock_int(&mock_system, "ActionGroupMask");
+    MockCamera* camera;
+    MockHandle* handle;
+    int i;
+
+    for (i = 0; i < mock_camera_count; i++) {
+        camera = &mock_cameras[i];
+        handle = &camera->handle;
+        if (!camera->acquiring ||
+            strcmp(mock_enum(handle, "TriggerMode"), "On") != 0 ||
+            strncmp(mock_enum(handle, "TriggerSource"), "Action", 6) != 0 ||
+            mock_int(handle, "ActionDeviceKey") != device_key ||
+            mock_int(handle, "ActionGroupKey") != group_key ||
+            (mock_int(handle, "ActionGroupMask") & group_mask) == 0) {
+            continue;
+        }
+        mock_trigger(camera);
+    }
+    return VmbErrorSuccess;
+}
+
+/* api */
+
+VmbError_t VMB_CALL VmbStartup (void) {
+    int i;
+
+    pthread_mutex_lock(&mock_lock);
+    if (mock_started) {
+        pthread_mutex_unlock(&mock_lock);
+        return VmbErrorSuccess;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &mock_epoch);
+    memset(&mock_system, 0, sizeof(MockHandle));
+    mock_system.kind = MOCK_SYSTEM;
+    mock_add(&mock_system, "GeVTLIsPresent", VmbFeatureDataBool)->bool_value =
+        VmbBoolTrue;
+    mock_add(&mock_system, "GeVDiscoveryAllOnce", VmbFeatureDataCommand);
+    mock_add_int(&mock_system, "ActionDeviceKey", 0, 0, UINT32_MAX, 1);
+    mock_add_int(&mock_system, "ActionGroupKey", 0, 0, UINT32_MAX, 1);
+    mock_add_int(&mock_system, "ActionGroupMask", 0, 0, UINT32_MAX, 1);
+    mock_add(&mock_system, "ActionCommand", VmbFeatureDataCommand);
+
+    mock_camera_count = (int) mock_env_long("VIMBA_MOCK_CAMERAS", 1);
+    if (mock_camera_count < 0) {
+        mock_camera_count = 0;
+    } else if (mock_camera_count > MOCK_MAX_CAMERAS) {
+        mock_camera_count = MOCK_MAX_CAMERAS;
+    }
+    for (i = 0; i < mock_camera_count; i++) {
+        mock_init_camera(&mock_cameras[i], i);
+    }
+    mock_incomplete = mock_env_double("VIMBA_MOCK_INCOMPLETE", 0);
+    mock_jitter_us = mock_env_long("VIMBA_MOCK_JITTER", 0);
+    mock_unplug_after = mock_env_long("VIMBA_MOCK_UNPLUG_AFTER", 0);
+    mock_unplug_ms = mock_env_long("VIMBA_MOCK_UNPLUG_MS", 300);
+    mock_started = 1;
+    pthread_mutex_unlock(&mock_lock);
+    return VmbErrorSuccess;
+}
+
+void VMB_CALL VmbShutdown (void) {
+    int i;
+
+    for (i = 0; i < mock_camera_count; i++) {
+        VmbCameraClose((VmbHandle_t) &mock_cameras[i]);
+    }
+    pthread_mutex_lock(&mock_lock);
+    mock_started = 0;
+    pthread_mutex_unlock(&mock_lock);
+}
+
+static void mock_camera_info (MockCamera* camera, VmbCameraInfo_t* info) {
+    info->cameraIdString = camera->id;
+    info->cameraName = camera->model;
+    info->modelName = camera->model;
+    info->serialString = camera->serial;
+    info->permittedAccess = VmbAccessModeFull | VmbAccessModeRead;
+    info->interfaceIdString = "MockInterface";
+}
+
+VmbError_t VMB_CALL VmbCamerasList (
+    VmbCameraInfo_t* pCameraInfo, VmbUint32_t listLength,
+    VmbUint32_t* pNumFound, VmbUint32_t sizeofCameraInfo
+) {
+    VmbUint32_t i;
+
+    if (!mock_started) {
+        return VmbErrorApiNotStarted;
+    }
+    if (pNumFound == NULL) {
+        return VmbErrorBadParameter;
+    }
+    if (pCameraInfo != NULL && sizeofCameraInfo != sizeof(VmbCameraInfo_t)) {
+        return VmbErrorStructSize;
+    }
+    *pNumFound = (VmbUint32_t) mock_camera_count;
+    if (pCameraInfo == NULL) {
+        return VmbErrorSuccess;
+    }
+    for (i = 0; i < listLength && i < (VmbUint32_t) mock_camera_count; i++) {
+        mock_camera_info(&mock_cameras[i], &pCameraInfo[i]);
+    }
+    *pNumFound = i;
+    return listLength < (VmbUint32_t) mock_camera_count
+        ? VmbErrorMoreData : VmbErrorSuccess;
+}
+
+static MockCamera* mock_find_camera (const char* idString) {
+    int i;
+    for (i = 0; idString != NULL && i < mock_camera_count; i++) {
+        if (strcmp(mock_cameras[i].id, idString) == 0 ||
+            strcmp(mock_cameras[i].serial, idString) == 0) {
+            return &mock_cameras[i];
+        }
+    }
+    return NULL;
+}
+
+VmbError_t VMB_CALL VmbCameraInfoQuery (
+    const char* idString, VmbCameraInfo_t* pInfo, VmbUint32_t sizeofCameraInfo
+) {
+    MockCamera* camera;
+
+    if (!mock_started) {
+        return VmbErrorApiNotStarted;
+    }
+    if (pInfo == NULL || sizeofCameraInfo != sizeof(VmbCameraInfo_t)) {
+        return VmbErrorStructSize;
+    }
+    if ((camera = mock_find_camera(idString)) == NULL) {
+        return VmbErrorNotFound;
+    }
+    mock_camera_info(camera, pInfo);
+    return VmbErrorSuccess;
+}
+
+VmbError_t VMB_CALL VmbCameraOpen (
+    const char* idString, VmbAccessMode_t accessMode, VmbHandle_t* pCameraHandle
+) {
+    MockCamera* camera;
+
+    if (!mock_started) {
+        return VmbErrorApiNotStarted;
+    }
+    if (pCameraHandle == NULL) {
+        return VmbErrorBadParameter;
+    }
+    pthread_mutex_lock(&mock_lock);
+    camera = mock_find_camera(idString);
+    if (camera == NULL ||
+        (camera->unplugged && mock_now_ns() < camera->replug_ns)) {
+        pthread_mutex_unlock(&mock_lock);
+        return VmbErrorNotFound;
+    }
+    camera->unplugged = 0;
+    if (camera->open && (accessMode & VmbAccessModeFull)) {
+        pthread_mutex_unlock(&mock_lock);
+        return VmbErrorInvalidAccess;
+    }
+    camera->open = 1;
+    *pCameraHandle = (VmbHandle_t) camera;
+    pthread_mutex_unlock(&mock_lock);
+    return VmbErrorSuccess;
+}
+
+VmbError_t VMB_CALL VmbCameraClose (const VmbHandle_t cameraHandle) {
+    MockCamera* camera = (MockCamera*) cameraHandle;
+    MockListener* listener;
+    int i;
+
+    pthread_mutex_lock(&mock_lock);
+    if (!mock_is_camera(cameraHandle) || !camera->open) {
+        pthread_mutex_unlock(&mock_lock);
+        return VmbErrorBadHandle;
+    }
+    mock_stop_acquisition(camera);
+    camera->capturing = 0;
+    camera->queue_length = 0;
+    camera->open = 0;
+    for (i = 0; i < camera->handle.feature_count; i++) {
+        while ((listener = camera->handle.features[i].listeners) != NULL) {
+            camera->handle.features[i].listeners = listener->next;
+            free(listener);
+        }
+    }
+    pthread_mutex_unlock(&mock_lock);
+    return VmbErrorSuccess;
+}
+
+/* features */
+
+static void mock_feature_info (MockFeature* feature, VmbFeatureInfo_t* info) {
+    memset(info, 0, sizeof(VmbFeatureInfo_t));
+    info->name = feature->name;
+    info->featureDataType = feature->type;
+    info->featureFlags = feature->flags;
+    info->category = "/Mock";
+    info->displayName = feature->name;
+    info->visibility = VmbFeatureVisibilityBeginner;
+    info->isStreamable = (feature->flags & VmbFeatureFlagsWrite) &&
+        feature->type != VmbFeatureDataCommand ? VmbBoolTrue : VmbBoolFalse;
+}
+
+VmbError_t VMB_CALL VmbFeaturesList (
+    VmbHandle_t handle, VmbFeatureInfo_t* pFeatureInfoList,
+    VmbUint32_t listLength, VmbUint32_t* pNumFound,
+    VmbUint32_t sizeofFeatureInfo
+) {
+    MockHandle* mock;
+    VmbUint32_t i;
+
+    pthread_mutex_lock(&mock_lock);
+    if ((mock = mock_handle(handle)) == NULL) {
+        pthread_mutex_unlock(&mock_lock);
+        return VmbErrorBadHandle;
+    }
+    if (pFeatureInfoList != NULL && sizeofFeatureInfo != sizeof(VmbFeatureInfo_t)) {
+        pthread_mutex_unlock(&mock_lock);
+        return VmbErrorStructSize;
+    }
+    *pNumFound = (VmbUint32_t) mock->feature_count;
+    if (pFeatureInfoList != NULL) {
+        for (i = 0; i < listLength && i < (VmbUint32_t) mock->feature_count; i++) {
+            mock_feature_info(&mock->features[i], &pFeatureInfoList[i]);
+        }
+        *pNumFound = i;
+    }
+    pthread_mutex_unlock(&mock_lock);
+    return VmbErrorSuccess;
+}
+
+/*
+ * Look up a feature of the expected type, leaving mock_lock held on
+ * success.
+ */
+static VmbError_t mock_lookup (
+    const VmbHandle_t handle, const char* name, VmbFeatureData_t type,
+    MockHandle** pHandle, MockFeature** pFeature
+) {
+    MockHandle* mock;
+    MockFeature* feature;
+
+    pthread_mutex_lock(&mock_lock);
+    if ((mock = mock_handle(handle)) == NULL) {
+        pthread_mutex_unlock(&mock_lock);
+        return VmbErrorBadHandle;
+    }
+    if ((feature = mock_feature(mock, name)) == NULL) {
+        pthread_mutex_unlock(&mock_lock);
+        return VmbErrorNotFound;
+    }
+    if (type != VmbFeatureDataUnknown && feature->type != type) {
+        pthread_mutex_unlock(&mock_lock);
+        return VmbErrorWrongType;
+    }
+    mock_update_dynamic(mock, feature);
+    *pHandle = mock;
+    *pFeature = feature;
+    return VmbErrorSuccess;
+}
+
+VmbError_t VMB_CALL VmbFeatureInfoQuery (
+    const VmbHandle_t handle, const char* name, VmbFeatureInfo_t* pFeatureInfo,
+    VmbUint32_t sizeofFeatureInfo
+) {
+    MockHandle* mock;
+    MockFeature* feature;
+    VmbError_t err;
+
+    if (pFeatureInfo == NULL || sizeofFeatureInfo != sizeof(VmbFeatureInfo_t)) {
+        return VmbErrorStructSize;
+    }
+    err = mock_lookup(handle, name, VmbFeatureDataUnknown, &mock, &feature);
+    if (err == VmbErrorSuccess) {
+        mock_feature_info(feature, pFeatureInfo);
+        pthread_mutex_unlock(&mock_lock);
+    }
+    return err;
+}
+
+VmbError_t VMB_CALL VmbFeatureAccessQuery (
+    const VmbHandle_t handle, const char* name,
+    VmbBool_t* pIsReadable, VmbBool_t* pIsWriteable
+) {
+    MockHandle* mock;
+    MockFeature* feature;
+    VmbError_t err;
+
+    err = mock_lookup(handle, name, VmbFeatureDataUnknown, &mock, &feature);
+    if (err == VmbErrorSuccess) {
+        if (pIsReadable != NULL) {
+            *pIsReadable = (feature->flags & VmbFeatureFlagsRead) != 0;
+        }
+        if (pIsWriteable != NULL) {
+            *pIsWriteable = (feature->flags & VmbFeatureFlagsWrite) != 0;
+        }
+        pthread_mutex_unlock(&mock_lock);
+    }
+    return err;
+}
+
+VmbError_t VMB_CALL VmbFeatureIntGet (
+    const VmbHandle_t handle, const char* name, VmbInt64_t* pValue
+) {
+    MockHandle* mock;
+    MockFeature* feature;
+    VmbError_t err;
+
+    if (pValue == NULL) {
+        return VmbErrorBadParameter;
+    }
+    err = mock_lookup(handle, name, VmbFeatureDataInt, &mock, &feature);
+    if (err == VmbErrorSuccess) {
+        if (strcmp(name, "GevTimestampValue") == 0 && feature->int_value == 0) {
+            feature->int_value = (VmbInt64_t) mock_device_ns(mock);
+        }
+        *pValue = feature->int_value;
+        pthread_mutex_unlock(&mock_lock);
+    }
+    return err;
+}
+
+VmbError_t VMB_CALL VmbFeatureIntSet (
+    const VmbHandle_t handle, const char* name, VmbInt64_t value
+) {
+    MockHandle* mock;
+    MockFeature* feature;
+    VmbError_t err;
+
+    err = mock_lookup(handle, name, VmbFeatureDataInt, &mock, &feature);
+    if (err != VmbErrorSuccess) {
+        return err;
+    }
+    if (!(feature->flags & VmbFeatureFlagsWrite)) {
+        err = VmbErrorInvalidAccess;
+    } else if (value < feature->int_min || value > feature->int_max ||
+        (value - feature->int_min) % feature->int_inc != 0) {
+        err = VmbErrorInvalidValue;
+    } else if (mock->kind == MOCK_CAMERA && ((MockCamera*) mock)->acquiring &&
+        (strcmp(name, "Width") == 0 || strcmp(name, "Height") == 0)) {
+        /* the payload size cannot change while streaming */
+        err = VmbErrorInvalidAccess;
+    } else {
+        feature->int_value = value;
+    }
+    pthread_mutex_unlock(&mock_lock);
+    if (err == VmbErrorSuccess) {
+        mock_notify(mock, name);
+    }
+    return err;
+}
+
+VmbError_t VMB_CALL VmbFeatureIntRangeQuery (
+    const VmbHandle_t handle, const char* name, VmbInt64_t* pMin, VmbInt64_t* pMax
+) {
+    MockHandle* mock;
+    MockFeature* feature;
+    VmbError_t err;
+
+    err = mock_lookup(handle, name, VmbFeatureDataInt, &mock, &feature);
+    if (err == VmbErrorSuccess) {
+        if (pMin != NULL) *pMin = feature->int_min;
+        if (pMax != NULL) *pMax = feature->int_max;
+        pthread_mutex_unlock(&mock_lock);
+    }
+    return err;
+}
+
+VmbError_t VMB_CALL VmbFeatureIntIncrementQuery (
+    const VmbHandle_t handle, const char* name, VmbInt64_t* pValue
+) {
+    MockHandle* mock;
+    MockFeature* feature;
+    VmbError_t err;
+
+    err = mock_lookup(handle, name, VmbFeatureDataInt, &mock, &feature);
+    if (err == VmbErrorSuccess) {
+        if (pValue != NULL) *pValue = feature->int_inc;
+        pthread_mutex_unlock(&mock_lock);
+    }
+    return err;
+}
+
+VmbError_t VMB_CALL VmbFeatureFloatGet (
+    const VmbHandle_t handle, const char* name, double* pValue
+) {
+    MockHandle* mock;
+    MockFeature* feature;
+    VmbError_t err;
+
+    if (pValue == NULL) {
+        return VmbErrorBadParameter;
+    }
+    err = mock_lookup(handle, name, VmbFeatureDataFloat, &mock, &feature);
+    if (err == VmbErrorSuccess) {
+        *pValue = feature->float_value;
+        pthread_mutex_unlock(&mock_lock);
+    }
+    return err;
+}
+
+VmbError_t VMB_CALL VmbFeatureFloatSet (
+    const VmbHandle_t handle, const char* name, double value
+) {
+    MockHandle* mock;
+    MockFeature* feature;
+    VmbError_t err;
+
+    err = mock_lookup(handle, name, VmbFeatureDataFloat, &mock, &feature);
+    if (err != VmbErrorSuccess) {
+        return err;
+    }
+    if (!(feature->flags & VmbFeatureFlagsWrite)) {
+        err = VmbErrorInvalidAccess;
+    } else if (value < feature->float_min || value > feature->float_max) {
+        err = VmbErrorInvalidValue;
+    } else {
+        feature->float_value = value;
+        /* a new frame rate applies from the next frame on */
+        if (mock->kind == MOCK_CAMERA) {
+            pthread_cond_broadcast(&((MockCamera*) mock)->cond);
+        }
+    }
+    pthread_mutex_unlock(&mock_lock);
+    if (err == VmbErrorSuccess) {
+        mock_notify(mock, name);
+    }
+    return err;
+}
+
+VmbError_t VMB_CALL VmbFeatureFloatRangeQuery (
+    const VmbHandle_t handle, const char* name, double* pMin, double* pMax
+) {
+    MockHandle* mock;
+    MockFeature* feature;
+    VmbError_t err;
+
+    err = mock_lookup(handle, name, VmbFeatureDataFloat, &mock, &feature);
+    if (err == VmbErrorSuccess) {
+        if (pMin != NULL) *pMin = feature->float_min;
+        if (pMax != NULL) *pMax = feature->float_max;
+        pthread_mutex_unlock(&mock_lock);
+    }
+    return err;
+}
+
+VmbError_t VMB_CALL VmbFeatureEnumGet (
+    const VmbHandle_t handle, const char* name, const char** pValue
+) {
+    MockHandle* mock;
+    MockFeature* feature;
+    VmbError_t err;
+
+    if (pValue == NULL) {
+        return VmbErrorBadParameter;
+    }
+    err = mock_lookup(handle, name, VmbFeatureDataEnum, &mock, &feature);
+    if (err == VmbErrorSuccess) {
+        *pValue = feature->enum_value;
+        pthread_mutex_unlock(&mock_lock);
+    }
+    return err;
+}
+
+VmbError_t VMB_CALL VmbFeatureEnumSet (
+    const VmbHandle_t handle, const char* name, const char* value
+) {
+    MockHandle* mock;
+    MockFeature* feature;
+    VmbError_t err;
+    int i;
+
+    if (value == NULL) {
+        return VmbErrorBadParameter;
+    }
+    err = mock_lookup(handle, name, VmbFeatureDataEnum, &mock, &feature);
+    if (err != VmbErrorSuccess) {
+        return err;
+    }
+    err = VmbErrorInvalidValue;
+    if (!(feature->flags & VmbFeatureFlagsWrite)) {
+        err = VmbErrorInvalidAccess;
+    } else if (mock->kind == MOCK_CAMERA && ((MockCamera*) mock)->acquiring &&
+        strcmp(name, "PixelFormat") == 0) {
+        err = VmbErrorInvalidAccess;
+    } else {
+        for (i = 0; feature->enum_entries[i] != NULL; i++) {
+            if (strcmp(feature->enum_entries[i], value) == 0) {
+                feature->enum_value = feature->enum_entries[i];
+                err = VmbErrorSuccess;
+                break;
+            }
+        }
+    }
+    if (err == VmbErrorSuccess && strcmp(name, "PtpMode") == 0) {
+        /* locks right away, Auto always ends up a slave */
+        mock_feature(mock, "PtpStatus")->enum_value =
+            strcmp(value, "Off") == 0 ? "Disabled" :
+            strcmp(value, "Master") == 0 ? "Master" : "Slave";
+    }
+    if (err == VmbErrorSuccess && mock->kind == MOCK_CAMERA) {
+        pthread_cond_broadcast(&((MockCamera*) mock)->cond);
+    }
+    pthread_mutex_unlock(&mock_lock);
+    if (err == VmbErrorSuccess) {
+        mock_notify(mock, name);
+    }
+    return err;
+}
+
+VmbError_t VMB_CALL VmbFeatureEnumRangeQuery (
+    const VmbHandle_t handle, const char* name, const char** pNameArray,
+    VmbUint32_t arrayLength, VmbUint32_t* pNumFilled
+) {
+    MockHandle* mock;
+    MockFeature* feature;
+    VmbError_t err;
+    VmbUint32_t i;
+
+    err = mock_lookup(handle, name, VmbFeatureDataEnum, &mock, &feature);
+    if (err != VmbErrorSuccess) {
+        return err;
+    }
+    for (i = 0; feature->enum_entries[i] != NULL; i++) {
+        if (pNameArray != NULL) {
+            if (i >= arrayLength) {
+                err = VmbErrorMoreData;
+                break;
+            }
+            pNameArray[i] = feature->enum_entries[i];
+        }
+    }
+    if (pNumFilled != NULL) {
+        *pNumFilled = i;
+    }
+    pthread_mutex_unlock(&mock_lock);
+    return err;
+}
+
+VmbError_t VMB_CALL VmbFeatureEnumIsAvailable (
+    const VmbHandle_t handle, const char* name, const char* value,
+    VmbBool_t* pIsAvailable
+) {
+    MockHandle* mock;
+    MockFeature* feature;
+    VmbError_t err;
+    int i;
+
+    err = mock_lookup(handle, name, VmbFeatureDataEnum, &mock, &feature);
+    if (err != VmbErrorSuccess) {
+        return err;
+    }
+    *pIsAvailable = VmbBoolFalse;
+    for (i = 0; value != NULL && feature->enum_entries[i] != NULL; i++) {
+        if (strcmp(feature->enum_entries[i], value) == 0) {
+            *pIsAvailable = VmbBoolTrue;
+        }
+    }
+    pthread_mutex_unlock(&mock_lock);
+    return VmbErrorSuccess;
+}
+
+VmbError_t VMB_CALL VmbFeatureStringGet (
+    const VmbHandle_t handle, const char* name, char* buffer,
+    VmbUint32_t bufferSize, VmbUint32_t* pSizeFilled
+) {
+    MockHandle* mock;
+    MockFeature* feature;
+    VmbError_t err;
+    VmbUint32_t length;
+
+    err = mock_lookup(handle, name, VmbFeatureDataString, &mock, &feature);
+    if (err != VmbErrorSuccess) {
+        return err;
+    }
+    length = (VmbUint32_t) strlen(feature->string_value) + 1;
+    if (pSizeFilled != NULL) {
+        *pSizeFilled = length;
+    }
+    if (buffer != NULL) {
+        if (bufferSize < length) {
+            err = VmbErrorMoreData;
+        } else {
+            memcpy(buffer, feature->string_value, length);
+        }
+    }
+    pthread_mutex_unlock(&mock_lock);
+    return err;
+}
+
+VmbError_t VMB_CALL VmbFeatureStringSet (
+    const VmbHandle_t handle, const char* name, const char* value
+) {
+    MockHandle* mock;
+    MockFeature* feature;
+    VmbError_t err;
+
+    if (value == NULL) {
+        return VmbErrorBadParameter;
+    }
+    err = mock_lookup(handle, name, VmbFeatureDataString, &mock, &feature);
+    if (err != VmbErrorSuccess) {
+        return err;
+    }
+    if (!(feature->flags & VmbFeatureFlagsWrite)) {
+        err = VmbErrorInvalidAccess;
+    } else {
+        strncpy(feature->string_value, value, MOCK_STRING_SIZE - 1);
+    }
+    pthread_mutex_unlock(&mock_lock);
+    if (err == VmbErrorSuccess) {
+        mock_notify(mock, name);
+    }
+    return err;
+}
+
+VmbError_t VMB_CALL VmbFeatureBoolGet (
+    const VmbHandle_t handle, const char* name, VmbBool_t* pValue
+) {
+    MockHandle* mock;
+    MockFeature* feature;
+    VmbError_t err;
+
+    if (pValue == NULL) {
+        return VmbErrorBadParameter;
+    }
+    err = mock_lookup(handle, name, VmbFeatureDataBool, &mock, &feature);
+    if (err == VmbErrorSuccess) {
+        *pValue = feature->bool_value;
+        pthread_mutex_unlock(&mock_lock);
+    }
+    return err;
+}
+
+VmbError_t VMB_CALL VmbFeatureBoolSet (
+    const VmbHandle_t handle, const char* name, VmbBool_t value
+) {
+    MockHandle* mock;
+    MockFeature* feature;
+    VmbError_t err;
+
+    err = mock_lookup(handle, name, VmbFeatureDataBool, &mock, &feature);
+    if (err != VmbErrorSuccess) {
+        return err;
+    }
+    if (mock->kind == MOCK_CAMERA && ((MockCamera*) mock)->acquiring &&
+        strcmp(name, "ChunkModeActive") == 0) {
+        err = VmbErrorInvalidAccess;
+    } else {
+        feature->bool_value = value ? VmbBoolTrue : VmbBoolFalse;
+    }
+    pthread_mutex_unlock(&mock_lock);
+    if (err == VmbErrorSuccess) {
+        mock_notify(mock, name);
+    }
+    return err;
+}
+
+VmbError_t VMB_CALL VmbFeatureCommandRun (
+    const VmbHandle_t handle, const char* name
+) {
+    MockHandle* mock;
+    MockFeature* feature;
+    MockCamera* camera;
+    MockFeature* latched;
+    VmbError_t err;
+
+    err = mock_lookup(handle, name, VmbFeatureDataCommand, &mock, &feature);
+    if (err != VmbErrorSuccess) {
+        return err;
+    }
+    camera = mock->kind == MOCK_CAMERA ? (MockCamera*) mock : NULL;
+    if (mock == &mock_system && strcmp(name, "ActionCommand") == 0) {
+        err = mock_action_command();
+    } else if (camera != NULL && strcmp(name, "AcquisitionStart") == 0) {
+        mock_start_acquisition(camera);
+    } else if (camera != NULL && strcmp(name, "AcquisitionStop") == 0) {
+        mock_stop_acquisition(camera);
+    } else if (camera != NULL && strcmp(name, "TriggerSoftware") == 0) {
+        if (camera->acquiring &&
+            strcmp(mock_enum(mock, "TriggerSource"), "Software") == 0) {
+            mock_trigger(camera);
+        }
+    } else if (camera != NULL && strcmp(name, "GevTimestampControlLatch") == 0) {
+        latched = mock_feature(mock, "GevTimestampValue");
+        latched->int_value = (VmbInt64_t) mock_device_ns(mock);
+    } else if (camera != NULL && strcmp(name, "PtpDataSetLatch") == 0) {
+        /* a slave stays within 100 ns of its master */
+        latched = mock_feature(mock, "PtpOffsetFromMaster");
+        latched->int_value = strcmp(mock_enum(mock, "PtpStatus"), "Slave") == 0
+            ? (VmbInt64_t) (rand_r(&camera->seed) % 201) - 100 : 0;
+    }
+    pthread_mutex_unlock(&mock_lock);
+    return err;
+}
+
+VmbError_t VMB_CALL VmbFeatureCommandIsDone (
+    const VmbHandle_t handle, const char* name, VmbBool_t* pIsDone
+) {
+    MockHandle* mock;
+    MockFeature* feature;
+    VmbError_t err;
+
+    err = mock_lookup(handle, name, VmbFeatureDataCommand, &mock, &feature);
+    if (err == VmbErrorSuccess) {
+        *pIsDone = VmbBoolTrue;
+        pthread_mutex_unlock(&mock_lock);
+    }
+    return err;
+}
+
+VmbError_t VMB_CALL VmbFeatureInvalidationRegister (
+    VmbHandle_t handle, const char* name, VmbInvalidationCallback callback,
+    void* pUserContext
+) {
+    MockHandle* mock;
+    MockFeature* feature;
+    MockListener* listener;
+    VmbError_t err;
+
+    if (callback == NULL) {
+        return VmbErrorBadParameter;
+    }
+    err = mock_lookup(handle, name, VmbFeatureDataUnknown, &mock, &feature);
+    if (err != VmbErrorSuccess) {
+        return err;
+    }
+    for (listener = feature->listeners; listener; listener = listener->next) {
+        if (listener->callback == callback) {
+            pthread_mutex_unlock(&mock_lock);
+            return VmbErrorInvalidCall;
+        }
+    }
+    listener = calloc(1, sizeof(MockListener));
+    listener->callback = callback;
+    listener->context = pUserContext;
+    listener->next = feature->listeners;
+    feature->listeners = listener;
+    pthread_mutex_unlock(&mock_lock);
+    return VmbErrorSuccess;
+}
+
+VmbError_t VMB_CALL VmbFeatureInvalidationUnregister (
+    VmbHandle_t handle, const char* name, VmbInvalidationCallback callback
+) {
+    MockHandle* mock;
+    MockFeature* feature;
+    MockListener** link;
+    MockListener* listener;
+    VmbError_t err;
+
+    err = mock_lookup(handle, name, VmbFeatureDataUnknown, &mock, &feature);
+    if (err != VmbErrorSuccess) {
+        return err;
+    }
+    err = VmbErrorNotFound;
+    for (link = &feature->listeners; *link; link = &(*link)->next) {
+        if ((*link)->callback == callback) {
+            listener = *link;
+            *link = listener->next;
+            free(listener);
+            err = VmbErrorSuccess;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&mock_lock);
+    return err;
+}
+
+/* capture */
+
+static MockCamera* mock_lock_camera (VmbHandle_t cameraHandle) {
+    MockCamera* camera = (MockCamera*) cameraHandle;
+
+    pthread_mutex_lock(&mock_lock);
+    if (!mock_started || !mock_is_camera(cameraHandle) || !camera->open ||
+        camera->unplugged) {
+        pthread_mutex_unlock(&mock_lock);
+        return NULL;
+    }
+    return camera;
+}
+
+VmbError_t VMB_CALL VmbFrameAnnounce (
+    VmbHandle_t cameraHandle, const VmbFrame_t* pFrame, VmbUint32_t sizeofFrame
+) {
+    MockCamera* camera;
+
+    if (pFrame == NULL || pFrame->buffer == NULL) {
+        return VmbErrorBadParameter;
+    }
+    if (sizeofFrame != sizeof(VmbFrame_t)) {
+        return VmbErrorStructSize;
+    }
+    if ((camera = mock_lock_camera(cameraHandle)) == NULL) {
+        return VmbErrorBadHandle;
+    }
+    pthread_mutex_unlock(&mock_lock);
+    return VmbErrorSuccess;
+}
+
+VmbError_t VMB_CALL VmbFrameRevoke (
+    VmbHandle_t cameraHandle, const VmbFrame_t* pFrame
+) {
+    return VmbFrameRevokeAll(cameraHandle);
+}
+
+VmbError_t VMB_CALL VmbFrameRevokeAll (VmbHandle_t cameraHandle) {
+    MockCamera* camera;
+
+    if ((camera = mock_lock_camera(cameraHandle)) == NULL) {
+        return VmbErrorBadHandle;
+    }
+    camera->queue_length = 0;
+    pthread_mutex_unlock(&mock_lock);
+    return VmbErrorSuccess;
+}
+
+VmbError_t VMB_CALL VmbCaptureStart (VmbHandle_t cameraHandle) {
+    MockCamera* camera;
+
+    if ((camera = mock_lock_camera(cameraHandle)) == NULL) {
+        return VmbErrorBadHandle;
+    }
+    camera->capturing = 1;
+    pthread_mutex_unlock(&mock_lock);
+    return VmbErrorSuccess;
+}
+
+VmbError_t VMB_CALL VmbCaptureEnd (VmbHandle_t cameraHandle) {
+    MockCamera* camera;
+
+    if ((camera = mock_lock_camera(cameraHandle)) == NULL) {
+        return VmbErrorBadHandle;
+    }
+    camera->capturing = 0;
+    camera->queue_length = 0;
+    pthread_mutex_unlock(&mock_lock);
+    return VmbErrorSuccess;
+}
+
+VmbError_t VMB_CALL VmbCaptureFrameQueue (
+    VmbHandle_t cameraHandle, const VmbFrame_t* pFrame, VmbFrameCallback callback
+) {
+    MockCamera* camera;
+    int tail;
+
+    if (pFrame == NULL || pFrame->buffer == NULL) {
+        return VmbErrorBadParameter;
+    }
+    if ((camera = mock_lock_camera(cameraHandle)) == NULL) {
+        return VmbErrorBadHandle;
+    }
+    if (camera->queue_length == MOCK_MAX_QUEUED) {
+        pthread_mutex_unlock(&mock_lock);
+        return VmbErrorResources;
+    }
+    tail = (camera->queue_head + camera->queue_length) % MOCK_MAX_QUEUED;
+    camera->queue[tail].frame = (VmbFrame_t*) pFrame;
+    camera->queue[tail].callback = callback;
+    camera->queue_length++;
+    pthread_mutex_unlock(&mock_lock);
+    return VmbErrorSuccess;
+}
+
+VmbError_t VMB_CALL VmbCaptureFrameWait (
+    const VmbHandle_t cameraHandle, const VmbFrame_t* pFrame, VmbUint32_t timeout
+) {
+    MockCamera* camera;
+    int tail;
+
+    if ((camera = mock_lock_camera(cameraHandle)) == NULL) {
+        return VmbErrorBadHandle;
+    }
+    /* deliver the frame right away, without callback */
+    camera->queue_head = 0;
+    camera->queue_length = 0;
+    tail = 0;
+    camera->queue[tail].frame = (VmbFrame_t*) pFrame;
+    camera->queue[tail].callback = NULL;
+    camera->queue_length = 1;
+    pthread_mutex_unlock(&mock_lock);
+    mock_deliver(camera);
+    return VmbErrorSuccess;
+}
+
+VmbError_t VMB_CALL VmbCaptureQueueFlush (VmbHandle_t cameraHandle) {
+    MockCamera* camera;
+
+    if ((camera = mock_lock_camera(cameraHandle)) == NULL) {
+        return VmbErrorBadHandle;
+    }
+    camera->queue_length = 0;
+    pthread_mutex_unlock(&mock_lock);
+    return VmbErrorSuccess;
+}
+
+/* chunk data */
+
+VmbError_t VMB_CALL VmbAncillaryDataOpen (
+    VmbFrame_t* pFrame, VmbHandle_t* pAncillaryDataHandle
+) {
+    MockHandle* handle;
+    MockChunk chunk;
+
+    if (pFrame == NULL || pAncillaryDataHandle == NULL) {
+        return VmbErrorBadParameter;
+    }
+    if (pFrame->ancillarySize < sizeof(MockChunk)) {
+        return VmbErrorNotFound;
+    }
+    memcpy(&chunk, (unsigned char*) pFrame->buffer + pFrame->imageSize,
+        sizeof(chunk));
+    handle = calloc(1, sizeof(MockHandle));
+    handle->kind = MOCK_ANCILLARY;
+    mock_add_float(handle, "ChunkExposureTime", chunk.exposure_time, 0, 1e9);
+    mock_add_float(handle, "ChunkGain", chunk.gain, 0, 100);
+    mock_add_int(handle, "ChunkAcquisitionFrameCount", chunk.frame_counter,
+        0, INT64_MAX, 1);
+    mock_add_int(handle, "ChunkSyncInLevels", chunk.line_status, 0, 15, 1);
+    *pAncillaryDataHandle = (VmbHandle_t) handle;
+    return VmbErrorSuccess;
+}
+
+VmbError_t VMB_CALL VmbAncillaryDataClose (VmbHandle_t ancillaryDataHandle) {
+    MockHandle* handle = (MockHandle*) ancillaryDataHandle;
+
+    if (handle == NULL || handle->kind != MOCK_ANCILLARY) {
+        return VmbErrorBadHandle;
+    }
+    free(handle);
+    return VmbErrorSuccess;
+}
+
+/* settings, stored as one "name=value" line per writable feature */
+
+VmbError_t VMB_CALL VmbCameraSettingsSave (
+    const VmbHandle_t handle, const char* fileName,
+    VmbFeaturePersistSettings_t* pSettings, VmbUint32_t sizeofSettings
+) {
+    MockHandle* mock;
+    MockFeature* feature;
+    FILE* file;
+    int i;
+
+    if (fileName == NULL) {
+        return VmbErrorBadParameter;
+    }
+    if ((file = fopen(fileName, "w")) == NULL) {
+        return VmbErrorResources;
+    }
+    pthread_mutex_lock(&mock_lock);
+    if ((mock = mock_handle(handle)) == NULL) {
+        pthread_mutex_unlock(&mock_lock);
+        fclose(file);
+        return VmbErrorBadHandle;
+    }
+    for (i = 0; i < mock->feature_count; i++) {
+        feature = &mock->features[i];
+        if (!(feature->flags & VmbFeatureFlagsWrite)) {
+            continue;
+        }
+        switch (feature->type) {
+            case VmbFeatureDataInt:
+                fprintf(file, "%s=%lld\n", feature->name, feature->int_value);
+                break;
+            case VmbFeatureDataFloat:
+                fprintf(file, "%s=%.17g\n", feature->name, feature->float_value);
+                break;
+            case VmbFeatureDataBool:
+                fprintf(file, "%s=%s\n", feature->name,
+                    feature->bool_value ? "true" : "false");
+                break;
+            case VmbFeatureDataEnum:
+                fprintf(file, "%s=%s\n", feature->name, feature->enum_value);
+                break;
+            case VmbFeatureDataString:
+                fprintf(file, "%s=%s\n", feature->name, feature->string_value);
+                break;
+            default:
+                break;
+        }
+    }
+    pthread_mutex_unlock(&mock_lock);
+    fclose(file);
+    return VmbErrorSuccess;
+}
+
+VmbError_t VMB_CALL VmbCameraSettingsLoad (
+    const VmbHandle_t handle, const char* fileName,
+    VmbFeaturePersistSettings_t* pSettings, VmbUint32_t sizeofSettings
+) {
+    VmbFeatureInfo_t info;
+    char line[MOCK_STRING_SIZE + MOCK_NAME_SIZE];
+    char* value;
+    FILE* file;
+    VmbError_t err, result = VmbErrorSuccess;
+    VmbUint32_t iteration, iterations = 5;
+    int failed;
+
+    if (fileName == NULL) {
+        return VmbErrorBadParameter;
+    }
+    if (pSettings != NULL && pSettings->maxIterations > 0) {
+        iterations = pSettings->maxIterations;
+    }
+    /* features depending on each other may need several passes */
+    for (iteration = 0; iteration < iterations; iteration++) {
+        if ((file = fopen(fileName, "r")) == NULL) {
+            return VmbErrorNotFound;
+        }
+        failed = 0;
+        while (fgets(line, sizeof(line), file) != NULL) {
+            line[strcspn(line, "\r\n")] = '\0';
+            if ((value = strchr(line, '=')) == NULL) {
+                continue;
+            }
+            *value++ = '\0';
+            err = VmbFeatureInfoQuery(handle, line, &info, sizeof(info));
+            if (err != VmbErrorSuccess) {
+                continue;
+            }
+            switch (info.featureDataType) {
+                case VmbFeatureDataInt:
+                    err = VmbFeatureIntSet(handle, line, strtoll(value, NULL, 0));
+                    break;
+                case VmbFeatureDataFloat:
+                    err = VmbFeatureFloatSet(handle, line, strtod(value, NULL));
+                    break;
+                case VmbFeatureDataBool:
+                    err = VmbFeatureBoolSet(handle, line,
+                        strcmp(value, "true") == 0 ? VmbBoolTrue : VmbBoolFalse);
+                    break;
+                case VmbFeatureDataEnum:
+                    err = VmbFeatureEnumSet(handle, line, value);
+                    break;
+                case VmbFeatureDataString:
+                    err = VmbFeatureStringSet(handle, line, value);
+                    break;
+                default:
+                    break;
+            }
+            if (err != VmbErrorSuccess) {
+                failed = 1;
+                result = err;
+            }
+        }
+        fclose(file);
+        if (!failed) {
+            return VmbErrorSuccess;
+        }
+    }
+    return result;
+}
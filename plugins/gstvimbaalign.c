@@ -0,0 +1,602 @@
+/* GStreamer
+ * Copyright (C) 2015 Art+Com AG <info@artcom.de>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Suite 500,
+ * Boston, MA 02110-1335, USA.
+ */
+/**
+ * SECTION:element-gstvimbaalign
+ *
+ * The vimbaalign element collects one buffer from each of its sink pads into
+ * a set and pushes the set as a single multiview buffer. Buffers are matched
+ * by the trigger id vimbasrc stores in the buffer offset, or by the camera's
+ * device timestamp within a tolerance. In trigger id mode, sets with a
+ * buffer without trigger id are matched by timestamp within half a frame
+ * period. Each view is a separate memory of the
+ * output buffer, so nothing is copied. Sets that cannot be completed within
+ * the configured latency are dropped.
+ *
+ * <refsect2>
+ * <title>Example launch line</title>
+ * |[
+ * gst-launch-1.0 vimbaalign name=align latency=50000000 ! fakesink \
+ *     vimbasrc camera=DEV_A trigger-mode=action trigger-rate=10 ! align. \
+ *     vimbasrc camera=DEV_B trigger-mode=action ! align.
+ * ]|
+ * This pairs the frames of two cameras exposed by the same action command.
+ * </refsect2>
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+#include <gst/gst.h>
+#include <gst/video/video.h>
+#include "gstvimbasrc.h"
+#include "gstvimbaalign.h"
+
+GST_DEBUG_CATEGORY_STATIC (gst_vimba_align_debug_category);
+#define GST_CAT_DEFAULT gst_vimba_align_debug_category
+
+/* prototypes */
+
+static void gst_vimba_align_set_property (GObject * object,
+        guint property_id, const GValue * value, GParamSpec * pspec);
+static void gst_vimba_align_get_property (GObject * object,
+        guint property_id, GValue * value, GParamSpec * pspec);
+static void gst_vimba_align_finalize (GObject * object);
+static gboolean gst_vimba_align_start (GstAggregator * agg);
+static gboolean gst_vimba_align_stop (GstAggregator * agg);
+static gboolean gst_vimba_align_sink_event (GstAggregator * agg,
+        GstAggregatorPad * pad, GstEvent * event);
+static GstFlowReturn gst_vimba_align_update_src_caps (GstAggregator * agg,
+        GstCaps * caps, GstCaps ** ret);
+static GstFlowReturn gst_vimba_align_aggregate (GstAggregator * agg,
+        gboolean timeout);
+
+enum
+{
+    PROP_0,
+    PROP_MATCH,
+    PROP_TOLERANCE,
+    PROP_SETS_COMPLETED,
+    PROP_SETS_DROPPED
+};
+
+#define DEFAULT_MATCH GST_VIMBA_ALIGN_MATCH_TRIGGER_ID
+#define DEFAULT_TOLERANCE (GST_MSECOND)
+
+#define GST_TYPE_VIMBA_ALIGN_MATCH (gst_vimba_align_match_get_type())
+static GType
+gst_vimba_align_match_get_type (void)
+{
+    static GType match_type = 0;
+    static const GEnumValue matches[] = {
+        {GST_VIMBA_ALIGN_MATCH_TRIGGER_ID, "Trigger id (buffer offset)", "trigger-id"},
+        {GST_VIMBA_ALIGN_MATCH_DEVICE_TIMESTAMP, "Camera device timestamp", "device-timestamp"},
+        {0, NULL, NULL}
+    };
+
+    if (!match_type) {
+        match_type = g_enum_register_static("GstVimbaAlignMatch", matches);
+    }
+    return match_type;
+}
+
+/* pad templates */
+
+static GstStaticPadTemplate gst_vimba_align_sink_template =
+GST_STATIC_PAD_TEMPLATE ("sink_%u",
+    GST_PAD_SINK,
+    GST_PAD_REQUEST,
+    GST_STATIC_CAPS ("video/x-raw; video/x-bayer")
+);
+
+static GstStaticPadTemplate gst_vimba_align_src_template =
+GST_STATIC_PAD_TEMPLATE ("src",
+    GST_PAD_SRC,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS ("video/x-raw; video/x-bayer")
+);
+
+static GstStaticCaps device_timestamp_caps =
+    GST_STATIC_CAPS (GST_VIMBA_DEVICE_TIMESTAMP_CAPS);
+
+/* class initialization */
+
+G_DEFINE_TYPE_WITH_CODE (
+    GstVimbaAlign,
+    gst_vimba_align,
+    GST_TYPE_AGGREGATOR,
+    GST_DEBUG_CATEGORY_INIT (
+        gst_vimba_align_debug_category,
+        "vimbaalign",
+        0,
+        "debug category for vimbaalign element"
+    )
+);
+
+static void
+gst_vimba_align_class_init (GstVimbaAlignClass * klass)
+{
+    GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+    GstAggregatorClass *aggregator_class = GST_AGGREGATOR_CLASS (klass);
+
+    gst_element_class_add_static_pad_template_with_gtype (
+        GST_ELEMENT_CLASS(klass),
+        &gst_vimba_align_sink_template,
+        GST_TYPE_AGGREGATOR_PAD
+    );
+    gst_element_class_add_static_pad_template_with_gtype (
+        GST_ELEMENT_CLASS(klass),
+        &gst_vimba_align_src_template,
+        GST_TYPE_AGGREGATOR_PAD
+    );
+
+    gst_element_class_set_static_metadata (
+        GST_ELEMENT_CLASS(klass),
+        "VIMBA Frame Aligner",
+        "Filter/Video",
+        "Combines synchronized frames of several VIMBA cameras into one "
+        "multiview buffer",
+        "Art+Com AG <info@artcom.de>"
+    );
+
+    gobject_class->set_property = gst_vimba_align_set_property;
+    gobject_class->get_property = gst_vimba_align_get_property;
+    gobject_class->finalize = gst_vimba_align_finalize;
+    aggregator_class->start = GST_DEBUG_FUNCPTR (gst_vimba_align_start);
+    aggregator_class->stop = GST_DEBUG_FUNCPTR (gst_vimba_align_stop);
+    aggregator_class->sink_event = GST_DEBUG_FUNCPTR (gst_vimba_align_sink_event);
+    aggregator_class->update_src_caps =
+        GST_DEBUG_FUNCPTR (gst_vimba_align_update_src_caps);
+    aggregator_class->aggregate = GST_DEBUG_FUNCPTR (gst_vimba_align_aggregate);
+    aggregator_class->get_next_time = gst_aggregator_simple_get_next_time;
+
+    /* define properties */
+    g_object_class_install_property(
+        gobject_class,
+        PROP_MATCH,
+        g_param_spec_enum(
+            "match",
+            "Match",
+            "How buffers of the sink pads are paired into a set",
+            GST_TYPE_VIMBA_ALIGN_MATCH,
+            DEFAULT_MATCH,
+            G_PARAM_READWRITE
+        )
+    );
+
+    g_object_class_install_property(
+        gobject_class,
+        PROP_TOLERANCE,
+        g_param_spec_uint64(
+            "tolerance",
+            "Tolerance",
+            "Maximum difference of the device timestamps within a set in ns",
+            0,
+            G_MAXUINT64,
+            DEFAULT_TOLERANCE,
+            G_PARAM_READWRITE
+        )
+    );
+
+    g_object_class_install_property(
+        gobject_class,
+        PROP_SETS_COMPLETED,
+        g_param_spec_uint64(
+            "sets-completed",
+            "Sets completed",
+            "Number of complete sets pushed downstream",
+            0,
+            G_MAXUINT64,
+            0,
+            G_PARAM_READABLE
+        )
+    );
+
+    g_object_class_install_property(
+        gobject_class,
+        PROP_SETS_DROPPED,
+        g_param_spec_uint64(
+            "sets-dropped",
+            "Sets dropped",
+            "Number of sets dropped because a frame was missing or too late",
+            0,
+            G_MAXUINT64,
+            0,
+            G_PARAM_READABLE
+        )
+    );
+}
+
+static void
+gst_vimba_align_init (GstVimbaAlign *vimbaalign)
+{
+    vimbaalign->match = DEFAULT_MATCH;
+    vimbaalign->tolerance = DEFAULT_TOLERANCE;
+}
+
+void
+gst_vimba_align_set_property (GObject * object, guint property_id,
+        const GValue * value, GParamSpec * pspec)
+{
+    GstVimbaAlign *vimbaalign = GST_VIMBA_ALIGN (object);
+
+    switch (property_id) {
+        case PROP_MATCH:
+            GST_OBJECT_LOCK(vimbaalign);
+            vimbaalign->match = g_value_get_enum(value);
+            GST_OBJECT_UNLOCK(vimbaalign);
+            break;
+        case PROP_TOLERANCE:
+            GST_OBJECT_LOCK(vimbaalign);
+            vimbaalign->tolerance = g_value_get_uint64(value);
+            GST_OBJECT_UNLOCK(vimbaalign);
+            break;
+        default:
+            G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
+            break;
+    }
+}
+
+void
+gst_vimba_align_get_property (GObject * object, guint property_id,
+        GValue * value, GParamSpec * pspec)
+{
+    GstVimbaAlign *vimbaalign = GST_VIMBA_ALIGN (object);
+
+    GST_OBJECT_LOCK(vimbaalign);
+    switch (property_id) {
+        case PROP_MATCH:
+            g_value_set_enum(value, vimbaalign->match);
+            break;
+        case PROP_TOLERANCE:
+            g_value_set_uint64(value, vimbaalign->tolerance);
+            break;
+        case PROP_SETS_COMPLETED:
+            g_value_set_uint64(value, vimbaalign->sets_completed);
+            break;
+        case PROP_SETS_DROPPED:
+            g_value_set_uint64(value, vimbaalign->sets_dropped);
+            break;
+        default:
+            G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
+            break;
+    }
+    GST_OBJECT_UNLOCK(vimbaalign);
+}
+
+void
+gst_vimba_align_finalize (GObject * object)
+{
+    GstVimbaAlign *vimbaalign = GST_VIMBA_ALIGN (object);
+
+    gst_caps_replace(&vimbaalign->sink_caps, NULL);
+
+    G_OBJECT_CLASS (gst_vimba_align_parent_class)->finalize (object);
+}
+
+static gboolean
+gst_vimba_align_start (GstAggregator * agg)
+{
+    GstVimbaAlign *vimbaalign = GST_VIMBA_ALIGN (agg);
+
+    GST_OBJECT_LOCK(vimbaalign);
+    vimbaalign->sets_completed = 0;
+    vimbaalign->sets_dropped = 0;
+    GST_OBJECT_UNLOCK(vimbaalign);
+
+    return TRUE;
+}
+
+static gboolean
+gst_vimba_align_stop (GstAggregator * agg)
+{
+    GstVimbaAlign *vimbaalign = GST_VIMBA_ALIGN (agg);
+
+    GST_OBJECT_LOCK(vimbaalign);
+    gst_caps_replace(&vimbaalign->sink_caps, NULL);
+    GST_OBJECT_UNLOCK(vimbaalign);
+
+    return TRUE;
+}
+
+static gboolean
+gst_vimba_align_sink_event (GstAggregator * agg, GstAggregatorPad * pad,
+        GstEvent * event)
+{
+    GstVimbaAlign *vimbaalign = GST_VIMBA_ALIGN (agg);
+
+    if (GST_EVENT_TYPE(event) == GST_EVENT_CAPS) {
+        GstCaps *caps;
+
+        gst_event_parse_caps(event, &caps);
+        GST_OBJECT_LOCK(vimbaalign);
+        if (vimbaalign->sink_caps != NULL &&
+            !gst_caps_is_equal(vimbaalign->sink_caps, caps)) {
+            GST_WARNING_OBJECT(pad, "caps %" GST_PTR_FORMAT " differ from "
+                "the other pads", caps);
+        }
+        gst_caps_replace(&vimbaalign->sink_caps, caps);
+        GST_OBJECT_UNLOCK(vimbaalign);
+
+        gst_pad_mark_reconfigure(GST_AGGREGATOR_SRC_PAD(agg));
+        gst_event_unref(event);
+        return TRUE;
+    }
+
+    return GST_AGGREGATOR_CLASS (gst_vimba_align_parent_class)->sink_event(
+        agg, pad, event
+    );
+}
+
+static GstFlowReturn
+gst_vimba_align_update_src_caps (GstAggregator * agg, GstCaps * caps,
+        GstCaps ** ret)
+{
+    GstVimbaAlign *vimbaalign = GST_VIMBA_ALIGN (agg);
+    GstCaps *src_caps;
+
+    GST_OBJECT_LOCK(vimbaalign);
+    if (vimbaalign->sink_caps == NULL) {
+        GST_OBJECT_UNLOCK(vimbaalign);
+        return GST_AGGREGATOR_FLOW_NEED_DATA;
+    }
+    src_caps = gst_caps_copy(vimbaalign->sink_caps);
+    vimbaalign->n_views = GST_ELEMENT_CAST(agg)->numsinkpads;
+    GST_OBJECT_UNLOCK(vimbaalign);
+
+    gst_caps_set_simple(src_caps,
+        "multiview-mode", G_TYPE_STRING,
+        gst_video_multiview_mode_to_caps_string(
+            GST_VIDEO_MULTIVIEW_MODE_SEPARATED
+        ),
+        "views", G_TYPE_INT, (gint) vimbaalign->n_views,
+        NULL
+    );
+
+    *ret = gst_caps_intersect(caps, src_caps);
+    gst_caps_unref(src_caps);
+    if (gst_caps_is_empty(*ret)) {
+        gst_caps_unref(*ret);
+        *ret = NULL;
+        return GST_FLOW_NOT_NEGOTIATED;
+    }
+    return GST_FLOW_OK;
+}
+
+/* the value buffers of one set have in common */
+static guint64
+gst_vimba_align_buffer_key (GstBuffer * buf, gboolean by_trigger_id)
+{
+    GstReferenceTimestampMeta *meta;
+    GstCaps *caps;
+
+    if (by_trigger_id) {
+        return GST_BUFFER_OFFSET(buf);
+    }
+
+    caps = gst_static_caps_get(&device_timestamp_caps);
+    meta = gst_buffer_get_reference_timestamp_meta(buf, caps);
+    gst_caps_unref(caps);
+    if (meta != NULL) {
+        return meta->timestamp;
+    }
+    return GST_BUFFER_PTS(buf);
+}
+
+/* half the frame period of the sink caps, the tolerance property without a
+ * frame rate, must be called with the object lock held */
+static GstClockTime
+gst_vimba_align_half_period (GstVimbaAlign * vimbaalign)
+{
+    gint num = 0, denom = 1;
+
+    if (vimbaalign->sink_caps == NULL ||
+        gst_caps_get_size(vimbaalign->sink_caps) == 0 ||
+        !gst_structure_get_fraction(
+            gst_caps_get_structure(vimbaalign->sink_caps, 0),
+            "framerate", &num, &denom) || num <= 0) {
+        return vimbaalign->tolerance;
+    }
+    return gst_util_uint64_scale_int(GST_SECOND, denom, 2 * num);
+}
+
+/* drop the head buffer of every pad that has one */
+static gboolean
+gst_vimba_align_drop_heads (GList * pads)
+{
+    gboolean dropped = FALSE;
+    GList *l;
+
+    for (l = pads; l != NULL; l = l->next) {
+        dropped |= gst_aggregator_pad_drop_buffer(l->data);
+    }
+    return dropped;
+}
+
+static GstFlowReturn
+gst_vimba_align_push_set (GstVimbaAlign * vimbaalign, GList * pads)
+{
+    GstAggregator *agg = GST_AGGREGATOR (vimbaalign);
+    GstBuffer *out = gst_buffer_new();
+    GstClockTime pts = GST_CLOCK_TIME_NONE;
+    GstVideoInfo info;
+    gboolean have_info = FALSE;
+    gsize offset = 0;
+    guint view = 0;
+    GList *l;
+
+    GST_OBJECT_LOCK(vimbaalign);
+    if (vimbaalign->sink_caps != NULL) {
+        have_info = gst_video_info_from_caps(&info, vimbaalign->sink_caps);
+    }
+    GST_OBJECT_UNLOCK(vimbaalign);
+
+    for (l = pads; l != NULL; l = l->next, view++) {
+        GstBuffer *buf = gst_aggregator_pad_pop_buffer(l->data);
+
+        if (view == 0) {
+            gst_buffer_copy_into(out, buf, GST_BUFFER_COPY_METADATA, 0, -1);
+        }
+        if (GST_BUFFER_PTS_IS_VALID(buf) &&
+            (pts == GST_CLOCK_TIME_NONE || GST_BUFFER_PTS(buf) < pts)) {
+            pts = GST_BUFFER_PTS(buf);
+        }
+        /* every view keeps its own memory */
+        gst_buffer_copy_into(out, buf, GST_BUFFER_COPY_MEMORY, 0, -1);
+        if (have_info) {
+            gsize offsets[GST_VIDEO_MAX_PLANES];
+            GstVideoMeta *meta;
+            guint plane;
+
+            for (plane = 0; plane < GST_VIDEO_INFO_N_PLANES(&info); plane++) {
+                offsets[plane] = offset + GST_VIDEO_INFO_PLANE_OFFSET(&info, plane);
+            }
+            meta = gst_buffer_add_video_meta_full(out,
+                GST_VIDEO_FRAME_FLAG_NONE,
+                GST_VIDEO_INFO_FORMAT(&info),
+                GST_VIDEO_INFO_WIDTH(&info),
+                GST_VIDEO_INFO_HEIGHT(&info),
+                GST_VIDEO_INFO_N_PLANES(&info),
+                offsets,
+                info.stride
+            );
+            meta->id = view;
+        }
+        offset += gst_buffer_get_size(buf);
+        gst_buffer_unref(buf);
+    }
+
+    GST_BUFFER_PTS(out) = pts;
+    GST_BUFFER_DTS(out) = pts;
+    if (GST_CLOCK_TIME_IS_VALID(pts)) {
+        GST_AGGREGATOR_PAD(agg->srcpad)->segment.position = pts;
+    }
+
+    GST_OBJECT_LOCK(vimbaalign);
+    vimbaalign->sets_completed++;
+    GST_OBJECT_UNLOCK(vimbaalign);
+
+    GST_LOG_OBJECT(vimbaalign, "pushing set of %u views at %" GST_TIME_FORMAT,
+        view, GST_TIME_ARGS(pts));
+    return gst_aggregator_finish_buffer(agg, out);
+}
+
+static GstFlowReturn
+gst_vimba_align_aggregate (GstAggregator * agg, gboolean timeout)
+{
+    GstVimbaAlign *vimbaalign = GST_VIMBA_ALIGN (agg);
+    GstFlowReturn ret = GST_FLOW_OK;
+    GstClockTime tolerance, half_period;
+    guint n_pads = 0, n_heads = 0, n_eos = 0;
+    guint64 newest = 0;
+    gboolean stale = FALSE, by_trigger_id;
+    GList *pads, *l;
+
+    GST_OBJECT_LOCK(agg);
+    pads = g_list_copy_deep(GST_ELEMENT_CAST(agg)->sinkpads,
+        (GCopyFunc) gst_object_ref, NULL);
+    by_trigger_id = vimbaalign->match == GST_VIMBA_ALIGN_MATCH_TRIGGER_ID;
+    tolerance = vimbaalign->tolerance;
+    half_period = gst_vimba_align_half_period(vimbaalign);
+    GST_OBJECT_UNLOCK(agg);
+
+    /* trigger ids only compare among buffers that all have one, the others
+     * are matched by timestamp, no closer than half a frame period */
+    if (by_trigger_id) {
+        for (l = pads; l != NULL; l = l->next) {
+            GstBuffer *buf = gst_aggregator_pad_peek_buffer(l->data);
+
+            if (buf != NULL) {
+                by_trigger_id &= GST_BUFFER_OFFSET_IS_VALID(buf);
+                gst_buffer_unref(buf);
+            }
+        }
+        tolerance = by_trigger_id ? 0 : half_period;
+    }
+
+    /* the newest head buffer decides which set is being assembled */
+    for (l = pads; l != NULL; l = l->next) {
+        GstBuffer *buf = gst_aggregator_pad_peek_buffer(l->data);
+        guint64 key;
+
+        n_pads++;
+        if (buf == NULL) {
+            if (gst_aggregator_pad_is_eos(l->data)) {
+                n_eos++;
+            }
+            continue;
+        }
+        key = gst_vimba_align_buffer_key(buf, by_trigger_id);
+        if (n_heads == 0 || key > newest) {
+            newest = key;
+        }
+        n_heads++;
+        gst_buffer_unref(buf);
+    }
+
+    /* pads were added or released since the caps were negotiated */
+    if (n_pads != vimbaalign->n_views) {
+        gst_pad_mark_reconfigure(GST_AGGREGATOR_SRC_PAD(agg));
+    }
+
+    if (n_pads == 0 || (n_heads == 0 && n_eos > 0)) {
+        ret = n_pads > 0 && n_eos == n_pads ? GST_FLOW_EOS : GST_FLOW_OK;
+        goto done;
+    }
+
+    /* heads older than the newest one can never complete a set */
+    for (l = pads; l != NULL; l = l->next) {
+        GstBuffer *buf = gst_aggregator_pad_peek_buffer(l->data);
+
+        if (buf == NULL) {
+            continue;
+        }
+        if (gst_vimba_align_buffer_key(buf, by_trigger_id) + tolerance <
+            newest) {
+            GST_DEBUG_OBJECT(l->data, "dropping stale buffer %" GST_PTR_FORMAT,
+                buf);
+            gst_aggregator_pad_drop_buffer(l->data);
+            stale = TRUE;
+            n_heads--;
+        }
+        gst_buffer_unref(buf);
+    }
+
+    if (n_heads == n_pads && !stale) {
+        ret = gst_vimba_align_push_set(vimbaalign, pads);
+        goto done;
+    }
+
+    /* a set that cannot be completed in time is given up */
+    if (!stale && (timeout || n_eos > 0) && n_heads > 0) {
+        GST_DEBUG_OBJECT(vimbaalign, "dropping incomplete set, %u of %u "
+            "frames", n_heads, n_pads);
+        stale = gst_vimba_align_drop_heads(pads);
+    }
+    if (stale) {
+        GST_OBJECT_LOCK(vimbaalign);
+        vimbaalign->sets_dropped++;
+        GST_OBJECT_UNLOCK(vimbaalign);
+    }
+
+done:
+    g_list_free_full(pads, gst_object_unref);
+    return ret;
+}
@@ -0,0 +1,66 @@
+/* GStreamer
+ * Copyright (C) 2015 Art+Com AG <info@artcom.de>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef _GST_VIMBA_ALIGN_H_
+#define _GST_VIMBA_ALIGN_H_
+
+#include <gst/base/gstaggregator.h>
+
+G_BEGIN_DECLS
+
+#define GST_TYPE_VIMBA_ALIGN   (gst_vimba_align_get_type())
+#define GST_VIMBA_ALIGN(obj)   (G_TYPE_CHECK_INSTANCE_CAST((obj),GST_TYPE_VIMBA_ALIGN,GstVimbaAlign))
+#define GST_VIMBA_ALIGN_CLASS(klass)   (G_TYPE_CHECK_CLASS_CAST((klass),GST_TYPE_VIMBA_ALIGN,GstVimbaAlignClass))
+#define GST_IS_VIMBA_ALIGN(obj)   (G_TYPE_CHECK_INSTANCE_TYPE((obj),GST_TYPE_VIMBA_ALIGN))
+#define GST_IS_VIMBA_ALIGN_CLASS(obj)   (G_TYPE_CHECK_CLASS_TYPE((klass),GST_TYPE_VIMBA_ALIGN))
+
+typedef struct _GstVimbaAlign GstVimbaAlign;
+typedef struct _GstVimbaAlignClass GstVimbaAlignClass;
+
+/* how buffers of the sink pads are matched into a set */
+typedef enum {
+    GST_VIMBA_ALIGN_MATCH_TRIGGER_ID,
+    GST_VIMBA_ALIGN_MATCH_DEVICE_TIMESTAMP
+} GstVimbaAlignMatch;
+
+struct _GstVimbaAlign
+{
+    GstAggregator      base_vimbaalign;
+
+    GstVimbaAlignMatch match;
+    GstClockTime       tolerance;
+
+    /* caps of the sink pads, all pads have to agree */
+    GstCaps*           sink_caps;
+    guint              n_views;
+
+    guint64            sets_completed;
+    guint64            sets_dropped;
+};
+
+struct _GstVimbaAlignClass
+{
+    GstAggregatorClass base_vimbaalign_class;
+};
+
+GType gst_vimba_align_get_type (void);
+
+G_END_DECLS
+
+#endif
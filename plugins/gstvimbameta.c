@@ -0,0 +1,95 @@
+/* GStreamer
+ * Copyright (C) 2015 Art+Com AG <info@artcom.de>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Suite 500,
+ * Boston, MA 02110-1335, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+#include "gstvimbameta.h"
+
+GType
+gst_vimba_frame_meta_api_get_type (void)
+{
+    static gsize type = 0;
+    static const gchar *tags[] = { NULL };
+
+    if (g_once_init_enter(&type)) {
+        GType _type = gst_meta_api_type_register("GstVimbaFrameMetaAPI", tags);
+        g_once_init_leave(&type, _type);
+    }
+    return (GType) type;
+}
+
+static gboolean
+gst_vimba_frame_meta_init (GstMeta * meta, gpointer params, GstBuffer * buffer)
+{
+    GstVimbaFrameMeta *vmeta = (GstVimbaFrameMeta *) meta;
+
+    memset((guint8 *) vmeta + sizeof(GstMeta), 0,
+        sizeof(GstVimbaFrameMeta) - sizeof(GstMeta));
+    return TRUE;
+}
+
+static gboolean
+gst_vimba_frame_meta_transform (GstBuffer * dest, GstMeta * meta,
+        GstBuffer * buffer, GQuark type, gpointer data)
+{
+    GstVimbaFrameMeta *smeta = (GstVimbaFrameMeta *) meta;
+    GstVimbaFrameMeta *dmeta;
+
+    /* the values describe the whole frame, so only plain copies keep them */
+    if (!GST_META_TRANSFORM_IS_COPY(type)) {
+        return FALSE;
+    }
+    dmeta = gst_buffer_add_vimba_frame_meta(dest);
+    if (dmeta == NULL) {
+        return FALSE;
+    }
+    memcpy((guint8 *) dmeta + sizeof(GstMeta), (guint8 *) smeta + sizeof(GstMeta),
+        sizeof(GstVimbaFrameMeta) - sizeof(GstMeta));
+    return TRUE;
+}
+
+const GstMetaInfo *
+gst_vimba_frame_meta_get_info (void)
+{
+    static const GstMetaInfo *meta_info = NULL;
+
+    if (g_once_init_enter((GstMetaInfo **) &meta_info)) {
+        const GstMetaInfo *mi = gst_meta_register(
+            GST_VIMBA_FRAME_META_API_TYPE,
+            "GstVimbaFrameMeta",
+            sizeof(GstVimbaFrameMeta),
+            gst_vimba_frame_meta_init,
+            NULL,
+            gst_vimba_frame_meta_transform
+        );
+        g_once_init_leave((GstMetaInfo **) &meta_info, (GstMetaInfo *) mi);
+    }
+    return meta_info;
+}
+
+GstVimbaFrameMeta *
+gst_buffer_add_vimba_frame_meta (GstBuffer * buffer)
+{
+    return (GstVimbaFrameMeta *) gst_buffer_add_meta(
+        buffer, GST_VIMBA_FRAME_META_INFO, NULL
+    );
+}
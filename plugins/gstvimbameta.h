@@ -0,0 +1,85 @@
+/* GStreamer
+ * Copyright (C) 2015 Art+Com AG <info@artcom.de>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef _GST_VIMBA_META_H_
+#define _GST_VIMBA_META_H_
+
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+#define GST_VIMBA_FRAME_META_API_TYPE (gst_vimba_frame_meta_api_get_type())
+#define GST_VIMBA_FRAME_META_INFO (gst_vimba_frame_meta_get_info())
+
+typedef struct _GstVimbaFrameMeta GstVimbaFrameMeta;
+
+/**
+ * GstVimbaFrameMeta:
+ * @meta: parent #GstMeta
+ * @frame_id: frame id assigned by the camera
+ * @device_timestamp: camera timestamp of the frame in nanoseconds
+ * @trigger_id: id shared by frames of the same action command
+ * @receive_status: VmbFrameStatus_t of the frame
+ * @has_chunk: whether the chunk fields below were read from the frame
+ * @exposure_time: exposure time of the frame in microseconds
+ * @gain: gain applied to the frame
+ * @frame_counter: acquisition frame counter of the camera
+ * @line_status: levels of the input lines when the frame was exposed
+ * @callback_time: monotonic time (gst_util_get_timestamp()) the SDK
+ *   delivered the frame
+ * @dequeue_time: monotonic time vimbasrc took the frame from the queue
+ * @push_time: monotonic time vimbasrc handed the buffer on for pushing
+ * @feature_generation: generation of the last feature write in effect for
+ *   the frame, as returned by the feature-generation property after it
+ *
+ * Per frame information delivered by the camera together with the image,
+ * so downstream does not have to query features for every frame.
+ */
+struct _GstVimbaFrameMeta {
+    GstMeta  meta;
+
+    guint64  frame_id;
+    guint64  device_timestamp;
+    guint64  trigger_id;
+    gint     receive_status;
+
+    gboolean has_chunk;
+    gdouble  exposure_time;
+    gdouble  gain;
+    guint64  frame_counter;
+    guint32  line_status;
+
+    GstClockTime callback_time;
+    GstClockTime dequeue_time;
+    GstClockTime push_time;
+
+    guint64  feature_generation;
+};
+
+GType gst_vimba_frame_meta_api_get_type (void);
+const GstMetaInfo * gst_vimba_frame_meta_get_info (void);
+
+#define gst_buffer_get_vimba_frame_meta(b) \
+    ((GstVimbaFrameMeta*)gst_buffer_get_meta((b),GST_VIMBA_FRAME_META_API_TYPE))
+
+GstVimbaFrameMeta * gst_buffer_add_vimba_frame_meta (GstBuffer * buffer);
+
+G_END_DECLS
+
+#endif
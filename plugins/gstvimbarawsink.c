@@ -0,0 +1,841 @@
+/* GStreamer
+ * Copyright (C) 2015 Art+Com AG <info@artcom.de>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Suite 500,
+ * Boston, MA 02110-1335, USA.
+ */
+/**
+ * SECTION:element-gstvimbarawsink
+ *
+ * The vimbarawsink element records raw frames into a directory of
+ * preallocated segment files and an index with one fixed size entry per
+ * frame (frame id, device timestamp, pts, segment, offset, size, status).
+ * Frames are copied into a shared mapping of the segment, which the kernel
+ * writes back from the page cache, or written with O_DIRECT past the page
+ * cache. Every frame starts on a page boundary so a recording can be mapped
+ * and seeked directly afterwards, see vimbareplaysrc. With compression=lz4 frames are
+ * compressed by a pool of worker threads and still written in order.
+ *
+ * <refsect2>
+ * <title>Example launch line</title>
+ * |[
+ * gst-launch-1.0 vimbasrc camera=DEV_A drop-incomplete=false ! \
+ *     vimbarawsink location=/data/run1 io-mode=direct
+ * ]|
+ * </refsect2>
+ */
+
+#define _GNU_SOURCE
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <glib/gstdio.h>
+#include <gst/gst.h>
+#ifdef HAVE_LZ4
+#include <lz4.h>
+#endif
+#include "gstvimbameta.h"
+#include "gstvimbarawsink.h"
+
+#ifndef O_DIRECT
+#define O_DIRECT 0
+#endif
+
+GST_DEBUG_CATEGORY_STATIC (gst_vimba_raw_sink_debug_category);
+#define GST_CAT_DEFAULT gst_vimba_raw_sink_debug_category
+
+/* prototypes */
+
+static void gst_vimba_raw_sink_set_property (GObject * object,
+        guint property_id, const GValue * value, GParamSpec * pspec);
+static void gst_vimba_raw_sink_get_property (GObject * object,
+        guint property_id, GValue * value, GParamSpec * pspec);
+static void gst_vimba_raw_sink_finalize (GObject * object);
+static gboolean gst_vimba_raw_sink_start (GstBaseSink * sink);
+static gboolean gst_vimba_raw_sink_stop (GstBaseSink * sink);
+static gboolean gst_vimba_raw_sink_set_caps (GstBaseSink * sink, GstCaps * caps);
+static gboolean gst_vimba_raw_sink_event (GstBaseSink * sink, GstEvent * event);
+static GstFlowReturn gst_vimba_raw_sink_render (GstBaseSink * sink,
+        GstBuffer * buffer);
+
+enum
+{
+    PROP_0,
+    PROP_LOCATION,
+    PROP_SEGMENT_SIZE,
+    PROP_IO_MODE,
+    PROP_COMPRESSION,
+    PROP_COMPRESSION_THREADS,
+    PROP_FRAMES_WRITTEN,
+    PROP_BYTES_WRITTEN
+};
+
+#define DEFAULT_SEGMENT_SIZE (G_GUINT64_CONSTANT(1) << 30)
+#define DEFAULT_COMPRESSION_THREADS 4
+/* frames waiting for a worker before render blocks */
+#define JOBS_PER_THREAD 2
+
+#define ALIGN_UP(x) (((x) + VIMBA_RAW_ALIGN - 1) & ~((guint64) VIMBA_RAW_ALIGN - 1))
+/* the largest aligned file size, ALIGN_UP of it does not wrap */
+#define MAX_SEGMENT_SIZE ((guint64) G_MAXINT64 & ~((guint64) VIMBA_RAW_ALIGN - 1))
+
+typedef struct {
+    guint64             seq;
+    GstBuffer          *buffer;
+    VimbaRawIndexEntry  entry;
+    /* compressed frame, NULL writes the buffer as it is */
+    guint8             *data;
+} GstVimbaRawJob;
+
+#define GST_TYPE_VIMBA_RAW_IO_MODE (gst_vimba_raw_io_mode_get_type())
+static GType
+gst_vimba_raw_io_mode_get_type (void)
+{
+    static GType io_mode_type = 0;
+    static const GEnumValue io_modes[] = {
+        {GST_VIMBA_RAW_IO_MMAP, "Copy into a shared mapping of the segment", "mmap"},
+        {GST_VIMBA_RAW_IO_DIRECT, "Write with O_DIRECT, bypassing the page cache", "direct"},
+        {0, NULL, NULL}
+    };
+
+    if (!io_mode_type) {
+        io_mode_type = g_enum_register_static("GstVimbaRawIoMode", io_modes);
+    }
+    return io_mode_type;
+}
+
+#define GST_TYPE_VIMBA_RAW_COMPRESSION (gst_vimba_raw_compression_get_type())
+static GType
+gst_vimba_raw_compression_get_type (void)
+{
+    static GType compression_type = 0;
+    static const GEnumValue compressions[] = {
+        {GST_VIMBA_RAW_COMPRESSION_NONE, "Store frames as they are", "none"},
+        {GST_VIMBA_RAW_COMPRESSION_LZ4, "LZ4 on worker threads", "lz4"},
+        {0, NULL, NULL}
+    };
+
+    if (!compression_type) {
+        compression_type = g_enum_register_static(
+            "GstVimbaRawCompression", compressions
+        );
+    }
+    return compression_type;
+}
+
+/* pad templates */
+
+static GstStaticPadTemplate gst_vimba_raw_sink_sink_template =
+GST_STATIC_PAD_TEMPLATE ("sink",
+    GST_PAD_SINK,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS_ANY
+);
+
+/* class initialization */
+
+G_DEFINE_TYPE_WITH_CODE (
+    GstVimbaRawSink,
+    gst_vimba_raw_sink,
+    GST_TYPE_BASE_SINK,
+    GST_DEBUG_CATEGORY_INIT (
+        gst_vimba_raw_sink_debug_category,
+        "vimbarawsink",
+        0,
+        "debug category for vimbarawsink element"
+    )
+);
+
+static void
+gst_vimba_raw_sink_class_init (GstVimbaRawSinkClass * klass)
+{
+    GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+    GstBaseSinkClass *base_sink_class = GST_BASE_SINK_CLASS (klass);
+
+    gst_element_class_add_pad_template (GST_ELEMENT_CLASS(klass),
+            gst_static_pad_template_get (&gst_vimba_raw_sink_sink_template));
+
+    gst_element_class_set_static_metadata (
+        GST_ELEMENT_CLASS(klass),
+        "VIMBA Raw Recorder",
+        "Sink/File",
+        "Records raw camera frames into indexed segment files",
+        "Art+Com AG <info@artcom.de>"
+    );
+
+    gobject_class->set_property = gst_vimba_raw_sink_set_property;
+    gobject_class->get_property = gst_vimba_raw_sink_get_property;
+    gobject_class->finalize = gst_vimba_raw_sink_finalize;
+    base_sink_class->start = GST_DEBUG_FUNCPTR (gst_vimba_raw_sink_start);
+    base_sink_class->stop = GST_DEBUG_FUNCPTR (gst_vimba_raw_sink_stop);
+    base_sink_class->set_caps = GST_DEBUG_FUNCPTR (gst_vimba_raw_sink_set_caps);
+    base_sink_class->event = GST_DEBUG_FUNCPTR (gst_vimba_raw_sink_event);
+    base_sink_class->render = GST_DEBUG_FUNCPTR (gst_vimba_raw_sink_render);
+
+    g_object_class_install_property(
+        gobject_class,
+        PROP_LOCATION,
+        g_param_spec_string(
+            "location",
+            "Location",
+            "Directory the recording is written to, created if needed",
+            NULL,
+            G_PARAM_READWRITE
+        )
+    );
+
+    g_object_class_install_property(
+        gobject_class,
+        PROP_SEGMENT_SIZE,
+        g_param_spec_uint64(
+            "segment-size",
+            "Segment size",
+            "Bytes preallocated for every segment file",
+            VIMBA_RAW_ALIGN,
+            MAX_SEGMENT_SIZE,
+            DEFAULT_SEGMENT_SIZE,
+            G_PARAM_READWRITE
+        )
+    );
+
+    g_object_class_install_property(
+        gobject_class,
+        PROP_IO_MODE,
+        g_param_spec_enum(
+            "io-mode",
+            "IO mode",
+            "How frames are written to the segment files",
+            GST_TYPE_VIMBA_RAW_IO_MODE,
+            GST_VIMBA_RAW_IO_MMAP,
+            G_PARAM_READWRITE
+        )
+    );
+
+    g_object_class_install_property(
+        gobject_class,
+        PROP_COMPRESSION,
+        g_param_spec_enum(
+            "compression",
+            "Compression",
+            "Compression of the frame data (lz4 needs a build with liblz4)",
+            GST_TYPE_VIMBA_RAW_COMPRESSION,
+            GST_VIMBA_RAW_COMPRESSION_NONE,
+            G_PARAM_READWRITE
+        )
+    );
+
+    g_object_class_install_property(
+        gobject_class,
+        PROP_COMPRESSION_THREADS,
+        g_param_spec_uint(
+            "compression-threads",
+            "Compression threads",
+            "Worker threads compressing frames",
+            1,
+            64,
+            DEFAULT_COMPRESSION_THREADS,
+            G_PARAM_READWRITE
+        )
+    );
+
+    g_object_class_install_property(
+        gobject_class,
+        PROP_FRAMES_WRITTEN,
+        g_param_spec_uint64(
+            "frames-written",
+            "Frames written",
+            "Frames recorded since start",
+            0,
+            G_MAXUINT64,
+            0,
+            G_PARAM_READABLE
+        )
+    );
+
+    g_object_class_install_property(
+        gobject_class,
+        PROP_BYTES_WRITTEN,
+        g_param_spec_uint64(
+            "bytes-written",
+            "Bytes written",
+            "Bytes of frame data stored since start, after compression",
+            0,
+            G_MAXUINT64,
+            0,
+            G_PARAM_READABLE
+        )
+    );
+}
+
+static void
+gst_vimba_raw_sink_init (GstVimbaRawSink *rawsink)
+{
+    g_mutex_init(&rawsink->write_lock);
+    g_cond_init(&rawsink->write_cond);
+    rawsink->segment_size = DEFAULT_SEGMENT_SIZE;
+    rawsink->io_mode = GST_VIMBA_RAW_IO_MMAP;
+    rawsink->compression = GST_VIMBA_RAW_COMPRESSION_NONE;
+    rawsink->compression_threads = DEFAULT_COMPRESSION_THREADS;
+    rawsink->index_fd = -1;
+    rawsink->segment_fd = -1;
+
+    /* a recorder keeps up as fast as it can instead of following the clock */
+    gst_base_sink_set_sync(GST_BASE_SINK(rawsink), FALSE);
+}
+
+void
+gst_vimba_raw_sink_set_property (GObject * object, guint property_id,
+        const GValue * value, GParamSpec * pspec)
+{
+    GstVimbaRawSink *rawsink = GST_VIMBA_RAW_SINK (object);
+
+    GST_OBJECT_LOCK(rawsink);
+    switch (property_id) {
+        case PROP_LOCATION:
+            g_free(rawsink->location);
+            rawsink->location = g_value_dup_string(value);
+            break;
+        case PROP_SEGMENT_SIZE:
+            rawsink->segment_size = ALIGN_UP(g_value_get_uint64(value));
+            break;
+        case PROP_IO_MODE:
+            rawsink->io_mode = g_value_get_enum(value);
+            break;
+        case PROP_COMPRESSION:
+            rawsink->compression = g_value_get_enum(value);
+            break;
+        case PROP_COMPRESSION_THREADS:
+            rawsink->compression_threads = g_value_get_uint(value);
+            break;
+        default:
+            G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
+            break;
+    }
+    GST_OBJECT_UNLOCK(rawsink);
+}
+
+void
+gst_vimba_raw_sink_get_property (GObject * object, guint property_id,
+        GValue * value, GParamSpec * pspec)
+{
+    GstVimbaRawSink *rawsink = GST_VIMBA_RAW_SINK (object);
+
+    switch (property_id) {
+        case PROP_LOCATION:
+            GST_OBJECT_LOCK(rawsink);
+            g_value_set_string(value, rawsink->location);
+            GST_OBJECT_UNLOCK(rawsink);
+            break;
+        case PROP_SEGMENT_SIZE:
+            g_value_set_uint64(value, rawsink->segment_size);
+            break;
+        case PROP_IO_MODE:
+            g_value_set_enum(value, rawsink->io_mode);
+            break;
+        case PROP_COMPRESSION:
+            g_value_set_enum(value, rawsink->compression);
+            break;
+        case PROP_COMPRESSION_THREADS:
+            g_value_set_uint(value, rawsink->compression_threads);
+            break;
+        case PROP_FRAMES_WRITTEN:
+            g_mutex_lock(&rawsink->write_lock);
+            g_value_set_uint64(value, rawsink->frames_written);
+            g_mutex_unlock(&rawsink->write_lock);
+            break;
+        case PROP_BYTES_WRITTEN:
+            g_mutex_lock(&rawsink->write_lock);
+            g_value_set_uint64(value, rawsink->bytes_written);
+            g_mutex_unlock(&rawsink->write_lock);
+            break;
+        default:
+            G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
+            break;
+    }
+}
+
+void
+gst_vimba_raw_sink_finalize (GObject * object)
+{
+    GstVimbaRawSink *rawsink = GST_VIMBA_RAW_SINK (object);
+
+    g_free(rawsink->location);
+    g_mutex_clear(&rawsink->write_lock);
+    g_cond_clear(&rawsink->write_cond);
+
+    G_OBJECT_CLASS (gst_vimba_raw_sink_parent_class)->finalize (object);
+}
+
+/* segments */
+
+/* must be called with write_lock held */
+static void
+gst_vimba_raw_sink_close_segment (GstVimbaRawSink * rawsink)
+{
+    if (rawsink->segment_map != NULL) {
+        munmap(rawsink->segment_map, rawsink->segment_size);
+        rawsink->segment_map = NULL;
+    }
+    if (rawsink->segment_fd >= 0) {
+        /* give back what the last segment did not use */
+        if (ftruncate(rawsink->segment_fd, rawsink->segment_offset) != 0) {
+            GST_WARNING_OBJECT(rawsink, "cannot truncate segment %u: %s",
+                rawsink->segment, g_strerror(errno));
+        }
+        close(rawsink->segment_fd);
+        rawsink->segment_fd = -1;
+    }
+}
+
+/* must be called with write_lock held */
+static gboolean
+gst_vimba_raw_sink_open_segment (GstVimbaRawSink * rawsink, guint32 segment)
+{
+    gchar *name = g_strdup_printf(VIMBA_RAW_SEGMENT_FORMAT, segment);
+    gchar *path = g_build_filename(rawsink->location, name, NULL);
+    int flags = O_RDWR | O_CREAT | O_TRUNC;
+    int err;
+
+    g_free(name);
+    if (rawsink->io_mode == GST_VIMBA_RAW_IO_DIRECT) {
+        rawsink->segment_fd = open(path, flags | O_DIRECT, 0644);
+        if (rawsink->segment_fd < 0 && errno == EINVAL) {
+            /* e.g. tmpfs, fall back to buffered writes */
+            GST_WARNING_OBJECT(rawsink, "%s does not support O_DIRECT", path);
+            rawsink->segment_fd = open(path, flags, 0644);
+        }
+    } else {
+        rawsink->segment_fd = open(path, flags, 0644);
+    }
+    if (rawsink->segment_fd < 0) {
+        GST_ELEMENT_ERROR(rawsink, RESOURCE, OPEN_WRITE,
+            ("Could not open segment \"%s\" for writing.", path),
+            GST_ERROR_SYSTEM);
+        g_free(path);
+        return FALSE;
+    }
+
+    /* reserve the whole segment up front so writing never waits for it */
+    err = posix_fallocate(rawsink->segment_fd, 0, rawsink->segment_size);
+    if (err != 0 && ftruncate(rawsink->segment_fd, rawsink->segment_size) != 0) {
+        GST_ELEMENT_ERROR(rawsink, RESOURCE, NO_SPACE_LEFT,
+            ("Could not allocate segment \"%s\".", path), GST_ERROR_SYSTEM);
+        g_free(path);
+        return FALSE;
+    }
+    if (rawsink->io_mode == GST_VIMBA_RAW_IO_MMAP) {
+        rawsink->segment_map = mmap(NULL, rawsink->segment_size,
+            PROT_READ | PROT_WRITE, MAP_SHARED, rawsink->segment_fd, 0);
+        if (rawsink->segment_map == MAP_FAILED) {
+            rawsink->segment_map = NULL;
+            GST_ELEMENT_ERROR(rawsink, RESOURCE, WRITE,
+                ("Could not map segment \"%s\".", path), GST_ERROR_SYSTEM);
+            g_free(path);
+            return FALSE;
+        }
+        madvise(rawsink->segment_map, rawsink->segment_size, MADV_SEQUENTIAL);
+    }
+    GST_DEBUG_OBJECT(rawsink, "opened segment %s", path);
+    g_free(path);
+
+    rawsink->segment = segment;
+    rawsink->segment_offset = 0;
+    return TRUE;
+}
+
+/* writing */
+
+/* must be called with write_lock held */
+static GstFlowReturn
+gst_vimba_raw_sink_write_job (GstVimbaRawSink * rawsink, GstVimbaRawJob * job)
+{
+    VimbaRawIndexEntry *entry = &job->entry;
+    GstMapInfo map;
+    const guint8 *data;
+    guint64 aligned;
+    gboolean mapped = FALSE;
+
+    if (rawsink->write_result != GST_FLOW_OK) {
+        return rawsink->write_result;
+    }
+    if (job->data != NULL) {
+        data = job->data;
+    } else {
+        if (!gst_buffer_map(job->buffer, &map, GST_MAP_READ)) {
+            GST_ELEMENT_ERROR(rawsink, RESOURCE, WRITE,
+                ("Could not map buffer."), (NULL));
+            return rawsink->write_result = GST_FLOW_ERROR;
+        }
+        mapped = TRUE;
+        data = map.data;
+        entry->size = map.size;
+    }
+
+    aligned = ALIGN_UP(entry->size);
+    if (aligned > rawsink->segment_size) {
+        GST_ELEMENT_ERROR(rawsink, RESOURCE, WRITE,
+            ("Frame of %u bytes does not fit a segment.", entry->size), (NULL));
+        rawsink->write_result = GST_FLOW_ERROR;
+        goto done;
+    }
+    if (rawsink->segment_offset + aligned > rawsink->segment_size) {
+        gst_vimba_raw_sink_close_segment(rawsink);
+        if (!gst_vimba_raw_sink_open_segment(rawsink, rawsink->segment + 1)) {
+            rawsink->write_result = GST_FLOW_ERROR;
+            goto done;
+        }
+    }
+    entry->segment = rawsink->segment;
+    entry->offset = rawsink->segment_offset;
+
+    if (rawsink->segment_map != NULL) {
+        memcpy(rawsink->segment_map + entry->offset, data, entry->size);
+    } else {
+        /* O_DIRECT needs an aligned buffer and whole blocks */
+        if (rawsink->bounce_size < aligned) {
+            free(rawsink->bounce);
+            rawsink->bounce = NULL;
+            rawsink->bounce_size = 0;
+            if (posix_memalign((void **) &rawsink->bounce, VIMBA_RAW_ALIGN,
+                    aligned) != 0) {
+                GST_ELEMENT_ERROR(rawsink, RESOURCE, WRITE,
+                    ("Could not allocate write buffer."), (NULL));
+                rawsink->write_result = GST_FLOW_ERROR;
+                goto done;
+            }
+            rawsink->bounce_size = aligned;
+        }
+        memcpy(rawsink->bounce, data, entry->size);
+        memset(rawsink->bounce + entry->size, 0, aligned - entry->size);
+        if (pwrite(rawsink->segment_fd, rawsink->bounce, aligned,
+                entry->offset) != (ssize_t) aligned) {
+            GST_ELEMENT_ERROR(rawsink, RESOURCE, WRITE,
+                ("Could not write segment %u.", rawsink->segment),
+                GST_ERROR_SYSTEM);
+            rawsink->write_result = GST_FLOW_ERROR;
+            goto done;
+        }
+    }
+    rawsink->segment_offset += aligned;
+
+    if (pwrite(rawsink->index_fd, entry, sizeof(VimbaRawIndexEntry),
+            VIMBA_RAW_HEADER_SIZE + rawsink->entries * sizeof(VimbaRawIndexEntry))
+            != sizeof(VimbaRawIndexEntry)) {
+        GST_ELEMENT_ERROR(rawsink, RESOURCE, WRITE,
+            ("Could not write index."), GST_ERROR_SYSTEM);
+        rawsink->write_result = GST_FLOW_ERROR;
+        goto done;
+    }
+    rawsink->entries++;
+    rawsink->frames_written++;
+    rawsink->bytes_written += entry->size;
+    rawsink->raw_bytes += entry->raw_size;
+
+done:
+    if (mapped) {
+        gst_buffer_unmap(job->buffer, &map);
+    }
+    return rawsink->write_result;
+}
+
+static void
+gst_vimba_raw_sink_free_job (GstVimbaRawJob * job)
+{
+    gst_buffer_unref(job->buffer);
+    g_free(job->data);
+    g_slice_free(GstVimbaRawJob, job);
+}
+
+/* worker thread: compress, then write every frame that is next in line */
+static void
+gst_vimba_raw_sink_compress (gpointer data, gpointer user_data)
+{
+    GstVimbaRawSink *rawsink = user_data;
+    GstVimbaRawJob *job = data;
+
+#ifdef HAVE_LZ4
+    GstMapInfo map;
+
+    if (gst_buffer_map(job->buffer, &map, GST_MAP_READ)) {
+        int bound = LZ4_compressBound((int) map.size);
+        guint8 *out = g_malloc(bound);
+        int size = LZ4_compress_default((const char *) map.data, (char *) out,
+            (int) map.size, bound);
+
+        /* incompressible frames are stored as they are */
+        if (size > 0 && (gsize) size < map.size) {
+            job->data = out;
+            job->entry.size = size;
+            job->entry.flags |= VIMBA_RAW_ENTRY_LZ4;
+        } else {
+            g_free(out);
+        }
+        gst_buffer_unmap(job->buffer, &map);
+    }
+#endif
+
+    g_mutex_lock(&rawsink->write_lock);
+    g_hash_table_insert(rawsink->compressed, &job->seq, job);
+    while ((job = g_hash_table_lookup(rawsink->compressed,
+            &rawsink->write_seq)) != NULL) {
+        g_hash_table_remove(rawsink->compressed, &job->seq);
+        gst_vimba_raw_sink_write_job(rawsink, job);
+        gst_vimba_raw_sink_free_job(job);
+        rawsink->write_seq++;
+        rawsink->in_flight--;
+    }
+    g_cond_broadcast(&rawsink->write_cond);
+    g_mutex_unlock(&rawsink->write_lock);
+}
+
+/* wait until all frames handed to the workers are on disk */
+static void
+gst_vimba_raw_sink_drain (GstVimbaRawSink * rawsink)
+{
+    g_mutex_lock(&rawsink->write_lock);
+    while (rawsink->in_flight > 0) {
+        g_cond_wait(&rawsink->write_cond, &rawsink->write_lock);
+    }
+    g_mutex_unlock(&rawsink->write_lock);
+}
+
+static gboolean
+gst_vimba_raw_sink_write_header (GstVimbaRawSink * rawsink)
+{
+    if (pwrite(rawsink->index_fd, &rawsink->header, sizeof(VimbaRawHeader), 0)
+            != sizeof(VimbaRawHeader)) {
+        GST_ELEMENT_ERROR(rawsink, RESOURCE, WRITE,
+            ("Could not write index header."), GST_ERROR_SYSTEM);
+        return FALSE;
+    }
+    return TRUE;
+}
+
+static gboolean
+gst_vimba_raw_sink_start (GstBaseSink * sink)
+{
+    GstVimbaRawSink *rawsink = GST_VIMBA_RAW_SINK (sink);
+    gchar *path;
+    gboolean res;
+
+    if (rawsink->location == NULL) {
+        GST_ELEMENT_ERROR(rawsink, RESOURCE, NOT_FOUND,
+            ("No recording location specified."), (NULL));
+        return FALSE;
+    }
+    if (g_mkdir_with_parents(rawsink->location, 0755) != 0) {
+        GST_ELEMENT_ERROR(rawsink, RESOURCE, OPEN_WRITE,
+            ("Could not create \"%s\".", rawsink->location), GST_ERROR_SYSTEM);
+        return FALSE;
+    }
+
+    path = g_build_filename(rawsink->location, VIMBA_RAW_INDEX_NAME, NULL);
+    rawsink->index_fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (rawsink->index_fd < 0) {
+        GST_ELEMENT_ERROR(rawsink, RESOURCE, OPEN_WRITE,
+            ("Could not open \"%s\" for writing.", path), GST_ERROR_SYSTEM);
+        g_free(path);
+        return FALSE;
+    }
+    g_free(path);
+
+#ifndef HAVE_LZ4
+    if (rawsink->compression == GST_VIMBA_RAW_COMPRESSION_LZ4) {
+        GST_WARNING_OBJECT(rawsink, "built without liblz4, not compressing");
+        rawsink->compression = GST_VIMBA_RAW_COMPRESSION_NONE;
+    }
+#endif
+
+    memset(&rawsink->header, 0, sizeof(VimbaRawHeader));
+    memcpy(rawsink->header.magic, VIMBA_RAW_MAGIC, sizeof(rawsink->header.magic));
+    rawsink->header.version = VIMBA_RAW_VERSION;
+    rawsink->header.segment_size = rawsink->segment_size;
+    rawsink->header.entry_size = sizeof(VimbaRawIndexEntry);
+    if (rawsink->compression == GST_VIMBA_RAW_COMPRESSION_LZ4) {
+        rawsink->header.flags |= VIMBA_RAW_FLAG_LZ4;
+    }
+
+    rawsink->entries = 0;
+    rawsink->frames_written = 0;
+    rawsink->bytes_written = 0;
+    rawsink->raw_bytes = 0;
+    rawsink->next_seq = 0;
+    rawsink->write_seq = 0;
+    rawsink->in_flight = 0;
+    rawsink->write_result = GST_FLOW_OK;
+
+    g_mutex_lock(&rawsink->write_lock);
+    res = gst_vimba_raw_sink_write_header(rawsink) &&
+        gst_vimba_raw_sink_open_segment(rawsink, 0);
+    if (!res) {
+        gst_vimba_raw_sink_close_segment(rawsink);
+        close(rawsink->index_fd);
+        rawsink->index_fd = -1;
+    }
+    g_mutex_unlock(&rawsink->write_lock);
+    if (!res) {
+        return FALSE;
+    }
+
+    if (rawsink->compression == GST_VIMBA_RAW_COMPRESSION_LZ4) {
+        rawsink->compressed = g_hash_table_new(g_int64_hash, g_int64_equal);
+        rawsink->pool = g_thread_pool_new(gst_vimba_raw_sink_compress,
+            rawsink, rawsink->compression_threads, FALSE, NULL);
+    }
+
+    GST_DEBUG_OBJECT (rawsink, "start");
+    return TRUE;
+}
+
+static gboolean
+gst_vimba_raw_sink_stop (GstBaseSink * sink)
+{
+    GstVimbaRawSink *rawsink = GST_VIMBA_RAW_SINK (sink);
+
+    if (rawsink->pool != NULL) {
+        /* waits for the queued frames */
+        g_thread_pool_free(rawsink->pool, FALSE, TRUE);
+        rawsink->pool = NULL;
+        g_hash_table_unref(rawsink->compressed);
+        rawsink->compressed = NULL;
+    }
+
+    g_mutex_lock(&rawsink->write_lock);
+    gst_vimba_raw_sink_close_segment(rawsink);
+    if (rawsink->index_fd >= 0) {
+        fsync(rawsink->index_fd);
+        close(rawsink->index_fd);
+        rawsink->index_fd = -1;
+    }
+    free(rawsink->bounce);
+    rawsink->bounce = NULL;
+    rawsink->bounce_size = 0;
+    GST_INFO_OBJECT(rawsink, "recorded %" G_GUINT64_FORMAT " frames, %"
+        G_GUINT64_FORMAT " of %" G_GUINT64_FORMAT " bytes in %u segments",
+        rawsink->frames_written, rawsink->bytes_written, rawsink->raw_bytes,
+        rawsink->segment + 1);
+    g_mutex_unlock(&rawsink->write_lock);
+
+    GST_DEBUG_OBJECT (rawsink, "stop");
+    return TRUE;
+}
+
+static gboolean
+gst_vimba_raw_sink_set_caps (GstBaseSink * sink, GstCaps * caps)
+{
+    GstVimbaRawSink *rawsink = GST_VIMBA_RAW_SINK (sink);
+    gchar *string = gst_caps_to_string(caps);
+    gboolean res;
+
+    if (strlen(string) >= sizeof(rawsink->header.caps)) {
+        GST_ELEMENT_ERROR(rawsink, STREAM, FORMAT,
+            ("Caps too long for the recording header."), ("%s", string));
+        g_free(string);
+        return FALSE;
+    }
+
+    /* frames already written keep the caps they were recorded with */
+    gst_vimba_raw_sink_drain(rawsink);
+    g_mutex_lock(&rawsink->write_lock);
+    if (rawsink->entries > 0 && strcmp(rawsink->header.caps, string) != 0) {
+        GST_WARNING_OBJECT(rawsink, "caps changed during the recording");
+    }
+    g_strlcpy(rawsink->header.caps, string, sizeof(rawsink->header.caps));
+    res = gst_vimba_raw_sink_write_header(rawsink);
+    g_mutex_unlock(&rawsink->write_lock);
+
+    g_free(string);
+    return res;
+}
+
+static gboolean
+gst_vimba_raw_sink_event (GstBaseSink * sink, GstEvent * event)
+{
+    if (GST_EVENT_TYPE(event) == GST_EVENT_EOS) {
+        /* the index is complete when EOS is posted */
+        gst_vimba_raw_sink_drain(GST_VIMBA_RAW_SINK(sink));
+    }
+    return GST_BASE_SINK_CLASS(gst_vimba_raw_sink_parent_class)->event(
+        sink, event
+    );
+}
+
+static void
+gst_vimba_raw_sink_fill_entry (GstBuffer * buffer, VimbaRawIndexEntry * entry)
+{
+    GstVimbaFrameMeta *meta = gst_buffer_get_vimba_frame_meta(buffer);
+
+    memset(entry, 0, sizeof(VimbaRawIndexEntry));
+    entry->pts = GST_BUFFER_PTS(buffer);
+    entry->duration = GST_BUFFER_DURATION(buffer);
+    entry->raw_size = gst_buffer_get_size(buffer);
+    entry->size = entry->raw_size;
+    if (meta != NULL) {
+        entry->frame_id = meta->frame_id;
+        entry->device_timestamp = meta->device_timestamp;
+        entry->status = meta->receive_status;
+    } else {
+        entry->frame_id = GST_BUFFER_OFFSET(buffer);
+        entry->status = GST_BUFFER_FLAG_IS_SET(buffer, GST_BUFFER_FLAG_CORRUPTED)
+            ? VIMBA_RAW_STATUS_INCOMPLETE : VIMBA_RAW_STATUS_COMPLETE;
+    }
+    if (GST_BUFFER_FLAG_IS_SET(buffer, GST_BUFFER_FLAG_DISCONT)) {
+        entry->flags |= VIMBA_RAW_ENTRY_DISCONT;
+    }
+}
+
+static GstFlowReturn
+gst_vimba_raw_sink_render (GstBaseSink * sink, GstBuffer * buffer)
+{
+    GstVimbaRawSink *rawsink = GST_VIMBA_RAW_SINK (sink);
+    GstVimbaRawJob *job = g_slice_new0(GstVimbaRawJob);
+    GstFlowReturn ret;
+
+    job->buffer = gst_buffer_ref(buffer);
+    gst_vimba_raw_sink_fill_entry(buffer, &job->entry);
+
+    g_mutex_lock(&rawsink->write_lock);
+    if (rawsink->pool == NULL) {
+        ret = gst_vimba_raw_sink_write_job(rawsink, job);
+        g_mutex_unlock(&rawsink->write_lock);
+        gst_vimba_raw_sink_free_job(job);
+        return ret;
+    }
+
+    /* bound the memory held by frames waiting for a worker */
+    while (rawsink->in_flight >= rawsink->compression_threads * JOBS_PER_THREAD &&
+        rawsink->write_result == GST_FLOW_OK) {
+        g_cond_wait(&rawsink->write_cond, &rawsink->write_lock);
+    }
+    ret = rawsink->write_result;
+    if (ret != GST_FLOW_OK) {
+        g_mutex_unlock(&rawsink->write_lock);
+        gst_vimba_raw_sink_free_job(job);
+        return ret;
+    }
+    job->seq = rawsink->next_seq++;
+    rawsink->in_flight++;
+    g_mutex_unlock(&rawsink->write_lock);
+
+    g_thread_pool_push(rawsink->pool, job, NULL);
+    return GST_FLOW_OK;
+}
@@ -0,0 +1,93 @@
+/* GStreamer
+ * Copyright (C) 2015 Art+Com AG <info@artcom.de>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef _GST_VIMBA_RAW_SINK_H_
+#define _GST_VIMBA_RAW_SINK_H_
+
+#include <gst/base/gstbasesink.h>
+#include "vimbarawformat.h"
+
+G_BEGIN_DECLS
+
+#define GST_TYPE_VIMBA_RAW_SINK   (gst_vimba_raw_sink_get_type())
+#define GST_VIMBA_RAW_SINK(obj)   (G_TYPE_CHECK_INSTANCE_CAST((obj),GST_TYPE_VIMBA_RAW_SINK,GstVimbaRawSink))
+#define GST_VIMBA_RAW_SINK_CLASS(klass)   (G_TYPE_CHECK_CLASS_CAST((klass),GST_TYPE_VIMBA_RAW_SINK,GstVimbaRawSinkClass))
+#define GST_IS_VIMBA_RAW_SINK(obj)   (G_TYPE_CHECK_INSTANCE_TYPE((obj),GST_TYPE_VIMBA_RAW_SINK))
+#define GST_IS_VIMBA_RAW_SINK_CLASS(obj)   (G_TYPE_CHECK_CLASS_TYPE((klass),GST_TYPE_VIMBA_RAW_SINK))
+
+typedef struct _GstVimbaRawSink GstVimbaRawSink;
+typedef struct _GstVimbaRawSinkClass GstVimbaRawSinkClass;
+
+/* how frame data reaches the segment files */
+typedef enum {
+    GST_VIMBA_RAW_IO_MMAP,
+    GST_VIMBA_RAW_IO_DIRECT
+} GstVimbaRawIoMode;
+
+typedef enum {
+    GST_VIMBA_RAW_COMPRESSION_NONE,
+    GST_VIMBA_RAW_COMPRESSION_LZ4
+} GstVimbaRawCompression;
+
+struct _GstVimbaRawSink
+{
+    GstBaseSink            base_vimbarawsink;
+
+    gchar*                 location;
+    guint64                segment_size;
+    GstVimbaRawIoMode      io_mode;
+    GstVimbaRawCompression compression;
+    guint                  compression_threads;
+
+    /* writer state, protected by write_lock */
+    GMutex                 write_lock;
+    GCond                  write_cond;
+    VimbaRawHeader         header;
+    gint                   index_fd;
+    guint64                entries;
+    gint                   segment_fd;
+    guint32                segment;
+    guint64                segment_offset;
+    guint8*                segment_map;
+    guint8*                bounce;
+    gsize                  bounce_size;
+    GstFlowReturn          write_result;
+
+    /* frames are compressed in any order but written in arrival order */
+    GThreadPool*           pool;
+    guint64                next_seq;
+    guint64                write_seq;
+    GHashTable*            compressed;
+    guint                  in_flight;
+
+    guint64                frames_written;
+    guint64                bytes_written;
+    guint64                raw_bytes;
+};
+
+struct _GstVimbaRawSinkClass
+{
+    GstBaseSinkClass base_vimbarawsink_class;
+};
+
+GType gst_vimba_raw_sink_get_type (void);
+
+G_END_DECLS
+
+#endif
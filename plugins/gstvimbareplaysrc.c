@@ -0,0 +1,781 @@
+/* GStreamer
+ * Copyright (C) 2015 Art+Com AG <info@artcom.de>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Suite 500,
+ * Boston, MA 02110-1335, USA.
+ */
+/**
+ * SECTION:element-gstvimbareplaysrc
+ *
+ * The vimbareplaysrc element plays back a recording written by vimbarawsink.
+ * The index and the segments are mapped and every frame is pushed without a
+ * copy (unless it was stored compressed), with the recorded caps, its
+ * original timing, frame id and device timestamp as #GstVimbaFrameMeta and
+ * incomplete frames flagged %GST_BUFFER_FLAG_CORRUPTED. pacing=realtime
+ * pushes frames with the intervals they were captured with, pacing=rate
+ * with those intervals divided by rate and pacing=asap as fast as
+ * downstream accepts them. The recording is seekable in time.
+ *
+ * <refsect2>
+ * <title>Example launch line</title>
+ * |[
+ * gst-launch-1.0 vimbareplaysrc location=/data/run1 pacing=rate rate=4 ! \
+ *     videoconvert ! autovideosink
+ * ]|
+ * </refsect2>
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <gst/gst.h>
+#include <gst/base/gstpushsrc.h>
+#ifdef HAVE_LZ4
+#include <lz4.h>
+#endif
+#include "gstvimbameta.h"
+#include "gstvimbareplaysrc.h"
+
+GST_DEBUG_CATEGORY_STATIC (gst_vimba_replay_src_debug_category);
+#define GST_CAT_DEFAULT gst_vimba_replay_src_debug_category
+
+/* prototypes */
+
+static void gst_vimba_replay_src_set_property (GObject * object,
+        guint property_id, const GValue * value, GParamSpec * pspec);
+static void gst_vimba_replay_src_get_property (GObject * object,
+        guint property_id, GValue * value, GParamSpec * pspec);
+static void gst_vimba_replay_src_finalize (GObject * object);
+static GstCaps *gst_vimba_replay_src_get_caps (GstBaseSrc * src,
+        GstCaps * filter);
+static gboolean gst_vimba_replay_src_start (GstBaseSrc * src);
+static gboolean gst_vimba_replay_src_stop (GstBaseSrc * src);
+static gboolean gst_vimba_replay_src_is_seekable (GstBaseSrc * src);
+static gboolean gst_vimba_replay_src_do_seek (GstBaseSrc * src,
+        GstSegment * segment);
+static gboolean gst_vimba_replay_src_query (GstBaseSrc * src, GstQuery * query);
+static gboolean gst_vimba_replay_src_unlock (GstBaseSrc * src);
+static gboolean gst_vimba_replay_src_unlock_stop (GstBaseSrc * src);
+static GstFlowReturn gst_vimba_replay_src_create (GstPushSrc * src,
+        GstBuffer ** buf);
+
+enum
+{
+    PROP_0,
+    PROP_LOCATION,
+    PROP_PACING,
+    PROP_RATE,
+    PROP_FRAMES,
+    PROP_FRAMES_PUSHED
+};
+
+#define GST_TYPE_VIMBA_REPLAY_PACING (gst_vimba_replay_pacing_get_type())
+static GType
+gst_vimba_replay_pacing_get_type (void)
+{
+    static GType pacing_type = 0;
+    static const GEnumValue pacings[] = {
+        {GST_VIMBA_REPLAY_PACING_REALTIME, "Frame intervals as recorded", "realtime"},
+        {GST_VIMBA_REPLAY_PACING_RATE, "Frame intervals divided by rate", "rate"},
+        {GST_VIMBA_REPLAY_PACING_ASAP, "As fast as downstream accepts frames", "asap"},
+        {0, NULL, NULL}
+    };
+
+    if (!pacing_type) {
+        pacing_type = g_enum_register_static("GstVimbaReplayPacing", pacings);
+    }
+    return pacing_type;
+}
+
+/* pad templates */
+
+static GstStaticPadTemplate gst_vimba_replay_src_src_template =
+GST_STATIC_PAD_TEMPLATE ("src",
+    GST_PAD_SRC,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS_ANY
+);
+
+/* class initialization */
+
+G_DEFINE_TYPE_WITH_CODE (
+    GstVimbaReplaySrc,
+    gst_vimba_replay_src,
+    GST_TYPE_PUSH_SRC,
+    GST_DEBUG_CATEGORY_INIT (
+        gst_vimba_replay_src_debug_category,
+        "vimbareplaysrc",
+        0,
+        "debug category for vimbareplaysrc element"
+    )
+);
+
+static void
+gst_vimba_replay_src_class_init (GstVimbaReplaySrcClass * klass)
+{
+    GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+    GstBaseSrcClass *base_src_class = GST_BASE_SRC_CLASS (klass);
+    GstPushSrcClass *push_src_class = GST_PUSH_SRC_CLASS (klass);
+
+    gst_element_class_add_pad_template (GST_ELEMENT_CLASS(klass),
+            gst_static_pad_template_get (&gst_vimba_replay_src_src_template));
+
+    gst_element_class_set_static_metadata (
+        GST_ELEMENT_CLASS(klass),
+        "VIMBA Raw Replay",
+        "Source/File",
+        "Plays back camera frames recorded by vimbarawsink",
+        "Art+Com AG <info@artcom.de>"
+    );
+
+    gobject_class->set_property = gst_vimba_replay_src_set_property;
+    gobject_class->get_property = gst_vimba_replay_src_get_property;
+    gobject_class->finalize = gst_vimba_replay_src_finalize;
+    base_src_class->get_caps = GST_DEBUG_FUNCPTR (gst_vimba_replay_src_get_caps);
+    base_src_class->start = GST_DEBUG_FUNCPTR (gst_vimba_replay_src_start);
+    base_src_class->stop = GST_DEBUG_FUNCPTR (gst_vimba_replay_src_stop);
+    base_src_class->is_seekable = GST_DEBUG_FUNCPTR (gst_vimba_replay_src_is_seekable);
+    base_src_class->do_seek = GST_DEBUG_FUNCPTR (gst_vimba_replay_src_do_seek);
+    base_src_class->query = GST_DEBUG_FUNCPTR (gst_vimba_replay_src_query);
+    base_src_class->unlock = GST_DEBUG_FUNCPTR (gst_vimba_replay_src_unlock);
+    base_src_class->unlock_stop = GST_DEBUG_FUNCPTR (gst_vimba_replay_src_unlock_stop);
+    push_src_class->create = GST_DEBUG_FUNCPTR (gst_vimba_replay_src_create);
+
+    g_object_class_install_property(
+        gobject_class,
+        PROP_LOCATION,
+        g_param_spec_string(
+            "location",
+            "Location",
+            "Directory of the recording",
+            NULL,
+            G_PARAM_READWRITE
+        )
+    );
+
+    g_object_class_install_property(
+        gobject_class,
+        PROP_PACING,
+        g_param_spec_enum(
+            "pacing",
+            "Pacing",
+            "When frames are pushed",
+            GST_TYPE_VIMBA_REPLAY_PACING,
+            GST_VIMBA_REPLAY_PACING_REALTIME,
+            G_PARAM_READWRITE
+        )
+    );
+
+    g_object_class_install_property(
+        gobject_class,
+        PROP_RATE,
+        g_param_spec_double(
+            "rate",
+            "Rate",
+            "Playback speed with pacing=rate, timestamps are scaled by it",
+            0.001,
+            1000.0,
+            1.0,
+            G_PARAM_READWRITE
+        )
+    );
+
+    g_object_class_install_property(
+        gobject_class,
+        PROP_FRAMES,
+        g_param_spec_uint64(
+            "frames",
+            "Frames",
+            "Frames in the recording",
+            0,
+            G_MAXUINT64,
+            0,
+            G_PARAM_READABLE
+        )
+    );
+
+    g_object_class_install_property(
+        gobject_class,
+        PROP_FRAMES_PUSHED,
+        g_param_spec_uint64(
+            "frames-pushed",
+            "Frames pushed",
+            "Frames pushed since start",
+            0,
+            G_MAXUINT64,
+            0,
+            G_PARAM_READABLE
+        )
+    );
+}
+
+static void
+gst_vimba_replay_src_init (GstVimbaReplaySrc *replaysrc)
+{
+    replaysrc->pacing = GST_VIMBA_REPLAY_PACING_REALTIME;
+    replaysrc->rate = 1.0;
+
+    gst_base_src_set_format(GST_BASE_SRC(replaysrc), GST_FORMAT_TIME);
+}
+
+void
+gst_vimba_replay_src_set_property (GObject * object, guint property_id,
+        const GValue * value, GParamSpec * pspec)
+{
+    GstVimbaReplaySrc *replaysrc = GST_VIMBA_REPLAY_SRC (object);
+
+    GST_OBJECT_LOCK(replaysrc);
+    switch (property_id) {
+        case PROP_LOCATION:
+            g_free(replaysrc->location);
+            replaysrc->location = g_value_dup_string(value);
+            break;
+        case PROP_PACING:
+            replaysrc->pacing = g_value_get_enum(value);
+            break;
+        case PROP_RATE:
+            replaysrc->rate = g_value_get_double(value);
+            break;
+        default:
+            G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
+            break;
+    }
+    GST_OBJECT_UNLOCK(replaysrc);
+}
+
+void
+gst_vimba_replay_src_get_property (GObject * object, guint property_id,
+        GValue * value, GParamSpec * pspec)
+{
+    GstVimbaReplaySrc *replaysrc = GST_VIMBA_REPLAY_SRC (object);
+
+    GST_OBJECT_LOCK(replaysrc);
+    switch (property_id) {
+        case PROP_LOCATION:
+            g_value_set_string(value, replaysrc->location);
+            break;
+        case PROP_PACING:
+            g_value_set_enum(value, replaysrc->pacing);
+            break;
+        case PROP_RATE:
+            g_value_set_double(value, replaysrc->rate);
+            break;
+        case PROP_FRAMES:
+            g_value_set_uint64(value, replaysrc->n_entries);
+            break;
+        case PROP_FRAMES_PUSHED:
+            g_value_set_uint64(value, replaysrc->frames_pushed);
+            break;
+        default:
+            G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
+            break;
+    }
+    GST_OBJECT_UNLOCK(replaysrc);
+}
+
+void
+gst_vimba_replay_src_finalize (GObject * object)
+{
+    GstVimbaReplaySrc *replaysrc = GST_VIMBA_REPLAY_SRC (object);
+
+    g_free(replaysrc->location);
+
+    G_OBJECT_CLASS (gst_vimba_replay_src_parent_class)->finalize (object);
+}
+
+/* recording */
+
+static void
+gst_vimba_replay_segment_unref (GstVimbaReplaySegment * segment)
+{
+    if (g_atomic_int_dec_and_test(&segment->refcount)) {
+        munmap(segment->data, segment->size);
+        g_slice_free(GstVimbaReplaySegment, segment);
+    }
+}
+
+/* map a file read-only, returns NULL on failure */
+static guint8 *
+gst_vimba_replay_src_map (GstVimbaReplaySrc * replaysrc, const gchar * path,
+        gsize * size)
+{
+    struct stat st;
+    guint8 *data = NULL;
+    int fd = open(path, O_RDONLY);
+
+    if (fd < 0) {
+        GST_ELEMENT_ERROR(replaysrc, RESOURCE, OPEN_READ,
+            ("Could not open \"%s\" for reading.", path), GST_ERROR_SYSTEM);
+        return NULL;
+    }
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+        data = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        if (data == MAP_FAILED) {
+            data = NULL;
+        } else {
+            *size = st.st_size;
+            madvise(data, st.st_size, MADV_SEQUENTIAL);
+        }
+    }
+    if (data == NULL) {
+        GST_ELEMENT_ERROR(replaysrc, RESOURCE, READ,
+            ("Could not map \"%s\".", path), GST_ERROR_SYSTEM);
+    }
+    close(fd);
+    return data;
+}
+
+/* segments are mapped when the first frame in them is pushed */
+static GstVimbaReplaySegment *
+gst_vimba_replay_src_segment (GstVimbaReplaySrc * replaysrc, guint32 index)
+{
+    GstVimbaReplaySegment *segment;
+    gchar *name, *path;
+
+    if (index < replaysrc->segments->len &&
+        (segment = g_ptr_array_index(replaysrc->segments, index)) != NULL) {
+        return segment;
+    }
+
+    name = g_strdup_printf(VIMBA_RAW_SEGMENT_FORMAT, index);
+    path = g_build_filename(replaysrc->location, name, NULL);
+    segment = g_slice_new0(GstVimbaReplaySegment);
+    segment->refcount = 1;
+    segment->data = gst_vimba_replay_src_map(replaysrc, path, &segment->size);
+    g_free(name);
+    g_free(path);
+    if (segment->data == NULL) {
+        g_slice_free(GstVimbaReplaySegment, segment);
+        return NULL;
+    }
+
+    if (index >= replaysrc->segments->len) {
+        g_ptr_array_set_size(replaysrc->segments, index + 1);
+    }
+    g_ptr_array_index(replaysrc->segments, index) = segment;
+    return segment;
+}
+
+static const VimbaRawIndexEntry *
+gst_vimba_replay_src_entry (GstVimbaReplaySrc * replaysrc, guint64 index)
+{
+    return (const VimbaRawIndexEntry *) (replaysrc->index_map +
+        VIMBA_RAW_HEADER_SIZE + index * replaysrc->header->entry_size);
+}
+
+/* time of a frame since the first one, scaled by the playback speed */
+static GstClockTime
+gst_vimba_replay_src_time (GstVimbaReplaySrc * replaysrc, guint64 index)
+{
+    const VimbaRawIndexEntry *first = gst_vimba_replay_src_entry(replaysrc, 0);
+    const VimbaRawIndexEntry *entry = gst_vimba_replay_src_entry(replaysrc, index);
+    GstClockTime time;
+
+    if (GST_CLOCK_TIME_IS_VALID(first->pts) && GST_CLOCK_TIME_IS_VALID(entry->pts)) {
+        time = entry->pts > first->pts ? entry->pts - first->pts : 0;
+    } else {
+        /* recorded without timestamps, the camera clock is all there is */
+        time = entry->device_timestamp > first->device_timestamp
+            ? entry->device_timestamp - first->device_timestamp : 0;
+    }
+    if (replaysrc->pacing == GST_VIMBA_REPLAY_PACING_RATE) {
+        time = (GstClockTime) (time / replaysrc->rate);
+    }
+    return time;
+}
+
+static GstClockTime
+gst_vimba_replay_src_duration (GstVimbaReplaySrc * replaysrc, guint64 index)
+{
+    GstClockTime duration = gst_vimba_replay_src_entry(replaysrc, index)->duration;
+
+    if (GST_CLOCK_TIME_IS_VALID(duration) &&
+        replaysrc->pacing == GST_VIMBA_REPLAY_PACING_RATE) {
+        duration = (GstClockTime) (duration / replaysrc->rate);
+    }
+    return duration;
+}
+
+/* basesrc */
+
+static GstCaps *
+gst_vimba_replay_src_get_caps (GstBaseSrc * src, GstCaps * filter)
+{
+    GstVimbaReplaySrc *replaysrc = GST_VIMBA_REPLAY_SRC (src);
+    GstCaps *caps;
+
+    GST_OBJECT_LOCK(replaysrc);
+    if (replaysrc->caps != NULL) {
+        caps = gst_caps_ref(replaysrc->caps);
+    } else {
+        caps = gst_pad_get_pad_template_caps(GST_BASE_SRC_PAD(src));
+    }
+    GST_OBJECT_UNLOCK(replaysrc);
+
+    if (filter != NULL) {
+        GstCaps *tmp = gst_caps_intersect_full(filter, caps,
+            GST_CAPS_INTERSECT_FIRST);
+        gst_caps_unref(caps);
+        caps = tmp;
+    }
+    return caps;
+}
+
+static gboolean
+gst_vimba_replay_src_start (GstBaseSrc * src)
+{
+    GstVimbaReplaySrc *replaysrc = GST_VIMBA_REPLAY_SRC (src);
+    const VimbaRawHeader *header;
+    GstCaps *caps = NULL;
+    gchar *path;
+    gsize size = 0;
+    guint8 *map;
+
+    if (replaysrc->location == NULL) {
+        GST_ELEMENT_ERROR(replaysrc, RESOURCE, NOT_FOUND,
+            ("No recording location specified."), (NULL));
+        return FALSE;
+    }
+
+    path = g_build_filename(replaysrc->location, VIMBA_RAW_INDEX_NAME, NULL);
+    map = gst_vimba_replay_src_map(replaysrc, path, &size);
+    g_free(path);
+    if (map == NULL) {
+        return FALSE;
+    }
+
+    header = (const VimbaRawHeader *) map;
+    if (size < VIMBA_RAW_HEADER_SIZE ||
+        memcmp(header->magic, VIMBA_RAW_MAGIC, sizeof(header->magic)) != 0 ||
+        header->version != VIMBA_RAW_VERSION ||
+        header->entry_size < sizeof(VimbaRawIndexEntry)) {
+        GST_ELEMENT_ERROR(replaysrc, STREAM, WRONG_TYPE,
+            ("\"%s\" is not a recording of vimbarawsink.", replaysrc->location),
+            (NULL));
+        munmap(map, size);
+        return FALSE;
+    }
+    if (memchr(header->caps, '\0', sizeof(header->caps)) != NULL) {
+        caps = gst_caps_from_string(header->caps);
+    }
+    if (caps == NULL || gst_caps_is_empty(caps)) {
+        GST_ELEMENT_ERROR(replaysrc, STREAM, FORMAT,
+            ("The recording has no caps."), (NULL));
+        if (caps != NULL) {
+            gst_caps_unref(caps);
+        }
+        munmap(map, size);
+        return FALSE;
+    }
+#ifndef HAVE_LZ4
+    if (header->flags & VIMBA_RAW_FLAG_LZ4) {
+        GST_ELEMENT_ERROR(replaysrc, STREAM, CODEC_NOT_FOUND,
+            ("The recording is compressed and liblz4 is not available."),
+            (NULL));
+        gst_caps_unref(caps);
+        munmap(map, size);
+        return FALSE;
+    }
+#endif
+
+    GST_OBJECT_LOCK(replaysrc);
+    replaysrc->index_map = map;
+    replaysrc->index_size = size;
+    replaysrc->header = header;
+    /* entries of a recording still being written may be partial */
+    replaysrc->n_entries = (size - VIMBA_RAW_HEADER_SIZE) / header->entry_size;
+    replaysrc->caps = caps;
+    replaysrc->segments = g_ptr_array_new_with_free_func(
+        (GDestroyNotify) gst_vimba_replay_segment_unref
+    );
+    replaysrc->position = 0;
+    replaysrc->discont = TRUE;
+    replaysrc->frames_pushed = 0;
+    GST_OBJECT_UNLOCK(replaysrc);
+
+    GST_INFO_OBJECT(replaysrc, "replaying %" G_GUINT64_FORMAT " frames of %"
+        GST_PTR_FORMAT, replaysrc->n_entries, caps);
+    return TRUE;
+}
+
+static gboolean
+gst_vimba_replay_src_stop (GstBaseSrc * src)
+{
+    GstVimbaReplaySrc *replaysrc = GST_VIMBA_REPLAY_SRC (src);
+
+    GST_OBJECT_LOCK(replaysrc);
+    /* buffers still downstream keep their segment mapped */
+    g_clear_pointer(&replaysrc->segments, g_ptr_array_unref);
+    if (replaysrc->index_map != NULL) {
+        munmap(replaysrc->index_map, replaysrc->index_size);
+        replaysrc->index_map = NULL;
+        replaysrc->header = NULL;
+    }
+    gst_caps_replace(&replaysrc->caps, NULL);
+    GST_OBJECT_UNLOCK(replaysrc);
+
+    GST_DEBUG_OBJECT (replaysrc, "stop");
+    return TRUE;
+}
+
+static gboolean
+gst_vimba_replay_src_is_seekable (GstBaseSrc * src)
+{
+    return TRUE;
+}
+
+static gboolean
+gst_vimba_replay_src_do_seek (GstBaseSrc * src, GstSegment * segment)
+{
+    GstVimbaReplaySrc *replaysrc = GST_VIMBA_REPLAY_SRC (src);
+    guint64 low = 0, high;
+
+    if (segment->format != GST_FORMAT_TIME || replaysrc->index_map == NULL) {
+        return FALSE;
+    }
+
+    /* first frame at or after the start of the segment */
+    GST_OBJECT_LOCK(replaysrc);
+    high = replaysrc->n_entries;
+    while (low < high) {
+        guint64 mid = low + (high - low) / 2;
+        if (gst_vimba_replay_src_time(replaysrc, mid) < segment->start) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    replaysrc->position = low;
+    replaysrc->discont = TRUE;
+    GST_OBJECT_UNLOCK(replaysrc);
+
+    segment->time = segment->start;
+    segment->position = segment->start;
+    GST_DEBUG_OBJECT(replaysrc, "seek to %" GST_TIME_FORMAT ", frame %"
+        G_GUINT64_FORMAT, GST_TIME_ARGS(segment->start), low);
+    return TRUE;
+}
+
+static gboolean
+gst_vimba_replay_src_query (GstBaseSrc * src, GstQuery * query)
+{
+    GstVimbaReplaySrc *replaysrc = GST_VIMBA_REPLAY_SRC (src);
+    GstFormat format;
+
+    if (GST_QUERY_TYPE(query) == GST_QUERY_DURATION) {
+        gst_query_parse_duration(query, &format, NULL);
+        if (format == GST_FORMAT_TIME) {
+            GstClockTime duration = GST_CLOCK_TIME_NONE;
+
+            GST_OBJECT_LOCK(replaysrc);
+            if (replaysrc->index_map != NULL && replaysrc->n_entries > 0) {
+                guint64 last = replaysrc->n_entries - 1;
+                GstClockTime frame = gst_vimba_replay_src_duration(replaysrc, last);
+                duration = gst_vimba_replay_src_time(replaysrc, last) +
+                    (GST_CLOCK_TIME_IS_VALID(frame) ? frame : 0);
+            }
+            GST_OBJECT_UNLOCK(replaysrc);
+            if (GST_CLOCK_TIME_IS_VALID(duration)) {
+                gst_query_set_duration(query, GST_FORMAT_TIME, duration);
+                return TRUE;
+            }
+        }
+    }
+    return GST_BASE_SRC_CLASS(gst_vimba_replay_src_parent_class)->query(
+        src, query
+    );
+}
+
+static gboolean
+gst_vimba_replay_src_unlock (GstBaseSrc * src)
+{
+    GstVimbaReplaySrc *replaysrc = GST_VIMBA_REPLAY_SRC (src);
+
+    GST_OBJECT_LOCK(replaysrc);
+    replaysrc->flushing = TRUE;
+    if (replaysrc->clock_id != NULL) {
+        gst_clock_id_unschedule(replaysrc->clock_id);
+    }
+    GST_OBJECT_UNLOCK(replaysrc);
+    return TRUE;
+}
+
+static gboolean
+gst_vimba_replay_src_unlock_stop (GstBaseSrc * src)
+{
+    GstVimbaReplaySrc *replaysrc = GST_VIMBA_REPLAY_SRC (src);
+
+    GST_OBJECT_LOCK(replaysrc);
+    replaysrc->flushing = FALSE;
+    GST_OBJECT_UNLOCK(replaysrc);
+    return TRUE;
+}
+
+/* wait until the running time of the frame, unless pacing is asap */
+static GstFlowReturn
+gst_vimba_replay_src_wait (GstVimbaReplaySrc * replaysrc, GstClockTime pts)
+{
+    GstBaseSrc *src = GST_BASE_SRC(replaysrc);
+    GstClockTime running_time;
+    GstClockReturn res;
+    GstClock *clock;
+
+    running_time = gst_segment_to_running_time(&src->segment,
+        GST_FORMAT_TIME, pts);
+
+    GST_OBJECT_LOCK(replaysrc);
+    if (replaysrc->pacing == GST_VIMBA_REPLAY_PACING_ASAP ||
+        !GST_CLOCK_TIME_IS_VALID(running_time) ||
+        GST_STATE(replaysrc) != GST_STATE_PLAYING ||
+        (clock = GST_ELEMENT_CLOCK(replaysrc)) == NULL) {
+        GST_OBJECT_UNLOCK(replaysrc);
+        return GST_FLOW_OK;
+    }
+    if (replaysrc->flushing) {
+        GST_OBJECT_UNLOCK(replaysrc);
+        return GST_FLOW_FLUSHING;
+    }
+    replaysrc->clock_id = gst_clock_new_single_shot_id(clock,
+        GST_ELEMENT_CAST(replaysrc)->base_time + running_time);
+    GST_OBJECT_UNLOCK(replaysrc);
+
+    res = gst_clock_id_wait(replaysrc->clock_id, NULL);
+
+    GST_OBJECT_LOCK(replaysrc);
+    gst_clock_id_unref(replaysrc->clock_id);
+    replaysrc->clock_id = NULL;
+    GST_OBJECT_UNLOCK(replaysrc);
+
+    return res == GST_CLOCK_UNSCHEDULED ? GST_FLOW_FLUSHING : GST_FLOW_OK;
+}
+
+/* the frame data, mapped in place or decompressed */
+static GstBuffer *
+gst_vimba_replay_src_frame (GstVimbaReplaySrc * replaysrc,
+        const VimbaRawIndexEntry * entry)
+{
+    GstVimbaReplaySegment *segment =
+        gst_vimba_replay_src_segment(replaysrc, entry->segment);
+    GstBuffer *buf;
+
+    if (segment == NULL) {
+        return NULL;
+    }
+    if (entry->offset + entry->size > segment->size) {
+        GST_ELEMENT_ERROR(replaysrc, STREAM, DECODE,
+            ("Frame %" G_GUINT64_FORMAT " lies beyond the end of segment %u.",
+                entry->frame_id, entry->segment), (NULL));
+        return NULL;
+    }
+
+    if (entry->flags & VIMBA_RAW_ENTRY_LZ4) {
+#ifdef HAVE_LZ4
+        GstMapInfo map;
+
+        buf = gst_buffer_new_allocate(NULL, entry->raw_size, NULL);
+        gst_buffer_map(buf, &map, GST_MAP_WRITE);
+        if (LZ4_decompress_safe((const char *) segment->data + entry->offset,
+                (char *) map.data, entry->size, entry->raw_size)
+                != (int) entry->raw_size) {
+            gst_buffer_unmap(buf, &map);
+            gst_buffer_unref(buf);
+            GST_ELEMENT_ERROR(replaysrc, STREAM, DECODE,
+                ("Frame %" G_GUINT64_FORMAT " cannot be decompressed.",
+                    entry->frame_id), (NULL));
+            return NULL;
+        }
+        gst_buffer_unmap(buf, &map);
+#else
+        GST_ELEMENT_ERROR(replaysrc, STREAM, CODEC_NOT_FOUND,
+            ("Frame %" G_GUINT64_FORMAT " is compressed and liblz4 is not "
+                "available.", entry->frame_id), (NULL));
+        return NULL;
+#endif
+    } else {
+        g_atomic_int_inc(&segment->refcount);
+        buf = gst_buffer_new_wrapped_full(GST_MEMORY_FLAG_READONLY,
+            segment->data + entry->offset, entry->size, 0, entry->size,
+            segment, (GDestroyNotify) gst_vimba_replay_segment_unref);
+    }
+    return buf;
+}
+
+static GstFlowReturn
+gst_vimba_replay_src_create (GstPushSrc * src, GstBuffer ** bufp)
+{
+    GstVimbaReplaySrc *replaysrc = GST_VIMBA_REPLAY_SRC (src);
+    const VimbaRawIndexEntry *entry;
+    GstVimbaFrameMeta *meta;
+    GstClockTime pts, duration;
+    GstFlowReturn ret;
+    gboolean discont;
+    GstBuffer *buf;
+    guint64 index;
+
+    GST_OBJECT_LOCK(replaysrc);
+    if (replaysrc->position >= replaysrc->n_entries) {
+        GST_OBJECT_UNLOCK(replaysrc);
+        return GST_FLOW_EOS;
+    }
+    index = replaysrc->position++;
+    discont = replaysrc->discont;
+    replaysrc->discont = FALSE;
+    entry = gst_vimba_replay_src_entry(replaysrc, index);
+    pts = gst_vimba_replay_src_time(replaysrc, index);
+    duration = gst_vimba_replay_src_duration(replaysrc, index);
+    GST_OBJECT_UNLOCK(replaysrc);
+
+    ret = gst_vimba_replay_src_wait(replaysrc, pts);
+    if (ret != GST_FLOW_OK) {
+        return ret;
+    }
+
+    buf = gst_vimba_replay_src_frame(replaysrc, entry);
+    if (buf == NULL) {
+        return GST_FLOW_ERROR;
+    }
+
+    GST_BUFFER_PTS(buf) = pts;
+    GST_BUFFER_DTS(buf) = pts;
+    GST_BUFFER_DURATION(buf) = duration;
+    /* the trigger id is not recorded, the frame id stands in for it */
+    GST_BUFFER_OFFSET(buf) = entry->frame_id;
+    GST_BUFFER_OFFSET_END(buf) = entry->frame_id + 1;
+    if (discont || (entry->flags & VIMBA_RAW_ENTRY_DISCONT)) {
+        GST_BUFFER_FLAG_SET(buf, GST_BUFFER_FLAG_DISCONT);
+    }
+    if (entry->status != VIMBA_RAW_STATUS_COMPLETE) {
+        GST_BUFFER_FLAG_SET(buf, GST_BUFFER_FLAG_CORRUPTED);
+    }
+
+    meta = gst_buffer_add_vimba_frame_meta(buf);
+    meta->frame_id = entry->frame_id;
+    meta->device_timestamp = entry->device_timestamp;
+    meta->trigger_id = entry->frame_id;
+    meta->receive_status = entry->status;
+
+    GST_OBJECT_LOCK(replaysrc);
+    replaysrc->frames_pushed++;
+    GST_OBJECT_UNLOCK(replaysrc);
+
+    *bufp = buf;
+    return GST_FLOW_OK;
+}
@@ -0,0 +1,85 @@
+/* GStreamer
+ * Copyright (C) 2015 Art+Com AG <info@artcom.de>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef _GST_VIMBA_REPLAY_SRC_H_
+#define _GST_VIMBA_REPLAY_SRC_H_
+
+#include <gst/base/gstpushsrc.h>
+#include "vimbarawformat.h"
+
+G_BEGIN_DECLS
+
+#define GST_TYPE_VIMBA_REPLAY_SRC   (gst_vimba_replay_src_get_type())
+#define GST_VIMBA_REPLAY_SRC(obj)   (G_TYPE_CHECK_INSTANCE_CAST((obj),GST_TYPE_VIMBA_REPLAY_SRC,GstVimbaReplaySrc))
+#define GST_VIMBA_REPLAY_SRC_CLASS(klass)   (G_TYPE_CHECK_CLASS_CAST((klass),GST_TYPE_VIMBA_REPLAY_SRC,GstVimbaReplaySrcClass))
+#define GST_IS_VIMBA_REPLAY_SRC(obj)   (G_TYPE_CHECK_INSTANCE_TYPE((obj),GST_TYPE_VIMBA_REPLAY_SRC))
+#define GST_IS_VIMBA_REPLAY_SRC_CLASS(obj)   (G_TYPE_CHECK_CLASS_TYPE((klass),GST_TYPE_VIMBA_REPLAY_SRC))
+
+typedef struct _GstVimbaReplaySrc GstVimbaReplaySrc;
+typedef struct _GstVimbaReplaySrcClass GstVimbaReplaySrcClass;
+
+/* when frames are pushed */
+typedef enum {
+    GST_VIMBA_REPLAY_PACING_REALTIME,
+    GST_VIMBA_REPLAY_PACING_RATE,
+    GST_VIMBA_REPLAY_PACING_ASAP
+} GstVimbaReplayPacing;
+
+/* a mapped segment file, shared by the buffers pointing into it */
+typedef struct {
+    gint     refcount;
+    guint8*  data;
+    gsize    size;
+} GstVimbaReplaySegment;
+
+struct _GstVimbaReplaySrc
+{
+    GstPushSrc             base_vimbareplaysrc;
+
+    gchar*                 location;
+    GstVimbaReplayPacing   pacing;
+    gdouble                rate;
+
+    /* the mapped index */
+    guint8*                index_map;
+    gsize                  index_size;
+    const VimbaRawHeader*  header;
+    guint64                n_entries;
+    GstCaps*               caps;
+    GPtrArray*             segments;
+
+    /* replay position, protected by the object lock */
+    guint64                position;
+    gboolean               discont;
+    GstClockID             clock_id;
+    gboolean               flushing;
+
+    guint64                frames_pushed;
+};
+
+struct _GstVimbaReplaySrcClass
+{
+    GstPushSrcClass base_vimbareplaysrc_class;
+};
+
+GType gst_vimba_replay_src_get_type (void);
+
+G_END_DECLS
+
+#endif
@@ -0,0 +1,504 @@
+/* GStreamer
+ * Copyright (C) 2015 Art+Com AG <info@artcom.de>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Suite 500,
+ * Boston, MA 02110-1335, USA.
+ */
+/**
+ * SECTION:element-gstvimbashmsrc
+ *
+ * The vimbashmsrc element receives the frames a vimbasrc in another process
+ * publishes with its shm-name property. Frames are read in place from the
+ * shared ring, with the caps, frame id, trigger id and device timestamp the
+ * owner saw, and stay pinned there until their buffer is freed. Frames that
+ * were overwritten before this consumer got to them are skipped and the next
+ * buffer is flagged %GST_BUFFER_FLAG_DISCONT. When the owner goes away the
+ * element waits for it to come back.
+ *
+ * <refsect2>
+ * <title>Example launch line</title>
+ * |[
+ * gst-launch-1.0 vimbasrc camera=DEV_A shm-name=cam-a ! fakesink
+ * gst-launch-1.0 vimbashmsrc shm-name=cam-a ! videoconvert ! autovideosink
+ * ]|
+ * </refsect2>
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <gst/gst.h>
+#include <gst/base/gstpushsrc.h>
+#include "gstvimbameta.h"
+#include "gstvimbashmsrc.h"
+
+GST_DEBUG_CATEGORY_STATIC (gst_vimba_shm_src_debug_category);
+#define GST_CAT_DEFAULT gst_vimba_shm_src_debug_category
+
+/* longest wait before the streaming thread checks for flushing */
+#define SHM_POLL_US 100000
+
+/* prototypes */
+
+static void gst_vimba_shm_src_set_property (GObject * object,
+        guint property_id, const GValue * value, GParamSpec * pspec);
+static void gst_vimba_shm_src_get_property (GObject * object,
+        guint property_id, GValue * value, GParamSpec * pspec);
+static void gst_vimba_shm_src_finalize (GObject * object);
+static GstCaps *gst_vimba_shm_src_get_caps (GstBaseSrc * src,
+        GstCaps * filter);
+static gboolean gst_vimba_shm_src_start (GstBaseSrc * src);
+static gboolean gst_vimba_shm_src_stop (GstBaseSrc * src);
+static gboolean gst_vimba_shm_src_unlock (GstBaseSrc * src);
+static gboolean gst_vimba_shm_src_unlock_stop (GstBaseSrc * src);
+static GstFlowReturn gst_vimba_shm_src_create (GstPushSrc * src,
+        GstBuffer ** buf);
+
+enum
+{
+    PROP_0,
+    PROP_SHM_NAME,
+    PROP_FRAMES_RECEIVED,
+    PROP_FRAMES_DROPPED
+};
+
+/* pad templates */
+
+static GstStaticPadTemplate gst_vimba_shm_src_src_template =
+GST_STATIC_PAD_TEMPLATE ("src",
+    GST_PAD_SRC,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS_ANY
+);
+
+/* class initialization */
+
+G_DEFINE_TYPE_WITH_CODE (
+    GstVimbaShmSrc,
+    gst_vimba_shm_src,
+    GST_TYPE_PUSH_SRC,
+    GST_DEBUG_CATEGORY_INIT (
+        gst_vimba_shm_src_debug_category,
+        "vimbashmsrc",
+        0,
+        "debug category for vimbashmsrc element"
+    )
+);
+
+static void
+gst_vimba_shm_src_class_init (GstVimbaShmSrcClass * klass)
+{
+    GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+    GstBaseSrcClass *base_src_class = GST_BASE_SRC_CLASS (klass);
+    GstPushSrcClass *push_src_class = GST_PUSH_SRC_CLASS (klass);
+
+    gst_element_class_add_pad_template (GST_ELEMENT_CLASS(klass),
+            gst_static_pad_template_get (&gst_vimba_shm_src_src_template));
+
+    gst_element_class_set_static_metadata (
+        GST_ELEMENT_CLASS(klass),
+        "VIMBA Shared Memory Source",
+        "Source/Video",
+        "Receives camera frames a vimbasrc in another process shares",
+        "Art+Com AG <info@artcom.de>"
+    );
+
+    gobject_class->set_property = gst_vimba_shm_src_set_property;
+    gobject_class->get_property = gst_vimba_shm_src_get_property;
+    gobject_class->finalize = gst_vimba_shm_src_finalize;
+    base_src_class->get_caps = GST_DEBUG_FUNCPTR (gst_vimba_shm_src_get_caps);
+    base_src_class->start = GST_DEBUG_FUNCPTR (gst_vimba_shm_src_start);
+    base_src_class->stop = GST_DEBUG_FUNCPTR (gst_vimba_shm_src_stop);
+    base_src_class->unlock = GST_DEBUG_FUNCPTR (gst_vimba_shm_src_unlock);
+    base_src_class->unlock_stop = GST_DEBUG_FUNCPTR (gst_vimba_shm_src_unlock_stop);
+    push_src_class->create = GST_DEBUG_FUNCPTR (gst_vimba_shm_src_create);
+
+    g_object_class_install_property(
+        gobject_class,
+        PROP_SHM_NAME,
+        g_param_spec_string(
+            "shm-name",
+            "Shared memory name",
+            "Name of the shared frame ring, as set on the shm-name of vimbasrc",
+            NULL,
+            G_PARAM_READWRITE
+        )
+    );
+
+    g_object_class_install_property(
+        gobject_class,
+        PROP_FRAMES_RECEIVED,
+        g_param_spec_uint64(
+            "frames-received",
+            "Frames received",
+            "Frames read from the ring since start",
+            0,
+            G_MAXUINT64,
+            0,
+            G_PARAM_READABLE
+        )
+    );
+
+    g_object_class_install_property(
+        gobject_class,
+        PROP_FRAMES_DROPPED,
+        g_param_spec_uint64(
+            "frames-dropped",
+            "Frames dropped",
+            "Frames overwritten before they were read",
+            0,
+            G_MAXUINT64,
+            0,
+            G_PARAM_READABLE
+        )
+    );
+}
+
+static void
+gst_vimba_shm_src_init (GstVimbaShmSrc *shmsrc)
+{
+    gst_base_src_set_live(GST_BASE_SRC(shmsrc), TRUE);
+    gst_base_src_set_format(GST_BASE_SRC(shmsrc), GST_FORMAT_TIME);
+}
+
+void
+gst_vimba_shm_src_set_property (GObject * object, guint property_id,
+        const GValue * value, GParamSpec * pspec)
+{
+    GstVimbaShmSrc *shmsrc = GST_VIMBA_SHM_SRC (object);
+
+    GST_OBJECT_LOCK(shmsrc);
+    switch (property_id) {
+        case PROP_SHM_NAME:
+            g_free(shmsrc->shm_name);
+            shmsrc->shm_name = g_value_dup_string(value);
+            break;
+        default:
+            G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
+            break;
+    }
+    GST_OBJECT_UNLOCK(shmsrc);
+}
+
+void
+gst_vimba_shm_src_get_property (GObject * object, guint property_id,
+        GValue * value, GParamSpec * pspec)
+{
+    GstVimbaShmSrc *shmsrc = GST_VIMBA_SHM_SRC (object);
+
+    GST_OBJECT_LOCK(shmsrc);
+    switch (property_id) {
+        case PROP_SHM_NAME:
+            g_value_set_string(value, shmsrc->shm_name);
+            break;
+        case PROP_FRAMES_RECEIVED:
+            g_value_set_uint64(value, shmsrc->frames_received);
+            break;
+        case PROP_FRAMES_DROPPED:
+            g_value_set_uint64(value, shmsrc->frames_dropped);
+            break;
+        default:
+            G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
+            break;
+    }
+    GST_OBJECT_UNLOCK(shmsrc);
+}
+
+void
+gst_vimba_shm_src_finalize (GObject * object)
+{
+    GstVimbaShmSrc *shmsrc = GST_VIMBA_SHM_SRC (object);
+
+    g_free(shmsrc->shm_name);
+
+    G_OBJECT_CLASS (gst_vimba_shm_src_parent_class)->finalize (object);
+}
+
+/* basesrc */
+
+static GstCaps *
+gst_vimba_shm_src_get_caps (GstBaseSrc * src, GstCaps * filter)
+{
+    GstVimbaShmSrc *shmsrc = GST_VIMBA_SHM_SRC (src);
+    GstCaps *caps;
+
+    GST_OBJECT_LOCK(shmsrc);
+    if (shmsrc->caps != NULL) {
+        caps = gst_caps_ref(shmsrc->caps);
+    } else {
+        caps = gst_pad_get_pad_template_caps(GST_BASE_SRC_PAD(src));
+    }
+    GST_OBJECT_UNLOCK(shmsrc);
+
+    if (filter != NULL) {
+        GstCaps *tmp = gst_caps_intersect_full(filter, caps,
+            GST_CAPS_INTERSECT_FIRST);
+        gst_caps_unref(caps);
+        caps = tmp;
+    }
+    return caps;
+}
+
+static gboolean
+gst_vimba_shm_src_start (GstBaseSrc * src)
+{
+    GstVimbaShmSrc *shmsrc = GST_VIMBA_SHM_SRC (src);
+
+    GST_OBJECT_LOCK(shmsrc);
+    if (shmsrc->shm_name == NULL) {
+        GST_OBJECT_UNLOCK(shmsrc);
+        GST_ELEMENT_ERROR(shmsrc, RESOURCE, NOT_FOUND,
+            ("No shared memory name specified."), (NULL));
+        return FALSE;
+    }
+    shmsrc->frames_received = 0;
+    shmsrc->frames_dropped = 0;
+    GST_OBJECT_UNLOCK(shmsrc);
+
+    shmsrc->have_caps = FALSE;
+    shmsrc->discont = TRUE;
+    return TRUE;
+}
+
+static gboolean
+gst_vimba_shm_src_stop (GstBaseSrc * src)
+{
+    GstVimbaShmSrc *shmsrc = GST_VIMBA_SHM_SRC (src);
+
+    /* buffers still downstream keep the ring mapped */
+    vimba_shm_consumer_unref(shmsrc->consumer);
+    shmsrc->consumer = NULL;
+
+    GST_OBJECT_LOCK(shmsrc);
+    gst_caps_replace(&shmsrc->caps, NULL);
+    GST_OBJECT_UNLOCK(shmsrc);
+
+    GST_DEBUG_OBJECT (shmsrc, "stop");
+    return TRUE;
+}
+
+static gboolean
+gst_vimba_shm_src_unlock (GstBaseSrc * src)
+{
+    GstVimbaShmSrc *shmsrc = GST_VIMBA_SHM_SRC (src);
+
+    GST_OBJECT_LOCK(shmsrc);
+    shmsrc->flushing = TRUE;
+    GST_OBJECT_UNLOCK(shmsrc);
+    return TRUE;
+}
+
+static gboolean
+gst_vimba_shm_src_unlock_stop (GstBaseSrc * src)
+{
+    GstVimbaShmSrc *shmsrc = GST_VIMBA_SHM_SRC (src);
+
+    GST_OBJECT_LOCK(shmsrc);
+    shmsrc->flushing = FALSE;
+    GST_OBJECT_UNLOCK(shmsrc);
+    return TRUE;
+}
+
+static gboolean
+gst_vimba_shm_src_flushing (GstVimbaShmSrc * shmsrc)
+{
+    gboolean flushing;
+
+    GST_OBJECT_LOCK(shmsrc);
+    flushing = shmsrc->flushing;
+    GST_OBJECT_UNLOCK(shmsrc);
+    return flushing;
+}
+
+/* attach to the ring, FALSE while the owner is not (yet) there */
+static gboolean
+gst_vimba_shm_src_attach (GstVimbaShmSrc * shmsrc)
+{
+    gchar *name;
+
+    GST_OBJECT_LOCK(shmsrc);
+    name = g_strdup(shmsrc->shm_name);
+    GST_OBJECT_UNLOCK(shmsrc);
+
+    shmsrc->consumer = vimba_shm_consumer_open(name);
+    if (shmsrc->consumer != NULL) {
+        GST_INFO_OBJECT(shmsrc, "attached to %s", name);
+        shmsrc->have_caps = FALSE;
+        shmsrc->dropped = 0;
+        shmsrc->discont = TRUE;
+    }
+    g_free(name);
+    return shmsrc->consumer != NULL;
+}
+
+/* follow the caps of the owner, they change only between frames */
+static gboolean
+gst_vimba_shm_src_update_caps (GstVimbaShmSrc * shmsrc, guint32 caps_seq)
+{
+    GstCaps *caps = NULL;
+    gchar *string;
+
+    if (shmsrc->have_caps && shmsrc->caps_seq == caps_seq) {
+        return TRUE;
+    }
+    string = vimba_shm_consumer_caps(shmsrc->consumer, &shmsrc->caps_seq);
+    if (string[0] != '\0') {
+        caps = gst_caps_from_string(string);
+    }
+    if (caps == NULL || gst_caps_is_empty(caps)) {
+        GST_ELEMENT_ERROR(shmsrc, STREAM, FORMAT,
+            ("The shared frames have no caps (\"%s\").", string), (NULL));
+        if (caps != NULL) {
+            gst_caps_unref(caps);
+        }
+        g_free(string);
+        return FALSE;
+    }
+    g_free(string);
+
+    GST_OBJECT_LOCK(shmsrc);
+    gst_caps_replace(&shmsrc->caps, caps);
+    GST_OBJECT_UNLOCK(shmsrc);
+    shmsrc->have_caps = TRUE;
+
+    GST_DEBUG_OBJECT(shmsrc, "caps %" GST_PTR_FORMAT, caps);
+    if (!gst_base_src_set_caps(GST_BASE_SRC(shmsrc), caps)) {
+        gst_caps_unref(caps);
+        return FALSE;
+    }
+    gst_caps_unref(caps);
+    return TRUE;
+}
+
+typedef struct {
+    VimbaShmConsumer *consumer;
+    guint             slot;
+} GstVimbaShmSrcPin;
+
+static void
+gst_vimba_shm_src_unpin (gpointer data)
+{
+    GstVimbaShmSrcPin *pin = data;
+
+    vimba_shm_consumer_release(pin->consumer, pin->slot);
+    vimba_shm_consumer_unref(pin->consumer);
+    g_slice_free(GstVimbaShmSrcPin, pin);
+}
+
+/* running time a frame reached the owner, both share the monotonic clock */
+static GstClockTime
+gst_vimba_shm_src_capture_time (GstVimbaShmSrc * shmsrc, guint64 capture_time)
+{
+    GstClockTimeDiff clock_offset;
+    GstClockTime base_time;
+    GstClock *clock;
+    gint64 time;
+
+    GST_OBJECT_LOCK(shmsrc);
+    if ((clock = GST_ELEMENT_CLOCK(shmsrc)) != NULL) {
+        gst_object_ref(clock);
+    }
+    base_time = GST_ELEMENT_CAST(shmsrc)->base_time;
+    GST_OBJECT_UNLOCK(shmsrc);
+
+    if (clock == NULL || capture_time == 0) {
+        if (clock != NULL) {
+            gst_object_unref(clock);
+        }
+        return GST_CLOCK_TIME_NONE;
+    }
+    clock_offset = GST_CLOCK_DIFF(gst_util_get_timestamp(),
+        gst_clock_get_time(clock));
+    gst_object_unref(clock);
+    time = (gint64) capture_time + clock_offset - (gint64) base_time;
+    return time > 0 ? (GstClockTime) time : 0;
+}
+
+static GstFlowReturn
+gst_vimba_shm_src_create (GstPushSrc * src, GstBuffer ** bufp)
+{
+    GstVimbaShmSrc *shmsrc = GST_VIMBA_SHM_SRC (src);
+    GstVimbaShmSrcPin *pin;
+    GstVimbaFrameMeta *meta;
+    VimbaShmFrame frame;
+    guint64 received, dropped;
+    GstBuffer *buf;
+
+    for (;;) {
+        if (gst_vimba_shm_src_flushing(shmsrc)) {
+            return GST_FLOW_FLUSHING;
+        }
+        if (shmsrc->consumer == NULL && !gst_vimba_shm_src_attach(shmsrc)) {
+            g_usleep(SHM_POLL_US);
+            continue;
+        }
+        switch (vimba_shm_consumer_read(shmsrc->consumer, SHM_POLL_US, &frame)) {
+            case VIMBA_SHM_OK:
+                break;
+            case VIMBA_SHM_TIMEOUT:
+                continue;
+            case VIMBA_SHM_CLOSED:
+                GST_INFO_OBJECT(shmsrc, "the owner closed the ring or died");
+                vimba_shm_consumer_unref(shmsrc->consumer);
+                shmsrc->consumer = NULL;
+                continue;
+        }
+        break;
+    }
+
+    if (!gst_vimba_shm_src_update_caps(shmsrc, frame.info.caps_seq)) {
+        vimba_shm_consumer_release(shmsrc->consumer, frame.slot);
+        return GST_FLOW_NOT_NEGOTIATED;
+    }
+
+    pin = g_slice_new(GstVimbaShmSrcPin);
+    pin->consumer = vimba_shm_consumer_ref(shmsrc->consumer);
+    pin->slot = frame.slot;
+    buf = gst_buffer_new_wrapped_full(GST_MEMORY_FLAG_READONLY,
+        (gpointer) frame.data, frame.size, 0, frame.size,
+        pin, gst_vimba_shm_src_unpin);
+
+    GST_BUFFER_PTS(buf) = gst_vimba_shm_src_capture_time(shmsrc,
+        frame.info.capture_time);
+    GST_BUFFER_DTS(buf) = GST_BUFFER_PTS(buf);
+    GST_BUFFER_DURATION(buf) = frame.info.duration;
+    GST_BUFFER_OFFSET(buf) = frame.info.trigger_id;
+    GST_BUFFER_OFFSET_END(buf) = frame.info.trigger_id + 1;
+    if (frame.info.status != 0) {
+        GST_BUFFER_FLAG_SET(buf, GST_BUFFER_FLAG_CORRUPTED);
+    }
+
+    meta = gst_buffer_add_vimba_frame_meta(buf);
+    meta->frame_id = frame.info.frame_id;
+    meta->device_timestamp = frame.info.device_timestamp;
+    meta->trigger_id = frame.info.trigger_id;
+    meta->receive_status = frame.info.status;
+    meta->callback_time = frame.info.capture_time;
+
+    vimba_shm_consumer_stats(shmsrc->consumer, &received, &dropped);
+    if (shmsrc->discont || dropped != shmsrc->dropped) {
+        GST_BUFFER_FLAG_SET(buf, GST_BUFFER_FLAG_DISCONT);
+        shmsrc->discont = FALSE;
+    }
+    GST_OBJECT_LOCK(shmsrc);
+    shmsrc->frames_received++;
+    shmsrc->frames_dropped += dropped - shmsrc->dropped;
+    GST_OBJECT_UNLOCK(shmsrc);
+    shmsrc->dropped = dropped;
+
+    *bufp = buf;
+    return GST_FLOW_OK;
+}
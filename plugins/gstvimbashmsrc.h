@@ -0,0 +1,66 @@
+/* GStreamer
+ * Copyright (C) 2015 Art+Com AG <info@artcom.de>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef _GST_VIMBA_SHM_SRC_H_
+#define _GST_VIMBA_SHM_SRC_H_
+
+#include <gst/base/gstpushsrc.h>
+#include "vimbashm.h"
+
+G_BEGIN_DECLS
+
+#define GST_TYPE_VIMBA_SHM_SRC   (gst_vimba_shm_src_get_type())
+#define GST_VIMBA_SHM_SRC(obj)   (G_TYPE_CHECK_INSTANCE_CAST((obj),GST_TYPE_VIMBA_SHM_SRC,GstVimbaShmSrc))
+#define GST_VIMBA_SHM_SRC_CLASS(klass)   (G_TYPE_CHECK_CLASS_CAST((klass),GST_TYPE_VIMBA_SHM_SRC,GstVimbaShmSrcClass))
+#define GST_IS_VIMBA_SHM_SRC(obj)   (G_TYPE_CHECK_INSTANCE_TYPE((obj),GST_TYPE_VIMBA_SHM_SRC))
+#define GST_IS_VIMBA_SHM_SRC_CLASS(obj)   (G_TYPE_CHECK_CLASS_TYPE((klass),GST_TYPE_VIMBA_SHM_SRC))
+
+typedef struct _GstVimbaShmSrc GstVimbaShmSrc;
+typedef struct _GstVimbaShmSrcClass GstVimbaShmSrcClass;
+
+struct _GstVimbaShmSrc
+{
+    GstPushSrc          base_vimbashmsrc;
+
+    gchar*              shm_name;
+
+    /* attached ring, only touched by the streaming thread */
+    VimbaShmConsumer*   consumer;
+    guint32             caps_seq;
+    gboolean            have_caps;
+    guint64             dropped;
+    gboolean            discont;
+
+    /* protected by the object lock */
+    GstCaps*            caps;
+    gboolean            flushing;
+    guint64             frames_received;
+    guint64             frames_dropped;
+};
+
+struct _GstVimbaShmSrcClass
+{
+    GstPushSrcClass base_vimbashmsrc_class;
+};
+
+GType gst_vimba_shm_src_get_type (void);
+
+G_END_DECLS
+
+#endif
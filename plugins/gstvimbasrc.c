@@ -41,7 +41,14 @@
 #include <gst/base/gstpushsrc.h>
 #include <gst/video/video-info.h>
 #include "pixelformat.h"
+#include "vimbasync.h"
 #include "gstvimbasrc.h"
+#include "gstvimbaalign.h"
+#include "gstvimbameta.h"
+#include "gstvimbatracer.h"
+#include "gstvimbarawsink.h"
+#include "gstvimbareplaysrc.h"
+#include "gstvimbashmsrc.h"
 
 GST_DEBUG_CATEGORY_STATIC (gst_vimba_src_debug_category);
 #define GST_CAT_DEFAULT gst_vimba_src_debug_category
@@ -56,18 +63,200 @@ static void gst_vimba_src_dispose (GObject * object);
 static void gst_vimba_src_finalize (GObject * object);
 static GstCaps *gst_vimba_src_get_caps (GstBaseSrc * src, GstCaps * filter);
 static gboolean gst_vimba_src_set_caps (GstBaseSrc * src, GstCaps * caps);
+static GstCaps *gst_vimba_src_fixate (GstBaseSrc * src, GstCaps * caps);
 static gboolean gst_vimba_src_start (GstBaseSrc * src);
 static gboolean gst_vimba_src_stop (GstBaseSrc * src);
 static GstFlowReturn gst_vimba_src_create (GstPushSrc * src, GstBuffer **buf);
+static guint64 gst_vimba_src_trigger (GstVimbaSrc * vimbasrc);
+static gboolean gst_vimba_src_set_feature (GstVimbaSrc * vimbasrc,
+        const gchar * name, const gchar * value);
+static gchar *gst_vimba_src_get_feature (GstVimbaSrc * vimbasrc,
+        const gchar * name);
+static void gst_vimba_src_feature_written (const gchar * name,
+        guint64 generation, gboolean ok, gpointer user_data);
+static gboolean gst_vimba_src_event (GstBaseSrc * src, GstEvent * event);
+static gboolean gst_vimba_src_query (GstBaseSrc * src, GstQuery * query);
+static void gst_vimba_src_qos_reset (GstVimbaSrc * vimbasrc);
+static void gst_vimba_src_qos_snapshot (GstVimbaSrc * vimbasrc);
+static GstClock *gst_vimba_src_provide_clock (GstElement * element);
+static gboolean gst_vimba_src_post_message (GstElement * element,
+        GstMessage * message);
+static gboolean gst_vimba_src_unlock (GstBaseSrc * src);
+static gboolean gst_vimba_src_unlock_stop (GstBaseSrc * src);
+static gboolean gst_vimba_src_burst_trigger (GstVimbaSrc * vimbasrc);
+static gboolean gst_vimba_src_save_settings (GstVimbaSrc * vimbasrc,
+        const gchar * path);
+static gboolean gst_vimba_src_calibrate (GstVimbaSrc * vimbasrc,
+        const gchar * kind, guint frames);
+static GstPad *gst_vimba_src_request_new_pad (GstElement * element,
+        GstPadTemplate * templ, const gchar * name, const GstCaps * caps);
+static void gst_vimba_src_release_pad (GstElement * element, GstPad * pad);
+static GstPadProbeReturn gst_vimba_src_preview_probe (GstPad * pad,
+        GstPadProbeInfo * info, gpointer user_data);
 
 enum
 {
     PROP_0,
     PROP_CAMERA,
     PROP_OFFSET_X,
-    PROP_OFFSET_Y
+    PROP_OFFSET_Y,
+    PROP_LINK_BUDGET,
+    PROP_STATS,
+    PROP_TRIGGER_MODE,
+    PROP_TRIGGER_LINE,
+    PROP_TRIGGER_RATE,
+    PROP_ACTION_DEVICE_KEY,
+    PROP_ACTION_GROUP_KEY,
+    PROP_ACTION_GROUP_MASK,
+    PROP_CHUNK_MODE,
+    PROP_EXPOSURE_TIME,
+    PROP_GAIN,
+    PROP_FEATURES,
+    PROP_BURST_FRAMES,
+    PROP_POST_TRIGGER_FRAMES,
+    PROP_DROP_INCOMPLETE,
+    PROP_NUMA_NODE,
+    PROP_NETWORK_INTERFACE,
+    PROP_HUGEPAGES,
+    PROP_LOCK_MEMORY,
+    PROP_STREAMING_CPUS,
+    PROP_STREAMING_PRIORITY,
+    PROP_CALLBACK_CPUS,
+    PROP_CALLBACK_PRIORITY,
+    PROP_MAX_BATCH,
+    PROP_BATCH_LATENCY,
+    PROP_PREVIEW_SCALE,
+    PROP_PREVIEW_DECIMATION,
+    PROP_FD_MEMORY,
+    PROP_SHM_NAME,
+    PROP_SHM_SLOTS,
+    PROP_SHM_DROP_POLICY,
+    PROP_FEATURE_GENERATION,
+    PROP_SETTINGS_FILE,
+    PROP_QOS_THROTTLE,
+    PROP_IMAGE_STATS_INTERVAL,
+    PROP_IMAGE_STATS_STEP,
+    PROP_CORRECTION,
+    PROP_CALIBRATION_DIR,
+    PROP_PTP_MODE,
+    PROP_PTP_CLOCK,
+    PROP_TIMESTAMP_MODE,
+    PROP_FD_FRAMES
 };
 
+enum
+{
+    SIGNAL_TRIGGER,
+    SIGNAL_SET_FEATURE,
+    SIGNAL_GET_FEATURE,
+    SIGNAL_BURST_TRIGGER,
+    SIGNAL_SAVE_SETTINGS,
+    SIGNAL_CALIBRATE,
+    LAST_SIGNAL
+};
+
+/* feature names differ between camera families, the first one found wins */
+static const char * const exposure_features[] = {
+    "ExposureTimeAbs", "ExposureTime", NULL
+};
+static const char * const gain_features[] = {
+    "Gain", "GainRaw", NULL
+};
+
+static guint gst_vimba_src_signals[LAST_SIGNAL] = { 0 };
+
+/* how long the streaming thread waits for a frame before checking for
+ * flushes and a lost camera */
+#define FRAME_POLL_US 100000
+
+/* ring frames downstream may hold with fd-memory before capture stalls */
+#define DEFAULT_FD_FRAMES 16
+
+static GstStaticCaps device_timestamp_static_caps =
+    GST_STATIC_CAPS (GST_VIMBA_DEVICE_TIMESTAMP_CAPS);
+static GstCaps *device_timestamp_caps = NULL;
+
+#define GST_TYPE_VIMBA_SRC_TRIGGER_MODE (gst_vimba_src_trigger_mode_get_type())
+static GType
+gst_vimba_src_trigger_mode_get_type (void)
+{
+    static GType trigger_mode_type = 0;
+    static const GEnumValue trigger_modes[] = {
+        {VIMBA_TRIGGER_FREERUN, "Free running acquisition", "free-run"},
+        {VIMBA_TRIGGER_SOFTWARE, "Software trigger (trigger signal)", "software"},
+        {VIMBA_TRIGGER_LINE, "Hardware trigger on an input line", "line"},
+        {VIMBA_TRIGGER_ACTION, "Action command shared by a sync group", "action"},
+        {0, NULL, NULL}
+    };
+
+    if (!trigger_mode_type) {
+        trigger_mode_type = g_enum_register_static(
+            "GstVimbaSrcTriggerMode", trigger_modes
+        );
+    }
+    return trigger_mode_type;
+}
+
+#define GST_TYPE_VIMBA_SRC_SHM_DROP_POLICY (gst_vimba_src_shm_drop_policy_get_type())
+static GType
+gst_vimba_src_shm_drop_policy_get_type (void)
+{
+    static GType drop_policy_type = 0;
+    static const GEnumValue drop_policies[] = {
+        {VIMBA_SHM_DROP_FRAME, "Drop the frame for all consumers", "drop-frame"},
+        {VIMBA_SHM_WAIT, "Wait up to a second for the slow consumer", "wait"},
+        {0, NULL, NULL}
+    };
+
+    if (!drop_policy_type) {
+        drop_policy_type = g_enum_register_static(
+            "GstVimbaSrcShmDropPolicy", drop_policies
+        );
+    }
+    return drop_policy_type;
+}
+
+#define GST_TYPE_VIMBA_SRC_PTP_MODE (gst_vimba_src_ptp_mode_get_type())
+static GType
+gst_vimba_src_ptp_mode_get_type (void)
+{
+    static GType ptp_mode_type = 0;
+    static const GEnumValue ptp_modes[] = {
+        {VIMBA_PTP_MODE_NONE, "Leave PtpMode as configured", "none"},
+        {VIMBA_PTP_MODE_OFF, "No PTP synchronization", "off"},
+        {VIMBA_PTP_MODE_SLAVE, "Follow the PTP master", "slave"},
+        {VIMBA_PTP_MODE_MASTER, "Act as PTP master", "master"},
+        {VIMBA_PTP_MODE_AUTO, "Take part in the master election", "auto"},
+        {0, NULL, NULL}
+    };
+
+    if (!ptp_mode_type) {
+        ptp_mode_type = g_enum_register_static(
+            "GstVimbaSrcPtpMode", ptp_modes
+        );
+    }
+    return ptp_mode_type;
+}
+
+#define GST_TYPE_VIMBA_SRC_TIMESTAMP_MODE (gst_vimba_src_timestamp_mode_get_type())
+static GType
+gst_vimba_src_timestamp_mode_get_type (void)
+{
+    static GType timestamp_mode_type = 0;
+    static const GEnumValue timestamp_modes[] = {
+        {VIMBA_TIMESTAMP_HOST, "Pipeline clock when the frame is pushed", "host"},
+        {VIMBA_TIMESTAMP_DEVICE, "Device time of the exposure", "device"},
+        {0, NULL, NULL}
+    };
+
+    if (!timestamp_mode_type) {
+        timestamp_mode_type = g_enum_register_static(
+            "GstVimbaSrcTimestampMode", timestamp_modes
+        );
+    }
+    return timestamp_mode_type;
+}
+
 #define VIMBASRC_VIDEO_CAPS GST_VIDEO_CAPS_MAKE (GST_VIDEO_FORMATS_ALL) ";" \
   "video/x-bayer, format=(string) { bggr, rggb, grbg, gbrg }, "        \
   "width = " GST_VIDEO_SIZE_RANGE ", "                                 \
@@ -83,6 +272,13 @@ GST_STATIC_PAD_TEMPLATE ("src",
     GST_STATIC_CAPS (VIMBASRC_VIDEO_CAPS)
 );
 
+static GstStaticPadTemplate gst_vimba_src_preview_template =
+GST_STATIC_PAD_TEMPLATE ("preview",
+    GST_PAD_SRC,
+    GST_PAD_REQUEST,
+    GST_STATIC_CAPS (GST_VIDEO_CAPS_MAKE ("{ GRAY8, RGB, BGR }"))
+);
+
 
 /* class initialization */
 
@@ -109,6 +305,8 @@ gst_vimba_src_class_init (GstVimbaSrcClass * klass)
        base_class_init if you intend to subclass this class. */
     gst_element_class_add_pad_template (GST_ELEMENT_CLASS(klass),
             gst_static_pad_template_get (&gst_vimba_src_src_template));
+    gst_element_class_add_pad_template (GST_ELEMENT_CLASS(klass),
+            gst_static_pad_template_get (&gst_vimba_src_preview_template));
 
     gst_element_class_set_static_metadata (
         GST_ELEMENT_CLASS(klass),
@@ -122,11 +320,32 @@ gst_vimba_src_class_init (GstVimbaSrcClass * klass)
     gobject_class->get_property = gst_vimba_src_get_property;
     gobject_class->dispose = gst_vimba_src_dispose;
     gobject_class->finalize = gst_vimba_src_finalize;
+    GST_ELEMENT_CLASS(klass)->request_new_pad =
+        GST_DEBUG_FUNCPTR (gst_vimba_src_request_new_pad);
+    GST_ELEMENT_CLASS(klass)->release_pad =
+        GST_DEBUG_FUNCPTR (gst_vimba_src_release_pad);
+    GST_ELEMENT_CLASS(klass)->provide_clock =
+        GST_DEBUG_FUNCPTR (gst_vimba_src_provide_clock);
+    GST_ELEMENT_CLASS(klass)->post_message =
+        GST_DEBUG_FUNCPTR (gst_vimba_src_post_message);
     base_src_class->get_caps = GST_DEBUG_FUNCPTR (gst_vimba_src_get_caps);
     base_src_class->set_caps = GST_DEBUG_FUNCPTR (gst_vimba_src_set_caps);
+    base_src_class->fixate = GST_DEBUG_FUNCPTR (gst_vimba_src_fixate);
     base_src_class->start = GST_DEBUG_FUNCPTR (gst_vimba_src_start);
     base_src_class->stop = GST_DEBUG_FUNCPTR (gst_vimba_src_stop);
+    base_src_class->event = GST_DEBUG_FUNCPTR (gst_vimba_src_event);
+    base_src_class->query = GST_DEBUG_FUNCPTR (gst_vimba_src_query);
+    base_src_class->unlock = GST_DEBUG_FUNCPTR (gst_vimba_src_unlock);
+    base_src_class->unlock_stop = GST_DEBUG_FUNCPTR (gst_vimba_src_unlock_stop);
     push_src_class->create = GST_DEBUG_FUNCPTR (gst_vimba_src_create);
+    klass->trigger = gst_vimba_src_trigger;
+    klass->set_feature = gst_vimba_src_set_feature;
+    klass->get_feature = gst_vimba_src_get_feature;
+    klass->burst_trigger = gst_vimba_src_burst_trigger;
+    klass->save_settings = gst_vimba_src_save_settings;
+    klass->calibrate = gst_vimba_src_calibrate;
+
+    device_timestamp_caps = gst_static_caps_get(&device_timestamp_static_caps);
 
     /* define properties */
     g_object_class_install_property(
@@ -169,293 +388,3420 @@ gst_vimba_src_class_init (GstVimbaSrcClass * klass)
         )
     );
 
-}
-
-static void
-gst_vimba_src_init (GstVimbaSrc *vimbasrc)
-{
+    g_object_class_install_property(
+        gobject_class,
+        PROP_LINK_BUDGET,
+        g_param_spec_uint64(
+            "link-budget",
+            "Link budget",
+            "Bandwidth in bytes per second available for streaming, used to "
+            "rank pixel formats during negotiation (0 = use the camera's "
+            "StreamBytesPerSecond)",
+            0,
+            G_MAXUINT64,
+            0,
+            G_PARAM_READWRITE
+        )
+    );
 
-    g_mutex_init(&vimbasrc->config_lock);
+    g_object_class_install_property(
+        gobject_class,
+        PROP_STATS,
+        g_param_spec_boxed(
+            "stats",
+            "Statistics",
+            "Negotiation and streaming statistics",
+            GST_TYPE_STRUCTURE,
+            G_PARAM_READABLE
+        )
+    );
 
-    g_mutex_lock(&vimbasrc->config_lock);
-    vimbasrc->vimba  = vimba_init();
-    vimba_discover(vimbasrc->vimba);
-    vimbasrc->camera = vimbacamera_init();
+    g_object_class_install_property(
+        gobject_class,
+        PROP_TRIGGER_MODE,
+        g_param_spec_enum(
+            "trigger-mode",
+            "Trigger mode",
+            "What starts the exposure of a frame, applied when acquisition "
+            "starts",
+            GST_TYPE_VIMBA_SRC_TRIGGER_MODE,
+            VIMBA_TRIGGER_FREERUN,
+            G_PARAM_READWRITE
+        )
+    );
 
-    /* Startup the Vimba API */
-    g_mutex_unlock(&vimbasrc->config_lock);
-    gst_base_src_set_live(GST_BASE_SRC(vimbasrc), TRUE);
-    gst_base_src_set_format(GST_BASE_SRC(vimbasrc), GST_FORMAT_TIME);
-}
+    g_object_class_install_property(
+        gobject_class,
+        PROP_TRIGGER_LINE,
+        g_param_spec_string(
+            "trigger-line",
+            "Trigger line",
+            "Input line used in line trigger mode",
+            "Line1",
+            G_PARAM_READWRITE
+        )
+    );
 
-void
-gst_vimba_src_set_property (GObject * object, guint property_id,
-        const GValue * value, GParamSpec * pspec)
-{
-    GstVimbaSrc *vimbasrc = GST_VIMBA_SRC (object);
+    g_object_class_install_property(
+        gobject_class,
+        PROP_TRIGGER_RATE,
+        g_param_spec_double(
+            "trigger-rate",
+            "Trigger rate",
+            "Action commands per second sent to the sync group in action "
+            "trigger mode (0 = only when the trigger signal is emitted)",
+            0,
+            G_MAXDOUBLE,
+            0,
+            G_PARAM_READWRITE
+        )
+    );
 
-    GST_DEBUG_OBJECT (vimbasrc, "set_property");
+    g_object_class_install_property(
+        gobject_class,
+        PROP_ACTION_DEVICE_KEY,
+        g_param_spec_uint(
+            "action-device-key",
+            "Action device key",
+            "Device key of action commands in action trigger mode",
+            0,
+            G_MAXUINT32,
+            1,
+            G_PARAM_READWRITE
+        )
+    );
 
-    switch (property_id) {
-        case PROP_CAMERA:
-            g_mutex_lock(&vimbasrc->config_lock);
-            VmbUint32_t i = 0;
-            const gchar* camera_id = g_value_get_string(value);
-            vimbasrc->camera->camera_id = NULL;
-            for (i = 0; i < vimbasrc->vimba->count; ++i) {
-                if (!(strcmp(vimbasrc->vimba->camera_list[i].cameraIdString, camera_id))) {
-                    vimbasrc->camera->camera_id = camera_id;
-                    break;
-                }
-            }
-            /* open the camera */
-            if (vimbasrc->camera->camera_id != NULL) {
-                if (vimbacamera_open(vimbasrc->camera)) {
-                    if (vimbacamera_load(vimbasrc->camera)) {
-                        g_message(
-                                "camera configuration: width: %lu, height: %lu, format: %s",
-                                (unsigned long) vimbasrc->camera->width,
-                                (unsigned long) vimbasrc->camera->height,
-                                vimbasrc->camera->format
-                                );
-                    } else {
-                        g_error("cannot fetch initial camera settings");
-                    }
-                }
-            } else {
-                g_message("Camera %s not found!", camera_id);
-            }
-            g_mutex_unlock(&vimbasrc->config_lock);
-            break;
-        case PROP_OFFSET_X:
-            g_mutex_lock(&vimbasrc->config_lock);
-            int offset_x = g_value_get_int(value);
-            g_message("setting offset x to %d", offset_x);
-            vimbacamera_set_feature_int(vimbasrc->camera, "OffsetX", offset_x);
-            g_mutex_unlock(&vimbasrc->config_lock);
-            break;
-        case PROP_OFFSET_Y:
-            g_mutex_lock(&vimbasrc->config_lock);
-            int offset_y = g_value_get_int(value);
-            g_message("setting offset y to %d", offset_y);
-            vimbacamera_set_feature_int(vimbasrc->camera, "OffsetY", offset_y);
-            g_mutex_unlock(&vimbasrc->config_lock);
-            break;
-        default:
-            G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
-            break;
-    }
-}
+    g_object_class_install_property(
+        gobject_class,
+        PROP_ACTION_GROUP_KEY,
+        g_param_spec_uint(
+            "action-group-key",
+            "Action group key",
+            "Group key of action commands, all sources with the same key are "
+            "triggered together",
+            0,
+            G_MAXUINT32,
+            1,
+            G_PARAM_READWRITE
+        )
+    );
 
-void
-gst_vimba_src_get_property (GObject * object, guint property_id,
-        GValue * value, GParamSpec * pspec)
-{
-    GstVimbaSrc *vimbasrc = GST_VIMBA_SRC (object);
+    g_object_class_install_property(
+        gobject_class,
+        PROP_ACTION_GROUP_MASK,
+        g_param_spec_uint(
+            "action-group-mask",
+            "Action group mask",
+            "Group mask of action commands in action trigger mode",
+            0,
+            G_MAXUINT32,
+            1,
+            G_PARAM_READWRITE
+        )
+    );
 
-    GST_DEBUG_OBJECT (vimbasrc, "get_property");
+    g_object_class_install_property(
+        gobject_class,
+        PROP_CHUNK_MODE,
+        g_param_spec_boolean(
+            "chunk-mode",
+            "Chunk mode",
+            "Let the camera append exposure time, gain, frame counter and line "
+            "status to every frame and attach them as GstVimbaFrameMeta",
+            FALSE,
+            G_PARAM_READWRITE
+        )
+    );
 
-    switch (property_id) {
-        case PROP_CAMERA:
-            g_value_set_string(value, vimbasrc->camera->camera_id);
-            break;
-        case PROP_OFFSET_X:
-            g_value_set_int(value, vimbacamera_get_feature_int(vimbasrc->camera, "OffsetX"));
-            break;
-        case PROP_OFFSET_Y:
-            g_value_set_int(value, vimbacamera_get_feature_int(vimbasrc->camera, "OffsetY"));
-            break;
-        default:
-            G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
-            break;
-    }
-}
+    g_object_class_install_property(
+        gobject_class,
+        PROP_EXPOSURE_TIME,
+        g_param_spec_double(
+            "exposure-time",
+            "Exposure time",
+            "Exposure time in microseconds (-1 = leave camera setting)",
+            -1,
+            G_MAXDOUBLE,
+            -1,
+            G_PARAM_READWRITE | GST_PARAM_CONTROLLABLE
+        )
+    );
 
-void
-gst_vimba_src_dispose (GObject * object)
-{
-    GstVimbaSrc *vimbasrc = GST_VIMBA_SRC (object);
+    g_object_class_install_property(
+        gobject_class,
+        PROP_GAIN,
+        g_param_spec_double(
+            "gain",
+            "Gain",
+            "Gain of the camera (-1 = leave camera setting)",
+            -1,
+            G_MAXDOUBLE,
+            -1,
+            G_PARAM_READWRITE | GST_PARAM_CONTROLLABLE
+        )
+    );
 
-    GST_DEBUG_OBJECT (vimbasrc, "dispose");
+    g_object_class_install_property(
+        gobject_class,
+        PROP_FEATURES,
+        g_param_spec_string(
+            "features",
+            "Features",
+            "Arbitrary camera features as a structure, e.g. "
+            "\"features, ExposureAuto=Off, BalanceRatioAbs=1.2\". Reading "
+            "returns the current values of the features set this way",
+            NULL,
+            G_PARAM_READWRITE
+        )
+    );
 
-    /* clean up as possible.  may be called multiple times */
-    vimbacamera_close(vimbasrc->camera);
+    g_object_class_install_property(
+        gobject_class,
+        PROP_BURST_FRAMES,
+        g_param_spec_uint(
+            "burst-frames",
+            "Burst frames",
+            "Keep the last frames in the ring and only push them, without "
+            "copies, when a burst is triggered (0 = push every frame)",
+            0,
+            G_MAXUINT16,
+            0,
+            G_PARAM_READWRITE
+        )
+    );
 
-    G_OBJECT_CLASS (gst_vimba_src_parent_class)->dispose (object);
-}
+    g_object_class_install_property(
+        gobject_class,
+        PROP_POST_TRIGGER_FRAMES,
+        g_param_spec_uint(
+            "post-trigger-frames",
+            "Post trigger frames",
+            "Frames captured after a burst trigger that are pushed together "
+            "with the burst-frames before it",
+            0,
+            G_MAXUINT16,
+            0,
+            G_PARAM_READWRITE
+        )
+    );
 
-void
-gst_vimba_src_finalize (GObject * object)
-{
-    GstVimbaSrc *vimbasrc = GST_VIMBA_SRC (object);
+    g_object_class_install_property(
+        gobject_class,
+        PROP_DROP_INCOMPLETE,
+        g_param_spec_boolean(
+            "drop-incomplete",
+            "Drop incomplete",
+            "Drop incomplete frames instead of pushing them flagged as "
+            "corrupted",
+            TRUE,
+            G_PARAM_READWRITE
+        )
+    );
 
-    GST_DEBUG_OBJECT (vimbasrc, "finalize");
+    g_object_class_install_property(
+        gobject_class,
+        PROP_NUMA_NODE,
+        g_param_spec_int(
+            "numa-node",
+            "NUMA node",
+            "NUMA node of the frame ring (-1 = node of network-interface)",
+            -1,
+            1022,
+            -1,
+            G_PARAM_READWRITE
+        )
+    );
 
-    /* clean up object here */
-    g_mutex_clear(&vimbasrc->config_lock);
-    free(vimbasrc->camera);
+    g_object_class_install_property(
+        gobject_class,
+        PROP_NETWORK_INTERFACE,
+        g_param_spec_string(
+            "network-interface",
+            "Network interface",
+            "Host interface the camera is attached to, its NUMA node gets "
+            "the frame ring (default: the interface reported by the sdk)",
+            NULL,
+            G_PARAM_READWRITE
+        )
+    );
 
-    /* Shutdown the Vimba API */
-    vimba_destroy(vimbasrc->vimba);
+    g_object_class_install_property(
+        gobject_class,
+        PROP_HUGEPAGES,
+        g_param_spec_boolean(
+            "hugepages",
+            "Hugepages",
+            "Back the frame ring with 2 MB hugepages when available",
+            TRUE,
+            G_PARAM_READWRITE
+        )
+    );
 
-    G_OBJECT_CLASS (gst_vimba_src_parent_class)->finalize (object);
-}
+    g_object_class_install_property(
+        gobject_class,
+        PROP_LOCK_MEMORY,
+        g_param_spec_boolean(
+            "lock-memory",
+            "Lock memory",
+            "Lock the frame ring in memory so it is never paged out",
+            TRUE,
+            G_PARAM_READWRITE
+        )
+    );
 
-/* get caps from subclass */
-static GstCaps *
-gst_vimba_src_get_caps (GstBaseSrc * src, GstCaps * filter)
-{
-    g_message("gst_vimba_src_get_caps");
-    GstVimbaSrc *vimbasrc = GST_VIMBA_SRC (src);
-    GstCaps *caps;
+    g_object_class_install_property(
+        gobject_class,
+        PROP_FD_MEMORY,
+        g_param_spec_boolean(
+            "fd-memory",
+            "Fd memory",
+            "Back the frame ring with a memfd and push frames as fd (or dmabuf) memory without a copy",
+            FALSE,
+            G_PARAM_READWRITE
+        )
+    );
 
-    g_mutex_lock(&vimbasrc->config_lock);
-    caps = gst_pad_get_pad_template_caps(GST_BASE_SRC_PAD(src));
-    caps = gst_caps_make_writable(caps);
+    g_object_class_install_property(
+        gobject_class,
+        PROP_FD_FRAMES,
+        g_param_spec_uint(
+            "fd-frames",
+            "Fd frames",
+            "Frames added to the ring with fd-memory, for the buffers "
+            "downstream holds on to; capture stalls once downstream holds "
+            "more than this",
+            0,
+            1024,
+            DEFAULT_FD_FRAMES,
+            G_PARAM_READWRITE
+        )
+    );
 
-    guint size = gst_caps_get_size(caps);
-    g_message("num structures: %d", size );
+    g_object_class_install_property(
+        gobject_class,
+        PROP_SHM_NAME,
+        g_param_spec_string(
+            "shm-name",
+            "Shared memory name",
+            "Also publish frames to vimbashmsrc elements in other processes under this name (NULL = off)",
+            NULL,
+            G_PARAM_READWRITE
+        )
+    );
 
-    /*
-     * Fill both "Bayer" and "Raw" capability structures with available
-     * formats from the camera.
+    g_object_class_install_property(
+        gobject_class,
+        PROP_SHM_SLOTS,
+        g_param_spec_uint(
+            "shm-slots",
+            "Shared memory slots",
+            "Frames the shared ring holds",
+            2,
+            4096,
+            16,
+            G_PARAM_READWRITE
+        )
+    );
+
+    g_object_class_install_property(
+        gobject_class,
+        PROP_SHM_DROP_POLICY,
+        g_param_spec_enum(
+            "shm-drop-policy",
+            "Shared memory drop policy",
+            "What happens when a consumer still holds the slot the next frame goes to",
+            GST_TYPE_VIMBA_SRC_SHM_DROP_POLICY,
+            VIMBA_SHM_DROP_FRAME,
+            G_PARAM_READWRITE
+        )
+    );
+
+    g_object_class_install_property(
+        gobject_class,
+        PROP_FEATURE_GENERATION,
+        g_param_spec_uint64(
+            "feature-generation",
+            "Feature generation",
+            "Generation of the last queued feature write, frames carry it in their meta once it is in effect",
+            0,
+            G_MAXUINT64,
+            0,
+            G_PARAM_READABLE
+        )
+    );
+
+    g_object_class_install_property(
+        gobject_class,
+        PROP_STREAMING_CPUS,
+        g_param_spec_string(
+            "streaming-cpus",
+            "Streaming CPUs",
+            "CPUs the streaming thread is pinned to, e.g. \"2-3\" (NULL = any)",
+            NULL,
+            G_PARAM_READWRITE
+        )
+    );
+
+    g_object_class_install_property(
+        gobject_class,
+        PROP_STREAMING_PRIORITY,
+        g_param_spec_int(
+            "streaming-priority",
+            "Streaming priority",
+            "SCHED_FIFO priority of the streaming thread (0 = SCHED_OTHER)",
+            0,
+            VIMBA_THREAD_MAX_PRIORITY,
+            0,
+            G_PARAM_READWRITE
+        )
+    );
+
+    g_object_class_install_property(
+        gobject_class,
+        PROP_CALLBACK_CPUS,
+        g_param_spec_string(
+            "callback-cpus",
+            "Callback CPUs",
+            "CPUs the sdk thread delivering frames is pinned to (NULL = any)",
+            NULL,
+            G_PARAM_READWRITE
+        )
+    );
+
+    g_object_class_install_property(
+        gobject_class,
+        PROP_CALLBACK_PRIORITY,
+        g_param_spec_int(
+            "callback-priority",
+            "Callback priority",
+            "SCHED_FIFO priority of the sdk thread delivering frames "
+            "(0 = SCHED_OTHER)",
+            0,
+            VIMBA_THREAD_MAX_PRIORITY,
+            0,
+            G_PARAM_READWRITE
+        )
+    );
+
+    g_object_class_install_property(
+        gobject_class,
+        PROP_MAX_BATCH,
+        g_param_spec_uint(
+            "max-batch",
+            "Max batch",
+            "Push frames that queued up meanwhile together as one buffer "
+            "list of up to this many buffers (1 = push every frame alone)",
+            1,
+            G_MAXUINT16,
+            1,
+            G_PARAM_READWRITE
+        )
+    );
+
+    g_object_class_install_property(
+        gobject_class,
+        PROP_BATCH_LATENCY,
+        g_param_spec_uint64(
+            "batch-latency",
+            "Batch latency",
+            "Nanoseconds a batch waits for more frames after its first one "
+            "(0 = only take frames that are already queued)",
+            0,
+            GST_SECOND,
+            0,
+            G_PARAM_READWRITE
+        )
+    );
+
+    g_object_class_install_property(
+        gobject_class,
+        PROP_PREVIEW_SCALE,
+        g_param_spec_uint(
+            "preview-scale",
+            "Preview scale",
+            "Downscale factor of the preview in both directions (rounded up "
+            "to even for Bayer formats)",
+            2,
+            16,
+            4,
+            G_PARAM_READWRITE
+        )
+    );
+
+    g_object_class_install_property(
+        gobject_class,
+        PROP_PREVIEW_DECIMATION,
+        g_param_spec_uint(
+            "preview-decimation",
+            "Preview decimation",
+            "Push a preview of every n-th frame",
+            1,
+            G_MAXUINT16,
+            1,
+            G_PARAM_READWRITE
+        )
+    );
+
+    g_object_class_install_property(
+        gobject_class,
+        PROP_IMAGE_STATS_INTERVAL,
+        g_param_spec_uint64(
+            "image-stats-interval",
+            "Image statistics interval",
+            "Post histograms, means and clipped pixel counts of a frame as "
+            "vimbasrc-image-stats element message at most this often (in "
+            "nanoseconds), 0 to compute none",
+            0,
+            G_MAXUINT64,
+            0,
+            G_PARAM_READWRITE
+        )
+    );
+
+    g_object_class_install_property(
+        gobject_class,
+        PROP_IMAGE_STATS_STEP,
+        g_param_spec_uint(
+            "image-stats-step",
+            "Image statistics step",
+            "Sample every n-th row for the image statistics (rounded up to "
+            "even for Bayer formats)",
+            1,
+            64,
+            4,
+            G_PARAM_READWRITE
+        )
+    );
+
+    g_object_class_install_property(
+        gobject_class,
+        PROP_CORRECTION,
+        g_param_spec_boolean(
+            "correction",
+            "Correction",
+            "Subtract the dark frame, normalize by the flat field and replace "
+            "defect pixels of Mono8 and 8 bit Bayer frames, with the maps "
+            "calibrated for this camera",
+            FALSE,
+            G_PARAM_READWRITE
+        )
+    );
+
+    g_object_class_install_property(
+        gobject_class,
+        PROP_CALIBRATION_DIR,
+        g_param_spec_string(
+            "calibration-dir",
+            "Calibration directory",
+            "Where the correction maps of each camera are stored, as "
+            "<serial>.vcal, NULL for gst-vimba/calibration in the user data "
+            "directory",
+            NULL,
+            G_PARAM_READWRITE
+        )
+    );
+
+    g_object_class_install_property(
+        gobject_class,
+        PROP_SETTINGS_FILE,
+        g_param_spec_string(
+            "settings-file",
+            "Settings file",
+            "Camera settings saved with save-settings, applied in one batch "
+            "when the camera is opened, before the other feature properties",
+            NULL,
+            G_PARAM_READWRITE
+        )
+    );
+    g_object_class_install_property(
+        gobject_class,
+        PROP_QOS_THROTTLE,
+        g_param_spec_boolean(
+            "qos-throttle",
+            "QoS throttle",
+            "Lower AcquisitionFrameRateAbs of a free running camera while "
+            "downstream QoS reports overload, and raise it again once "
+            "downstream keeps up",
+            FALSE,
+            G_PARAM_READWRITE
+        )
+    );
+
+    g_object_class_install_property(
+        gobject_class,
+        PROP_PTP_MODE,
+        g_param_spec_enum(
+            "ptp-mode",
+            "PTP mode",
+            "PtpMode of the camera, for cameras synchronizing their device "
+            "clocks over IEEE 1588",
+            GST_TYPE_VIMBA_SRC_PTP_MODE,
+            VIMBA_PTP_MODE_NONE,
+            G_PARAM_READWRITE
+        )
+    );
+    g_object_class_install_property(
+        gobject_class,
+        PROP_PTP_CLOCK,
+        g_param_spec_boolean(
+            "ptp-clock",
+            "PTP clock",
+            "Provide a pipeline clock following the device clock of the "
+            "camera, the shared PTP time once it is locked",
+            FALSE,
+            G_PARAM_READWRITE
+        )
+    );
+    g_object_class_install_property(
+        gobject_class,
+        PROP_TIMESTAMP_MODE,
+        g_param_spec_enum(
+            "timestamp-mode",
+            "Timestamp mode",
+            "Whether buffers are stamped with the time they are pushed or "
+            "with the device time of the exposure",
+            GST_TYPE_VIMBA_SRC_TIMESTAMP_MODE,
+            VIMBA_TIMESTAMP_HOST,
+            G_PARAM_READWRITE
+        )
+    );
+
+    /**
+     * GstVimbaSrc::set-feature:
+     * @name: name of the camera feature
+     * @value: new value in its string form
+     *
+     * Queues a write of any camera feature. Returns whether the camera is
+     * open to take it; a write the camera rejects is posted as a warning.
      */
-    const char * raw_formats[GST_VIMBA_SRC_MAXFORMATS];
-    const char * bayer_formats[GST_VIMBA_SRC_MAXFORMATS];
-    int i, num_raw_formats = 0, num_bayer_formats = 0;
+    gst_vimba_src_signals[SIGNAL_SET_FEATURE] = g_signal_new(
+        "set-feature",
+        G_TYPE_FROM_CLASS(klass),
+        G_SIGNAL_RUN_LAST | G_SIGNAL_ACTION,
+        G_STRUCT_OFFSET(GstVimbaSrcClass, set_feature),
+        NULL, NULL, NULL,
+        G_TYPE_BOOLEAN,
+        2,
+        G_TYPE_STRING,
+        G_TYPE_STRING
+    );
 
-    GValue format = G_VALUE_INIT;
-    GValue raw_format_list   = G_VALUE_INIT;
-    GValue bayer_format_list = G_VALUE_INIT;
-    g_value_init(&format, G_TYPE_STRING);
-    g_value_init(&raw_format_list, GST_TYPE_LIST);
-    g_value_init(&bayer_format_list, GST_TYPE_LIST);
+    /**
+     * GstVimbaSrc::get-feature:
+     * @name: name of the camera feature
+     *
+     * Reads any camera feature, served from the feature cache while the
+     * camera does not report it as changed. Returns the value in its string
+     * form or NULL.
+     */
+    gst_vimba_src_signals[SIGNAL_GET_FEATURE] = g_signal_new(
+        "get-feature",
+        G_TYPE_FROM_CLASS(klass),
+        G_SIGNAL_RUN_LAST | G_SIGNAL_ACTION,
+        G_STRUCT_OFFSET(GstVimbaSrcClass, get_feature),
+        NULL, NULL, NULL,
+        G_TYPE_STRING,
+        1,
+        G_TYPE_STRING
+    );
 
-    vimbasrc_supported_raw_formats(
-        vimbasrc->camera->supported_formats,
-        vimbasrc->camera->format_count,
-        raw_formats,
-        &num_raw_formats
+    /**
+     * GstVimbaSrc::trigger:
+     *
+     * Exposes a frame in software trigger mode, or fires one action command
+     * across the sync group in action trigger mode. Returns the trigger id
+     * the resulting frames carry as buffer offset, 0 if nothing was triggered.
+     */
+    gst_vimba_src_signals[SIGNAL_TRIGGER] = g_signal_new(
+        "trigger",
+        G_TYPE_FROM_CLASS(klass),
+        G_SIGNAL_RUN_LAST | G_SIGNAL_ACTION,
+        G_STRUCT_OFFSET(GstVimbaSrcClass, trigger),
+        NULL, NULL, NULL,
+        G_TYPE_UINT64,
+        0
     );
-    for (i = 0; i < num_raw_formats; i++) {
-        const char * fstring = vimbasrc_vimba_to_gstreamer_raw(raw_formats[i]);
-        g_value_set_static_string(&format, fstring);
-        gst_value_list_append_value(&raw_format_list, &format);
+
+    /**
+     * GstVimbaSrc::burst-trigger:
+     *
+     * Pushes the frames kept in burst mode together with the
+     * post-trigger-frames that follow, stamped with their capture times.
+     * Does the same as the "vimbasrc-burst" custom upstream event. Returns
+     * FALSE when burst mode is off.
+     */
+    gst_vimba_src_signals[SIGNAL_BURST_TRIGGER] = g_signal_new(
+        "burst-trigger",
+        G_TYPE_FROM_CLASS(klass),
+        G_SIGNAL_RUN_LAST | G_SIGNAL_ACTION,
+        G_STRUCT_OFFSET(GstVimbaSrcClass, burst_trigger),
+        NULL, NULL, NULL,
+        G_TYPE_BOOLEAN,
+        0
+    );
+
+    /**
+     * GstVimbaSrc::save-settings:
+     * @path: file to write, NULL for settings-file
+     *
+     * Saves the writable features of the open camera to a settings file to
+     * be applied with settings-file later. Returns whether it was written.
+     */
+    gst_vimba_src_signals[SIGNAL_SAVE_SETTINGS] = g_signal_new(
+        "save-settings",
+        G_TYPE_FROM_CLASS(klass),
+        G_SIGNAL_RUN_LAST | G_SIGNAL_ACTION,
+        G_STRUCT_OFFSET(GstVimbaSrcClass, save_settings),
+        NULL, NULL, NULL,
+        G_TYPE_BOOLEAN,
+        1,
+        G_TYPE_STRING
+    );
+
+    /**
+     * GstVimbaSrc::calibrate:
+     * @kind: "dark" for frames with the lens covered, "flat" for frames of
+     * a uniformly lit target
+     * @frames: number of frames to average
+     *
+     * Averages the next frames into the dark or the flat map. Once they are
+     * captured, the correction maps are computed from the dark and flat
+     * frames captured so far, stored for this camera and used right away;
+     * a vimbasrc-calibration element message reports them. Returns FALSE
+     * when the request is not understood.
+     */
+    gst_vimba_src_signals[SIGNAL_CALIBRATE] = g_signal_new(
+        "calibrate",
+        G_TYPE_FROM_CLASS(klass),
+        G_SIGNAL_RUN_LAST | G_SIGNAL_ACTION,
+        G_STRUCT_OFFSET(GstVimbaSrcClass, calibrate),
+        NULL, NULL, NULL,
+        G_TYPE_BOOLEAN,
+        2,
+        G_TYPE_STRING,
+        G_TYPE_UINT
+    );
+
+}
+
+static void
+gst_vimba_src_init (GstVimbaSrc *vimbasrc)
+{
+
+    g_mutex_init(&vimbasrc->config_lock);
+
+    g_mutex_lock(&vimbasrc->config_lock);
+    vimbasrc->vimba  = vimba_init();
+    vimba_discover(vimbasrc->vimba);
+    vimbasrc->camera = vimbacamera_init();
+    vimbasrc->camera->trigger_line = g_strdup("Line1");
+    vimbasrc->camera->action_device_key = 1;
+    vimbasrc->camera->action_group_key = 1;
+    vimbasrc->camera->action_group_mask = 1;
+    vimbasrc->exposure_time = -1;
+    vimbasrc->gain = -1;
+    vimbasrc->offset_x = -1;
+    vimbasrc->offset_y = -1;
+    vimbasrc->drop_incomplete = TRUE;
+    vimbasrc->fd_frames = DEFAULT_FD_FRAMES;
+    vimbasrc->max_batch = 1;
+    vimbasrc->preview_scale = 4;
+    vimbasrc->preview_decimation = 1;
+    vimbasrc->image_stats_step = 4;
+    vimbasrc->calibration_kind = -1;
+    vimbasrc->shm_slots = 16;
+    vimbasrc->shm_drop_policy = VIMBA_SHM_DROP_FRAME;
+    vimba_qos_reset(&vimbasrc->qos);
+    vimbasrc->qos_last_adjustment = GST_CLOCK_TIME_NONE;
+    vimba_thread_params_init(&vimbasrc->streaming_thread);
+    vimba_thread_report_init(&vimbasrc->streaming_report);
+    g_queue_init(&vimbasrc->burst_history);
+    g_queue_init(&vimbasrc->burst_window);
+    vimbasrc->control = vimba_control_new(vimbasrc->camera,
+        gst_vimba_src_feature_written, vimbasrc);
+    vimbasrc->device_clock = vimba_ptp_clock_new();
+
+    /* Startup the Vimba API */
+    g_mutex_unlock(&vimbasrc->config_lock);
+    gst_base_src_set_live(GST_BASE_SRC(vimbasrc), TRUE);
+    gst_base_src_set_format(GST_BASE_SRC(vimbasrc), GST_FORMAT_TIME);
+
+    /* flushes and EOS of the main pad also apply to the preview */
+    gst_pad_add_probe(GST_BASE_SRC_PAD(vimbasrc),
+        GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM | GST_PAD_PROBE_TYPE_EVENT_FLUSH,
+        gst_vimba_src_preview_probe, vimbasrc, NULL);
+}
+
+/* the first of the alternative feature names the camera provides */
+static const char *
+gst_vimba_src_feature_name (GstVimbaSrc * vimbasrc, const char * const * names)
+{
+    int i;
+
+    for (i = 0; names[i] != NULL; i++) {
+        if (vimba_feature_exists(vimbasrc->camera->features, names[i])) {
+            return names[i];
+        }
     }
-    vimbasrc_supported_bayer_formats(
-        vimbasrc->camera->supported_formats,
-        vimbasrc->camera->format_count,
-        bayer_formats,
-        &num_bayer_formats
+    return names[0];
+}
+
+/* runs on the control thread */
+static void
+gst_vimba_src_feature_written (const gchar * name, guint64 generation,
+        gboolean ok, gpointer user_data)
+{
+    GstVimbaSrc *vimbasrc = user_data;
+
+    if (!ok) {
+        GST_ELEMENT_WARNING(vimbasrc, RESOURCE, SETTINGS,
+            ("Camera rejected feature %s.", name),
+            ("write of generation %" G_GUINT64_FORMAT, generation));
+    }
+}
+
+/*
+ * Queue a write of an open camera. A closed one gets the value stored by
+ * the caller from apply_features when opened, so an older value kept for
+ * restore must not override it then.
+ */
+static void
+gst_vimba_src_queue_double (GstVimbaSrc * vimbasrc, const gchar * name,
+        gdouble value)
+{
+    GValue v = G_VALUE_INIT;
+
+    if (value < 0 || name == NULL) {
+        return;
+    }
+    if (!vimbasrc->camera->open) {
+        vimba_control_forget(vimbasrc->control, name);
+        return;
+    }
+    g_value_init(&v, G_TYPE_DOUBLE);
+    g_value_set_double(&v, value);
+    vimba_control_queue(vimbasrc->control, name, &v);
+    g_value_unset(&v);
+}
+
+static gboolean
+gst_vimba_src_queue_feature (GQuark field_id, const GValue * value,
+        gpointer user_data)
+{
+    GstVimbaSrc *vimbasrc = user_data;
+
+    vimba_control_queue(vimbasrc->control, g_quark_to_string(field_id), value);
+    return TRUE;
+}
+
+static void
+gst_vimba_src_queue_int (GstVimbaSrc * vimbasrc, const gchar * name,
+        gint value)
+{
+    GValue v = G_VALUE_INIT;
+
+    if (value < 0) {
+        return;
+    }
+    if (!vimbasrc->camera->open) {
+        vimba_control_forget(vimbasrc->control, name);
+        return;
+    }
+    g_value_init(&v, G_TYPE_INT64);
+    g_value_set_int64(&v, value);
+    vimba_control_queue(vimbasrc->control, name, &v);
+    g_value_unset(&v);
+}
+
+/* must be called with config_lock held */
+static void
+gst_vimba_src_apply_double (GstVimbaSrc * vimbasrc, const char * const * names,
+        gdouble value)
+{
+    GValue v = G_VALUE_INIT;
+
+    if (value < 0 || vimbasrc->camera->features == NULL) {
+        return;
+    }
+    g_value_init(&v, G_TYPE_DOUBLE);
+    g_value_set_double(&v, value);
+    vimba_feature_set(vimbasrc->camera->features,
+        gst_vimba_src_feature_name(vimbasrc, names), &v
     );
-    for (i = 0; i < num_bayer_formats; i++) {
-        const char * fstring = vimbasrc_vimba_to_gstreamer_bayer(bayer_formats[i]);
-        g_value_set_static_string(&format, fstring);
-        gst_value_list_append_value(&bayer_format_list, &format);
+    g_value_unset(&v);
+}
+
+/* must be called with config_lock held */
+static void
+gst_vimba_src_apply_int (GstVimbaSrc * vimbasrc, const gchar * name,
+        gint value)
+{
+    GValue v = G_VALUE_INIT;
+
+    if (value < 0) {
+        return;
     }
-    g_value_unset(&format);
+    g_value_init(&v, G_TYPE_INT64);
+    g_value_set_int64(&v, value);
+    if (!vimba_feature_set(vimbasrc->camera->features, name, &v)) {
+        GST_WARNING_OBJECT(vimbasrc, "camera rejected %s %d", name, value);
+    }
+    g_value_unset(&v);
+}
+
+static gboolean
+gst_vimba_src_apply_feature (GQuark field_id, const GValue * value,
+        gpointer user_data)
+{
+    GstVimbaSrc *vimbasrc = user_data;
+    const gchar *name = g_quark_to_string(field_id);
+
+    if (!vimba_feature_set(vimbasrc->camera->features, name, value)) {
+        GST_WARNING_OBJECT(vimbasrc, "camera rejected feature %s", name);
+    }
+    return TRUE;
+}
+
+/* must be called with config_lock held */
+static void
+gst_vimba_src_apply_ptp_mode (GstVimbaSrc * vimbasrc)
+{
+    const gchar *mode;
+    GValue v = G_VALUE_INIT;
+
+    GST_OBJECT_LOCK(vimbasrc);
+    mode = vimba_ptp_mode_feature(vimbasrc->ptp_mode);
+    GST_OBJECT_UNLOCK(vimbasrc);
+    if (mode == NULL) {
+        return;
+    }
+    g_value_init(&v, G_TYPE_STRING);
+    g_value_set_static_string(&v, mode);
+    if (!vimba_feature_set(vimbasrc->camera->features, "PtpMode", &v)) {
+        GST_WARNING_OBJECT(vimbasrc, "camera rejected PtpMode %s", mode);
+    }
+    g_value_unset(&v);
+}
+
+/* must be called with config_lock held */
+static void
+gst_vimba_src_apply_features (GstVimbaSrc * vimbasrc)
+{
+    if (vimbasrc->camera->features == NULL) {
+        return;
+    }
+    gst_vimba_src_apply_double(vimbasrc, exposure_features,
+        vimbasrc->exposure_time
+    );
+    gst_vimba_src_apply_double(vimbasrc, gain_features, vimbasrc->gain);
+    gst_vimba_src_apply_int(vimbasrc, "OffsetX", vimbasrc->offset_x);
+    gst_vimba_src_apply_int(vimbasrc, "OffsetY", vimbasrc->offset_y);
+    gst_vimba_src_apply_ptp_mode(vimbasrc);
+    if (vimbasrc->features != NULL) {
+        gst_structure_foreach(vimbasrc->features,
+            gst_vimba_src_apply_feature, vimbasrc
+        );
+    }
+}
+
+/*
+ * Apply the settings file to the open camera. With keep_format the cached
+ * geometry, format and frame rate win over the file, as they do after a
+ * reconnect. Must be called with config_lock held.
+ */
+static void
+gst_vimba_src_load_settings (GstVimbaSrc * vimbasrc, gboolean keep_format)
+{
+    VimbaSettingsReport report;
+    GError *error = NULL;
+
+    if (vimbasrc->settings_file == NULL || !vimbasrc->camera->open) {
+        return;
+    }
+    if (!vimba_settings_load(vimbasrc->camera, vimbasrc->settings_file,
+            &report, &error)) {
+        GST_ELEMENT_WARNING(vimbasrc, RESOURCE, OPEN_READ,
+            ("Could not load camera settings from \"%s\".",
+                vimbasrc->settings_file),
+            ("%s", error->message));
+        g_error_free(error);
+        return;
+    }
+    if (report.failed > 0) {
+        GST_ELEMENT_WARNING(vimbasrc, RESOURCE, SETTINGS,
+            ("Camera rejected %u features from \"%s\".", report.failed,
+                vimbasrc->settings_file),
+            (NULL));
+    }
+    /* geometry, format and frame rate may have changed */
+    if (keep_format) {
+        vimbacamera_write_format(vimbasrc->camera);
+    } else {
+        vimbacamera_load(vimbasrc->camera);
+    }
+
+    GST_OBJECT_LOCK(vimbasrc);
+    vimbasrc->settings_report = report;
+    GST_OBJECT_UNLOCK(vimbasrc);
+}
+
+/* runs on the reconnect watchdog with config_lock held */
+static void
+gst_vimba_src_restore (VimbaCamera * camera, gpointer user_data)
+{
+    GstVimbaSrc *vimbasrc = user_data;
+
+    vimbasrc->exposure_feature = gst_vimba_src_feature_name(vimbasrc,
+        exposure_features);
+    vimbasrc->gain_feature = gst_vimba_src_feature_name(vimbasrc,
+        gain_features);
+    /* the settings file and the properties first, then what was
+     * written since */
+    gst_vimba_src_load_settings(vimbasrc, TRUE);
+    gst_vimba_src_apply_features(vimbasrc);
+    vimba_control_restore(vimbasrc->control);
+}
+
+/* the ring holds the burst window, and the frames downstream holds with
+ * fd-memory, on top of the frames the sdk fills */
+static void
+gst_vimba_src_update_frame_count (GstVimbaSrc * vimbasrc)
+{
+    vimbasrc->camera->frame_count = VIMBA_FRAME_COUNT;
+    if (vimbasrc->fd_memory) {
+        vimbasrc->camera->frame_count += vimbasrc->fd_frames;
+    }
+    if (vimbasrc->burst_frames > 0) {
+        vimbasrc->camera->frame_count +=
+            vimbasrc->burst_frames + vimbasrc->post_trigger_frames;
+    }
+}
+
+/* accepts the structure with or without its name */
+static GstStructure *
+gst_vimba_src_parse_features (const gchar * string)
+{
+    GstStructure *features;
+    gchar *named;
+
+    if (string == NULL || *string == '\0') {
+        return NULL;
+    }
+    features = gst_structure_from_string(string, NULL);
+    if (features == NULL) {
+        named = g_strdup_printf("features, %s", string);
+        features = gst_structure_from_string(named, NULL);
+        g_free(named);
+    }
+    return features;
+}
+
+static gboolean
+gst_vimba_src_read_feature (GQuark field_id, GValue * value, gpointer user_data)
+{
+    GstVimbaSrc *vimbasrc = user_data;
+    GValue current = G_VALUE_INIT;
+
+    if (vimba_feature_get(vimbasrc->camera->features,
+            g_quark_to_string(field_id), &current)) {
+        g_value_unset(value);
+        g_value_init(value, G_VALUE_TYPE(&current));
+        g_value_copy(&current, value);
+        g_value_unset(&current);
+    }
+    return TRUE;
+}
+
+/* must be called with config_lock held */
+static gdouble
+gst_vimba_src_read_double (GstVimbaSrc * vimbasrc, const char * const * names,
+        gdouble fallback)
+{
+    GValue v = G_VALUE_INIT;
+    gdouble result = fallback;
+
+    if (vimba_feature_get(vimbasrc->camera->features,
+            gst_vimba_src_feature_name(vimbasrc, names), &v)) {
+        if (G_VALUE_HOLDS_DOUBLE(&v)) {
+            result = g_value_get_double(&v);
+        } else if (G_VALUE_HOLDS_INT64(&v)) {
+            result = (gdouble) g_value_get_int64(&v);
+        }
+        g_value_unset(&v);
+    }
+    return result;
+}
+
+void
+gst_vimba_src_set_property (GObject * object, guint property_id,
+        const GValue * value, GParamSpec * pspec)
+{
+    GstVimbaSrc *vimbasrc = GST_VIMBA_SRC (object);
+
+    GST_DEBUG_OBJECT (vimbasrc, "set_property");
+
+    switch (property_id) {
+        case PROP_CAMERA:
+            g_mutex_lock(&vimbasrc->config_lock);
+            VmbUint32_t i = 0;
+            const gchar* camera_id = g_value_get_string(value);
+            /* kept for reopening the camera, the value is gone by then */
+            g_free((gchar *) vimbasrc->camera->camera_id);
+            vimbasrc->camera->camera_id = NULL;
+            for (i = 0; i < vimbasrc->vimba->count; ++i) {
+                if (!(g_strcmp0(vimbasrc->vimba->camera_list[i].cameraIdString, camera_id))) {
+                    vimbasrc->camera->camera_id = g_strdup(camera_id);
+                    g_free(vimbasrc->camera_serial);
+                    vimbasrc->camera_serial = g_strdup(
+                        vimbasrc->vimba->camera_list[i].serialString);
+                    break;
+                }
+            }
+            /* open the camera */
+            if (vimbasrc->camera->camera_id != NULL) {
+                if (vimbacamera_open(vimbasrc->camera)) {
+                    if (vimbacamera_load(vimbasrc->camera)) {
+                        g_message(
+                                "camera configuration: width: %lu, height: %lu, format: %s",
+                                (unsigned long) vimbasrc->camera->width,
+                                (unsigned long) vimbasrc->camera->height,
+                                vimbasrc->camera->format
+                                );
+                        gst_vimba_src_load_settings(vimbasrc, FALSE);
+                        vimbasrc->exposure_feature = gst_vimba_src_feature_name(
+                            vimbasrc, exposure_features);
+                        vimbasrc->gain_feature = gst_vimba_src_feature_name(
+                            vimbasrc, gain_features);
+                        gst_vimba_src_apply_features(vimbasrc);
+                    } else {
+                        GST_WARNING_OBJECT(vimbasrc,
+                            "cannot fetch initial camera settings");
+                    }
+                } else {
+                    GST_ELEMENT_WARNING(vimbasrc, RESOURCE, OPEN_READ_WRITE,
+                        ("Could not open camera %s.", camera_id), (NULL));
+                }
+            } else {
+                g_message("Camera %s not found!", camera_id);
+            }
+            g_mutex_unlock(&vimbasrc->config_lock);
+            break;
+        case PROP_OFFSET_X:
+            vimbasrc->offset_x = g_value_get_int(value);
+            GST_DEBUG_OBJECT(vimbasrc, "setting offset x to %d",
+                vimbasrc->offset_x);
+            gst_vimba_src_queue_int(vimbasrc, "OffsetX", vimbasrc->offset_x);
+            break;
+        case PROP_OFFSET_Y:
+            vimbasrc->offset_y = g_value_get_int(value);
+            GST_DEBUG_OBJECT(vimbasrc, "setting offset y to %d",
+                vimbasrc->offset_y);
+            gst_vimba_src_queue_int(vimbasrc, "OffsetY", vimbasrc->offset_y);
+            break;
+        case PROP_LINK_BUDGET:
+            GST_OBJECT_LOCK(vimbasrc);
+            vimbasrc->link_budget = g_value_get_uint64(value);
+            GST_OBJECT_UNLOCK(vimbasrc);
+            break;
+        case PROP_TRIGGER_MODE:
+            g_mutex_lock(&vimbasrc->config_lock);
+            vimbasrc->camera->trigger_mode = g_value_get_enum(value);
+            g_mutex_unlock(&vimbasrc->config_lock);
+            break;
+        case PROP_TRIGGER_LINE:
+            g_mutex_lock(&vimbasrc->config_lock);
+            g_free((gchar *) vimbasrc->camera->trigger_line);
+            vimbasrc->camera->trigger_line = g_value_dup_string(value);
+            g_mutex_unlock(&vimbasrc->config_lock);
+            break;
+        case PROP_TRIGGER_RATE:
+            g_mutex_lock(&vimbasrc->config_lock);
+            vimbasrc->trigger_rate = g_value_get_double(value);
+            vimba_sync_set_rate(
+                vimbasrc->camera->action_group_key, vimbasrc->trigger_rate
+            );
+            g_mutex_unlock(&vimbasrc->config_lock);
+            break;
+        case PROP_ACTION_DEVICE_KEY:
+            g_mutex_lock(&vimbasrc->config_lock);
+            vimbasrc->camera->action_device_key = g_value_get_uint(value);
+            g_mutex_unlock(&vimbasrc->config_lock);
+            break;
+        case PROP_ACTION_GROUP_KEY:
+            g_mutex_lock(&vimbasrc->config_lock);
+            /* the timer of the old group stops with the move */
+            if (vimbasrc->trigger_rate > 0 &&
+                vimbasrc->camera->action_group_key != g_value_get_uint(value)) {
+                vimba_sync_set_rate(vimbasrc->camera->action_group_key, 0);
+            }
+            vimbasrc->camera->action_group_key = g_value_get_uint(value);
+            if (vimbasrc->trigger_rate > 0) {
+                vimba_sync_set_rate(
+                    vimbasrc->camera->action_group_key, vimbasrc->trigger_rate
+                );
+            }
+            g_mutex_unlock(&vimbasrc->config_lock);
+            break;
+        case PROP_ACTION_GROUP_MASK:
+            g_mutex_lock(&vimbasrc->config_lock);
+            vimbasrc->camera->action_group_mask = g_value_get_uint(value);
+            g_mutex_unlock(&vimbasrc->config_lock);
+            break;
+        case PROP_CHUNK_MODE:
+            g_mutex_lock(&vimbasrc->config_lock);
+            vimbasrc->camera->chunk_mode = g_value_get_boolean(value);
+            g_mutex_unlock(&vimbasrc->config_lock);
+            break;
+        case PROP_EXPOSURE_TIME:
+            /* control bindings set it from the streaming thread, which must
+             * not wait for config_lock or the camera */
+            vimbasrc->exposure_time = g_value_get_double(value);
+            gst_vimba_src_queue_double(vimbasrc, vimbasrc->exposure_feature,
+                vimbasrc->exposure_time
+            );
+            break;
+        case PROP_GAIN:
+            vimbasrc->gain = g_value_get_double(value);
+            gst_vimba_src_queue_double(vimbasrc, vimbasrc->gain_feature,
+                vimbasrc->gain
+            );
+            break;
+        case PROP_FEATURES:
+        {
+            GstStructure *features =
+                gst_vimba_src_parse_features(g_value_get_string(value));
+
+            if (features == NULL && g_value_get_string(value) != NULL) {
+                GST_WARNING_OBJECT(vimbasrc, "cannot parse features '%s'",
+                    g_value_get_string(value));
+                break;
+            }
+            g_mutex_lock(&vimbasrc->config_lock);
+            if (vimbasrc->features != NULL) {
+                gst_structure_free(vimbasrc->features);
+            }
+            vimbasrc->features = features;
+            if (features != NULL && vimbasrc->camera->features != NULL) {
+                gst_structure_foreach(features,
+                    gst_vimba_src_queue_feature, vimbasrc
+                );
+            }
+            g_mutex_unlock(&vimbasrc->config_lock);
+            break;
+        }
+        case PROP_BURST_FRAMES:
+            g_mutex_lock(&vimbasrc->config_lock);
+            vimbasrc->burst_frames = g_value_get_uint(value);
+            gst_vimba_src_update_frame_count(vimbasrc);
+            g_mutex_unlock(&vimbasrc->config_lock);
+            break;
+        case PROP_POST_TRIGGER_FRAMES:
+            g_mutex_lock(&vimbasrc->config_lock);
+            vimbasrc->post_trigger_frames = g_value_get_uint(value);
+            gst_vimba_src_update_frame_count(vimbasrc);
+            g_mutex_unlock(&vimbasrc->config_lock);
+            break;
+        case PROP_DROP_INCOMPLETE:
+            vimbasrc->drop_incomplete = g_value_get_boolean(value);
+            break;
+        case PROP_NUMA_NODE:
+            g_mutex_lock(&vimbasrc->config_lock);
+            vimbasrc->camera->alloc_params.numa_node = g_value_get_int(value);
+            g_mutex_unlock(&vimbasrc->config_lock);
+            break;
+        case PROP_NETWORK_INTERFACE:
+            g_mutex_lock(&vimbasrc->config_lock);
+            g_free(vimbasrc->camera->network_interface);
+            vimbasrc->camera->network_interface = g_value_dup_string(value);
+            g_mutex_unlock(&vimbasrc->config_lock);
+            break;
+        case PROP_HUGEPAGES:
+            g_mutex_lock(&vimbasrc->config_lock);
+            vimbasrc->camera->alloc_params.hugepages = g_value_get_boolean(value);
+            g_mutex_unlock(&vimbasrc->config_lock);
+            break;
+        case PROP_LOCK_MEMORY:
+            g_mutex_lock(&vimbasrc->config_lock);
+            vimbasrc->camera->alloc_params.lock = g_value_get_boolean(value);
+            g_mutex_unlock(&vimbasrc->config_lock);
+            break;
+        case PROP_FD_MEMORY:
+            g_mutex_lock(&vimbasrc->config_lock);
+            vimbasrc->fd_memory = g_value_get_boolean(value);
+            vimbasrc->camera->alloc_params.memfd = vimbasrc->fd_memory;
+            gst_vimba_src_update_frame_count(vimbasrc);
+            g_mutex_unlock(&vimbasrc->config_lock);
+            break;
+        case PROP_FD_FRAMES:
+            g_mutex_lock(&vimbasrc->config_lock);
+            vimbasrc->fd_frames = g_value_get_uint(value);
+            gst_vimba_src_update_frame_count(vimbasrc);
+            g_mutex_unlock(&vimbasrc->config_lock);
+            break;
+        case PROP_STREAMING_CPUS:
+            vimba_thread_params_set_cpus(&vimbasrc->streaming_thread,
+                g_value_get_string(value));
+            break;
+        case PROP_STREAMING_PRIORITY:
+            vimba_thread_params_set_priority(&vimbasrc->streaming_thread,
+                g_value_get_int(value));
+            break;
+        case PROP_CALLBACK_CPUS:
+            vimba_thread_params_set_cpus(&vimbasrc->camera->callback_thread,
+                g_value_get_string(value));
+            break;
+        case PROP_CALLBACK_PRIORITY:
+            vimba_thread_params_set_priority(&vimbasrc->camera->callback_thread,
+                g_value_get_int(value));
+            break;
+        case PROP_MAX_BATCH:
+            GST_OBJECT_LOCK(vimbasrc);
+            vimbasrc->max_batch = g_value_get_uint(value);
+            GST_OBJECT_UNLOCK(vimbasrc);
+            /* batching adds batch-latency to the reported latency */
+            gst_element_post_message(GST_ELEMENT(vimbasrc),
+                gst_message_new_latency(GST_OBJECT(vimbasrc)));
+            break;
+        case PROP_BATCH_LATENCY:
+            GST_OBJECT_LOCK(vimbasrc);
+            vimbasrc->batch_latency = g_value_get_uint64(value);
+            GST_OBJECT_UNLOCK(vimbasrc);
+            gst_element_post_message(GST_ELEMENT(vimbasrc),
+                gst_message_new_latency(GST_OBJECT(vimbasrc)));
+            break;
+        case PROP_PREVIEW_SCALE:
+            GST_OBJECT_LOCK(vimbasrc);
+            vimbasrc->preview_scale = g_value_get_uint(value);
+            vimbasrc->preview_dirty = TRUE;
+            GST_OBJECT_UNLOCK(vimbasrc);
+            break;
+        case PROP_PREVIEW_DECIMATION:
+            GST_OBJECT_LOCK(vimbasrc);
+            vimbasrc->preview_decimation = g_value_get_uint(value);
+            vimbasrc->preview_dirty = TRUE;
+            GST_OBJECT_UNLOCK(vimbasrc);
+            break;
+        case PROP_IMAGE_STATS_INTERVAL:
+            GST_OBJECT_LOCK(vimbasrc);
+            vimbasrc->image_stats_interval = g_value_get_uint64(value);
+            GST_OBJECT_UNLOCK(vimbasrc);
+            break;
+        case PROP_IMAGE_STATS_STEP:
+            GST_OBJECT_LOCK(vimbasrc);
+            vimbasrc->image_stats_step = g_value_get_uint(value);
+            vimbasrc->image_stats_dirty = TRUE;
+            GST_OBJECT_UNLOCK(vimbasrc);
+            break;
+        case PROP_CORRECTION:
+            GST_OBJECT_LOCK(vimbasrc);
+            vimbasrc->correction_enabled = g_value_get_boolean(value);
+            vimbasrc->correction_dirty = TRUE;
+            GST_OBJECT_UNLOCK(vimbasrc);
+            break;
+        case PROP_CALIBRATION_DIR:
+            GST_OBJECT_LOCK(vimbasrc);
+            g_free(vimbasrc->calibration_dir);
+            vimbasrc->calibration_dir = g_value_dup_string(value);
+            vimbasrc->correction_dirty = TRUE;
+            GST_OBJECT_UNLOCK(vimbasrc);
+            break;
+        case PROP_SHM_NAME:
+            GST_OBJECT_LOCK(vimbasrc);
+            g_free(vimbasrc->shm_name);
+            vimbasrc->shm_name = g_value_dup_string(value);
+            GST_OBJECT_UNLOCK(vimbasrc);
+            break;
+        case PROP_SHM_SLOTS:
+            GST_OBJECT_LOCK(vimbasrc);
+            vimbasrc->shm_slots = g_value_get_uint(value);
+            GST_OBJECT_UNLOCK(vimbasrc);
+            break;
+        case PROP_SHM_DROP_POLICY:
+            vimbasrc->shm_drop_policy = g_value_get_enum(value);
+            break;
+        case PROP_SETTINGS_FILE:
+            /* an open camera gets it right away, while acquiring features
+             * like the geometry are locked and rejected */
+            g_mutex_lock(&vimbasrc->config_lock);
+            g_free(vimbasrc->settings_file);
+            vimbasrc->settings_file = g_value_dup_string(value);
+            gst_vimba_src_load_settings(vimbasrc, vimbasrc->camera->started);
+            g_mutex_unlock(&vimbasrc->config_lock);
+            break;
+        case PROP_QOS_THROTTLE:
+            GST_OBJECT_LOCK(vimbasrc);
+            vimbasrc->qos_throttle = g_value_get_boolean(value);
+            GST_OBJECT_UNLOCK(vimbasrc);
+            if (!g_value_get_boolean(value)) {
+                gst_vimba_src_qos_reset(vimbasrc);
+            }
+            break;
+        case PROP_PTP_MODE:
+            GST_OBJECT_LOCK(vimbasrc);
+            vimbasrc->ptp_mode = g_value_get_enum(value);
+            GST_OBJECT_UNLOCK(vimbasrc);
+            /* a closed camera gets it when opened, an open one through the
+             * control thread, which restores it after a reconnect */
+            if (vimbasrc->camera->open &&
+                vimba_ptp_mode_feature(vimbasrc->ptp_mode) != NULL) {
+                GValue v = G_VALUE_INIT;
+
+                g_value_init(&v, G_TYPE_STRING);
+                g_value_set_static_string(&v,
+                    vimba_ptp_mode_feature(vimbasrc->ptp_mode));
+                vimba_control_queue(vimbasrc->control, "PtpMode", &v);
+                g_value_unset(&v);
+            }
+            break;
+        case PROP_PTP_CLOCK:
+            GST_OBJECT_LOCK(vimbasrc);
+            vimbasrc->ptp_clock = g_value_get_boolean(value);
+            if (vimbasrc->ptp_clock) {
+                GST_OBJECT_FLAG_SET(vimbasrc, GST_ELEMENT_FLAG_PROVIDE_CLOCK);
+            } else {
+                GST_OBJECT_FLAG_UNSET(vimbasrc, GST_ELEMENT_FLAG_PROVIDE_CLOCK);
+            }
+            GST_OBJECT_UNLOCK(vimbasrc);
+            /* the pipeline picks its clock again on the next PLAYING */
+            gst_element_post_message(GST_ELEMENT(vimbasrc),
+                gst_message_new_clock_provide(GST_OBJECT(vimbasrc), NULL,
+                    g_value_get_boolean(value)));
+            break;
+        case PROP_TIMESTAMP_MODE:
+            GST_OBJECT_LOCK(vimbasrc);
+            vimbasrc->timestamp_mode = g_value_get_enum(value);
+            GST_OBJECT_UNLOCK(vimbasrc);
+            break;
+        default:
+            G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
+            break;
+    }
+}
+
+/* software triggers sent or action commands fired since the camera joined
+ * its group; free running and line triggered cameras trigger every frame */
+static guint
+gst_vimba_src_trigger_count (GstVimbaSrc * vimbasrc)
+{
+    VimbaCamera *camera = vimbasrc->camera;
+
+    switch (camera->trigger_mode) {
+        case VIMBA_TRIGGER_SOFTWARE:
+            return (guint) g_atomic_int_get(&camera->triggers_sent);
+        case VIMBA_TRIGGER_ACTION:
+            if (!camera->started) {
+                return 0;
+            }
+            return (guint) (vimba_sync_trigger_id(camera->action_group_key) -
+                camera->trigger_base);
+        default:
+            return (guint) g_atomic_int_get(&camera->frames_received);
+    }
+}
+
+static GstStructure *
+gst_vimba_src_create_stats (GstVimbaSrc * vimbasrc)
+{
+    GstStructure *stats;
+
+    GST_OBJECT_LOCK(vimbasrc);
+    stats = gst_structure_new(
+        "application/x-vimbasrc-stats",
+        "link-budget", G_TYPE_UINT64, vimbasrc->link_budget,
+        "camera-link-budget", G_TYPE_UINT64,
+            (guint64) vimbasrc->camera->stream_bytes_per_second,
+        "trigger-count", G_TYPE_UINT, gst_vimba_src_trigger_count(vimbasrc),
+        "frames-received", G_TYPE_UINT,
+            (guint) g_atomic_int_get(&vimbasrc->camera->frames_received),
+        "frames-incomplete", G_TYPE_UINT,
+            (guint) g_atomic_int_get(&vimbasrc->camera->frames_incomplete),
+        "frames-dropped", G_TYPE_UINT,
+            (guint) g_atomic_int_get(&vimbasrc->camera->frames_dropped),
+        NULL
+    );
+    if (vimbasrc->preview_pad != NULL) {
+        gst_structure_set(stats,
+            "previews-pushed", G_TYPE_UINT64, vimbasrc->previews_pushed,
+            NULL
+        );
+    }
+    if (vimbasrc->correction_enabled) {
+        gst_structure_set(stats,
+            "frames-corrected", G_TYPE_UINT64, vimbasrc->frames_corrected,
+            NULL
+        );
+    }
+    if (vimbasrc->image_stats_interval > 0) {
+        gst_structure_set(stats,
+            "image-stats-posted", G_TYPE_UINT64, vimbasrc->image_stats_posted,
+            NULL
+        );
+    }
+    if (vimbasrc->max_batch > 1) {
+        gst_structure_set(stats,
+            "batches-pushed", G_TYPE_UINT64, vimbasrc->batches_pushed,
+            "batched-frames", G_TYPE_UINT64, vimbasrc->batched_frames,
+            NULL
+        );
+    }
+    if (vimbasrc->burst_frames > 0) {
+        gst_structure_set(stats,
+            "bursts-completed", G_TYPE_UINT64, vimbasrc->bursts_completed,
+            "ring-frames", G_TYPE_UINT, vimbasrc->camera->frame_count,
+            NULL
+        );
+    }
+    vimba_thread_report_to_structure(&vimbasrc->streaming_report, stats,
+        "streaming");
+    vimba_thread_report_to_structure(&vimbasrc->camera->callback_report, stats,
+        "callback");
+    if (vimbasrc->camera->ring_bytes > 0) {
+        gchar *placement =
+            vimba_alloc_placement_string(vimbasrc->camera->ring_placement);
+        gst_structure_set(stats,
+            "ring-placement", G_TYPE_STRING, placement,
+            "ring-numa-node", G_TYPE_INT, vimbasrc->camera->ring_numa_node,
+            "ring-bytes", G_TYPE_UINT64, vimbasrc->camera->ring_bytes,
+            NULL
+        );
+        g_free(placement);
+    }
+    if (vimbasrc->shm != NULL) {
+        guint64 published, dropped;
+        guint consumers;
+
+        vimba_shm_producer_stats(vimbasrc->shm, &published, &dropped,
+            &consumers);
+        gst_structure_set(stats,
+            "shm-published", G_TYPE_UINT64, published,
+            "shm-dropped", G_TYPE_UINT64, dropped,
+            "shm-consumers", G_TYPE_UINT, consumers,
+            NULL
+        );
+    }
+    {
+        guint64 queued, applied, failed;
+        GstClockTime max_latency;
+
+        vimba_control_stats(vimbasrc->control, &queued, &applied, &failed,
+            &max_latency);
+        gst_structure_set(stats,
+            "feature-writes-queued", G_TYPE_UINT64, queued,
+            "feature-writes-applied", G_TYPE_UINT64, applied,
+            "feature-writes-failed", G_TYPE_UINT64, failed,
+            "feature-write-max-latency", G_TYPE_UINT64, max_latency,
+            NULL
+        );
+    }
+    if (vimbasrc->settings_report.passes > 0) {
+        gst_structure_set(stats,
+            "settings-written", G_TYPE_UINT, vimbasrc->settings_report.written,
+            "settings-unchanged", G_TYPE_UINT,
+                vimbasrc->settings_report.unchanged,
+            "settings-failed", G_TYPE_UINT, vimbasrc->settings_report.failed,
+            "settings-load-time", G_TYPE_UINT64,
+                vimbasrc->settings_report.duration,
+            NULL
+        );
+    }
+    if (vimbasrc->qos_throttle || vimbasrc->qos.lowered > 0) {
+        gst_structure_set(stats,
+            "qos-frame-rate", G_TYPE_DOUBLE, vimba_qos_active(&vimbasrc->qos)
+                ? vimbasrc->qos.rate : vimbasrc->camera->framerate,
+            "qos-nominal-frame-rate", G_TYPE_DOUBLE, vimbasrc->camera->framerate,
+            "qos-rate-lowered", G_TYPE_UINT, vimbasrc->qos.lowered,
+            "qos-rate-raised", G_TYPE_UINT, vimbasrc->qos.raised,
+            "qos-last-adjustment", G_TYPE_UINT64, vimbasrc->qos_last_adjustment,
+            NULL
+        );
+    }
+    if (vimbasrc->ptp != NULL) {
+        VimbaPtpStats ptp;
+
+        vimba_ptp_stats(vimbasrc->ptp, &ptp);
+        gst_structure_set(stats,
+            "ptp-status", G_TYPE_STRING, ptp.status,
+            "ptp-locked", G_TYPE_BOOLEAN, ptp.locked,
+            "ptp-lock-changes", G_TYPE_UINT, ptp.lock_changes,
+            "ptp-latch-time", G_TYPE_UINT64, ptp.latch_time,
+            "ptp-clock-observations", G_TYPE_UINT64, ptp.observations,
+            NULL
+        );
+        if (ptp.has_offset) {
+            gst_structure_set(stats,
+                "ptp-offset", G_TYPE_INT64, ptp.offset,
+                NULL
+            );
+        }
+        g_free(ptp.status);
+    }
+    gst_structure_set(stats,
+        "config-writes", G_TYPE_UINT, vimbasrc->config_report.writes,
+        "config-failures", G_TYPE_UINT, vimbasrc->config_failures,
+        NULL
+    );
+    if (vimbasrc->reconnect != NULL) {
+        guint reconnects;
+        GstClockTime last_recovery, max_recovery;
+
+        vimba_reconnect_stats(vimbasrc->reconnect, &reconnects,
+            &last_recovery, &max_recovery);
+        gst_structure_set(stats,
+            "camera-lost", G_TYPE_BOOLEAN,
+                vimbacamera_is_lost(vimbasrc->camera),
+            "reconnects", G_TYPE_UINT, reconnects,
+            "last-recovery-time", G_TYPE_UINT64, last_recovery,
+            "max-recovery-time", G_TYPE_UINT64, max_recovery,
+            "gap-events", G_TYPE_UINT64, vimbasrc->gap_events,
+            NULL
+        );
+    }
+    g_rw_lock_reader_lock(&vimbasrc->camera->handle_lock);
+    if (vimbasrc->camera->features != NULL) {
+        guint64 hits, misses;
+
+        vimba_feature_cache_stats(vimbasrc->camera->features, &hits, &misses);
+        gst_structure_set(stats,
+            "feature-cache-hits", G_TYPE_UINT64, hits,
+            "feature-cache-misses", G_TYPE_UINT64, misses,
+            NULL
+        );
+    }
+    g_rw_lock_reader_unlock(&vimbasrc->camera->handle_lock);
+    if (vimbasrc->camera->trigger_mode == VIMBA_TRIGGER_ACTION) {
+        guint32 group_key = vimbasrc->camera->action_group_key;
+        gst_structure_set(stats,
+            "sync-trigger-id", G_TYPE_UINT64, vimba_sync_trigger_id(group_key),
+            "sync-participants", G_TYPE_UINT, vimba_sync_participants(group_key),
+            NULL
+        );
+    }
+    if (vimbasrc->fixated_format != NULL) {
+        gst_structure_set(stats,
+            "fixated-format", G_TYPE_STRING, vimbasrc->fixated_format,
+            "fixated-bandwidth", G_TYPE_UINT64, vimbasrc->fixated_bandwidth,
+            "fixated-framerate", G_TYPE_DOUBLE, vimbasrc->fixated_framerate,
+            "fixation-report", G_TYPE_STRING, vimbasrc->fixation_report,
+            NULL
+        );
+    }
+    GST_OBJECT_UNLOCK(vimbasrc);
+
+    return stats;
+}
+
+void
+gst_vimba_src_get_property (GObject * object, guint property_id,
+        GValue * value, GParamSpec * pspec)
+{
+    GstVimbaSrc *vimbasrc = GST_VIMBA_SRC (object);
+
+    GST_DEBUG_OBJECT (vimbasrc, "get_property");
+
+    switch (property_id) {
+        case PROP_CAMERA:
+            g_value_set_string(value, vimbasrc->camera->camera_id);
+            break;
+        case PROP_OFFSET_X:
+            g_mutex_lock(&vimbasrc->config_lock);
+            g_value_set_int(value, vimbasrc->camera->open ?
+                vimbacamera_get_feature_int(vimbasrc->camera, "OffsetX") :
+                MAX(vimbasrc->offset_x, 0));
+            g_mutex_unlock(&vimbasrc->config_lock);
+            break;
+        case PROP_OFFSET_Y:
+            g_mutex_lock(&vimbasrc->config_lock);
+            g_value_set_int(value, vimbasrc->camera->open ?
+                vimbacamera_get_feature_int(vimbasrc->camera, "OffsetY") :
+                MAX(vimbasrc->offset_y, 0));
+            g_mutex_unlock(&vimbasrc->config_lock);
+            break;
+        case PROP_LINK_BUDGET:
+            GST_OBJECT_LOCK(vimbasrc);
+            g_value_set_uint64(value, vimbasrc->link_budget);
+            GST_OBJECT_UNLOCK(vimbasrc);
+            break;
+        case PROP_STATS:
+            g_value_take_boxed(value, gst_vimba_src_create_stats(vimbasrc));
+            break;
+        case PROP_TRIGGER_MODE:
+            g_value_set_enum(value, vimbasrc->camera->trigger_mode);
+            break;
+        case PROP_TRIGGER_LINE:
+            g_value_set_string(value, vimbasrc->camera->trigger_line);
+            break;
+        case PROP_TRIGGER_RATE:
+            g_value_set_double(value, vimbasrc->trigger_rate);
+            break;
+        case PROP_ACTION_DEVICE_KEY:
+            g_value_set_uint(value, vimbasrc->camera->action_device_key);
+            break;
+        case PROP_ACTION_GROUP_KEY:
+            g_value_set_uint(value, vimbasrc->camera->action_group_key);
+            break;
+        case PROP_ACTION_GROUP_MASK:
+            g_value_set_uint(value, vimbasrc->camera->action_group_mask);
+            break;
+        case PROP_CHUNK_MODE:
+            g_value_set_boolean(value, vimbasrc->camera->chunk_mode);
+            break;
+        case PROP_EXPOSURE_TIME:
+            g_mutex_lock(&vimbasrc->config_lock);
+            g_value_set_double(value, gst_vimba_src_read_double(vimbasrc,
+                exposure_features, vimbasrc->exposure_time
+            ));
+            g_mutex_unlock(&vimbasrc->config_lock);
+            break;
+        case PROP_GAIN:
+            g_mutex_lock(&vimbasrc->config_lock);
+            g_value_set_double(value, gst_vimba_src_read_double(vimbasrc,
+                gain_features, vimbasrc->gain
+            ));
+            g_mutex_unlock(&vimbasrc->config_lock);
+            break;
+        case PROP_FEATURES:
+            g_mutex_lock(&vimbasrc->config_lock);
+            if (vimbasrc->features != NULL) {
+                GstStructure *current = gst_structure_copy(vimbasrc->features);
+
+                gst_structure_map_in_place(current,
+                    gst_vimba_src_read_feature, vimbasrc
+                );
+                g_value_take_string(value, gst_structure_to_string(current));
+                gst_structure_free(current);
+            } else {
+                g_value_set_string(value, NULL);
+            }
+            g_mutex_unlock(&vimbasrc->config_lock);
+            break;
+        case PROP_BURST_FRAMES:
+            g_value_set_uint(value, vimbasrc->burst_frames);
+            break;
+        case PROP_POST_TRIGGER_FRAMES:
+            g_value_set_uint(value, vimbasrc->post_trigger_frames);
+            break;
+        case PROP_DROP_INCOMPLETE:
+            g_value_set_boolean(value, vimbasrc->drop_incomplete);
+            break;
+        case PROP_NUMA_NODE:
+            g_value_set_int(value, vimbasrc->camera->alloc_params.numa_node);
+            break;
+        case PROP_NETWORK_INTERFACE:
+            g_mutex_lock(&vimbasrc->config_lock);
+            g_value_set_string(value, vimbasrc->camera->network_interface);
+            g_mutex_unlock(&vimbasrc->config_lock);
+            break;
+        case PROP_HUGEPAGES:
+            g_value_set_boolean(value, vimbasrc->camera->alloc_params.hugepages);
+            break;
+        case PROP_LOCK_MEMORY:
+            g_value_set_boolean(value, vimbasrc->camera->alloc_params.lock);
+            break;
+        case PROP_FD_MEMORY:
+            g_value_set_boolean(value, vimbasrc->fd_memory);
+            break;
+        case PROP_FD_FRAMES:
+            g_value_set_uint(value, vimbasrc->fd_frames);
+            break;
+        case PROP_SHM_NAME:
+            GST_OBJECT_LOCK(vimbasrc);
+            g_value_set_string(value, vimbasrc->shm_name);
+            GST_OBJECT_UNLOCK(vimbasrc);
+            break;
+        case PROP_SHM_SLOTS:
+            g_value_set_uint(value, vimbasrc->shm_slots);
+            break;
+        case PROP_SHM_DROP_POLICY:
+            g_value_set_enum(value, vimbasrc->shm_drop_policy);
+            break;
+        case PROP_FEATURE_GENERATION:
+            g_value_set_uint64(value, vimba_control_generation(vimbasrc->control));
+            break;
+        case PROP_SETTINGS_FILE:
+            g_mutex_lock(&vimbasrc->config_lock);
+            g_value_set_string(value, vimbasrc->settings_file);
+            g_mutex_unlock(&vimbasrc->config_lock);
+            break;
+        case PROP_QOS_THROTTLE:
+            GST_OBJECT_LOCK(vimbasrc);
+            g_value_set_boolean(value, vimbasrc->qos_throttle);
+            GST_OBJECT_UNLOCK(vimbasrc);
+            break;
+        case PROP_PTP_MODE:
+            GST_OBJECT_LOCK(vimbasrc);
+            g_value_set_enum(value, vimbasrc->ptp_mode);
+            GST_OBJECT_UNLOCK(vimbasrc);
+            break;
+        case PROP_PTP_CLOCK:
+            GST_OBJECT_LOCK(vimbasrc);
+            g_value_set_boolean(value, vimbasrc->ptp_clock);
+            GST_OBJECT_UNLOCK(vimbasrc);
+            break;
+        case PROP_TIMESTAMP_MODE:
+            GST_OBJECT_LOCK(vimbasrc);
+            g_value_set_enum(value, vimbasrc->timestamp_mode);
+            GST_OBJECT_UNLOCK(vimbasrc);
+            break;
+        case PROP_STREAMING_CPUS:
+            g_value_take_string(value,
+                vimba_thread_params_dup_cpus(&vimbasrc->streaming_thread));
+            break;
+        case PROP_STREAMING_PRIORITY:
+            g_value_set_int(value, vimbasrc->streaming_thread.priority);
+            break;
+        case PROP_CALLBACK_CPUS:
+            g_value_take_string(value,
+                vimba_thread_params_dup_cpus(&vimbasrc->camera->callback_thread));
+            break;
+        case PROP_CALLBACK_PRIORITY:
+            g_value_set_int(value, vimbasrc->camera->callback_thread.priority);
+            break;
+        case PROP_MAX_BATCH:
+            g_value_set_uint(value, vimbasrc->max_batch);
+            break;
+        case PROP_BATCH_LATENCY:
+            g_value_set_uint64(value, vimbasrc->batch_latency);
+            break;
+        case PROP_PREVIEW_SCALE:
+            g_value_set_uint(value, vimbasrc->preview_scale);
+            break;
+        case PROP_PREVIEW_DECIMATION:
+            g_value_set_uint(value, vimbasrc->preview_decimation);
+            break;
+        case PROP_IMAGE_STATS_INTERVAL:
+            GST_OBJECT_LOCK(vimbasrc);
+            g_value_set_uint64(value, vimbasrc->image_stats_interval);
+            GST_OBJECT_UNLOCK(vimbasrc);
+            break;
+        case PROP_IMAGE_STATS_STEP:
+            GST_OBJECT_LOCK(vimbasrc);
+            g_value_set_uint(value, vimbasrc->image_stats_step);
+            GST_OBJECT_UNLOCK(vimbasrc);
+            break;
+        case PROP_CORRECTION:
+            GST_OBJECT_LOCK(vimbasrc);
+            g_value_set_boolean(value, vimbasrc->correction_enabled);
+            GST_OBJECT_UNLOCK(vimbasrc);
+            break;
+        case PROP_CALIBRATION_DIR:
+            GST_OBJECT_LOCK(vimbasrc);
+            g_value_set_string(value, vimbasrc->calibration_dir);
+            GST_OBJECT_UNLOCK(vimbasrc);
+            break;
+        default:
+            G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
+            break;
+    }
+}
+
+void
+gst_vimba_src_dispose (GObject * object)
+{
+    GstVimbaSrc *vimbasrc = GST_VIMBA_SRC (object);
+
+    GST_DEBUG_OBJECT (vimbasrc, "dispose");
+
+    /* clean up as possible.  may be called multiple times */
+    vimbacamera_close(vimbasrc->camera);
+
+    G_OBJECT_CLASS (gst_vimba_src_parent_class)->dispose (object);
+}
+
+void
+gst_vimba_src_finalize (GObject * object)
+{
+    GstVimbaSrc *vimbasrc = GST_VIMBA_SRC (object);
+
+    GST_DEBUG_OBJECT (vimbasrc, "finalize");
+
+    /* clean up object here */
+    vimba_control_free(vimbasrc->control);
+    g_mutex_clear(&vimbasrc->config_lock);
+    g_free((gchar *) vimbasrc->camera->trigger_line);
+    g_free((gchar *) vimbasrc->camera->camera_id);
+    vimbacamera_destroy(vimbasrc->camera);
+    vimba_thread_params_clear(&vimbasrc->streaming_thread);
+    vimba_thread_report_clear(&vimbasrc->streaming_report);
+    if (vimbasrc->features != NULL) {
+        gst_structure_free(vimbasrc->features);
+    }
+    g_free(vimbasrc->fixation_report);
+    vimba_preview_free(vimbasrc->preview);
+    vimba_histogram_free(vimbasrc->histogram);
+    vimba_correction_free(vimbasrc->correction);
+    vimba_calibration_free(vimbasrc->calibration);
+    g_free(vimbasrc->calibration_dir);
+    g_free(vimbasrc->camera_serial);
+    if (vimbasrc->fd_allocator != NULL) {
+        gst_object_unref(vimbasrc->fd_allocator);
+    }
+    g_free(vimbasrc->shm_name);
+    g_free(vimbasrc->settings_file);
+    gst_object_unref(vimbasrc->device_clock);
+
+    /* Shutdown the Vimba API */
+    vimba_destroy(vimbasrc->vimba);
+
+    G_OBJECT_CLASS (gst_vimba_src_parent_class)->finalize (object);
+}
+
+/*
+ * Create the shared ring once the payload size is known and announce the
+ * caps to its consumers. A ring too small for the new frames is replaced,
+ * its consumers follow by reopening the name.
+ */
+static void
+gst_vimba_src_update_shm (GstVimbaSrc * vimbasrc, GstCaps * caps)
+{
+    gsize slot_size = (gsize) vimbasrc->camera->payload_size;
+    gchar *name, *string;
+    guint slots;
+
+    GST_OBJECT_LOCK(vimbasrc);
+    name = g_strdup(vimbasrc->shm_name);
+    slots = vimbasrc->shm_slots;
+    GST_OBJECT_UNLOCK(vimbasrc);
+
+    if (name == NULL) {
+        return;
+    }
+    if (vimbasrc->shm != NULL &&
+        vimba_shm_producer_slot_size(vimbasrc->shm) < slot_size) {
+        vimba_shm_producer_free(vimbasrc->shm);
+        vimbasrc->shm = NULL;
+    }
+    if (vimbasrc->shm == NULL) {
+        vimbasrc->shm = vimba_shm_producer_new(name, slots, slot_size);
+        if (vimbasrc->shm == NULL) {
+            GST_ELEMENT_WARNING(vimbasrc, RESOURCE, OPEN_WRITE,
+                ("Could not create the shared frame ring \"%s\".", name),
+                (NULL));
+            g_free(name);
+            return;
+        }
+    }
+    string = gst_caps_to_string(caps);
+    vimba_shm_producer_set_caps(vimbasrc->shm, string);
+    g_free(string);
+    g_free(name);
+}
+
+/* get caps from subclass */
+static GstCaps *
+gst_vimba_src_get_caps (GstBaseSrc * src, GstCaps * filter)
+{
+    g_message("gst_vimba_src_get_caps");
+    GstVimbaSrc *vimbasrc = GST_VIMBA_SRC (src);
+    GstCaps *caps;
+
+    g_mutex_lock(&vimbasrc->config_lock);
+    caps = gst_pad_get_pad_template_caps(GST_BASE_SRC_PAD(src));
+    caps = gst_caps_make_writable(caps);
+
+    guint size = gst_caps_get_size(caps);
+    g_message("num structures: %d", size );
+
+    /*
+     * Fill both "Bayer" and "Raw" capability structures with available
+     * formats from the camera.
+     */
+    const char * raw_formats[GST_VIMBA_SRC_MAXFORMATS];
+    const char * bayer_formats[GST_VIMBA_SRC_MAXFORMATS];
+    int i, num_raw_formats = 0, num_bayer_formats = 0;
+
+    GValue format = G_VALUE_INIT;
+    GValue raw_format_list   = G_VALUE_INIT;
+    GValue bayer_format_list = G_VALUE_INIT;
+    g_value_init(&format, G_TYPE_STRING);
+    g_value_init(&raw_format_list, GST_TYPE_LIST);
+    g_value_init(&bayer_format_list, GST_TYPE_LIST);
+
+    vimbasrc_supported_raw_formats(
+        vimbasrc->camera->supported_formats,
+        vimbasrc->camera->format_count,
+        raw_formats,
+        &num_raw_formats
+    );
+    for (i = 0; i < num_raw_formats; i++) {
+        const char * fstring = vimbasrc_vimba_to_gstreamer_raw(raw_formats[i]);
+        g_value_set_static_string(&format, fstring);
+        gst_value_list_append_value(&raw_format_list, &format);
+    }
+    vimbasrc_supported_bayer_formats(
+        vimbasrc->camera->supported_formats,
+        vimbasrc->camera->format_count,
+        bayer_formats,
+        &num_bayer_formats
+    );
+    for (i = 0; i < num_bayer_formats; i++) {
+        const char * fstring = vimbasrc_vimba_to_gstreamer_bayer(bayer_formats[i]);
+        g_value_set_static_string(&format, fstring);
+        gst_value_list_append_value(&bayer_format_list, &format);
+    }
+    g_value_unset(&format);
 
     GstStructure *bayer, *raw;
     raw   = gst_caps_get_structure(caps, 0);
     bayer = gst_caps_get_structure(caps, 1);
 
-    g_message("current framerate: %lu", vimbasrc->camera->framerate);
+    g_message("current framerate: %lu", vimbasrc->camera->framerate);
+
+    gst_structure_set(raw,
+        "width",  GST_TYPE_INT_RANGE, 1, vimbasrc->camera->max_width,
+        "height", GST_TYPE_INT_RANGE, 1, vimbasrc->camera->max_height,
+        "framerate", GST_TYPE_FRACTION, 30, 1,
+        NULL
+    );
+    gst_structure_set(bayer,
+        "width",  GST_TYPE_INT_RANGE, 1, vimbasrc->camera->max_width,
+        "height", GST_TYPE_INT_RANGE, 1, vimbasrc->camera->max_height,
+        "framerate", GST_TYPE_FRACTION, 30, 1,
+        NULL
+    );
+
+    gst_structure_set_value(raw,   "format", &raw_format_list);
+    gst_structure_set_value(bayer, "format", &bayer_format_list);
+    g_value_unset(&raw_format_list);
+    g_value_unset(&bayer_format_list);
+
+    /* do not advertise structures the camera has no formats for */
+    if (num_bayer_formats == 0) {
+        gst_caps_remove_structure(caps, 1);
+    }
+    if (num_raw_formats == 0) {
+        gst_caps_remove_structure(caps, 0);
+    }
+
+    if (filter) {
+        GstCaps *intersection = gst_caps_intersect_full(
+            filter, caps, GST_CAPS_INTERSECT_FIRST
+        );
+        gst_caps_unref(caps);
+        caps = intersection;
+    }
+
+    g_message("caps: %s", gst_caps_to_string(caps));
+
+    g_mutex_unlock(&vimbasrc->config_lock);
+    GST_DEBUG_OBJECT (vimbasrc, "get_caps");
+
+    return caps;
+}
+
+/* Bandwidth in bytes per second the camera may use, 0 means unknown */
+static guint64
+gst_vimba_src_link_budget (GstVimbaSrc * vimbasrc)
+{
+    guint64 budget;
+
+    GST_OBJECT_LOCK(vimbasrc);
+    budget = vimbasrc->link_budget;
+    GST_OBJECT_UNLOCK(vimbasrc);
+
+    if (budget == 0 && vimbasrc->camera->stream_bytes_per_second > 0) {
+        budget = (guint64) vimbasrc->camera->stream_bytes_per_second;
+    }
+    return budget;
+}
+
+/*
+ * Fixate a single candidate structure (one format) to the current camera
+ * geometry and frame rate.
+ */
+static void
+gst_vimba_src_fixate_candidate (GstVimbaSrc * vimbasrc, GstStructure * s)
+{
+    VimbaCamera *camera = vimbasrc->camera;
+    gint fps_n = 30, fps_d = 1;
+
+    if (camera->framerate > 0) {
+        gst_util_double_to_fraction(camera->framerate, &fps_n, &fps_d);
+    }
+    gst_structure_fixate_field_nearest_int(s, "width",
+        camera->width > 0 ? (int) camera->width : (int) camera->max_width
+    );
+    gst_structure_fixate_field_nearest_int(s, "height",
+        camera->height > 0 ? (int) camera->height : (int) camera->max_height
+    );
+    gst_structure_fixate_field_nearest_fraction(s, "framerate", fps_n, fps_d);
+    gst_structure_fixate(s);
+}
+
+/*
+ * Rank every format downstream accepts by the bandwidth it needs on the
+ * wire. A format that sustains the requested frame rate within the link
+ * budget beats one that does not, then fewer bits per pixel win, then the
+ * higher achievable frame rate. The reasoning is kept for the "stats"
+ * property so the bandwidth consequences of the caps are visible.
+ */
+static GstCaps *
+gst_vimba_src_fixate (GstBaseSrc * src, GstCaps * caps)
+{
+    GstVimbaSrc *vimbasrc = GST_VIMBA_SRC (src);
+    GstStructure *best = NULL;
+    const char *best_format = NULL;
+    guint64 best_bandwidth = 0;
+    gdouble best_fps = 0;
+    gboolean best_fits = FALSE;
+    int best_bits = 0;
+    guint64 budget;
+    GString *report;
+    guint i, j;
+
+    budget = gst_vimba_src_link_budget(vimbasrc);
+    report = g_string_new(NULL);
+
+    for (i = 0; i < gst_caps_get_size(caps); i++) {
+        GstStructure *s = gst_caps_get_structure(caps, i);
+        const GValue *formats = gst_structure_get_value(s, "format");
+        gboolean bayer =
+            strcmp(gst_structure_get_name(s), "video/x-bayer") == 0;
+        guint n = 1;
+
+        if (formats == NULL) {
+            continue;
+        }
+        if (GST_VALUE_HOLDS_LIST(formats)) {
+            n = gst_value_list_get_size(formats);
+        }
+
+        for (j = 0; j < n; j++) {
+            GstStructure *candidate = gst_structure_copy(s);
+            const char *gst_format, *vimba_format;
+            gint width = 0, height = 0, fps_n = 0, fps_d = 1;
+            guint64 frame_bytes, bandwidth;
+            gdouble requested_fps, achievable_fps;
+            gboolean fits, better;
+            int bits;
+
+            if (GST_VALUE_HOLDS_LIST(formats)) {
+                gst_structure_set_value(candidate, "format",
+                    gst_value_list_get_value(formats, j)
+                );
+            }
+            gst_vimba_src_fixate_candidate(vimbasrc, candidate);
+
+            gst_format = gst_structure_get_string(candidate, "format");
+            vimba_format = NULL;
+            if (gst_format != NULL) {
+                vimba_format = bayer
+                    ? vimbasrc_gstreamer_to_vimba_bayer(gst_format)
+                    : vimbasrc_gstreamer_to_vimba_raw(gst_format);
+            }
+            bits = vimbasrc_format_bits_per_pixel(vimba_format);
+            if (bits == 0) {
+                gst_structure_free(candidate);
+                continue;
+            }
+
+            gst_structure_get_int(candidate, "width", &width);
+            gst_structure_get_int(candidate, "height", &height);
+            gst_structure_get_fraction(candidate, "framerate", &fps_n, &fps_d);
+
+            frame_bytes = ((guint64) width * height * bits + 7) / 8;
+            requested_fps = fps_d > 0 ? (gdouble) fps_n / fps_d : 0;
+            bandwidth = (guint64) (frame_bytes * requested_fps);
+
+            achievable_fps = vimbasrc->camera->max_framerate > 0
+                ? vimbasrc->camera->max_framerate
+                : requested_fps;
+            if (budget > 0 && frame_bytes > 0) {
+                achievable_fps = MIN(achievable_fps,
+                    (gdouble) budget / frame_bytes
+                );
+            }
+            fits = achievable_fps >= requested_fps;
+
+            if (best == NULL) {
+                better = TRUE;
+            } else if (fits != best_fits) {
+                better = fits;
+            } else if (bits != best_bits) {
+                better = bits < best_bits;
+            } else {
+                better = achievable_fps > best_fps;
+            }
+
+            g_string_append_printf(report,
+                "%s%s: %d bpp, %" G_GUINT64_FORMAT " B/s at %.2f fps, "
+                "achievable %.2f fps, %s;",
+                report->len > 0 ? " " : "",
+                vimba_format, bits, bandwidth, requested_fps, achievable_fps,
+                fits ? "fits link" : "exceeds link"
+            );
+            GST_INFO_OBJECT(vimbasrc,
+                "candidate %s: %d bpp, %" G_GUINT64_FORMAT " B/s needed, "
+                "budget %" G_GUINT64_FORMAT " B/s, achievable %.2f fps",
+                vimba_format, bits, bandwidth, budget, achievable_fps
+            );
+
+            if (better) {
+                if (best != NULL) {
+                    gst_structure_free(best);
+                }
+                best = candidate;
+                best_format = vimba_format;
+                best_bits = bits;
+                best_fits = fits;
+                best_fps = achievable_fps;
+                best_bandwidth = bandwidth;
+            } else {
+                gst_structure_free(candidate);
+            }
+        }
+    }
+
+    if (best == NULL) {
+        g_string_free(report, TRUE);
+        GST_DEBUG_OBJECT(vimbasrc, "no known format, default fixation");
+        return GST_BASE_SRC_CLASS(gst_vimba_src_parent_class)->fixate(
+            src, caps
+        );
+    }
+
+    g_string_append_printf(report, " chose %s (%d bpp, %s)",
+        best_format, best_bits,
+        best_fits ? "fits link" : "no format fits, highest achievable rate"
+    );
+    GST_INFO_OBJECT(vimbasrc, "fixation: %s", report->str);
+
+    GST_OBJECT_LOCK(vimbasrc);
+    vimbasrc->fixated_format = best_format;
+    vimbasrc->fixated_bandwidth = best_bandwidth;
+    vimbasrc->fixated_framerate = best_fps;
+    g_free(vimbasrc->fixation_report);
+    vimbasrc->fixation_report = g_string_free(report, FALSE);
+    GST_OBJECT_UNLOCK(vimbasrc);
+
+    gst_caps_unref(caps);
+    caps = gst_caps_new_empty();
+    gst_caps_append_structure(caps, best);
+
+    return caps;
+}
+
+/*
+ * Forget the frames kept for a burst, vimbacamera_start queues them to the
+ * sdk again. Runs on the streaming thread or with it stopped.
+ */
+static void
+gst_vimba_src_drop_burst (GstVimbaSrc * vimbasrc)
+{
+    g_queue_clear(&vimbasrc->burst_history);
+    g_queue_clear(&vimbasrc->burst_window);
+    vimbasrc->burst_collecting = FALSE;
+}
+
+/* notify the subclass of new caps */
+static gboolean
+gst_vimba_src_set_caps (GstBaseSrc * src, GstCaps * caps)
+{
+    g_message("gst_vimba_src_set_caps");
+
+
+    GstVimbaSrc *vimbasrc = GST_VIMBA_SRC (src);
+    GstStructure *structure;
+    VimbaConfig config;
+    GError *error = NULL;
+    const char *format;
+    gint width, height;
+    gboolean configured;
+
+    /* the ring may be reallocated, and start queues the kept frames */
+    gst_vimba_src_drop_burst(vimbasrc);
+    vimbacamera_stop(vimbasrc->camera);
+    gst_vimba_src_qos_snapshot(vimbasrc);
+
+    g_message("Negotiated Caps: %s", gst_caps_to_string(caps));
+
+    GST_OBJECT_LOCK(vimbasrc);
+    vimbasrc->preview_dirty = TRUE;
+    vimbasrc->image_stats_dirty = TRUE;
+    vimbasrc->correction_dirty = TRUE;
+    GST_OBJECT_UNLOCK(vimbasrc);
+
+    /* bayer caps are not video info, only the fields needed are read */
+    structure = gst_caps_get_structure(caps, 0);
+    if (!gst_structure_get_int(structure, "width", &width) ||
+        !gst_structure_get_int(structure, "height", &height)) {
+        return FALSE;
+    }
+    format = gst_structure_get_string(structure, "format");
+    /* Set capability from fomat */
+    if (strcmp(gst_structure_get_name(structure),"video/x-bayer") == 0) {
+        config.format = vimbasrc_gstreamer_to_vimba_bayer(format);
+    } else {
+        config.format = vimbasrc_gstreamer_to_vimba_raw(format);
+    }
+    if (config.format == NULL) {
+        GST_ELEMENT_ERROR(vimbasrc, CORE, NEGOTIATION,
+            ("Camera cannot deliver format %s", GST_STR_NULL(format)), (NULL));
+        return FALSE;
+    }
+    config.width = width;
+    config.height = height;
+    config.offset_x = -1;
+    config.offset_y = -1;
+    g_message("Setting camera format: %s", config.format);
+
+    g_mutex_lock(&vimbasrc->config_lock);
+    configured = vimba_config_apply(vimbasrc->camera, &config,
+        &vimbasrc->config_report, &error);
+    if (configured) {
+        vimbasrc->camera->width = width;
+        vimbasrc->camera->height = height;
+        vimbasrc->camera->format = config.format;
+    } else {
+        vimbasrc->config_failures++;
+    }
+    g_mutex_unlock(&vimbasrc->config_lock);
+    /* QoS starts over from the rate the new caps run at */
+    gst_vimba_src_qos_reset(vimbasrc);
+    if (!configured) {
+        /* the camera keeps its previous configuration, streaming that
+         * would hand out frames that do not match the caps */
+        GST_ELEMENT_ERROR(vimbasrc, CORE, NEGOTIATION,
+            ("Camera cannot deliver %dx%d %s", width, height, config.format),
+            ("%s", error->message));
+        g_error_free(error);
+        return FALSE;
+    }
+    GST_DEBUG_OBJECT (vimbasrc, "set_caps");
+
+    vimbacamera_start(vimbasrc->camera);
+    gst_vimba_src_qos_snapshot(vimbasrc);
+    gst_vimba_src_update_shm(vimbasrc, caps);
+
+    return TRUE;
+}
+
+/* the pipeline selects a clock again and redistributes the base time */
+static void
+gst_vimba_src_lose_clock (GstVimbaSrc * vimbasrc)
+{
+    if (GST_OBJECT_FLAG_IS_SET(vimbasrc, GST_ELEMENT_FLAG_PROVIDE_CLOCK)) {
+        gst_element_post_message(GST_ELEMENT(vimbasrc),
+            gst_message_new_clock_lost(GST_OBJECT(vimbasrc),
+                vimbasrc->device_clock));
+    }
+}
+
+/* runs on the ptp monitor thread, or in start for the first poll */
+static void
+gst_vimba_src_ptp_notify (const gchar * status, gboolean locked,
+        gboolean rebased, gpointer user_data)
+{
+    GstVimbaSrc *vimbasrc = user_data;
+
+    gst_element_post_message(GST_ELEMENT(vimbasrc),
+        gst_message_new_element(GST_OBJECT(vimbasrc),
+            gst_structure_new("vimbasrc-ptp-status",
+                "status", G_TYPE_STRING, status,
+                "locked", G_TYPE_BOOLEAN, locked,
+                "rebased", G_TYPE_BOOLEAN, rebased,
+                NULL)));
+    if (rebased) {
+        gst_vimba_src_lose_clock(vimbasrc);
+    }
+}
+
+static GstClock *
+gst_vimba_src_provide_clock (GstElement * element)
+{
+    GstVimbaSrc *vimbasrc = GST_VIMBA_SRC (element);
+    GstClock *clock = NULL;
+
+    GST_OBJECT_LOCK(vimbasrc);
+    if (vimbasrc->ptp_clock && vimbasrc->ptp != NULL) {
+        clock = gst_object_ref(vimbasrc->device_clock);
+    }
+    GST_OBJECT_UNLOCK(vimbasrc);
+    return clock;
+}
+
+/* the streaming task posts its leave from its own thread, the last chance
+ * to undo the cpus and priority before the thread goes back to the pool */
+static gboolean
+gst_vimba_src_post_message (GstElement * element, GstMessage * message)
+{
+    GstVimbaSrc *vimbasrc = GST_VIMBA_SRC (element);
+    GstStreamStatusType type;
+
+    if (GST_MESSAGE_TYPE(message) == GST_MESSAGE_STREAM_STATUS &&
+        GST_MESSAGE_SRC(message) == GST_OBJECT(GST_BASE_SRC_PAD(vimbasrc))) {
+        gst_message_parse_stream_status(message, &type, NULL);
+        if (type == GST_STREAM_STATUS_TYPE_LEAVE) {
+            vimba_thread_restore(&vimbasrc->streaming_thread,
+                &vimbasrc->streaming_report);
+        }
+    }
+    return GST_ELEMENT_CLASS(gst_vimba_src_parent_class)->post_message(
+        element, message);
+}
+
+/* start and stop processing, ideal for opening/closing the resource */
+static gboolean
+gst_vimba_src_start (GstBaseSrc * src)
+{
+    gboolean res = TRUE;
+    GstVimbaSrc *vimbasrc = GST_VIMBA_SRC (src);
+    VimbaPtp *ptp = NULL;
+    gboolean provide;
+
+    vimba_thread_params_reset(&vimbasrc->streaming_thread,
+        &vimbasrc->streaming_report);
+    vimbacamera_start(vimbasrc->camera);
+    gst_vimba_src_qos_snapshot(vimbasrc);
+    vimbasrc->discont = FALSE;
+    vimbasrc->reconnect = vimba_reconnect_new(vimbasrc->camera,
+        &vimbasrc->config_lock, gst_vimba_src_restore, vimbasrc);
+
+    /* the device clock is only followed when something uses it */
+    GST_OBJECT_LOCK(vimbasrc);
+    provide = vimbasrc->ptp_clock;
+    if (vimbasrc->ptp_mode != VIMBA_PTP_MODE_NONE || provide ||
+        vimbasrc->timestamp_mode == VIMBA_TIMESTAMP_DEVICE) {
+        GST_OBJECT_UNLOCK(vimbasrc);
+        ptp = vimba_ptp_new(vimbasrc->camera, &vimbasrc->config_lock,
+            vimbasrc->device_clock, gst_vimba_src_ptp_notify, vimbasrc);
+        GST_OBJECT_LOCK(vimbasrc);
+    }
+    vimbasrc->ptp = ptp;
+    GST_OBJECT_UNLOCK(vimbasrc);
+    if (provide) {
+        gst_element_post_message(GST_ELEMENT(vimbasrc),
+            gst_message_new_clock_provide(GST_OBJECT(vimbasrc),
+                vimbasrc->device_clock, TRUE));
+    }
+
+    GST_DEBUG_OBJECT (vimbasrc, "start");
+
+    return res;
+}
+
+static gboolean
+gst_vimba_src_stop (GstBaseSrc * src)
+{
+    gboolean res = TRUE;
+    GstVimbaSrc *vimbasrc = GST_VIMBA_SRC (src);
+    VimbaPtp *ptp;
+
+    vimba_reconnect_free(vimbasrc->reconnect);
+    vimbasrc->reconnect = NULL;
+    vimbacamera_stop(vimbasrc->camera);
+    gst_vimba_src_qos_snapshot(vimbasrc);
+
+    GST_OBJECT_LOCK(vimbasrc);
+    ptp = vimbasrc->ptp;
+    vimbasrc->ptp = NULL;
+    GST_OBJECT_UNLOCK(vimbasrc);
+    /* the clock keeps its last calibration, a pipeline using it picks one
+     * again */
+    vimba_ptp_free(ptp);
+    gst_vimba_src_lose_clock(vimbasrc);
+
+    gst_vimba_src_drop_burst(vimbasrc);
+    g_atomic_int_set(&vimbasrc->burst_requested, 0);
+
+    vimba_preview_free(vimbasrc->preview);
+    vimbasrc->preview = NULL;
+    vimbasrc->preview_started = FALSE;
+    vimba_histogram_free(vimbasrc->histogram);
+    vimbasrc->histogram = NULL;
+    vimba_correction_free(vimbasrc->correction);
+    vimbasrc->correction = NULL;
+    vimba_calibration_free(vimbasrc->calibration);
+    vimbasrc->calibration = NULL;
+    vimbasrc->correction_dirty = TRUE;
+
+    /* pushed frames keep the ring memory alive through their parent */
+    if (vimbasrc->ring_memory != NULL) {
+        gst_memory_unref(vimbasrc->ring_memory);
+        vimbasrc->ring_memory = NULL;
+    }
+    vimbacamera_ring_unref(vimbasrc->ring_memory_ring);
+    vimbasrc->ring_memory_ring = NULL;
+
+    vimba_shm_producer_free(vimbasrc->shm);
+    vimbasrc->shm = NULL;
+
+    GST_DEBUG_OBJECT (vimbasrc, "stop");
+
+    return res;
+}
+
+/* attach what the camera tells about the frame besides the image */
+static void
+gst_vimba_src_decorate_buffer (GstVimbaSrc * vimbasrc, GstBuffer * buf,
+        VmbFrame_t * frame, GstClockTime dequeue_time)
+{
+    VimbaCamera *camera = vimbasrc->camera;
+    GstVimbaFrameMeta *meta;
+    VimbaChunkData chunk;
+    gchar *applied = NULL;
+    guint64 device_time = vimbacamera_frame_device_time(camera, frame);
+
+    /* frames of one action command share the offset */
+    GST_BUFFER_OFFSET(buf) = vimbacamera_frame_trigger_id(camera, frame);
+    GST_BUFFER_OFFSET_END(buf) = GST_BUFFER_OFFSET(buf) + 1;
+    gst_buffer_add_reference_timestamp_meta(buf,
+        device_timestamp_caps,
+        device_time,
+        GST_CLOCK_TIME_NONE
+    );
+
+    meta = gst_buffer_add_vimba_frame_meta(buf);
+    meta->frame_id = frame->frameID;
+    meta->device_timestamp = device_time;
+    meta->trigger_id = GST_BUFFER_OFFSET(buf);
+    meta->receive_status = frame->receiveStatus;
+    meta->callback_time = vimbacamera_frame_callback_time(camera, frame);
+    meta->dequeue_time = dequeue_time;
+    meta->feature_generation = vimba_control_frame_generation(
+        vimbasrc->control, camera, frame, &applied
+    );
+    if (applied != NULL) {
+        /* tells control loops which frame carries their settings */
+        gst_element_post_message(GST_ELEMENT(vimbasrc),
+            gst_message_new_element(GST_OBJECT(vimbasrc),
+                gst_structure_new("vimbasrc-features-applied",
+                    "generation", G_TYPE_UINT64, meta->feature_generation,
+                    "features", G_TYPE_STRING, applied,
+                    "frame-id", G_TYPE_UINT64, meta->frame_id,
+                    "timestamp", G_TYPE_UINT64, GST_BUFFER_PTS(buf),
+                    NULL)));
+        g_free(applied);
+    }
+    if (vimbacamera_frame_chunk_data(camera, frame, &chunk)) {
+        meta->has_chunk = TRUE;
+        meta->exposure_time = chunk.exposure_time;
+        meta->gain = chunk.gain;
+        meta->frame_counter = (guint64) chunk.frame_counter;
+        meta->line_status = (guint32) chunk.line_status;
+    }
+}
+
+/* the time the buffer leaves the element, for vimbatracer */
+static void
+gst_vimba_src_stamp_push (GstBuffer * buf)
+{
+    GstVimbaFrameMeta *meta = gst_buffer_get_vimba_frame_meta(buf);
+
+    if (meta != NULL) {
+        meta->push_time = gst_util_get_timestamp();
+    }
+}
+
+/* running time the frame reached the host, taken from its callback time */
+static GstClockTime
+gst_vimba_src_capture_time (GstVimbaSrc * vimbasrc, VmbFrame_t * frame,
+        GstClock * clock, GstClockTime base_time)
+{
+    GstClockTime callback_time =
+        vimbacamera_frame_callback_time(vimbasrc->camera, frame);
+    GstClockTimeDiff clock_offset;
+    gint64 time;
+
+    if (clock == NULL || callback_time == 0) {
+        return GST_CLOCK_TIME_NONE;
+    }
+    /* the pipeline clock and the monotonic clock advance at the same rate */
+    clock_offset = GST_CLOCK_DIFF(gst_util_get_timestamp(),
+        gst_clock_get_time(clock));
+    time = (gint64) callback_time + clock_offset - (gint64) base_time;
+    return time > 0 ? (GstClockTime) time : 0;
+}
+
+/*
+ * In timestamp-mode device, the running time of the exposure taken from the
+ * device time of the frame, host_time otherwise or while the device clock
+ * is not calibrated. Exact with the ptp clock as pipeline clock, any other
+ * clock is compared with it first.
+ */
+static GstClockTime
+gst_vimba_src_frame_timestamp (GstVimbaSrc * vimbasrc, VmbFrame_t * frame,
+        GstClock * clock, GstClockTime base_time, GstClockTime host_time)
+{
+    VimbaTimestampMode mode;
+    GstClock *device_clock;
+    GstClockTimeDiff clock_offset = 0;
+    gint64 time;
+
+    GST_OBJECT_LOCK(vimbasrc);
+    mode = vimbasrc->timestamp_mode;
+    GST_OBJECT_UNLOCK(vimbasrc);
+    if (mode != VIMBA_TIMESTAMP_DEVICE || clock == NULL ||
+        vimbasrc->ptp == NULL || !vimba_ptp_calibrated(vimbasrc->ptp)) {
+        return host_time;
+    }
+    device_clock = vimba_ptp_get_clock(vimbasrc->ptp);
+    if (device_clock != clock) {
+        clock_offset = GST_CLOCK_DIFF(gst_clock_get_time(device_clock),
+            gst_clock_get_time(clock));
+    }
+    time = (gint64) vimbacamera_frame_device_time(vimbasrc->camera, frame) +
+        clock_offset - (gint64) base_time;
+    return time > 0 ? (GstClockTime) time : 0;
+}
+
+typedef struct {
+    GstVimbaSrc    *src;
+    VimbaFrameRing *ring;
+    VmbFrame_t     *frame;
+} GstVimbaSrcHeldFrame;
+
+static void
+gst_vimba_src_release_frame (gpointer data)
+{
+    GstVimbaSrcHeldFrame *held = data;
+
+    vimbacamera_release_frame(held->src->camera, held->ring, held->frame);
+    gst_object_unref(held->src);
+    g_slice_free(GstVimbaSrcHeldFrame, held);
+}
+
+static GQuark
+gst_vimba_src_held_quark (void)
+{
+    static GQuark quark = 0;
+
+    if (quark == 0) {
+        quark = g_quark_from_static_string("GstVimbaSrcHeldFrame");
+    }
+    return quark;
+}
+
+/*
+ * One memory spanning the whole ring when it is backed by a memfd, as
+ * dmabuf if udmabuf exported it. Frames are pushed as shares of it, so
+ * downstream sees their fd and offset. NULL for rings without an fd.
+ */
+static GstMemory *
+gst_vimba_src_ring_memory (GstVimbaSrc * vimbasrc, VimbaFrameRing * ring)
+{
+    VimbaAllocation *memory = &ring->memory;
+    GstFdMemoryFlags flags =
+        GST_FD_MEMORY_FLAG_KEEP_MAPPED | GST_FD_MEMORY_FLAG_DONT_CLOSE;
+
+    if (vimbasrc->ring_memory_ring == ring) {
+        return vimbasrc->ring_memory;
+    }
+    if (vimbasrc->ring_memory != NULL) {
+        gst_memory_unref(vimbasrc->ring_memory);
+        vimbasrc->ring_memory = NULL;
+    }
+    vimbacamera_ring_unref(vimbasrc->ring_memory_ring);
+    vimbasrc->ring_memory_ring = vimbacamera_ring_ref(ring);
+
+    if (vimbasrc->fd_allocator != NULL &&
+        GST_IS_DMABUF_ALLOCATOR(vimbasrc->fd_allocator) !=
+            (memory->dmabuf_fd >= 0)) {
+        gst_object_unref(vimbasrc->fd_allocator);
+        vimbasrc->fd_allocator = NULL;
+    }
+    if (memory->dmabuf_fd >= 0) {
+        if (vimbasrc->fd_allocator == NULL) {
+            vimbasrc->fd_allocator = gst_dmabuf_allocator_new();
+        }
+        vimbasrc->ring_memory = gst_dmabuf_allocator_alloc_with_flags(
+            vimbasrc->fd_allocator, memory->dmabuf_fd, memory->size, flags
+        );
+    } else if (memory->fd >= 0) {
+        if (vimbasrc->fd_allocator == NULL) {
+            vimbasrc->fd_allocator = gst_fd_allocator_new();
+        }
+        vimbasrc->ring_memory = gst_fd_allocator_alloc(
+            vimbasrc->fd_allocator, memory->fd, memory->size, flags
+        );
+    }
+    if (vimbasrc->ring_memory == NULL && vimbasrc->fd_memory) {
+        GST_WARNING_OBJECT(vimbasrc,
+            "fd-memory requested but the ring has no fd, pushing plain memory");
+    } else if (vimbasrc->ring_memory == NULL) {
+        GST_DEBUG_OBJECT(vimbasrc, "ring has no fd, wrapping its frames");
+    }
+    return vimbasrc->ring_memory;
+}
+
+/* a buffer using the frame memory, the frame is requeued when it is freed */
+static GstBuffer *
+gst_vimba_src_wrap_frame (GstVimbaSrc * vimbasrc, VmbFrame_t * frame)
+{
+    GstVimbaSrcHeldFrame *held = g_slice_new(GstVimbaSrcHeldFrame);
+    gsize size = frame->imageSize > 0 ? frame->imageSize : frame->bufferSize;
+    GstMemory *ring_memory, *mem;
+    GstBuffer *buf;
+
+    held->src = gst_object_ref(vimbasrc);
+    held->frame = frame;
+    held->ring = vimbacamera_hold_frame(vimbasrc->camera, frame);
+
+    ring_memory = gst_vimba_src_ring_memory(vimbasrc, held->ring);
+    if (ring_memory == NULL) {
+        return gst_buffer_new_wrapped_full(GST_MEMORY_FLAG_READONLY,
+            frame->buffer, frame->bufferSize, 0, size,
+            held, gst_vimba_src_release_frame
+        );
+    }
+    /* shares are read only, the frame returns when the share is freed */
+    mem = gst_memory_share(ring_memory,
+        (guint8 *) frame->buffer - (guint8 *) held->ring->memory.data, size);
+    gst_mini_object_set_qdata(GST_MINI_OBJECT_CAST(mem),
+        gst_vimba_src_held_quark(), held, gst_vimba_src_release_frame);
+    buf = gst_buffer_new();
+    gst_buffer_append_memory(buf, mem);
+    return buf;
+}
+
+/* cover the time since the last gap, the first call only sets its start */
+static void
+gst_vimba_src_push_gap (GstVimbaSrc * vimbasrc, GstClock * clock,
+        GstClockTime base_time)
+{
+    GstPad *pad = GST_BASE_SRC_PAD(vimbasrc);
+    GstEvent *segment;
+    GstClockTime now;
+
+    if (clock == NULL) {
+        return;
+    }
+    /* a gap before the first segment would precede it */
+    segment = gst_pad_get_sticky_event(pad, GST_EVENT_SEGMENT, 0);
+    if (segment == NULL) {
+        return;
+    }
+    gst_event_unref(segment);
+
+    now = gst_clock_get_time(clock) - base_time;
+    if (GST_CLOCK_TIME_IS_VALID(vimbasrc->gap_position) &&
+        now > vimbasrc->gap_position) {
+        gst_pad_push_event(pad, gst_event_new_gap(vimbasrc->gap_position,
+            now - vimbasrc->gap_position));
+        GST_OBJECT_LOCK(vimbasrc);
+        vimbasrc->gap_events++;
+        GST_OBJECT_UNLOCK(vimbasrc);
+    }
+    vimbasrc->gap_position = now;
+}
+
+/*
+ * The camera went away: keep downstream going with gap events until the
+ * watchdog reopened it, then restart acquisition on the same ring. The
+ * first buffer after it is flagged DISCONT.
+ */
+static GstFlowReturn
+gst_vimba_src_wait_camera (GstVimbaSrc * vimbasrc, GstClock * clock,
+        GstClockTime base_time)
+{
+    GstClockTime recovery_time = 0;
+
+    /* the sdk forgot the kept frames */
+    gst_vimba_src_drop_burst(vimbasrc);
+
+    gst_element_post_message(GST_ELEMENT(vimbasrc),
+        gst_message_new_element(GST_OBJECT(vimbasrc),
+            gst_structure_new("vimbasrc-camera-lost",
+                "camera", G_TYPE_STRING, vimbasrc->camera->camera_id,
+                NULL)));
+    vimbasrc->gap_position = GST_CLOCK_TIME_NONE;
+    gst_vimba_src_push_gap(vimbasrc, clock, base_time);
+    for (;;) {
+        if (vimba_reconnect_wait(vimbasrc->reconnect, FRAME_POLL_US)) {
+            if (vimba_reconnect_resume(vimbasrc->reconnect, &recovery_time)) {
+                break;
+            }
+            continue;
+        }
+        if (g_atomic_int_get(&vimbasrc->flushing)) {
+            return GST_FLOW_FLUSHING;
+        }
+        gst_vimba_src_push_gap(vimbasrc, clock, base_time);
+    }
+
+    GST_INFO_OBJECT(vimbasrc, "camera back after %" GST_TIME_FORMAT,
+        GST_TIME_ARGS(recovery_time));
+    gst_element_post_message(GST_ELEMENT(vimbasrc),
+        gst_message_new_element(GST_OBJECT(vimbasrc),
+            gst_structure_new("vimbasrc-camera-recovered",
+                "camera", G_TYPE_STRING, vimbasrc->camera->camera_id,
+                "recovery-time", G_TYPE_UINT64, recovery_time,
+                NULL)));
+    vimbasrc->discont = TRUE;
+    vimbasrc->burst_discont = TRUE;
+    return GST_FLOW_OK;
+}
+
+static void
+gst_vimba_src_burst_complete (GstVimbaSrc * vimbasrc)
+{
+    VmbFrame_t *frame;
+
+    GST_INFO_OBJECT(vimbasrc, "burst of %u frames",
+        g_queue_get_length(&vimbasrc->burst_history));
+    while ((frame = g_queue_pop_head(&vimbasrc->burst_history)) != NULL) {
+        g_queue_push_tail(&vimbasrc->burst_window, frame);
+    }
+    vimbasrc->burst_collecting = FALSE;
+    vimbasrc->burst_discont = TRUE;
+    GST_OBJECT_LOCK(vimbasrc);
+    vimbasrc->bursts_completed++;
+    GST_OBJECT_UNLOCK(vimbasrc);
+}
+
+/* add a fresh frame to the history, trimming it or completing a burst */
+static void
+gst_vimba_src_burst_collect (GstVimbaSrc * vimbasrc, VmbFrame_t * frame)
+{
+    if (VmbFrameStatusComplete != frame->receiveStatus) {
+        vimbacamera_queue_frame(vimbasrc->camera, frame);
+        return;
+    }
+    if (g_atomic_int_compare_and_exchange(&vimbasrc->burst_requested, 1, 0)) {
+        if (vimbasrc->burst_collecting) {
+            GST_DEBUG_OBJECT(vimbasrc, "burst already in progress");
+        } else {
+            vimbasrc->burst_collecting = TRUE;
+            vimbasrc->burst_remaining = vimbasrc->post_trigger_frames;
+        }
+    }
+    if (vimbasrc->burst_collecting && vimbasrc->burst_remaining == 0) {
+        gst_vimba_src_burst_complete(vimbasrc);
+    }
+
+    g_queue_push_tail(&vimbasrc->burst_history, frame);
+    if (vimbasrc->burst_collecting) {
+        if (--vimbasrc->burst_remaining == 0) {
+            gst_vimba_src_burst_complete(vimbasrc);
+        }
+        return;
+    }
+    while (g_queue_get_length(&vimbasrc->burst_history) > vimbasrc->burst_frames) {
+        vimbacamera_queue_frame(vimbasrc->camera,
+            g_queue_pop_head(&vimbasrc->burst_history));
+    }
+}
+
+/*
+ * Burst mode: frames only circulate through the history until a burst is
+ * triggered, then the window is pushed at the pace downstream accepts it
+ * while new frames keep filling the history.
+ */
+static GstFlowReturn
+gst_vimba_src_create_burst (GstVimbaSrc * vimbasrc, GstClock * clock,
+        GstClockTime base_time, GstBuffer ** bufp)
+{
+    VimbaCamera *camera = vimbasrc->camera;
+    VmbFrame_t *frame;
+    GstBuffer *buf;
+    GstClockTime timestamp;
+    GstFlowReturn ret;
+
+    for (;;) {
+        while ((frame = vimbacamera_consume_frame_timeout(camera, 0)) != NULL) {
+            gst_vimba_src_burst_collect(vimbasrc, frame);
+        }
+        if ((frame = g_queue_pop_head(&vimbasrc->burst_window)) != NULL) {
+            break;
+        }
+        if (g_atomic_int_get(&vimbasrc->flushing)) {
+            return GST_FLOW_FLUSHING;
+        }
+        if (vimbacamera_is_lost(camera)) {
+            ret = gst_vimba_src_wait_camera(vimbasrc, clock, base_time);
+            if (ret != GST_FLOW_OK) {
+                return ret;
+            }
+            continue;
+        }
+        if (camera->started == FALSE) {
+            return GST_FLOW_ERROR;
+        }
+        frame = vimbacamera_consume_frame_timeout(camera, FRAME_POLL_US);
+        if (frame != NULL) {
+            gst_vimba_src_burst_collect(vimbasrc, frame);
+        }
+    }
+
+    gst_vimba_src_correct_frame(vimbasrc, frame);
+    buf = gst_vimba_src_wrap_frame(vimbasrc, frame);
+    timestamp = gst_vimba_src_capture_time(vimbasrc, frame, clock, base_time);
+    timestamp = gst_vimba_src_frame_timestamp(vimbasrc, frame, clock,
+        base_time, timestamp);
+    GST_BUFFER_DTS(buf) = timestamp;
+    GST_BUFFER_PTS(buf) = timestamp;
+    if (vimbasrc->burst_discont) {
+        GST_BUFFER_FLAG_SET(buf, GST_BUFFER_FLAG_DISCONT);
+        vimbasrc->burst_discont = FALSE;
+    }
+    gst_vimba_src_decorate_buffer(vimbasrc, buf, frame, gst_util_get_timestamp());
+    gst_vimba_src_stamp_push(buf);
+    *bufp = buf;
+    return GST_FLOW_OK;
+}
+
+/* preview pad */
+
+static GstPad *
+gst_vimba_src_request_new_pad (GstElement * element, GstPadTemplate * templ,
+        const gchar * name, const GstCaps * caps)
+{
+    GstVimbaSrc *vimbasrc = GST_VIMBA_SRC (element);
+    GstPad *pad;
+
+    GST_OBJECT_LOCK(vimbasrc);
+    if (vimbasrc->preview_pad != NULL) {
+        GST_OBJECT_UNLOCK(vimbasrc);
+        GST_WARNING_OBJECT(vimbasrc, "there is only one preview pad");
+        return NULL;
+    }
+    pad = gst_pad_new_from_template(templ, "preview");
+    gst_pad_use_fixed_caps(pad);
+    vimbasrc->preview_pad = pad;
+    vimbasrc->preview_dirty = TRUE;
+    vimbasrc->preview_started = FALSE;
+    GST_OBJECT_UNLOCK(vimbasrc);
+
+    gst_pad_set_active(pad, TRUE);
+    gst_element_add_pad(element, pad);
+    return pad;
+}
+
+static void
+gst_vimba_src_release_pad (GstElement * element, GstPad * pad)
+{
+    GstVimbaSrc *vimbasrc = GST_VIMBA_SRC (element);
+
+    GST_OBJECT_LOCK(vimbasrc);
+    if (vimbasrc->preview_pad == pad) {
+        vimbasrc->preview_pad = NULL;
+    }
+    GST_OBJECT_UNLOCK(vimbasrc);
+
+    gst_pad_set_active(pad, FALSE);
+    gst_element_remove_pad(element, pad);
+}
+
+static GstPadProbeReturn
+gst_vimba_src_preview_probe (GstPad * pad, GstPadProbeInfo * info,
+        gpointer user_data)
+{
+    GstVimbaSrc *vimbasrc = GST_VIMBA_SRC (user_data);
+    GstEvent *event = GST_PAD_PROBE_INFO_EVENT(info);
+    GstPad *preview_pad = NULL;
+
+    switch (GST_EVENT_TYPE(event)) {
+        case GST_EVENT_FLUSH_START:
+        case GST_EVENT_FLUSH_STOP:
+        case GST_EVENT_EOS:
+            GST_OBJECT_LOCK(vimbasrc);
+            if (vimbasrc->preview_pad != NULL && vimbasrc->preview_started) {
+                preview_pad = gst_object_ref(vimbasrc->preview_pad);
+            }
+            GST_OBJECT_UNLOCK(vimbasrc);
+            break;
+        default:
+            break;
+    }
+    if (preview_pad != NULL) {
+        if (GST_EVENT_TYPE(event) == GST_EVENT_FLUSH_STOP) {
+            vimbasrc->preview_need_segment = TRUE;
+        }
+        gst_pad_push_event(preview_pad, gst_event_ref(event));
+        gst_object_unref(preview_pad);
+    }
+    return GST_PAD_PROBE_OK;
+}
+
+/* (re)create the preview for the negotiated caps and announce its caps */
+static gboolean
+gst_vimba_src_setup_preview (GstVimbaSrc * vimbasrc, GstPad * pad,
+        guint scale, guint decimation)
+{
+    GstCaps *caps = gst_pad_get_current_caps(GST_BASE_SRC_PAD(vimbasrc));
+
+    vimba_preview_free(vimbasrc->preview);
+    vimbasrc->preview = caps != NULL
+        ? vimba_preview_new(caps, scale, decimation) : NULL;
+    if (vimbasrc->preview == NULL) {
+        GST_WARNING_OBJECT(vimbasrc, "no preview of %" GST_PTR_FORMAT, caps);
+        if (caps != NULL) {
+            gst_caps_unref(caps);
+        }
+        return FALSE;
+    }
+    gst_caps_unref(caps);
+
+    if (!vimbasrc->preview_started) {
+        gchar *stream_id = gst_pad_create_stream_id(pad,
+            GST_ELEMENT(vimbasrc), "preview");
+        gst_pad_push_event(pad, gst_event_new_stream_start(stream_id));
+        g_free(stream_id);
+        vimbasrc->preview_started = TRUE;
+        vimbasrc->preview_need_segment = TRUE;
+    }
+    gst_pad_push_event(pad, gst_event_new_caps(vimbasrc->preview->caps));
+    return TRUE;
+}
 
-    gst_structure_set(raw,
-        "width",  GST_TYPE_INT_RANGE, 1, vimbasrc->camera->max_width,
-        "height", GST_TYPE_INT_RANGE, 1, vimbasrc->camera->max_height,
-        "framerate", GST_TYPE_FRACTION, 30, 1,
-        NULL
-    );
-    bayer = gst_structure_copy(raw);
+/* push a downscaled copy of a frame on the preview pad, if requested */
+static void
+gst_vimba_src_push_preview (GstVimbaSrc * vimbasrc, GstBuffer * buf,
+        const guint8 * data, gsize size)
+{
+    GstBuffer *preview;
+    guint scale, decimation;
+    gboolean dirty;
+    GstPad *pad;
 
-    gst_structure_set_value(raw,   "format", &raw_format_list);
-    gst_structure_set_value(bayer, "format", &bayer_format_list);
+    GST_OBJECT_LOCK(vimbasrc);
+    if (vimbasrc->preview_pad == NULL) {
+        GST_OBJECT_UNLOCK(vimbasrc);
+        return;
+    }
+    pad = gst_object_ref(vimbasrc->preview_pad);
+    scale = vimbasrc->preview_scale;
+    decimation = vimbasrc->preview_decimation;
+    dirty = vimbasrc->preview_dirty;
+    vimbasrc->preview_dirty = FALSE;
+    GST_OBJECT_UNLOCK(vimbasrc);
 
-    g_message("caps: %s", gst_caps_to_string(caps));
+    if (dirty) {
+        gst_vimba_src_setup_preview(vimbasrc, pad, scale, decimation);
+    }
+    if (vimbasrc->preview == NULL ||
+        vimbasrc->preview_frames++ % decimation != 0) {
+        goto done;
+    }
+    if (vimbasrc->preview_need_segment) {
+        gst_pad_push_event(pad,
+            gst_event_new_segment(&GST_BASE_SRC(vimbasrc)->segment));
+        vimbasrc->preview_need_segment = FALSE;
+    }
 
-    g_mutex_unlock(&vimbasrc->config_lock);
-    GST_DEBUG_OBJECT (vimbasrc, "get_caps");
+    preview = vimba_preview_process(vimbasrc->preview, data, size);
+    if (preview == NULL) {
+        goto done;
+    }
+    GST_BUFFER_PTS(preview) = GST_BUFFER_PTS(buf);
+    GST_BUFFER_DTS(preview) = GST_BUFFER_DTS(buf);
+    GST_BUFFER_OFFSET(preview) = GST_BUFFER_OFFSET(buf);
+    GST_BUFFER_OFFSET_END(preview) = GST_BUFFER_OFFSET_END(buf);
+    /* a slow preview branch holds up capture, put a leaky queue behind it */
+    gst_pad_push(pad, preview);
+    vimbasrc->previews_pushed++;
 
-    return caps;
+done:
+    gst_object_unref(pad);
 }
 
-/* notify the subclass of new caps */
-static gboolean
-gst_vimba_src_set_caps (GstBaseSrc * src, GstCaps * caps)
+/* where the correction maps of the open camera are stored */
+static gchar *
+gst_vimba_src_calibration_path (GstVimbaSrc * vimbasrc)
 {
-    g_message("gst_vimba_src_set_caps");
+    const gchar *serial = vimbasrc->camera_serial != NULL &&
+        vimbasrc->camera_serial[0] != '\0'
+        ? vimbasrc->camera_serial : vimbasrc->camera->camera_id;
+    gchar *name, *path;
 
+    if (serial == NULL) {
+        return NULL;
+    }
+    name = g_strconcat(serial, ".vcal", NULL);
+    GST_OBJECT_LOCK(vimbasrc);
+    if (vimbasrc->calibration_dir != NULL) {
+        path = g_build_filename(vimbasrc->calibration_dir, name, NULL);
+    } else {
+        path = g_build_filename(g_get_user_data_dir(), "gst-vimba",
+            "calibration", name, NULL);
+    }
+    GST_OBJECT_UNLOCK(vimbasrc);
+    g_free(name);
+    return path;
+}
 
-    GstVimbaSrc *vimbasrc = GST_VIMBA_SRC (src);
-    GstVideoInfo info;
+/* the sensor region of the negotiated frames, FALSE if they cannot be
+ * corrected */
+static gboolean
+gst_vimba_src_correction_region (GstVimbaSrc * vimbasrc, gint * width,
+        gint * height, gint * offset_x, gint * offset_y)
+{
+    GstCaps *caps = gst_pad_get_current_caps(GST_BASE_SRC_PAD(vimbasrc));
     GstStructure *structure;
+    GValue offset = G_VALUE_INIT;
+    gboolean res;
 
-    vimbacamera_stop(vimbasrc->camera);
-
-    g_message("Negotiated Caps: %s", gst_caps_to_string(caps));
-
-    if (!gst_video_info_from_caps(&info, caps)) {
+    if (caps == NULL) {
         return FALSE;
     }
     structure = gst_caps_get_structure(caps, 0);
-    g_mutex_lock(&vimbasrc->config_lock);
+    res = gst_structure_get_int(structure, "width", width) &&
+        gst_structure_get_int(structure, "height", height) &&
+        vimba_correction_supported(vimbasrc->camera->format);
+    gst_caps_unref(caps);
 
-    vimbasrc->camera->width = info.width;
-    vimbasrc->camera->height = info.height;
+    /* runs on the streaming thread, which does not hold config_lock while
+     * a reconnect replaces the features */
+    *offset_x = 0;
+    *offset_y = 0;
+    g_rw_lock_reader_lock(&vimbasrc->camera->handle_lock);
+    if (vimba_feature_get(vimbasrc->camera->features, "OffsetX", &offset)) {
+        *offset_x = (gint) g_value_get_int64(&offset);
+        g_value_unset(&offset);
+    }
+    if (vimba_feature_get(vimbasrc->camera->features, "OffsetY", &offset)) {
+        *offset_y = (gint) g_value_get_int64(&offset);
+        g_value_unset(&offset);
+    }
+    g_rw_lock_reader_unlock(&vimbasrc->camera->handle_lock);
+    return res;
+}
 
-    /* also set selected caps on the camera */
-    VmbFeatureIntSet(vimbasrc->camera->camera_handle, "Width",
-        vimbasrc->camera->width
-    );
-    VmbFeatureIntSet(vimbasrc->camera->camera_handle, "Height",
-        vimbasrc->camera->height
-    );
-    const char * format = gst_structure_get_string(structure, "format");
-    /* Set capability from fomat */
-    if (strcmp(gst_structure_get_name(structure),"video/x-bayer") == 0) {
-        vimbasrc->camera->format = vimbasrc_gstreamer_to_vimba_bayer(format);
+/* drop maps of another region and load the stored ones, if enabled */
+static void
+gst_vimba_src_setup_correction (GstVimbaSrc * vimbasrc, gboolean enabled)
+{
+    VimbaCalibration *calibration = vimbasrc->calibration;
+    GError *error = NULL;
+    gint width, height, offset_x, offset_y;
+    gchar *path;
+
+    vimba_correction_free(vimbasrc->correction);
+    vimbasrc->correction = NULL;
+    if (!gst_vimba_src_correction_region(vimbasrc, &width, &height,
+            &offset_x, &offset_y)) {
+        if (enabled) {
+            GST_WARNING_OBJECT(vimbasrc, "no correction of %s frames",
+                GST_STR_NULL(vimbasrc->camera->format));
+        }
+        vimba_calibration_free(calibration);
+        vimbasrc->calibration = NULL;
+        return;
+    }
+    /* frames captured so far only count for the same region */
+    if (calibration != NULL && (calibration->width != width ||
+            calibration->height != height ||
+            calibration->offset_x != offset_x ||
+            calibration->offset_y != offset_y ||
+            g_strcmp0(calibration->format, vimbasrc->camera->format) != 0)) {
+        vimba_calibration_free(calibration);
+        vimbasrc->calibration = NULL;
+    }
+    if (!enabled || (path = gst_vimba_src_calibration_path(vimbasrc)) == NULL) {
+        return;
+    }
+    vimbasrc->correction = vimba_correction_load(path, width, height,
+        offset_x, offset_y, vimbasrc->camera->format, &error);
+    if (vimbasrc->correction == NULL) {
+        GST_ELEMENT_WARNING(vimbasrc, RESOURCE, NOT_FOUND,
+            ("No usable calibration, frames are not corrected."),
+            ("%s", error->message));
+        g_error_free(error);
     } else {
-        vimbasrc->camera->format = vimbasrc_gstreamer_to_vimba_raw(format);
+        GST_INFO_OBJECT(vimbasrc, "correcting with %s, %u defect pixels",
+            path, vimbasrc->correction->defect_count);
     }
-    g_message("Setting camera format: %s", vimbasrc->camera->format);
-    VmbFeatureEnumSet(vimbasrc->camera->camera_handle, "PixelFormat",
-        vimbasrc->camera->format
-    );
+    g_free(path);
+}
 
-    g_mutex_unlock(&vimbasrc->config_lock);
-    GST_DEBUG_OBJECT (vimbasrc, "set_caps");
+/* compute, store and use the maps once a calibration capture completed */
+static void
+gst_vimba_src_finish_calibration (GstVimbaSrc * vimbasrc)
+{
+    VimbaCalibration *calibration = vimbasrc->calibration;
+    VimbaCorrection *correction = vimba_calibration_finish(calibration);
+    gchar *path = gst_vimba_src_calibration_path(vimbasrc);
+    GError *error = NULL;
+    gboolean saved = FALSE;
 
-    vimbacamera_start(vimbasrc->camera);
+    if (path != NULL) {
+        saved = vimba_correction_save(correction, path, &error);
+        if (!saved) {
+            GST_ELEMENT_WARNING(vimbasrc, RESOURCE, WRITE,
+                ("Cannot store the calibration."), ("%s", error->message));
+            g_error_free(error);
+        }
+    }
+    gst_element_post_message(GST_ELEMENT(vimbasrc),
+        gst_message_new_element(GST_OBJECT(vimbasrc),
+            gst_structure_new("vimbasrc-calibration",
+                "kind", G_TYPE_STRING,
+                    calibration->kind == VIMBA_CALIBRATION_DARK ? "dark" : "flat",
+                "dark-frames", G_TYPE_UINT, calibration->dark_frames,
+                "flat-frames", G_TYPE_UINT, calibration->flat_frames,
+                "defects", G_TYPE_UINT, correction->defect_count,
+                "path", G_TYPE_STRING, path,
+                "saved", G_TYPE_BOOLEAN, saved,
+                NULL)));
+    GST_INFO_OBJECT(vimbasrc, "calibrated from %u dark and %u flat frames, "
+        "%u defect pixels", calibration->dark_frames, calibration->flat_frames,
+        correction->defect_count);
+    vimba_correction_free(vimbasrc->correction);
+    vimbasrc->correction = correction;
+    g_free(path);
+}
 
-    return TRUE;
+/*
+ * Calibration capture and correction of a frame, in place before anything
+ * else reads it: the copy or the zero-copy buffer, the preview, the image
+ * statistics and the shared ring all see the corrected frame.
+ */
+static void
+gst_vimba_src_correct_frame (GstVimbaSrc * vimbasrc, VmbFrame_t * frame)
+{
+    gboolean enabled, dirty;
+    gint kind;
+    guint frames;
+    gsize size;
+
+    GST_OBJECT_LOCK(vimbasrc);
+    enabled = vimbasrc->correction_enabled;
+    dirty = vimbasrc->correction_dirty;
+    kind = vimbasrc->calibration_kind;
+    frames = vimbasrc->calibration_frames;
+    vimbasrc->correction_dirty = FALSE;
+    vimbasrc->calibration_kind = -1;
+    GST_OBJECT_UNLOCK(vimbasrc);
+
+    if (dirty) {
+        gst_vimba_src_setup_correction(vimbasrc, enabled);
+    }
+    if (kind >= 0) {
+        gint width, height, offset_x, offset_y;
+
+        if (vimbasrc->calibration == NULL &&
+            gst_vimba_src_correction_region(vimbasrc, &width, &height,
+                &offset_x, &offset_y)) {
+            vimbasrc->calibration = vimba_calibration_new(width, height,
+                offset_x, offset_y, vimbasrc->camera->format);
+        }
+        if (vimbasrc->calibration != NULL) {
+            vimba_calibration_begin(vimbasrc->calibration, kind, frames);
+        } else {
+            GST_WARNING_OBJECT(vimbasrc, "cannot calibrate %s frames",
+                GST_STR_NULL(vimbasrc->camera->format));
+        }
+    }
+
+    size = frame->imageSize > 0 ? frame->imageSize : frame->bufferSize;
+    if (vimbasrc->calibration != NULL &&
+        vimbasrc->calibration->remaining > 0 &&
+        frame->receiveStatus == VmbFrameStatusComplete &&
+        size >= (gsize) vimbasrc->calibration->width *
+            vimbasrc->calibration->height &&
+        vimba_calibration_add(vimbasrc->calibration, frame->buffer)) {
+        gst_vimba_src_finish_calibration(vimbasrc);
+    }
+    if (enabled && vimbasrc->correction != NULL &&
+        size >= (gsize) vimbasrc->correction->width *
+            vimbasrc->correction->height) {
+        vimba_correction_apply(vimbasrc->correction, frame->buffer);
+        vimbasrc->frames_corrected++;
+    }
 }
 
-/* start and stop processing, ideal for opening/closing the resource */
-static gboolean
-gst_vimba_src_start (GstBaseSrc * src)
+/* post statistics of a frame for exposure control, when one is due */
+static void
+gst_vimba_src_post_image_stats (GstVimbaSrc * vimbasrc, GstBuffer * buf,
+        const guint8 * data, gsize size)
 {
-    gboolean res = TRUE;
-    GstVimbaSrc *vimbasrc = GST_VIMBA_SRC (src);
+    GstClockTime interval, pts = GST_BUFFER_PTS(buf);
+    GstStructure *structure;
+    GstCaps *caps;
+    gboolean dirty;
+    guint step;
 
-    vimbacamera_start(vimbasrc->camera);
+    GST_OBJECT_LOCK(vimbasrc);
+    interval = vimbasrc->image_stats_interval;
+    step = vimbasrc->image_stats_step;
+    dirty = vimbasrc->image_stats_dirty;
+    vimbasrc->image_stats_dirty = FALSE;
+    GST_OBJECT_UNLOCK(vimbasrc);
 
-    GST_DEBUG_OBJECT (vimbasrc, "start");
+    if (interval == 0) {
+        return;
+    }
+    if (dirty || vimbasrc->histogram == NULL) {
+        vimba_histogram_free(vimbasrc->histogram);
+        caps = gst_pad_get_current_caps(GST_BASE_SRC_PAD(vimbasrc));
+        vimbasrc->histogram = caps != NULL
+            ? vimba_histogram_new(caps, step) : NULL;
+        if (vimbasrc->histogram == NULL && dirty) {
+            GST_WARNING_OBJECT(vimbasrc, "no image statistics of %"
+                GST_PTR_FORMAT, caps);
+        }
+        if (caps != NULL) {
+            gst_caps_unref(caps);
+        }
+        vimbasrc->image_stats_last = GST_CLOCK_TIME_NONE;
+    }
+    /* frames in between are not looked at, only the posted ones cost */
+    if (vimbasrc->histogram == NULL || (GST_CLOCK_TIME_IS_VALID(pts) &&
+            GST_CLOCK_TIME_IS_VALID(vimbasrc->image_stats_last) &&
+            pts < vimbasrc->image_stats_last + interval)) {
+        return;
+    }
+    if (!vimba_histogram_process(vimbasrc->histogram, data, size)) {
+        return;
+    }
+    vimbasrc->image_stats_last = pts;
 
-    return res;
+    structure = vimba_histogram_to_structure(vimbasrc->histogram,
+        "vimbasrc-image-stats");
+    gst_structure_set(structure,
+        "timestamp", G_TYPE_UINT64, pts,
+        "offset", G_TYPE_UINT64, GST_BUFFER_OFFSET(buf),
+        NULL);
+    gst_element_post_message(GST_ELEMENT(vimbasrc),
+        gst_message_new_element(GST_OBJECT(vimbasrc), structure));
+    vimbasrc->image_stats_posted++;
 }
 
-static gboolean
-gst_vimba_src_stop (GstBaseSrc * src)
+/* copy a frame into the shared ring, once for all consumers */
+static void
+gst_vimba_src_publish (GstVimbaSrc * vimbasrc, GstBuffer * buf,
+        VmbFrame_t * frame, gsize size)
 {
-    gboolean res = TRUE;
-    GstVimbaSrc *vimbasrc = GST_VIMBA_SRC (src);
+    GstVimbaFrameMeta *meta = gst_buffer_get_vimba_frame_meta(buf);
+    VimbaShmFrameInfo info = { 0 };
 
-    vimbacamera_stop(vimbasrc->camera);
+    info.frame_id = meta->frame_id;
+    info.trigger_id = meta->trigger_id;
+    info.device_timestamp = meta->device_timestamp;
+    info.capture_time = meta->callback_time;
+    info.duration = GST_BUFFER_DURATION(buf);
+    info.status = frame->receiveStatus;
+    if (!vimba_shm_producer_write(vimbasrc->shm, frame->buffer, size, &info,
+            vimbasrc->shm_drop_policy)) {
+        GST_LOG_OBJECT(vimbasrc, "frame %" G_GUINT64_FORMAT " not published",
+            info.frame_id);
+    }
+}
 
-    GST_DEBUG_OBJECT (vimbasrc, "stop");
+/*
+ * A buffer for a frame, NULL if the frame is not pushed. The frame is copied
+ * and requeued right away, unless fd-memory is set: then the buffer uses the
+ * frame memory and the frame goes back to the sdk when the buffer is freed.
+ */
+static GstBuffer *
+gst_vimba_src_frame_buffer (GstVimbaSrc * vimbasrc, VmbFrame_t * frame,
+        GstClock * clock, GstClockTime base_time, GstClockTime dequeue_time)
+{
+    GstClockTime timestamp;
+    GstBuffer *buf = NULL;
+    gboolean held = FALSE;
 
-    return res;
+    if (VmbFrameStatusComplete == frame->receiveStatus ||
+        (VmbFrameStatusIncomplete == frame->receiveStatus &&
+            !vimbasrc->drop_incomplete)) {
+        /*g_message("Frame received %lu", (unsigned long int)frame->frameID);*/
+
+        /* chunk data behind the image is attached as meta instead */
+        gsize size = frame->imageSize > 0
+            ? frame->imageSize : frame->bufferSize;
+
+        gst_vimba_src_correct_frame(vimbasrc, frame);
+        if (vimbasrc->fd_memory) {
+            buf = gst_vimba_src_wrap_frame(vimbasrc, frame);
+            held = TRUE;
+        } else {
+            buf = gst_buffer_new_allocate(NULL, size, NULL);
+        }
+        if (buf) {
+            timestamp = gst_vimba_src_frame_timestamp(vimbasrc, frame, clock,
+                base_time, gst_clock_get_time(clock) - base_time);
+            /* let control bindings (exposure, gain ramps) follow */
+            gst_object_sync_values(GST_OBJECT(vimbasrc), timestamp);
+            GST_BUFFER_DTS(buf) = timestamp;
+            GST_BUFFER_PTS(buf) = GST_BUFFER_DTS(buf);
+            gst_vimba_src_decorate_buffer(vimbasrc, buf, frame, dequeue_time);
+            if (VmbFrameStatusComplete != frame->receiveStatus) {
+                /* recorders keep them, the index marks them */
+                GST_BUFFER_FLAG_SET(buf, GST_BUFFER_FLAG_CORRUPTED);
+            }
+            /*gst_buffer_memset(buf, 0, 111 * rand(), frame->bufferSize);*/
+            if (!held) {
+                gst_buffer_fill(
+                    buf, 0,
+                    frame->buffer,
+                    size
+                );
+            }
+            /* the frame is still in cache */
+            gst_vimba_src_push_preview(vimbasrc, buf, frame->buffer, size);
+            gst_vimba_src_post_image_stats(vimbasrc, buf, frame->buffer,
+                size);
+            if (vimbasrc->shm != NULL) {
+                gst_vimba_src_publish(vimbasrc, buf, frame, size);
+            }
+        }
+    } else if (VmbFrameStatusIncomplete == frame->receiveStatus) {
+        g_message("Frame %lu incomplete", (unsigned long int) frame->frameID);
+    } else if (VmbFrameStatusTooSmall == frame->receiveStatus) {
+        g_message("Frame %lu too small", (unsigned long int) frame->frameID);
+    } else if (VmbFrameStatusInvalid == frame->receiveStatus) {
+        g_message("Frame %lu invalid", (unsigned long int) frame->frameID);
+    } else {
+        g_message(
+            "Error receiving frame %lu", (unsigned long int) frame->frameID
+        );
+    }
+    if (!held) {
+        vimbacamera_queue_frame(vimbasrc->camera, frame);
+    }
+    return buf;
+}
+
+/*
+ * Add the frames that are already queued, or arrive within batch-latency,
+ * to buf and submit them as one buffer list. Returns buf when there was
+ * nothing to batch it with, NULL when the list was submitted.
+ */
+static GstBuffer *
+gst_vimba_src_batch (GstVimbaSrc * vimbasrc, GstBuffer * buf,
+        GstClock * clock, GstClockTime base_time)
+{
+    GstBufferList *list = NULL;
+    gint64 deadline = g_get_monotonic_time() +
+        (gint64) (vimbasrc->batch_latency / GST_USECOND);
+    guint length = 1, i;
+
+    while (length < vimbasrc->max_batch &&
+        !g_atomic_int_get(&vimbasrc->flushing)) {
+        gint64 remaining = deadline - g_get_monotonic_time();
+        VmbFrame_t *frame = vimbacamera_consume_frame_timeout(
+            vimbasrc->camera, remaining > 0 ? (guint64) remaining : 0
+        );
+        GstBuffer *next;
+
+        if (frame == NULL) {
+            break;
+        }
+        next = gst_vimba_src_frame_buffer(vimbasrc, frame, clock, base_time,
+            gst_util_get_timestamp());
+        if (next == NULL) {
+            continue;
+        }
+        if (list == NULL) {
+            list = gst_buffer_list_new_sized(vimbasrc->max_batch);
+            gst_buffer_list_add(list, buf);
+        }
+        gst_buffer_list_add(list, next);
+        length++;
+    }
+    if (list == NULL) {
+        return buf;
+    }
+
+    GST_OBJECT_LOCK(vimbasrc);
+    vimbasrc->batches_pushed++;
+    vimbasrc->batched_frames += length;
+    GST_OBJECT_UNLOCK(vimbasrc);
+    GST_LOG_OBJECT(vimbasrc, "batch of %u frames", length);
+    for (i = 0; i < length; i++) {
+        gst_vimba_src_stamp_push(gst_buffer_list_get(list, i));
+    }
+    gst_base_src_submit_buffer_list(GST_BASE_SRC(vimbasrc), list);
+    return NULL;
 }
 
 /* ask the subclass to create a buffer with offset and size, the default
@@ -465,10 +3811,13 @@ gst_vimba_src_create (GstPushSrc * src, GstBuffer ** bufp)
 {
     GstVimbaSrc *vimbasrc = GST_VIMBA_SRC (src);
     GstClock * clock = NULL;
-    GstClockTime base_time, timestamp = GST_CLOCK_TIME_NONE;
+    GstClockTime base_time;
     GstBuffer *buf = NULL;
     GstFlowReturn ret = GST_FLOW_ERROR;
 
+    vimba_thread_apply_pending(&vimbasrc->streaming_thread,
+        &vimbasrc->streaming_report);
+
     /* obtain element clock and base time */
     GST_OBJECT_LOCK(src);
     if ((clock = GST_ELEMENT_CLOCK(src)) != NULL) {
@@ -477,39 +3826,54 @@ gst_vimba_src_create (GstPushSrc * src, GstBuffer ** bufp)
     base_time = GST_ELEMENT_CAST (src)->base_time;
     GST_OBJECT_UNLOCK(src);
 
+    if (vimbasrc->burst_frames > 0) {
+        ret = gst_vimba_src_create_burst(vimbasrc, clock, base_time, bufp);
+        if (clock) {
+            gst_object_unref(clock);
+        }
+        return ret;
+    }
+
     do {
-        VmbFrame_t * frame = vimbacamera_consume_frame(vimbasrc->camera);
-        if (frame == NULL) break;
-        if (VmbFrameStatusComplete == frame->receiveStatus) {
-            /*g_message("Frame received %lu", (unsigned long int)frame->frameID);*/
-
-            buf = gst_buffer_new_allocate(NULL, frame->bufferSize, NULL);
-            if (buf) {
-                timestamp = gst_clock_get_time(clock) - base_time;
-                GST_BUFFER_DTS(buf) = timestamp;
-                GST_BUFFER_PTS(buf) = GST_BUFFER_DTS(buf);
-                /*gst_buffer_memset(buf, 0, 111 * rand(), frame->bufferSize);*/
-                gst_buffer_fill(
-                    buf, 0,
-                    frame->buffer,
-                    frame->bufferSize
-                );
+        VmbFrame_t * frame = vimbacamera_consume_frame_timeout(
+            vimbasrc->camera, FRAME_POLL_US);
+        GstClockTime dequeue_time = gst_util_get_timestamp();
+        if (frame == NULL) {
+            if (g_atomic_int_get(&vimbasrc->flushing)) {
+                ret = GST_FLOW_FLUSHING;
+                break;
             }
-            ret = GST_FLOW_OK;
-            *bufp = buf;
-        } else if (VmbFrameStatusIncomplete == frame->receiveStatus) {
-            g_message("Frame %lu incomplete", (unsigned long int) frame->frameID);
-        } else if (VmbFrameStatusTooSmall == frame->receiveStatus) {
-            g_message("Frame %lu too small", (unsigned long int) frame->frameID);
-        } else if (VmbFrameStatusInvalid == frame->receiveStatus) {
-            g_message("Frame %lu invalid", (unsigned long int) frame->frameID);
-        } else {
-            g_message(
-                "Error receiving frame %lu", (unsigned long int) frame->frameID
-            );
-        }  
-        vimbacamera_queue_frame(vimbasrc->camera, frame);
-    } while (ret != GST_FLOW_OK); 
+            if (vimbacamera_is_lost(vimbasrc->camera)) {
+                ret = gst_vimba_src_wait_camera(vimbasrc, clock, base_time);
+                if (ret != GST_FLOW_OK) {
+                    break;
+                }
+                continue;
+            }
+            if (vimbasrc->camera->started == FALSE) {
+                ret = GST_FLOW_ERROR;
+                break;
+            }
+            continue;
+        }
+        buf = gst_vimba_src_frame_buffer(vimbasrc, frame, clock, base_time,
+            dequeue_time);
+    } while (buf == NULL);
+
+    if (buf != NULL) {
+        ret = GST_FLOW_OK;
+        if (vimbasrc->discont) {
+            GST_BUFFER_FLAG_SET(buf, GST_BUFFER_FLAG_DISCONT);
+            vimbasrc->discont = FALSE;
+        }
+        if (vimbasrc->max_batch > 1) {
+            buf = gst_vimba_src_batch(vimbasrc, buf, clock, base_time);
+        }
+        if (buf != NULL) {
+            gst_vimba_src_stamp_push(buf);
+        }
+        *bufp = buf;
+    }
 
     if (clock) {
         gst_object_unref(clock);
@@ -520,6 +3884,267 @@ gst_vimba_src_create (GstPushSrc * src, GstBuffer ** bufp)
     return ret;
 }
 
+static guint64
+gst_vimba_src_trigger (GstVimbaSrc * vimbasrc)
+{
+    guint64 trigger_id = 0;
+
+    g_mutex_lock(&vimbasrc->config_lock);
+    switch (vimbasrc->camera->trigger_mode) {
+        case VIMBA_TRIGGER_SOFTWARE:
+            if (vimbacamera_software_trigger(vimbasrc->camera)) {
+                trigger_id = vimbasrc->camera->trigger_base +
+                    g_atomic_int_get(&vimbasrc->camera->triggers_sent);
+            }
+            break;
+        case VIMBA_TRIGGER_ACTION:
+            trigger_id = vimba_sync_fire(vimbasrc->camera->action_group_key);
+            break;
+        default:
+            GST_WARNING_OBJECT(vimbasrc,
+                "trigger ignored, not in software or action trigger mode"
+            );
+            break;
+    }
+    g_mutex_unlock(&vimbasrc->config_lock);
+
+    GST_DEBUG_OBJECT(vimbasrc, "trigger %" G_GUINT64_FORMAT, trigger_id);
+    return trigger_id;
+}
+
+static gboolean
+gst_vimba_src_burst_trigger (GstVimbaSrc * vimbasrc)
+{
+    if (vimbasrc->burst_frames == 0) {
+        GST_WARNING_OBJECT(vimbasrc, "burst trigger ignored, burst-frames is 0");
+        return FALSE;
+    }
+    g_atomic_int_set(&vimbasrc->burst_requested, 1);
+    GST_DEBUG_OBJECT(vimbasrc, "burst triggered");
+    return TRUE;
+}
+
+/* stop throttling, a camera left throttled goes back to its configured rate */
+static void
+gst_vimba_src_qos_reset (GstVimbaSrc * vimbasrc)
+{
+    gboolean throttled;
+    gdouble nominal;
+
+    GST_OBJECT_LOCK(vimbasrc);
+    throttled = vimba_qos_active(&vimbasrc->qos) &&
+        vimbasrc->qos.rate < vimbasrc->qos.nominal;
+    nominal = vimbasrc->qos.nominal;
+    vimba_qos_reset(&vimbasrc->qos);
+    GST_OBJECT_UNLOCK(vimbasrc);
+    if (throttled) {
+        gst_vimba_src_queue_double(vimbasrc, "AcquisitionFrameRateAbs",
+            nominal);
+    }
+}
+
+/* QoS events arrive on threads that must not wait for config_lock, so
+ * they work from the rates of the last start or stop */
+static void
+gst_vimba_src_qos_snapshot (GstVimbaSrc * vimbasrc)
+{
+    VimbaCamera *camera = vimbasrc->camera;
+    gdouble framerate = 0, min_framerate = 0;
+
+    g_mutex_lock(&vimbasrc->config_lock);
+    /* triggered cameras expose when told, their rate is not theirs to set */
+    if (camera->trigger_mode == VIMBA_TRIGGER_FREERUN && camera->started &&
+        camera->framerate > 0) {
+        framerate = camera->framerate;
+        min_framerate = camera->min_framerate;
+    }
+    g_mutex_unlock(&vimbasrc->config_lock);
+
+    GST_OBJECT_LOCK(vimbasrc);
+    vimbasrc->qos_framerate = framerate;
+    vimbasrc->qos_min_framerate = min_framerate;
+    GST_OBJECT_UNLOCK(vimbasrc);
+}
+
+/* lower or raise the camera frame rate from a downstream QoS event */
+static void
+gst_vimba_src_qos (GstVimbaSrc * vimbasrc, GstEvent * event)
+{
+    GstQOSType type;
+    gdouble proportion, rate = 0, previous = 0, framerate;
+    GstClockTimeDiff diff;
+    GstClockTime now = gst_util_get_timestamp();
+
+    gst_event_parse_qos(event, &type, &proportion, &diff, NULL);
+
+    GST_OBJECT_LOCK(vimbasrc);
+    framerate = vimbasrc->qos_framerate;
+    if (vimbasrc->qos_throttle && framerate > 0) {
+        if (!vimba_qos_active(&vimbasrc->qos)) {
+            vimba_qos_start(&vimbasrc->qos, framerate,
+                vimbasrc->qos_min_framerate);
+        }
+        previous = vimbasrc->qos.rate;
+        rate = vimba_qos_observe(&vimbasrc->qos, type, proportion, diff, now);
+        if (rate > 0) {
+            vimbasrc->qos_last_adjustment = now;
+        }
+    }
+    GST_OBJECT_UNLOCK(vimbasrc);
+
+    if (rate > 0) {
+        GST_INFO_OBJECT(vimbasrc, "QoS proportion %.3f: frame rate %.3f -> "
+            "%.3f of %.3f", proportion, previous, rate, framerate);
+        gst_vimba_src_queue_double(vimbasrc, "AcquisitionFrameRateAbs", rate);
+    }
+}
+
+static gboolean
+gst_vimba_src_event (GstBaseSrc * src, GstEvent * event)
+{
+    if (GST_EVENT_TYPE(event) == GST_EVENT_CUSTOM_UPSTREAM &&
+        gst_event_has_name(event, GST_VIMBA_BURST_EVENT)) {
+        return gst_vimba_src_burst_trigger(GST_VIMBA_SRC(src));
+    }
+    if (GST_EVENT_TYPE(event) == GST_EVENT_QOS) {
+        gst_vimba_src_qos(GST_VIMBA_SRC(src), event);
+    }
+    return GST_BASE_SRC_CLASS(gst_vimba_src_parent_class)->event(src, event);
+}
+
+/* the first frame of a batch waits up to batch-latency for the others */
+static gboolean
+gst_vimba_src_query (GstBaseSrc * src, GstQuery * query)
+{
+    GstVimbaSrc *vimbasrc = GST_VIMBA_SRC (src);
+    GstClockTime min_latency, max_latency, batch_latency = 0;
+    gboolean live;
+
+    if (!GST_BASE_SRC_CLASS(gst_vimba_src_parent_class)->query(src, query)) {
+        return FALSE;
+    }
+    if (GST_QUERY_TYPE(query) != GST_QUERY_LATENCY) {
+        return TRUE;
+    }
+    GST_OBJECT_LOCK(vimbasrc);
+    if (vimbasrc->max_batch > 1) {
+        batch_latency = vimbasrc->batch_latency;
+    }
+    GST_OBJECT_UNLOCK(vimbasrc);
+    if (batch_latency > 0) {
+        gst_query_parse_latency(query, &live, &min_latency, &max_latency);
+        min_latency += batch_latency;
+        if (GST_CLOCK_TIME_IS_VALID(max_latency)) {
+            max_latency += batch_latency;
+        }
+        GST_DEBUG_OBJECT(vimbasrc, "latency %" GST_TIME_FORMAT " - %"
+            GST_TIME_FORMAT " with batching", GST_TIME_ARGS(min_latency),
+            GST_TIME_ARGS(max_latency));
+        gst_query_set_latency(query, live, min_latency, max_latency);
+    }
+    return TRUE;
+}
+
+static gboolean
+gst_vimba_src_unlock (GstBaseSrc * src)
+{
+    g_atomic_int_set(&GST_VIMBA_SRC(src)->flushing, 1);
+    return TRUE;
+}
+
+static gboolean
+gst_vimba_src_unlock_stop (GstBaseSrc * src)
+{
+    g_atomic_int_set(&GST_VIMBA_SRC(src)->flushing, 0);
+    return TRUE;
+}
+
+static gboolean
+gst_vimba_src_set_feature (GstVimbaSrc * vimbasrc, const gchar * name,
+        const gchar * value)
+{
+    GValue v = G_VALUE_INIT;
+    guint64 generation;
+
+    if (vimbasrc->camera->features == NULL) {
+        GST_WARNING_OBJECT(vimbasrc, "no camera open to set %s on", name);
+        return FALSE;
+    }
+    g_value_init(&v, G_TYPE_STRING);
+    g_value_set_string(&v, value);
+    generation = vimba_control_queue(vimbasrc->control, name, &v);
+    g_value_unset(&v);
+
+    GST_DEBUG_OBJECT(vimbasrc, "set feature %s = %s: generation %"
+        G_GUINT64_FORMAT, name, value, generation);
+    return TRUE;
+}
+
+static gboolean
+gst_vimba_src_calibrate (GstVimbaSrc * vimbasrc, const gchar * kind,
+        guint frames)
+{
+    gint calibration_kind;
+
+    if (g_strcmp0(kind, "dark") == 0) {
+        calibration_kind = VIMBA_CALIBRATION_DARK;
+    } else if (g_strcmp0(kind, "flat") == 0) {
+        calibration_kind = VIMBA_CALIBRATION_FLAT;
+    } else {
+        GST_WARNING_OBJECT(vimbasrc, "unknown calibration %s, expected dark "
+            "or flat", GST_STR_NULL(kind));
+        return FALSE;
+    }
+    if (frames == 0) {
+        GST_WARNING_OBJECT(vimbasrc, "calibration needs at least one frame");
+        return FALSE;
+    }
+    /* the streaming thread takes it up with the next frame */
+    GST_OBJECT_LOCK(vimbasrc);
+    vimbasrc->calibration_kind = calibration_kind;
+    vimbasrc->calibration_frames = frames;
+    GST_OBJECT_UNLOCK(vimbasrc);
+    GST_DEBUG_OBJECT(vimbasrc, "calibrating from %u %s frames", frames, kind);
+    return TRUE;
+}
+
+static gboolean
+gst_vimba_src_save_settings (GstVimbaSrc * vimbasrc, const gchar * path)
+{
+    GError *error = NULL;
+    gboolean res;
+
+    g_mutex_lock(&vimbasrc->config_lock);
+    if (path == NULL) {
+        path = vimbasrc->settings_file;
+    }
+    if (path == NULL) {
+        GST_WARNING_OBJECT(vimbasrc, "no file to save the settings to");
+        g_mutex_unlock(&vimbasrc->config_lock);
+        return FALSE;
+    }
+    res = vimba_settings_save(vimbasrc->camera, path, &error);
+    if (!res) {
+        GST_WARNING_OBJECT(vimbasrc, "cannot save settings to %s: %s", path,
+            error->message);
+        g_error_free(error);
+    }
+    g_mutex_unlock(&vimbasrc->config_lock);
+    return res;
+}
+
+static gchar *
+gst_vimba_src_get_feature (GstVimbaSrc * vimbasrc, const gchar * name)
+{
+    gchar *value;
+
+    g_mutex_lock(&vimbasrc->config_lock);
+    value = vimba_feature_get_string(vimbasrc->camera->features, name);
+    g_mutex_unlock(&vimbasrc->config_lock);
+
+    return value;
+}
+
 static gboolean
 plugin_init (GstPlugin * plugin)
 {
@@ -527,7 +4152,16 @@ plugin_init (GstPlugin * plugin)
     /* Remember to set the rank if it's an element that is meant
        to be autoplugged by decodebin. */
     return gst_element_register (plugin, "vimbasrc", GST_RANK_NONE,
-            GST_TYPE_VIMBA_SRC);
+            GST_TYPE_VIMBA_SRC) &&
+        gst_element_register (plugin, "vimbaalign", GST_RANK_NONE,
+            GST_TYPE_VIMBA_ALIGN) &&
+        gst_element_register (plugin, "vimbarawsink", GST_RANK_NONE,
+            GST_TYPE_VIMBA_RAW_SINK) &&
+        gst_element_register (plugin, "vimbareplaysrc", GST_RANK_NONE,
+            GST_TYPE_VIMBA_REPLAY_SRC) &&
+        gst_element_register (plugin, "vimbashmsrc", GST_RANK_NONE,
+            GST_TYPE_VIMBA_SHM_SRC) &&
+        gst_tracer_register (plugin, "vimbatracer", GST_TYPE_VIMBA_TRACER);
 }
 
 
@@ -21,12 +21,29 @@
 #define _GST_VIMBA_SRC_H_
 
 #include <gst/base/gstpushsrc.h>
+#include <gst/allocators/allocators.h>
 #include <VimbaC.h>
 #include "vimba.h"
 #include "vimbacamera.h"
+#include "vimbapreview.h"
+#include "vimbahistogram.h"
+#include "vimbacorrect.h"
+#include "vimbashm.h"
+#include "vimbacontrol.h"
+#include "vimbareconnect.h"
+#include "vimbasettings.h"
+#include "vimbaconfig.h"
+#include "vimbaqos.h"
+#include "vimbaptp.h"
 
 G_BEGIN_DECLS
 
+/* reference timestamp meta carrying the camera's device timestamp in ns */
+#define GST_VIMBA_DEVICE_TIMESTAMP_CAPS "timestamp/x-vimba-device"
+
+/* name of the custom upstream event that flushes the burst window */
+#define GST_VIMBA_BURST_EVENT "vimbasrc-burst"
+
 #define GST_TYPE_VIMBA_SRC   (gst_vimba_src_get_type())
 #define GST_VIMBA_SRC(obj)   (G_TYPE_CHECK_INSTANCE_CAST((obj),GST_TYPE_VIMBA_SRC,GstVimbaSrc))
 #define GST_VIMBA_SRC_CLASS(klass)   (G_TYPE_CHECK_CLASS_CAST((klass),GST_TYPE_VIMBA_SRC,GstVimbaSrcClass))
@@ -42,11 +59,157 @@ struct _GstVimbaSrc
     Vimba*       vimba;
     VimbaCamera* camera;
     GMutex config_lock;
+
+    /* bandwidth budget used to rank formats in fixate, 0 = camera value */
+    guint64      link_budget;
+
+    /* outcome of the last caps fixation, protected by the object lock */
+    const char*  fixated_format;
+    guint64      fixated_bandwidth;
+    gdouble      fixated_framerate;
+    gchar*       fixation_report;
+
+    /* action commands per second sent to the sync group, 0 = on request */
+    gdouble      trigger_rate;
+
+    /* controllable features, applied when the camera is opened, < 0 = unset */
+    gdouble      exposure_time;
+    gdouble      gain;
+    gint         offset_x;
+    gint         offset_y;
+    /* names the open camera uses for them, NULL while closed */
+    const gchar* exposure_feature;
+    const gchar* gain_feature;
+
+    /* writes while open go through the control thread */
+    VimbaControl* control;
+
+    /* reopens a lost camera while started, gap events cover the outage */
+    VimbaReconnect* reconnect;
+    GstClockTime  gap_position;
+    guint64       gap_events;
+    gboolean      discont;
+
+    /* features written through the "features" property */
+    GstStructure* features;
+
+    /* settings file applied when the camera is opened, and what it did */
+    gchar*        settings_file;
+    VimbaSettingsReport settings_report;
+
+    /* the last caps configuration and the negotiations the camera refused */
+    VimbaConfigReport config_report;
+    guint         config_failures;
+
+    /* lower the camera frame rate while downstream QoS reports overload,
+     * protected by the object lock */
+    gboolean      qos_throttle;
+    VimbaQos      qos;
+    GstClockTime  qos_last_adjustment;
+    /* rate and lower bound of the running free-run camera, taken when it
+     * starts, 0 while stopped or triggered */
+    gdouble       qos_framerate;
+    gdouble       qos_min_framerate;
+
+    /* PTP synchronization of the device clock, the settings are protected
+     * by the object lock, ptp runs from start to stop and calibrates
+     * device_clock, which lives as long as the element */
+    VimbaPtpMode       ptp_mode;
+    gboolean           ptp_clock;
+    VimbaTimestampMode timestamp_mode;
+    VimbaPtp*          ptp;
+    GstClock*          device_clock;
+
+    /* burst mode: the last burst_frames frames are kept in the ring and
+     * pushed without copies, with post_trigger_frames more, on request */
+    guint        burst_frames;
+    guint        post_trigger_frames;
+    gint         burst_requested;
+    gboolean     burst_collecting;
+    guint        burst_remaining;
+    gboolean     burst_discont;
+    GQueue       burst_history;
+    GQueue       burst_window;
+
+    /* push incomplete frames flagged GST_BUFFER_FLAG_CORRUPTED */
+    gboolean     drop_incomplete;
+
+    /* downscaled preview on the "preview" request pad, the pad and the
+     * settings are protected by the object lock, the rest is only used
+     * by the streaming thread */
+    GstPad*       preview_pad;
+    guint         preview_scale;
+    guint         preview_decimation;
+    gboolean      preview_dirty;
+    VimbaPreview* preview;
+    gboolean      preview_started;
+    gboolean      preview_need_segment;
+    guint64       preview_frames;
+    guint64       previews_pushed;
+
+    /* image statistics posted as element messages at most every
+     * image_stats_interval, the settings are protected by the object lock,
+     * the rest is only used by the streaming thread */
+    GstClockTime  image_stats_interval;
+    guint         image_stats_step;
+    gboolean      image_stats_dirty;
+    VimbaHistogram* histogram;
+    GstClockTime  image_stats_last;
+    guint64       image_stats_posted;
+
+    /* flat-field and defect correction, maps are stored per camera serial
+     * in calibration_dir; the settings and a requested calibration capture
+     * are protected by the object lock, the maps are only used by the
+     * streaming thread */
+    gchar*        camera_serial;
+    gboolean      correction_enabled;
+    gchar*        calibration_dir;
+    gboolean      correction_dirty;
+    gint          calibration_kind;
+    guint         calibration_frames;
+    VimbaCorrection*  correction;
+    VimbaCalibration* calibration;
+    guint64       frames_corrected;
+
+    /* frames queued up meanwhile are pushed as one buffer list */
+    guint        max_batch;
+    GstClockTime batch_latency;
+    guint64      batches_pushed;
+    guint64      batched_frames;
+
+    /* frames are pushed as fd memory sharing the memfd backed ring */
+    gboolean      fd_memory;
+    guint         fd_frames;
+    GstAllocator *fd_allocator;
+    GstMemory    *ring_memory;
+    VimbaFrameRing *ring_memory_ring;
+
+    /* frames published to other processes, see vimbashmsrc */
+    gchar*             shm_name;
+    guint              shm_slots;
+    VimbaShmDropPolicy shm_drop_policy;
+    VimbaShmProducer*  shm;
+
+    /* affinity and scheduling of the streaming thread running create */
+    VimbaThreadParams streaming_thread;
+    VimbaThreadReport streaming_report;
+    guint64      bursts_completed;
+
+    /* set while the streaming thread has to give up waiting for frames */
+    gint         flushing;
 };
 
 struct _GstVimbaSrcClass
 {
     GstPushSrcClass base_vimbasrc_class;
+
+    /* actions */
+    guint64  (*trigger) (GstVimbaSrc * src);
+    gboolean (*set_feature) (GstVimbaSrc * src, const gchar * name, const gchar * value);
+    gchar *  (*get_feature) (GstVimbaSrc * src, const gchar * name);
+    gboolean (*burst_trigger) (GstVimbaSrc * src);
+    gboolean (*save_settings) (GstVimbaSrc * src, const gchar * path);
+    gboolean (*calibrate) (GstVimbaSrc * src, const gchar * kind, guint frames);
 };
 
 GType gst_vimba_src_get_type (void);
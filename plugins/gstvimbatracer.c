@@ -0,0 +1,306 @@
+/* GStreamer
+ * Copyright (C) 2015 Art+Com AG <info@artcom.de>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Suite 500,
+ * Boston, MA 02110-1335, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <gst/gst.h>
+#include "gstvimbasrc.h"
+#include "gstvimbameta.h"
+#include "gstvimbatracer.h"
+
+GST_DEBUG_CATEGORY_STATIC (gst_vimba_tracer_debug_category);
+#define GST_CAT_DEFAULT gst_vimba_tracer_debug_category
+
+static void gst_vimba_tracer_finalize (GObject * object);
+
+static const gchar * const stage_names[GST_VIMBA_STAGE_COUNT] = {
+    "device-to-callback",
+    "callback-to-dequeue",
+    "dequeue-to-push",
+    "push-to-sink",
+    "callback-to-sink"
+};
+
+static GstTracerRecord *tr_stage;
+
+G_DEFINE_TYPE_WITH_CODE (
+    GstVimbaTracer,
+    gst_vimba_tracer,
+    GST_TYPE_TRACER,
+    GST_DEBUG_CATEGORY_INIT (
+        gst_vimba_tracer_debug_category,
+        "vimbatracer",
+        0,
+        "debug category for vimbatracer"
+    )
+);
+
+static void
+gst_vimba_tracer_add (GstVimbaStageHistogram * histogram, GstClockTime from,
+        GstClockTime to)
+{
+    guint64 us;
+    guint bucket;
+    gint max;
+
+    if (from == 0 || !GST_CLOCK_TIME_IS_VALID(from) ||
+        !GST_CLOCK_TIME_IS_VALID(to) || to < from) {
+        return;
+    }
+    us = (to - from) / GST_USECOND;
+    bucket = us > 1 ? g_bit_storage(us) - 1 : 0;
+    g_atomic_int_inc(&histogram->buckets[MIN(bucket,
+        GST_VIMBA_TRACER_BUCKETS - 1)]);
+
+    us = MIN(us, G_MAXINT);
+    do {
+        max = g_atomic_int_get(&histogram->max_us);
+    } while ((gint) us > max && !g_atomic_int_compare_and_exchange(
+        &histogram->max_us, max, (gint) us));
+}
+
+/* the element a pad belongs to, seeing through ghost pads */
+static GstElement *
+gst_vimba_tracer_pad_parent (GstPad * pad)
+{
+    GstObject *parent;
+
+    if (pad == NULL) {
+        return NULL;
+    }
+    parent = GST_OBJECT_PARENT(pad);
+    if (parent != NULL && GST_IS_GHOST_PAD(parent)) {
+        parent = GST_OBJECT_PARENT(parent);
+    }
+    return parent != NULL && GST_IS_ELEMENT(parent)
+        ? GST_ELEMENT_CAST(parent) : NULL;
+}
+
+/*
+ * Exposure end has no host clock equivalent, so the device stage is the
+ * callback time minus the device time, relative to the smallest such
+ * difference seen on the pad.
+ */
+static void
+gst_vimba_tracer_device_stage (GstVimbaTracer * self, GstPad * pad,
+        GstVimbaFrameMeta * meta)
+{
+    gint64 offset, *min;
+
+    if (meta->device_timestamp == 0 || meta->callback_time == 0) {
+        return;
+    }
+    offset = (gint64) meta->callback_time - (gint64) meta->device_timestamp;
+    g_mutex_lock(&self->lock);
+    min = g_hash_table_lookup(self->device_offsets, pad);
+    if (min == NULL) {
+        min = g_new(gint64, 1);
+        *min = offset;
+        g_hash_table_insert(self->device_offsets, pad, min);
+    } else if (offset < *min) {
+        *min = offset;
+    }
+    offset -= *min;
+    g_mutex_unlock(&self->lock);
+    gst_vimba_tracer_add(&self->stages[GST_VIMBA_STAGE_DEVICE_TO_CALLBACK],
+        1, 1 + (GstClockTime) offset);
+}
+
+static void
+gst_vimba_tracer_buffer (GstVimbaTracer * self, GstPad * pad,
+        GstBuffer * buffer)
+{
+    GstVimbaFrameMeta *meta = gst_buffer_get_vimba_frame_meta(buffer);
+    GstElement *parent, *peer;
+    GstClockTime now;
+
+    if (meta == NULL) {
+        return;
+    }
+    now = gst_util_get_timestamp();
+    parent = gst_vimba_tracer_pad_parent(pad);
+    if (parent != NULL && GST_IS_VIMBA_SRC(parent)) {
+        gst_vimba_tracer_device_stage(self, pad, meta);
+        gst_vimba_tracer_add(&self->stages[GST_VIMBA_STAGE_CALLBACK_TO_DEQUEUE],
+            meta->callback_time, meta->dequeue_time);
+        gst_vimba_tracer_add(&self->stages[GST_VIMBA_STAGE_DEQUEUE_TO_PUSH],
+            meta->dequeue_time, meta->push_time);
+        g_atomic_int_set(&self->logged, 0);
+    }
+    peer = gst_vimba_tracer_pad_parent(GST_PAD_PEER(pad));
+    if (peer != NULL && GST_OBJECT_FLAG_IS_SET(peer, GST_ELEMENT_FLAG_SINK)) {
+        gst_vimba_tracer_add(&self->stages[GST_VIMBA_STAGE_PUSH_TO_SINK],
+            meta->push_time, now);
+        gst_vimba_tracer_add(&self->stages[GST_VIMBA_STAGE_CALLBACK_TO_SINK],
+            meta->callback_time, now);
+    }
+}
+
+static void
+gst_vimba_tracer_log (GstVimbaTracer * self)
+{
+    GstVimbaStageHistogram *histogram;
+    GString *buckets;
+    guint64 frames, seen, p50, p99;
+    gint count;
+    guint stage, i;
+
+    for (stage = 0; stage < GST_VIMBA_STAGE_COUNT; stage++) {
+        histogram = &self->stages[stage];
+        frames = 0;
+        for (i = 0; i < GST_VIMBA_TRACER_BUCKETS; i++) {
+            frames += (guint) g_atomic_int_get(&histogram->buckets[i]);
+        }
+        if (frames == 0) {
+            continue;
+        }
+        /* percentiles are the upper bounds of their buckets */
+        buckets = g_string_new(NULL);
+        seen = 0;
+        p50 = p99 = 0;
+        for (i = 0; i < GST_VIMBA_TRACER_BUCKETS; i++) {
+            count = g_atomic_int_get(&histogram->buckets[i]);
+            if (count == 0) {
+                continue;
+            }
+            seen += (guint) count;
+            if (p50 == 0 && seen * 2 >= frames) {
+                p50 = G_GUINT64_CONSTANT(1) << (i + 1);
+            }
+            if (p99 == 0 && seen * 100 >= frames * 99) {
+                p99 = G_GUINT64_CONSTANT(1) << (i + 1);
+            }
+            g_string_append_printf(buckets, "%s%" G_GUINT64_FORMAT ":%d",
+                buckets->len > 0 ? " " : "",
+                i > 0 ? G_GUINT64_CONSTANT(1) << i : 0, count);
+        }
+        gst_tracer_record_log(tr_stage, stage_names[stage], frames, p50, p99,
+            (guint64) g_atomic_int_get(&histogram->max_us), buckets->str);
+        g_string_free(buckets, TRUE);
+    }
+}
+
+static void
+gst_vimba_tracer_push_pre (GstVimbaTracer * self, GstClockTime ts,
+        GstPad * pad, GstBuffer * buffer)
+{
+    gst_vimba_tracer_buffer(self, pad, buffer);
+}
+
+static void
+gst_vimba_tracer_push_list_pre (GstVimbaTracer * self, GstClockTime ts,
+        GstPad * pad, GstBufferList * list)
+{
+    guint i, length = gst_buffer_list_length(list);
+
+    for (i = 0; i < length; i++) {
+        gst_vimba_tracer_buffer(self, pad, gst_buffer_list_get(list, i));
+    }
+}
+
+static void
+gst_vimba_tracer_push_event_pre (GstVimbaTracer * self, GstClockTime ts,
+        GstPad * pad, GstEvent * event)
+{
+    GstElement *peer;
+
+    if (GST_EVENT_TYPE(event) != GST_EVENT_EOS) {
+        return;
+    }
+    peer = gst_vimba_tracer_pad_parent(GST_PAD_PEER(pad));
+    if (peer != NULL && GST_OBJECT_FLAG_IS_SET(peer, GST_ELEMENT_FLAG_SINK) &&
+        g_atomic_int_compare_and_exchange(&self->logged, 0, 1)) {
+        gst_vimba_tracer_log(self);
+    }
+}
+
+static void
+gst_vimba_tracer_class_init (GstVimbaTracerClass * klass)
+{
+    GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+
+    gobject_class->finalize = gst_vimba_tracer_finalize;
+
+    tr_stage = gst_tracer_record_new("vimba-stage.class",
+        "stage", GST_TYPE_STRUCTURE, gst_structure_new("scope",
+            "type", G_TYPE_GTYPE, G_TYPE_STRING,
+            "related-to", GST_TYPE_TRACER_VALUE_SCOPE,
+                GST_TRACER_VALUE_SCOPE_PROCESS,
+            NULL),
+        "frames", GST_TYPE_STRUCTURE, gst_structure_new("value",
+            "type", G_TYPE_GTYPE, G_TYPE_UINT64,
+            "description", G_TYPE_STRING, "frames measured",
+            NULL),
+        "p50-us", GST_TYPE_STRUCTURE, gst_structure_new("value",
+            "type", G_TYPE_GTYPE, G_TYPE_UINT64,
+            "description", G_TYPE_STRING,
+                "median latency in microseconds, bucket upper bound",
+            NULL),
+        "p99-us", GST_TYPE_STRUCTURE, gst_structure_new("value",
+            "type", G_TYPE_GTYPE, G_TYPE_UINT64,
+            "description", G_TYPE_STRING,
+                "99th percentile latency in microseconds, bucket upper bound",
+            NULL),
+        "max-us", GST_TYPE_STRUCTURE, gst_structure_new("value",
+            "type", G_TYPE_GTYPE, G_TYPE_UINT64,
+            "description", G_TYPE_STRING, "largest latency in microseconds",
+            NULL),
+        "histogram", GST_TYPE_STRUCTURE, gst_structure_new("value",
+            "type", G_TYPE_GTYPE, G_TYPE_STRING,
+            "description", G_TYPE_STRING,
+                "frames per log2 bucket, as lower bound in us:count",
+            NULL),
+        NULL);
+    GST_OBJECT_FLAG_SET(tr_stage, GST_OBJECT_FLAG_MAY_BE_LEAKED);
+}
+
+static void
+gst_vimba_tracer_init (GstVimbaTracer * self)
+{
+    GstTracer *tracer = GST_TRACER(self);
+
+    g_mutex_init(&self->lock);
+    self->device_offsets = g_hash_table_new_full(g_direct_hash,
+        g_direct_equal, NULL, g_free);
+    self->logged = 1;
+
+    gst_tracing_register_hook(tracer, "pad-push-pre",
+        G_CALLBACK(gst_vimba_tracer_push_pre));
+    gst_tracing_register_hook(tracer, "pad-push-list-pre",
+        G_CALLBACK(gst_vimba_tracer_push_list_pre));
+    gst_tracing_register_hook(tracer, "pad-push-event-pre",
+        G_CALLBACK(gst_vimba_tracer_push_event_pre));
+}
+
+/* pipelines torn down without EOS get their histograms logged here */
+static void
+gst_vimba_tracer_finalize (GObject * object)
+{
+    GstVimbaTracer *self = GST_VIMBA_TRACER (object);
+
+    if (g_atomic_int_compare_and_exchange(&self->logged, 0, 1)) {
+        gst_vimba_tracer_log(self);
+    }
+    g_hash_table_destroy(self->device_offsets);
+    g_mutex_clear(&self->lock);
+
+    G_OBJECT_CLASS (gst_vimba_tracer_parent_class)->finalize (object);
+}
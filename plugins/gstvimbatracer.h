@@ -0,0 +1,77 @@
+/* GStreamer
+ * Copyright (C) 2015 Art+Com AG <info@artcom.de>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef _GST_VIMBA_TRACER_H_
+#define _GST_VIMBA_TRACER_H_
+
+#include <gst/gst.h>
+#include <gst/gsttracer.h>
+
+G_BEGIN_DECLS
+
+#define GST_TYPE_VIMBA_TRACER   (gst_vimba_tracer_get_type())
+#define GST_VIMBA_TRACER(obj)   (G_TYPE_CHECK_INSTANCE_CAST((obj),GST_TYPE_VIMBA_TRACER,GstVimbaTracer))
+#define GST_VIMBA_TRACER_CLASS(klass)   (G_TYPE_CHECK_CLASS_CAST((klass),GST_TYPE_VIMBA_TRACER,GstVimbaTracerClass))
+#define GST_IS_VIMBA_TRACER(obj)   (G_TYPE_CHECK_INSTANCE_TYPE((obj),GST_TYPE_VIMBA_TRACER))
+
+/* log2 buckets of microseconds, bucket i holds [2^i, 2^(i+1)) */
+#define GST_VIMBA_TRACER_BUCKETS 32
+
+typedef enum {
+    GST_VIMBA_STAGE_DEVICE_TO_CALLBACK,
+    GST_VIMBA_STAGE_CALLBACK_TO_DEQUEUE,
+    GST_VIMBA_STAGE_DEQUEUE_TO_PUSH,
+    GST_VIMBA_STAGE_PUSH_TO_SINK,
+    GST_VIMBA_STAGE_CALLBACK_TO_SINK,
+    GST_VIMBA_STAGE_COUNT
+} GstVimbaStage;
+
+typedef struct _GstVimbaTracer GstVimbaTracer;
+typedef struct _GstVimbaTracerClass GstVimbaTracerClass;
+
+/* updated with atomics only, so hooks of all streaming threads can share it */
+typedef struct {
+    gint buckets[GST_VIMBA_TRACER_BUCKETS];
+    gint max_us;
+} GstVimbaStageHistogram;
+
+struct _GstVimbaTracer
+{
+    GstTracer              base_vimbatracer;
+
+    GstVimbaStageHistogram stages[GST_VIMBA_STAGE_COUNT];
+
+    /* smallest callback minus device time seen per vimbasrc pad, the
+     * device stage is measured against it */
+    GMutex                 lock;
+    GHashTable*            device_offsets;
+    /* the histograms were logged since the last frame */
+    gint                   logged;
+};
+
+struct _GstVimbaTracerClass
+{
+    GstTracerClass base_vimbatracer_class;
+};
+
+GType gst_vimba_tracer_get_type (void);
+
+G_END_DECLS
+
+#endif
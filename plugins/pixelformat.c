@@ -22,6 +22,18 @@ const char* VIMBA_RAW_FORMATS[RAW_FORMAT_COUNT] = {
     "YUV422Packed",
     "YUV444Packed"
 };
+/* bits per pixel on the wire, indexed like VIMBA_RAW_FORMATS */
+const int VIMBA_RAW_BITS[RAW_FORMAT_COUNT] = {
+    8,
+    24,
+    24,
+    32,
+    32,
+    12,
+    16,
+    24
+};
+
 const char * GST_BAYER_FORMATS[BAYER_FORMAT_COUNT] = {
     "gbrg",
     "rggb",
@@ -142,3 +154,23 @@ vimbasrc_vimba_to_gstreamer_raw(const char * format) {
         RAW_FORMAT_COUNT
     );
 }
+
+int
+vimbasrc_format_bits_per_pixel(const char * format) {
+    int i;
+    if (format == NULL) {
+        return 0;
+    }
+    for (i = 0; i < RAW_FORMAT_COUNT; i++) {
+        if (strcmp(format, VIMBA_RAW_FORMATS[i]) == 0) {
+            return VIMBA_RAW_BITS[i];
+        }
+    }
+    /* all supported bayer formats are 8 bit */
+    for (i = 0; i < BAYER_FORMAT_COUNT; i++) {
+        if (strcmp(format, VIMBA_BAYER_FORMATS[i]) == 0) {
+            return 8;
+        }
+    }
+    return 0;
+}
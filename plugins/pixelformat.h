@@ -58,5 +58,6 @@ const char* vimbasrc_gstreamer_to_vimba_bayer(const char * format);
 const char* vimbasrc_vimba_to_gstreamer_bayer(const char * format);
 const char* vimbasrc_gstreamer_to_vimba_raw(const char * format);
 const char* vimbasrc_vimba_to_gstreamer_raw(const char * format);
+int vimbasrc_format_bits_per_pixel(const char * format);
 
 #endif
@@ -0,0 +1,242 @@
+#define _GNU_SOURCE
+
+#include <fcntl.h>
+#include <string.h>
+#include <stdlib.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include "vimbaalloc.h"
+
+#define HUGEPAGE_SIZE (2 * 1024 * 1024)
+
+/* from <numaif.h>, so libnuma is not needed for a single syscall */
+#define VIMBA_MPOL_BIND     2
+#define VIMBA_MPOL_MF_MOVE  (1 << 1)
+#define VIMBA_MAX_NODES     1024
+
+/* from <linux/udmabuf.h>, which older kernel headers lack */
+struct vimba_udmabuf_create {
+    guint32 memfd;
+    guint32 flags;
+    guint64 offset;
+    guint64 size;
+};
+#define VIMBA_UDMABUF_CREATE _IOW('u', 0x42, struct vimba_udmabuf_create)
+#define VIMBA_UDMABUF_FLAGS_CLOEXEC 0x01
+
+static gsize vimba_alloc_round (gsize size, gsize unit) {
+    return (size + unit - 1) / unit * unit;
+}
+
+static gboolean vimba_alloc_bind (guint8 * data, gsize size, gint node) {
+#ifdef SYS_mbind
+    unsigned long mask[VIMBA_MAX_NODES / (8 * sizeof(unsigned long))];
+    const gint bits = 8 * sizeof(unsigned long);
+
+    if (node < 0 || node >= VIMBA_MAX_NODES - 1) {
+        return FALSE;
+    }
+    memset(mask, 0, sizeof(mask));
+    mask[node / bits] |= 1UL << (node % bits);
+    return syscall(SYS_mbind, data, size, VIMBA_MPOL_BIND, mask,
+        (unsigned long) VIMBA_MAX_NODES, VIMBA_MPOL_MF_MOVE) == 0;
+#else
+    return FALSE;
+#endif
+}
+
+/* a dmabuf of the whole memfd, -1 without udmabuf support */
+static gint vimba_alloc_udmabuf (gint memfd, gsize size) {
+    struct vimba_udmabuf_create create = { 0 };
+    gint dev, fd;
+
+    /* udmabuf insists on memfds that cannot shrink */
+    if (fcntl(memfd, F_ADD_SEALS, F_SEAL_SHRINK) != 0) {
+        return -1;
+    }
+    dev = open("/dev/udmabuf", O_RDWR | O_CLOEXEC);
+    if (dev < 0) {
+        return -1;
+    }
+    create.memfd = memfd;
+    create.flags = VIMBA_UDMABUF_FLAGS_CLOEXEC;
+    create.offset = 0;
+    create.size = size;
+    fd = ioctl(dev, VIMBA_UDMABUF_CREATE, &create);
+    close(dev);
+    return fd;
+}
+
+/* shared mapping of a new memfd, hugepage backed if possible */
+static void * vimba_alloc_memfd (
+    VimbaAllocation * alloc, gsize size, const VimbaAllocParams * params
+) {
+#ifdef MFD_CLOEXEC
+    void * data;
+
+#ifdef MFD_HUGETLB
+    if (params->hugepages) {
+        alloc->size = vimba_alloc_round(size, HUGEPAGE_SIZE);
+        alloc->fd = memfd_create("vimba-ring",
+            MFD_CLOEXEC | MFD_ALLOW_SEALING | MFD_HUGETLB);
+        if (alloc->fd >= 0 && ftruncate(alloc->fd, alloc->size) == 0) {
+            alloc->placement |= VIMBA_ALLOC_HUGEPAGES;
+        } else if (alloc->fd >= 0) {
+            close(alloc->fd);
+            alloc->fd = -1;
+        }
+    }
+#endif
+    if (alloc->fd < 0) {
+        alloc->size = vimba_alloc_round(size, sysconf(_SC_PAGESIZE));
+        alloc->fd = memfd_create("vimba-ring", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+        if (alloc->fd < 0) {
+            return MAP_FAILED;
+        }
+        if (ftruncate(alloc->fd, alloc->size) != 0) {
+            close(alloc->fd);
+            alloc->fd = -1;
+            return MAP_FAILED;
+        }
+    }
+    data = mmap(NULL, alloc->size, PROT_READ | PROT_WRITE, MAP_SHARED,
+        alloc->fd, 0);
+    if (data == MAP_FAILED) {
+        close(alloc->fd);
+        alloc->fd = -1;
+        alloc->placement = 0;
+        return MAP_FAILED;
+    }
+    alloc->placement |= VIMBA_ALLOC_MEMFD;
+    alloc->dmabuf_fd = vimba_alloc_udmabuf(alloc->fd, alloc->size);
+    if (alloc->dmabuf_fd >= 0) {
+        alloc->placement |= VIMBA_ALLOC_UDMABUF;
+    }
+    return data;
+#else
+    return MAP_FAILED;
+#endif
+}
+
+gboolean vimba_alloc (
+    VimbaAllocation * alloc, gsize size, const VimbaAllocParams * params
+) {
+    void * data = MAP_FAILED;
+
+    memset(alloc, 0, sizeof(VimbaAllocation));
+    alloc->numa_node = -1;
+    alloc->fd = -1;
+    alloc->dmabuf_fd = -1;
+
+    if (params->memfd) {
+        data = vimba_alloc_memfd(alloc, size, params);
+    }
+#ifdef MAP_HUGETLB
+    if (params->hugepages && data == MAP_FAILED) {
+        alloc->size = vimba_alloc_round(size, HUGEPAGE_SIZE);
+        /* fails unless hugepages were reserved (vm.nr_hugepages) */
+        data = mmap(NULL, alloc->size, PROT_READ | PROT_WRITE,
+            MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (data != MAP_FAILED) {
+            alloc->placement |= VIMBA_ALLOC_HUGEPAGES;
+        }
+    }
+#endif
+    if (data == MAP_FAILED) {
+        alloc->size = vimba_alloc_round(size, sysconf(_SC_PAGESIZE));
+        data = mmap(NULL, alloc->size, PROT_READ | PROT_WRITE,
+            MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (data == MAP_FAILED) {
+            alloc->size = 0;
+            return FALSE;
+        }
+#ifdef MADV_HUGEPAGE
+        if (params->hugepages && madvise(data, alloc->size, MADV_HUGEPAGE) == 0) {
+            alloc->placement |= VIMBA_ALLOC_TRANSPARENT_HUGEPAGES;
+        }
+#endif
+    }
+    alloc->data = data;
+
+    /* bind before the first touch, so the pages are faulted on the node */
+    if (params->numa_node >= 0 &&
+        vimba_alloc_bind(alloc->data, alloc->size, params->numa_node)) {
+        alloc->placement |= VIMBA_ALLOC_NUMA;
+        alloc->numa_node = params->numa_node;
+    }
+    memset(alloc->data, 0, alloc->size);
+
+    /* limited by RLIMIT_MEMLOCK without CAP_IPC_LOCK */
+    if (params->lock && mlock(alloc->data, alloc->size) == 0) {
+        alloc->placement |= VIMBA_ALLOC_LOCKED;
+    }
+    return TRUE;
+}
+
+void vimba_alloc_free (VimbaAllocation * alloc) {
+    if (alloc->data == NULL) {
+        return;
+    }
+    if (alloc->placement & VIMBA_ALLOC_LOCKED) {
+        munlock(alloc->data, alloc->size);
+    }
+    munmap(alloc->data, alloc->size);
+    if (alloc->dmabuf_fd >= 0) {
+        close(alloc->dmabuf_fd);
+    }
+    if (alloc->fd >= 0) {
+        close(alloc->fd);
+    }
+    alloc->data = NULL;
+    alloc->size = 0;
+    alloc->fd = -1;
+    alloc->dmabuf_fd = -1;
+}
+
+/* NUMA node of a network interface, -1 if unknown */
+gint vimba_alloc_interface_node (const gchar * interface) {
+    gchar * path, * contents = NULL;
+    gint node = -1;
+
+    if (interface == NULL || *interface == '\0' || strchr(interface, '/')) {
+        return -1;
+    }
+    path = g_strdup_printf("/sys/class/net/%s/device/numa_node", interface);
+    if (g_file_get_contents(path, &contents, NULL, NULL)) {
+        node = atoi(contents);
+        g_free(contents);
+    }
+    g_free(path);
+    return node >= 0 ? node : -1;
+}
+
+gchar * vimba_alloc_placement_string (guint placement) {
+    GString * string = g_string_new(NULL);
+
+    if (placement & VIMBA_ALLOC_HUGEPAGES) {
+        g_string_append(string, "hugepages,");
+    }
+    if (placement & VIMBA_ALLOC_TRANSPARENT_HUGEPAGES) {
+        g_string_append(string, "transparent-hugepages,");
+    }
+    if (placement & VIMBA_ALLOC_NUMA) {
+        g_string_append(string, "numa,");
+    }
+    if (placement & VIMBA_ALLOC_LOCKED) {
+        g_string_append(string, "locked,");
+    }
+    if (placement & VIMBA_ALLOC_MEMFD) {
+        g_string_append(string, "memfd,");
+    }
+    if (placement & VIMBA_ALLOC_UDMABUF) {
+        g_string_append(string, "udmabuf,");
+    }
+    if (string->len == 0) {
+        g_string_append(string, "default");
+    } else {
+        g_string_truncate(string, string->len - 1);
+    }
+    return g_string_free(string, FALSE);
+}
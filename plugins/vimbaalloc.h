@@ -0,0 +1,52 @@
+#ifndef _VIMBASRC_ALLOC_H_
+#define _VIMBASRC_ALLOC_H_
+
+#include <glib.h>
+
+/*
+ * Memory for the capture ring. The sdk writes every frame into it, so it is
+ * placed on the NUMA node of the network interface the camera is attached
+ * to, backed by hugepages to keep TLB misses down and locked so it is never
+ * paged out. Every step is best effort; the placement that succeeded is
+ * reported, plain anonymous memory is the fallback. Backed by a memfd the
+ * ring can be shared by fd, as a dmabuf when /dev/udmabuf is available.
+ */
+
+/* alignment of frames within the ring, enough for any SIMD load */
+#define VIMBA_ALLOC_ALIGN 64
+
+typedef enum {
+    VIMBA_ALLOC_HUGEPAGES             = 1 << 0,
+    VIMBA_ALLOC_TRANSPARENT_HUGEPAGES = 1 << 1,
+    VIMBA_ALLOC_NUMA                  = 1 << 2,
+    VIMBA_ALLOC_LOCKED                = 1 << 3,
+    VIMBA_ALLOC_MEMFD                 = 1 << 4,
+    VIMBA_ALLOC_UDMABUF               = 1 << 5
+} VimbaAllocPlacement;
+
+typedef struct {
+    /* node to bind to, -1 = where the kernel puts it */
+    gint      numa_node;
+    gboolean  hugepages;
+    gboolean  lock;
+    /* back the memory with a memfd, and export it through udmabuf */
+    gboolean  memfd;
+} VimbaAllocParams;
+
+typedef struct {
+    guint8*   data;
+    gsize     size;
+    /* VimbaAllocPlacement flags that took effect */
+    guint     placement;
+    gint      numa_node;
+    /* the memfd and the dmabuf made from it, -1 if there is none */
+    gint      fd;
+    gint      dmabuf_fd;
+} VimbaAllocation;
+
+gboolean vimba_alloc (VimbaAllocation * alloc, gsize size, const VimbaAllocParams * params);
+void     vimba_alloc_free (VimbaAllocation * alloc);
+gint     vimba_alloc_interface_node (const gchar * interface);
+gchar*   vimba_alloc_placement_string (guint placement);
+
+#endif
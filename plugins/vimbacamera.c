@@ -1,59 +1,455 @@
 #include <stdlib.h>
 #include <string.h>
-#include <stdio.h>
 #include "vimbacamera.h"
+#include "vimbasync.h"
+#include "vimbaconfig.h"
+
+/* context slots of the frames queued by vimbacamera_start */
+#define FRAME_CONTEXT_CAMERA 0
+#define FRAME_CONTEXT_COUNT  1
 
 void VMB_CALL frame_callback(
     const VmbHandle_t camera_handle, VmbFrame_t * frame
 ) {
+      VimbaCamera * camera = frame->context[FRAME_CONTEXT_CAMERA];
+      GstClockTime now = gst_util_get_timestamp();
+      gint count;
+
+      /* the sdk delivers all frames of a camera from one thread */
+      vimba_thread_apply_pending(&camera->callback_thread, &camera->callback_report);
+      g_atomic_int_inc(&camera->frames_received);
       /*g_message("Frame received %lu", (unsigned long int)frame->frameID);*/
-      g_async_queue_push(frame_queue, frame);
+      camera->ring->callback_times[frame - camera->ring->frames] = now;
+      camera->last_callback_time = now;
+      /* numbered by the camera, so frames lost on the way keep the later
+       * ones in step with their triggers */
+      if (camera->frame_id_base < 0) {
+          camera->frame_id_base = (gint64) frame->frameID;
+      }
+      count = (gint) ((gint64) frame->frameID - camera->frame_id_base + 1);
+      frame->context[FRAME_CONTEXT_COUNT] = GINT_TO_POINTER(count);
+      /* frame ids the camera skipped were lost on the way to the host */
+      if (camera->last_frame_id > 0 && frame->frameID > camera->last_frame_id + 1) {
+          g_atomic_int_add(&camera->frames_dropped,
+              (gint) (frame->frameID - camera->last_frame_id - 1)
+          );
+      }
+      camera->last_frame_id = frame->frameID;
+      if (frame->receiveStatus == VmbFrameStatusIncomplete) {
+          g_atomic_int_inc(&camera->frames_incomplete);
+      }
+      g_async_queue_push(camera->frame_queue, frame);
 }
 
 VmbFrame_t * vimbacamera_consume_frame(VimbaCamera * camera) {
     if (camera->started == FALSE) {
         return NULL;
     }
-    VmbFrame_t * frame = g_async_queue_pop(frame_queue);
+    VmbFrame_t * frame = g_async_queue_pop(camera->frame_queue);
     /*g_message("Frame consumed %lu", (unsigned long int) frame->frameID);*/
     return frame;
 }
 
-void vimbacamera_queue_frame (VimbaCamera * camera, VmbFrame_t * frame) {
+/* NULL when no frame arrived within the timeout, 0 does not wait */
+VmbFrame_t * vimbacamera_consume_frame_timeout (
+    VimbaCamera * camera, guint64 timeout_us
+) {
+    if (camera->started == FALSE) {
+        return NULL;
+    }
+    if (timeout_us == 0) {
+        return g_async_queue_try_pop(camera->frame_queue);
+    }
+    return g_async_queue_timeout_pop(camera->frame_queue, timeout_us);
+}
+
+/* NUMA node the frames arrive on, from the camera's network interface */
+static gint vimbacamera_numa_node (VimbaCamera * camera) {
+    VmbCameraInfo_t info;
+
+    if (camera->alloc_params.numa_node >= 0) {
+        return camera->alloc_params.numa_node;
+    }
+    if (camera->network_interface != NULL) {
+        return vimba_alloc_interface_node(camera->network_interface);
+    }
+    /* GigE transport layers may name the interface after the host NIC */
+    if (camera->camera_id != NULL && VmbErrorSuccess == VmbCameraInfoQuery(
+            camera->camera_id, &info, sizeof(info))) {
+        return vimba_alloc_interface_node(info.interfaceIdString);
+    }
+    return -1;
+}
+
+/* the placement a ring allocated now would be asked for */
+static void vimbacamera_ring_params (
+    VimbaCamera * camera, VimbaAllocParams * params
+) {
+    *params = camera->alloc_params;
+    params->numa_node = vimbacamera_numa_node(camera);
+}
+
+/* a ring is reused while its geometry and placement are still wanted */
+static gboolean vimbacamera_ring_fits (VimbaCamera * camera) {
+    VimbaFrameRing * ring = camera->ring;
+    VimbaAllocParams params;
+
+    if (ring == NULL || ring->size != (VmbUint32_t) camera->payload_size ||
+        ring->count != camera->frame_count) {
+        return FALSE;
+    }
+    vimbacamera_ring_params(camera, &params);
+    return params.numa_node == ring->params.numa_node &&
+        params.hugepages == ring->params.hugepages &&
+        params.lock == ring->params.lock &&
+        params.memfd == ring->params.memfd;
+}
+
+static VimbaFrameRing * vimbacamera_ring_new (
+    VimbaCamera * camera, guint count, VmbUint32_t size
+) {
+    VimbaFrameRing * ring;
+    VimbaAllocParams params;
+    gsize stride = (size + VIMBA_ALLOC_ALIGN - 1) & ~(gsize) (VIMBA_ALLOC_ALIGN - 1);
+    gchar * placement;
+    guint i;
+
+    ring = g_new0(VimbaFrameRing, 1);
+    vimbacamera_ring_params(camera, &params);
+    ring->params = params;
+    if (!vimba_alloc(&ring->memory, stride * count, &params)) {
+        GST_ERROR("cannot allocate %u frames of %u bytes", count, size);
+        g_free(ring);
+        return NULL;
+    }
+    placement = vimba_alloc_placement_string(ring->memory.placement);
+    g_message("frame ring: %u x %u bytes, %s, node %d", count, size,
+        placement, ring->memory.numa_node);
+    g_free(placement);
+
+    ring->refcount = 1;
+    ring->count = count;
+    ring->size = size;
+    ring->frames = g_new0(VmbFrame_t, count);
+    ring->callback_times = g_new0(GstClockTime, count);
+    ring->held = g_new0(gint, count);
+    for (i = 0; i < count; i++) {
+        ring->frames[i].buffer = ring->memory.data + i * stride;
+        ring->frames[i].bufferSize = size;
+        ring->frames[i].context[FRAME_CONTEXT_CAMERA] = camera;
+    }
+    return ring;
+}
+
+VimbaFrameRing * vimbacamera_ring_ref (VimbaFrameRing * ring) {
+    g_atomic_int_inc(&ring->refcount);
+    return ring;
+}
+
+void vimbacamera_ring_unref (VimbaFrameRing * ring) {
+    if (ring == NULL || !g_atomic_int_dec_and_test(&ring->refcount)) {
+        return;
+    }
+    vimba_alloc_free(&ring->memory);
+    g_free(ring->frames);
+    g_free(ring->callback_times);
+    g_free(ring->held);
+    g_free(ring);
+}
+
+/*
+ * Keep a frame out of the sdk queue while its memory is used downstream.
+ * Returns a reference on the ring to pass to vimbacamera_release_frame.
+ */
+VimbaFrameRing * vimbacamera_hold_frame (VimbaCamera * camera, VmbFrame_t * frame) {
+    VimbaFrameRing * ring = camera->ring;
+
+    g_atomic_int_inc(&ring->refcount);
+    g_atomic_int_set(&ring->held[frame - ring->frames], 1);
+    return ring;
+}
+
+/* hand a held frame back to the sdk, unless its ring was replaced meanwhile */
+void vimbacamera_release_frame (
+    VimbaCamera * camera, VimbaFrameRing * ring, VmbFrame_t * frame
+) {
+    g_atomic_int_set(&ring->held[frame - ring->frames], 0);
+    if (camera->started && g_atomic_pointer_get(&camera->ring) == ring) {
+        vimbacamera_queue_frame(camera, frame);
+    }
+    vimbacamera_ring_unref(ring);
+}
+
+/*
+ * Hand a frame to the sdk. A camera that went away fails here first, it is
+ * marked lost and the frame is queued again when acquisition restarts.
+ */
+gboolean vimbacamera_queue_frame (VimbaCamera * camera, VmbFrame_t * frame) {
     /*g_message("queuing frame %lu", (unsigned long int) frame->frameID);*/
-    VmbError_t err = VmbCaptureFrameQueue(
+    VmbError_t err;
+
+    if (g_atomic_int_get(&camera->lost)) {
+        return FALSE;
+    }
+    err = VmbCaptureFrameQueue(
         camera->camera_handle,
         frame,
         &frame_callback
     );
-    if (VmbErrorBadHandle == err) {
-        g_message("Invalid frame");
-    } else if (VmbErrorStructSize == err) {
-        g_error("Invalid struct size for current frame");
-    } else if (VmbErrorTimeout == err) {
-        g_error("Call timed out");
-    } else if (VmbErrorApiNotStarted == err) {
-        g_error("Api not started");
+    if (VmbErrorSuccess == err) {
+        return TRUE;
+    }
+    if (VmbErrorStructSize == err) {
+        GST_ERROR("Invalid struct size for current frame");
+    } else if (VmbErrorResources == err) {
+        GST_WARNING("sdk frame queue of camera %s is full", camera->camera_id);
+    } else if (camera->started) {
+        GST_WARNING("queuing a frame of camera %s failed: %d",
+            camera->camera_id, err);
+        vimbacamera_mark_lost(camera);
+    }
+    return FALSE;
+}
+
+/* returns TRUE for the call that noticed the loss */
+gboolean vimbacamera_mark_lost (VimbaCamera * camera) {
+    GstClockTime now = gst_util_get_timestamp();
+
+    if (!g_atomic_int_compare_and_exchange(&camera->lost, 0, 1)) {
+        return FALSE;
+    }
+    camera->lost_time = now;
+    g_warning("Camera %s lost", camera->camera_id);
+    return TRUE;
+}
+
+gboolean vimbacamera_is_lost (VimbaCamera * camera) {
+    return g_atomic_int_get(&camera->lost) != 0;
+}
+
+/* a cheap round trip to the camera, FALSE when it does not answer */
+gboolean vimbacamera_probe (VimbaCamera * camera) {
+    VmbInt64_t payload_size;
+
+    return camera->open && VmbErrorSuccess == VmbFeatureIntGet(
+        camera->camera_handle, "PayloadSize", &payload_size);
+}
+
+/*
+ * Frames of all cameras in a sync group that were exposed by the same action
+ * command share this id. In the other trigger modes it is the frame number.
+ */
+guint64 vimbacamera_frame_trigger_id (VimbaCamera * camera, VmbFrame_t * frame) {
+    return camera->trigger_base +
+        (guint64) GPOINTER_TO_INT(frame->context[FRAME_CONTEXT_COUNT]);
+}
+
+/* device timestamp of the frame in nanoseconds */
+guint64 vimbacamera_frame_device_time (VimbaCamera * camera, VmbFrame_t * frame) {
+    if (camera->timestamp_frequency <= 0) {
+        return frame->timestamp;
+    }
+    return gst_util_uint64_scale(
+        frame->timestamp, GST_SECOND, camera->timestamp_frequency
+    );
+}
+
+/* current time of the camera clock, comparable to the frame device times */
+gboolean vimbacamera_latch_device_time (VimbaCamera * camera, guint64 * time) {
+    VmbInt64_t ticks;
+
+    if (camera->camera_handle == NULL ||
+        VmbErrorSuccess != VmbFeatureCommandRun(
+            camera->camera_handle, "GevTimestampControlLatch") ||
+        VmbErrorSuccess != VmbFeatureIntGet(
+            camera->camera_handle, "GevTimestampValue", &ticks)) {
+        return FALSE;
+    }
+    if (camera->timestamp_frequency <= 0) {
+        *time = (guint64) ticks;
+    } else {
+        *time = gst_util_uint64_scale(
+            (guint64) ticks, GST_SECOND, camera->timestamp_frequency
+        );
+    }
+    return TRUE;
+}
+
+/* monotonic time the frame was handed to the sdk callback */
+GstClockTime vimbacamera_frame_callback_time (
+    VimbaCamera * camera, VmbFrame_t * frame
+) {
+    return camera->ring->callback_times[frame - camera->ring->frames];
+}
+
+/* read a chunk feature regardless of whether the camera reports it as int */
+static gboolean vimbacamera_chunk_float (
+    VmbHandle_t handle, const char * name, double * value
+) {
+    VmbInt64_t int_value;
+
+    if (VmbErrorSuccess == VmbFeatureFloatGet(handle, name, value)) {
+        return TRUE;
+    }
+    if (VmbErrorSuccess == VmbFeatureIntGet(handle, name, &int_value)) {
+        *value = (double) int_value;
+        return TRUE;
+    }
+    return FALSE;
+}
+
+/*
+ * Parse the chunk data the camera appended to the frame. Only works with
+ * chunk mode active, features the camera does not provide stay zero and
+ * FALSE is returned when it provides none of them.
+ */
+gboolean vimbacamera_frame_chunk_data (
+    VimbaCamera * camera, VmbFrame_t * frame, VimbaChunkData * chunk
+) {
+    VmbHandle_t ancillary;
+
+    gboolean found = FALSE;
+
+    memset(chunk, 0, sizeof(VimbaChunkData));
+    if (!camera->chunk_active || frame->ancillarySize == 0) {
+        return FALSE;
     }
+    if (VmbErrorSuccess != VmbAncillaryDataOpen(frame, &ancillary)) {
+        return FALSE;
+    }
+    found |= vimbacamera_chunk_float(ancillary, "ChunkExposureTime",
+        &chunk->exposure_time);
+    found |= vimbacamera_chunk_float(ancillary, "ChunkGain", &chunk->gain);
+    found |= VmbErrorSuccess == VmbFeatureIntGet(ancillary,
+        "ChunkAcquisitionFrameCount", &chunk->frame_counter);
+    found |= VmbErrorSuccess == VmbFeatureIntGet(ancillary,
+        "ChunkSyncInLevels", &chunk->line_status);
+    VmbAncillaryDataClose(ancillary);
+    return found;
+}
+
+/* chunks read by vimbacamera_frame_chunk_data, on cameras selecting them */
+static const char * const chunk_selectors[] = {
+    "ExposureTime", "Gain", "FrameID", "LineStatusAll", NULL
+};
+
+/*
+ * Switch chunk mode as chunk_mode says, TRUE when the camera appends chunks
+ * then. Cameras without ChunkSelector append all of theirs, the others only
+ * the selected ones, at least one of which has to be enabled.
+ */
+static gboolean vimbacamera_configure_chunks (VimbaCamera * camera) {
+    VmbHandle_t handle = camera->camera_handle;
+    gboolean enabled = FALSE;
+    VmbError_t err;
+    gint i;
+
+    if (VmbErrorSuccess != VmbFeatureBoolSet(handle, "ChunkModeActive",
+            camera->chunk_mode ? VmbBoolTrue : VmbBoolFalse) ||
+        !camera->chunk_mode) {
+        return FALSE;
+    }
+    for (i = 0; chunk_selectors[i] != NULL; i++) {
+        err = VmbFeatureEnumSet(handle, "ChunkSelector", chunk_selectors[i]);
+        if (VmbErrorNotFound == err && i == 0) {
+            return TRUE;
+        }
+        if (VmbErrorSuccess == err &&
+            VmbErrorSuccess == VmbFeatureBoolSet(handle, "ChunkEnable",
+                VmbBoolTrue)) {
+            enabled = TRUE;
+        } else {
+            GST_DEBUG("camera %s has no %s chunk", camera->camera_id,
+                chunk_selectors[i]);
+        }
+    }
+    if (!enabled) {
+        GST_WARNING("camera %s enabled none of the chunks", camera->camera_id);
+    }
+    return enabled;
+}
+
+gboolean vimbacamera_software_trigger (VimbaCamera * camera) {
+    if (camera->started == FALSE ||
+        camera->trigger_mode != VIMBA_TRIGGER_SOFTWARE) {
+        return FALSE;
+    }
+    if (VmbErrorSuccess != VmbFeatureCommandRun(
+            camera->camera_handle, "TriggerSoftware")) {
+        return FALSE;
+    }
+    g_atomic_int_inc(&camera->triggers_sent);
+    return TRUE;
+}
+
+static VmbError_t vimbacamera_acquisition_start (VimbaCamera * camera) {
+    return VmbFeatureCommandRun(camera->camera_handle, "AcquisitionStart");
+}
+
+static void vimbacamera_configure_trigger (VimbaCamera * camera) {
+    VmbHandle_t handle = camera->camera_handle;
+    const char * source = NULL;
+
+    VmbFeatureEnumSet(handle, "TriggerSelector", "FrameStart");
+    switch (camera->trigger_mode) {
+        case VIMBA_TRIGGER_SOFTWARE:
+            source = "Software";
+            break;
+        case VIMBA_TRIGGER_LINE:
+            source = camera->trigger_line ? camera->trigger_line : "Line1";
+            break;
+        case VIMBA_TRIGGER_ACTION:
+            source = "Action0";
+            VmbFeatureIntSet(handle, "ActionDeviceKey", camera->action_device_key);
+            VmbFeatureIntSet(handle, "ActionGroupKey", camera->action_group_key);
+            VmbFeatureIntSet(handle, "ActionGroupMask", camera->action_group_mask);
+            break;
+        case VIMBA_TRIGGER_FREERUN:
+        default:
+            break;
+    }
+
+    if (source == NULL) {
+        VmbFeatureEnumSet(handle, "TriggerMode", "Off");
+        return;
+    }
+    g_message("Frame start trigger source: %s", source);
+    if (VmbErrorSuccess != VmbFeatureEnumSet(handle, "TriggerSource", source)) {
+        g_warning("Camera %s does not support trigger source %s",
+            camera->camera_id, source
+        );
+    }
+    VmbFeatureEnumSet(handle, "TriggerMode", "On");
 }
 
 
 VimbaCamera* vimbacamera_init() {
-    VimbaCamera* camera = malloc(sizeof(VimbaCamera));
+    VimbaCamera* camera = calloc(1, sizeof(VimbaCamera));
+    camera->frame_count = VIMBA_FRAME_COUNT;
+    camera->alloc_params.numa_node = -1;
+    camera->alloc_params.hugepages = TRUE;
+    camera->alloc_params.lock = TRUE;
+    vimba_thread_params_init(&camera->callback_thread);
+    vimba_thread_report_init(&camera->callback_report);
     camera->started = FALSE;
     camera->open = FALSE;
+    g_rw_lock_init(&camera->handle_lock);
     return camera;
 }
 
 void vimbacamera_destroy (VimbaCamera * camera) {
-    g_async_queue_unref(frame_queue);
     if (camera) {
+        g_rw_lock_clear(&camera->handle_lock);
+        g_free(camera->network_interface);
+        vimba_thread_params_clear(&camera->callback_thread);
+        vimba_thread_report_clear(&camera->callback_report);
         free(camera);
     }
     camera = NULL;
 }
 
 gboolean vimbacamera_open (VimbaCamera * camera) {
+    VmbHandle_t handle = NULL;
     VmbError_t err;
 
     if (camera->camera_id == NULL) {
@@ -65,18 +461,25 @@ gboolean vimbacamera_open (VimbaCamera * camera) {
     err = VmbCameraOpen(
         camera->camera_id,
         VmbAccessModeFull,
-        &(camera->camera_handle)
+        &handle
     );
 
     if (VmbErrorSuccess == err) {
         g_message("success!");
+        g_rw_lock_writer_lock(&camera->handle_lock);
+        camera->camera_handle = handle;
         camera->open = TRUE;
+        camera->features = vimba_feature_cache_new(camera->camera_handle);
+        g_rw_lock_writer_unlock(&camera->handle_lock);
         VmbFeatureIntSet(camera->camera_handle, "GevSCPSPacketSize", 1500);
     } else if (VmbErrorNotFound == err) {
-        g_error("Camera %s not found", camera->camera_id);
+        GST_WARNING("Camera %s not found", camera->camera_id);
         return FALSE;
     } else if (VmbErrorInvalidAccess == err) {
-        g_error("Cannot acces camera");
+        GST_WARNING("Cannot access camera %s", camera->camera_id);
+        return FALSE;
+    } else {
+        GST_WARNING("Cannot open camera %s: %d", camera->camera_id, err);
         return FALSE;
     }
 
@@ -87,7 +490,14 @@ gboolean vimbacamera_close (VimbaCamera * camera) {
     VmbError_t err;
     if (camera->open == TRUE) {
         g_message("vimbacamera_close");
+        vimbacamera_ring_unref(camera->ring);
+        camera->ring = NULL;
+        g_rw_lock_writer_lock(&camera->handle_lock);
+        vimba_feature_cache_free(camera->features);
+        camera->features = NULL;
+        camera->open = FALSE;
         err = VmbCameraClose(camera->camera_handle);
+        g_rw_lock_writer_unlock(&camera->handle_lock);
         if (err != VmbErrorSuccess) {
             return FALSE;
         }
@@ -95,16 +505,67 @@ gboolean vimbacamera_close (VimbaCamera * camera) {
     return TRUE;
 }
 
-void print_feature_error(VmbError_t err) {
-    if (VmbErrorBadHandle == err) {
-        g_error("Bad handle");
-    } else if (VmbErrorInvalidAccess == err) {
-        g_error("Invalid access");
-    } else if (VmbErrorWrongType == err) {
-        g_error("Wrong type");
+/* write the cached geometry, format and frame rate to the camera */
+void vimbacamera_write_format (VimbaCamera * camera) {
+    VimbaConfig config = { camera->width, camera->height, -1, -1, camera->format };
+    VimbaConfigReport report;
+    GError * error = NULL;
+
+    if (camera->width > 0 && camera->height > 0 &&
+        !vimba_config_apply(camera, &config, &report, &error)) {
+        GST_WARNING("camera %s: %s", camera->camera_id, error->message);
+        g_error_free(error);
+    }
+    if (camera->framerate > 0) {
+        VmbFeatureFloatSet(camera->camera_handle, "AcquisitionFrameRateAbs",
+            camera->framerate);
     }
 }
 
+/*
+ * Close a lost camera and open it again, keeping the frame ring. The sdk
+ * forgot the frames that were queued, acquisition is restarted with
+ * vimbacamera_start, which queues them again. Geometry, format and frame
+ * rate are written back, other features are up to the caller. Must not run
+ * concurrently with the streaming thread consuming frames.
+ */
+gboolean vimbacamera_reopen (VimbaCamera * camera) {
+    VmbInt64_t width = camera->width;
+    VmbInt64_t height = camera->height;
+    const char * format = camera->format;
+    double framerate = camera->framerate;
+
+    camera->started = FALSE;
+    vimba_sync_leave(camera);
+    if (camera->open) {
+        /* a vanished camera fails these, its handle is gone either way */
+        VmbCaptureEnd(camera->camera_handle);
+        VmbFrameRevokeAll(camera->camera_handle);
+        g_rw_lock_writer_lock(&camera->handle_lock);
+        VmbCameraClose(camera->camera_handle);
+        vimba_feature_cache_free(camera->features);
+        camera->features = NULL;
+        camera->open = FALSE;
+        g_rw_lock_writer_unlock(&camera->handle_lock);
+    }
+    if (!vimbacamera_open(camera)) {
+        return FALSE;
+    }
+    vimbacamera_load(camera);
+    if (width > 0 && height > 0) {
+        camera->width = width;
+        camera->height = height;
+    }
+    if (format != NULL) {
+        camera->format = format;
+    }
+    if (framerate > 0) {
+        camera->framerate = framerate;
+    }
+    vimbacamera_write_format(camera);
+    return TRUE;
+}
+
 gboolean vimbacamera_load (VimbaCamera * camera) {
     g_message("Loading camera data for camera %s", camera->camera_id);
     gboolean res = TRUE;
@@ -164,6 +625,24 @@ gboolean vimbacamera_load (VimbaCamera * camera) {
         "AcquisitionFrameRateAbs",
         &camera->framerate
     );
+    /* bandwidth the camera is allowed to use on the link (GigE only) */
+    if (VmbErrorSuccess != VmbFeatureIntGet(
+            camera->camera_handle,
+            "StreamBytesPerSecond",
+            &camera->stream_bytes_per_second
+        )
+    ) {
+        camera->stream_bytes_per_second = 0;
+    }
+    /* ticks per second of the frame timestamps */
+    if (VmbErrorSuccess != VmbFeatureIntGet(
+            camera->camera_handle,
+            "GevTimestampTickFrequency",
+            &camera->timestamp_frequency
+        )
+    ) {
+        camera->timestamp_frequency = GST_SECOND;
+    }
     g_message(
         "Current camera configuration:\n \
         \tMaxWidth:\t\t%lu\n \
@@ -196,9 +675,24 @@ gboolean vimbacamera_start (VimbaCamera * camera) {
 
     /* Reset base time (should be set when reading the first frame) */
     camera->base_time = 0;
-
-    /* Create global frame queue that's going to be used by gstreamer */
-    frame_queue = g_async_queue_new();
+    /* the sdk may deliver from another thread than last time; its own
+     * thread only ever runs frame callbacks, so nothing is restored */
+    vimba_thread_params_reset(&camera->callback_thread, &camera->callback_report);
+
+    /* Create the frame queue that's going to be used by gstreamer, the
+     * one of a lost camera still holds frames the ring queues again */
+    if (camera->frame_queue != NULL) {
+        g_async_queue_unref(camera->frame_queue);
+    }
+    camera->frame_queue = g_async_queue_new();
+    camera->frames_received = 0;
+    camera->triggers_sent = 0;
+    camera->trigger_base = 0;
+    camera->frame_id_base = -1;
+    camera->frames_incomplete = 0;
+    camera->frames_dropped = 0;
+    camera->last_frame_id = 0;
+    camera->last_callback_time = 0;
 
     /* Continuous frame grabbing (in contrast to single frame capture) */
     err = VmbFeatureEnumSet(
@@ -206,44 +700,64 @@ gboolean vimbacamera_start (VimbaCamera * camera) {
         "AcquisitionMode",
         "Continuous"
     );
+    vimbacamera_configure_trigger(camera);
 
-    /* Create and announce frame buffers */
+    /* Chunk data enlarges the payload, so set it before querying its size */
+    camera->chunk_active = vimbacamera_configure_chunks(camera);
+
+    /* size of one frame, chunk data included */
     err = VmbFeatureIntGet(
         camera->camera_handle,
         "PayloadSize",
          &camera->payload_size
     );
 
-    /* create and announce frame buffers */
-    for (i = 0; i < VIMBA_FRAME_COUNT; i++) {
-        memset(&camera->frames[i], 0, sizeof(VmbFrame_t));
-        camera->frames[i].buffer = (unsigned char*)malloc(
-                                       (VmbUint32_t)camera->payload_size
-                                   );
-        camera->frames[i].bufferSize = (VmbUint32_t)camera->payload_size;
-        /* Somehow announcing a frame prevented the api from working */
-//        VmbFrameAnnounce(
-//            camera->camera_handle,
-//            &camera->frames[i],
-//            sizeof(VmbFrame_t)
-//        );
+    /* create frame buffers, the ring is reused while its geometry and
+     * placement fit */
+    if (!vimbacamera_ring_fits(camera)) {
+        VimbaFrameRing * old = camera->ring;
+        VimbaFrameRing * ring = vimbacamera_ring_new(
+            camera, camera->frame_count, (VmbUint32_t) camera->payload_size
+        );
+        if (ring == NULL) {
+            return FALSE;
+        }
+        g_atomic_pointer_set(&camera->ring, ring);
+        vimbacamera_ring_unref(old);
+        camera->ring_placement = ring->memory.placement;
+        camera->ring_numa_node = ring->memory.numa_node;
+        camera->ring_bytes = ring->memory.size;
     }
+    /* the ring frames are queued without VmbFrameAnnounce on purpose,
+     * announcing them kept the api from capturing */
 
     /* Start capture engine */
-    VmbCaptureStart(camera->camera_handle);
+    err = VmbCaptureStart(camera->camera_handle);
+    if (VmbErrorSuccess != err) {
+        GST_WARNING("Cannot start capture on camera %s: %d",
+            camera->camera_id, err);
+        return FALSE;
+    }
 
-    /* Queue frames */
-    for (i = 0; i < VIMBA_FRAME_COUNT; i++) {
-        vimbacamera_queue_frame(camera, &camera->frames[i]);
+    /* Queue frames, except those still used downstream */
+    g_atomic_int_set(&camera->lost, 0);
+    for (i = 0; i < (int) camera->ring->count; i++) {
+        if (!g_atomic_int_get(&camera->ring->held[i])) {
+            vimbacamera_queue_frame(camera, &camera->ring->frames[i]);
+        }
     }
 
-    /* Start aquisition */
-    err = VmbFeatureCommandRun(camera->camera_handle, "AcquisitionStart");
-    if (VmbErrorInvalidAccess == err) {
-        g_error("Operation not valid with curren access mode");
-        return FALSE;
-    } else if (VmbErrorWrongType == err) {
-        g_error("Not a command");
+    /* Start aquisition, a camera triggered by action commands listens to
+     * those of its group from then on */
+    if (camera->trigger_mode == VIMBA_TRIGGER_ACTION) {
+        err = vimba_sync_join(camera, vimbacamera_acquisition_start);
+    } else {
+        err = vimbacamera_acquisition_start(camera);
+    }
+    if (VmbErrorSuccess != err) {
+        GST_WARNING("Cannot start acquisition on camera %s: %d",
+            camera->camera_id, err);
+        VmbCaptureEnd(camera->camera_handle);
         return FALSE;
     }
     g_message("Acquisition started");
@@ -256,7 +770,8 @@ gboolean vimbacamera_stop (VimbaCamera * camera) {
         return TRUE;
     }
     g_message("vimbacamera_stop");
-    if (!VmbFeatureCommandRun(
+    vimba_sync_leave(camera);
+    if (VmbErrorSuccess != VmbFeatureCommandRun(
             camera->camera_handle,
             "AcquisitionStop"
         )
@@ -267,12 +782,8 @@ gboolean vimbacamera_stop (VimbaCamera * camera) {
     VmbCaptureEnd(camera->camera_handle);
     VmbFrameRevokeAll(camera->camera_handle);
 
-    g_async_queue_unref(frame_queue);
-
-    int i;
-    for (i = 0; i < VIMBA_FRAME_COUNT; i++) {
-        free(camera->frames[i].buffer);
-    }
+    g_async_queue_unref(camera->frame_queue);
+    camera->frame_queue = NULL;
 
     g_message("Acquisition stopped");
     camera->started = FALSE;
@@ -288,21 +799,25 @@ void vimbacamera_capture (VimbaCamera * camera) {
          &camera->payload_size
     );
 
-    camera->frames[0].buffer = malloc(camera->payload_size * sizeof(char));
-    camera->frames[0].bufferSize = camera->payload_size;
+    VmbFrame_t frame;
+    memset(&frame, 0, sizeof(VmbFrame_t));
+    frame.buffer = malloc(camera->payload_size * sizeof(char));
+    frame.bufferSize = camera->payload_size;
     VmbFrameAnnounce(
         camera->camera_handle,
-        &camera->frames[0],
+        &frame,
         sizeof(VmbFrame_t)
     );
-    VmbCaptureFrameWait(camera->camera_handle, &camera->frames[0], 9000);
+    VmbCaptureFrameWait(camera->camera_handle, &frame, 9000);
+    VmbFrameRevoke(camera->camera_handle, &frame);
+    free(frame.buffer);
 }
 
 #define VMB_HANDLE_FEATURE_ERROR(err) \
     if (VmbErrorBadHandle == err) { \
         g_message("You have to open the camera before setting any features!"); \
     } else if (VmbErrorWrongType == err) { \
-        g_error("%s has the wrong type!", name); \
+        g_warning("%s has the wrong type!", name); \
     } \
 
 void vimbacamera_set_feature_int(
@@ -310,91 +825,31 @@ void vimbacamera_set_feature_int(
 ) {
     VmbError_t err = VmbFeatureIntSet(camera->camera_handle, name, value);
     VMB_HANDLE_FEATURE_ERROR(err);
+    if (camera->features != NULL) {
+        vimba_feature_invalidate(camera->features, name);
+    }
 }
 
 long long vimbacamera_get_feature_int(VimbaCamera * camera, const char * name) {
     long long value = 0;
+    GValue cached = G_VALUE_INIT;
+
+    /* served from the cache until the sdk invalidates the feature */
+    if (vimba_feature_get(camera->features, name, &cached)) {
+        if (G_VALUE_HOLDS_INT64(&cached)) {
+            value = g_value_get_int64(&cached);
+        } else if (G_VALUE_HOLDS_DOUBLE(&cached)) {
+            /* some cameras report integral features such as offsets as float */
+            gdouble d = g_value_get_double(&cached);
+
+            value = (long long) (d < 0 ? d - 0.5 : d + 0.5);
+        } else {
+            g_warning("%s has the wrong type!", name);
+        }
+        g_value_unset(&cached);
+        return value;
+    }
     VmbError_t err = VmbFeatureIntGet(camera->camera_handle, name, &value);
     VMB_HANDLE_FEATURE_ERROR(err);
     return value;
 }
-
-void vimbacamera_list_features(VimbaCamera * camera) {
-    VmbFeatureInfo_t *features;
-    VmbUint32_t i, string_size = 0, count = 0;
-    VmbInt64_t int_value = 0;
-    char bool_value = 'f';
-    double float_value = 0;
-    const char * enum_value = NULL;
-    char buffer[1024];
-    char value_string[1024];
-    VmbError_t err;
-    FILE * outfile = fopen("/tmp/features.txt", "w");
-
-    err = VmbFeaturesList(
-        camera->camera_handle, NULL, 0, &count, sizeof *features
-    );
-
-    if (VmbErrorSuccess == err && 0 < count) {
-        features = malloc(count * sizeof(VmbFeatureInfo_t));
-        err = VmbFeaturesList(
-            camera->camera_handle, features, count, &count, sizeof(*features)
-        );
-        for (i = 0; i < count; ++i) {
-            switch(features[i].featureDataType) {
-                case VmbFeatureDataInt:
-                    VmbFeatureIntGet(
-                        camera->camera_handle,
-                        features[i].name,
-                        &int_value
-                    );
-                    sprintf(value_string, "%lld", int_value);
-                    break;
-                case VmbFeatureDataBool:
-                    VmbFeatureBoolGet(
-                        camera->camera_handle,
-                        features[i].name,
-                        &bool_value
-                    );
-                    sprintf(value_string, "%c", bool_value);
-                    break;
-                case VmbFeatureDataFloat:
-                    VmbFeatureFloatGet(
-                        camera->camera_handle,
-                        features[i].name,
-                        &float_value
-                    );
-                    sprintf(value_string, "%f", float_value);
-                    break;
-                case VmbFeatureDataEnum:
-                    VmbFeatureEnumGet(
-                        camera->camera_handle,
-                        features[i].name,
-                        &enum_value
-                    );
-                    sprintf(value_string, "%s", enum_value);
-                    break;
-                case VmbFeatureDataString:
-                    VmbFeatureStringGet(
-                        camera->camera_handle,
-                        features[i].name,
-                        buffer,
-                        1024,
-                        &string_size
-                    );
-                    sprintf(value_string, "%s", buffer);
-                    break;
-                default:
-                    break;
-            }
-            fprintf(
-                outfile,
-                "Feature %s: %s\n",
-                features[i].name,
-                value_string
-            );
-        }
-    }
-    fclose(outfile);
-}
-
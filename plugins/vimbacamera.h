@@ -3,12 +3,46 @@
 
 #include "VimbaC.h"
 #include "gst/gst.h"
+#include "vimbafeature.h"
+#include "vimbaalloc.h"
+#include "vimbathread.h"
 
 #define GST_VIMBA_SRC_MAXFORMATS 64
 #define VIMBA_FRAME_COUNT 5
 
-/* global frame queue with completed frames */
-GAsyncQueue* frame_queue;
+/* what starts the exposure of a frame */
+typedef enum {
+    VIMBA_TRIGGER_FREERUN,
+    VIMBA_TRIGGER_SOFTWARE,
+    VIMBA_TRIGGER_LINE,
+    VIMBA_TRIGGER_ACTION
+} VimbaTriggerMode;
+
+/* values the camera appends to a frame in chunk mode */
+typedef struct {
+    double      exposure_time;
+    double      gain;
+    VmbInt64_t  frame_counter;
+    VmbInt64_t  line_status;
+} VimbaChunkData;
+
+/*
+ * Frame buffers announced to the sdk. Frames handed downstream without a
+ * copy are marked held until their buffer is released, and every such buffer
+ * keeps a reference, so the ring outlives a stop or a renegotiation. All
+ * frames share one allocation, VIMBA_ALLOC_ALIGN apart.
+ */
+typedef struct {
+    gint          refcount;
+    guint         count;
+    VmbUint32_t   size;
+    /* what the memory was asked for, with the numa node resolved */
+    VimbaAllocParams params;
+    VimbaAllocation memory;
+    VmbFrame_t*   frames;
+    GstClockTime* callback_times;
+    gint*         held;
+} VimbaFrameRing;
 
 typedef struct _VimbaCamera VimbaCamera;
 struct _VimbaCamera {
@@ -21,7 +55,18 @@ struct _VimbaCamera {
     double      max_framerate;
     double      min_framerate;
     double      framerate;
-    VmbFrame_t  frames[VIMBA_FRAME_COUNT];
+    VmbInt64_t  stream_bytes_per_second;
+    VmbInt64_t  timestamp_frequency;
+    VimbaFrameRing* ring;
+    guint       frame_count;
+
+    /* placement of the ring, applied when it is allocated */
+    VimbaAllocParams alloc_params;
+    gchar*      network_interface;
+    /* what the current ring got, for reporting */
+    guint       ring_placement;
+    gint        ring_numa_node;
+    guint64     ring_bytes;
     VmbInt64_t  payload_size;
     const char* format;
     const char* supported_formats[GST_VIMBA_SRC_MAXFORMATS];
@@ -29,20 +74,81 @@ struct _VimbaCamera {
     VmbUint64_t base_time;
     gboolean    open;
     gboolean    started;
+
+    /* cached feature values, valid while the camera is open */
+    VimbaFeatureCache* features;
+    /* camera_handle and features are replaced by open, close and reopen,
+     * which hold the element's camera lock and this one for writing;
+     * threads that do not hold the camera lock use them as a reader */
+    GRWLock          handle_lock;
+
+    /* completed frames, filled from the sdk callback */
+    GAsyncQueue*     frame_queue;
+
+    /* trigger configuration, applied in vimbacamera_start */
+    VimbaTriggerMode trigger_mode;
+    const char*      trigger_line;
+    guint32          action_device_key;
+    guint32          action_group_key;
+    guint32          action_group_mask;
+
+    /* append chunk data (exposure, gain, counters) to every frame,
+     * chunk_active once the camera accepted it in vimbacamera_start */
+    gboolean         chunk_mode;
+    gboolean         chunk_active;
+
+    /* frames received and software triggers sent since start */
+    gint             frames_received;
+    gint             triggers_sent;
+    /* trigger ids count from the sync group trigger id at start, following
+     * the frame ids of the camera from the first one, -1 before it */
+    guint64          trigger_base;
+    gint64           frame_id_base;
+
+    /* affinity and scheduling of the sdk thread calling frame_callback */
+    VimbaThreadParams callback_thread;
+    VimbaThreadReport callback_report;
+
+    /* capture counters since start, updated from the sdk callback */
+    gint             frames_incomplete;
+    gint             frames_dropped;
+    VmbUint64_t      last_frame_id;
+    /* monotonic time of the last sdk callback, 0 before the first */
+    GstClockTime     last_callback_time;
+
+    /* set once the camera stopped answering, cleared by vimbacamera_start
+     * after vimbacamera_reopen, lost_time is when it was noticed */
+    gint             lost;
+    GstClockTime     lost_time;
 };
 
 VimbaCamera* vimbacamera_init();
 void         vimbacamera_destroy (VimbaCamera * camera);
 gboolean     vimbacamera_open (VimbaCamera * camera);
 gboolean     vimbacamera_close (VimbaCamera * camera);
+gboolean     vimbacamera_reopen (VimbaCamera * camera);
+void         vimbacamera_write_format (VimbaCamera * camera);
+gboolean     vimbacamera_mark_lost (VimbaCamera * camera);
+gboolean     vimbacamera_is_lost (VimbaCamera * camera);
+gboolean     vimbacamera_probe (VimbaCamera * camera);
 gboolean     vimbacamera_load (VimbaCamera * camera);
 gboolean     vimbacamera_start (VimbaCamera * camera);
 gboolean     vimbacamera_stop (VimbaCamera * camera);
 void         vimbacamera_capture (VimbaCamera * camera);
 VmbFrame_t * vimbacamera_consume_frame (VimbaCamera * camera);
-void         vimbacamera_queue_frame (VimbaCamera * camera, VmbFrame_t * frame);
+VmbFrame_t * vimbacamera_consume_frame_timeout (VimbaCamera * camera, guint64 timeout_us);
+gboolean     vimbacamera_queue_frame (VimbaCamera * camera, VmbFrame_t * frame);
+VimbaFrameRing * vimbacamera_hold_frame (VimbaCamera * camera, VmbFrame_t * frame);
+void         vimbacamera_release_frame (VimbaCamera * camera, VimbaFrameRing * ring, VmbFrame_t * frame);
+VimbaFrameRing * vimbacamera_ring_ref (VimbaFrameRing * ring);
+void         vimbacamera_ring_unref (VimbaFrameRing * ring);
+guint64      vimbacamera_frame_trigger_id (VimbaCamera * camera, VmbFrame_t * frame);
+guint64      vimbacamera_frame_device_time (VimbaCamera * camera, VmbFrame_t * frame);
+gboolean     vimbacamera_latch_device_time (VimbaCamera * camera, guint64 * time);
+GstClockTime vimbacamera_frame_callback_time (VimbaCamera * camera, VmbFrame_t * frame);
+gboolean     vimbacamera_software_trigger (VimbaCamera * camera);
+gboolean     vimbacamera_frame_chunk_data (VimbaCamera * camera, VmbFrame_t * frame, VimbaChunkData * chunk);
 void         vimbacamera_set_feature_int(VimbaCamera * camera, const char * name, int value);
 long long    vimbacamera_get_feature_int(VimbaCamera * camera, const char * name);
-void         vimbacamera_list_features(VimbaCamera * camera);
 
 #endif
@@ -0,0 +1,269 @@
+#include <string.h>
+#include "vimbaconfig.h"
+
+/* one dimension of the region of interest */
+typedef struct {
+    const char*  size_name;
+    const char*  offset_name;
+    const char*  max_name;
+    VmbInt64_t   size;
+    VmbInt64_t   offset;
+    VmbInt64_t   current_size;
+    VmbInt64_t   current_offset;
+} VimbaConfigAxis;
+
+/* a feature written by the transaction and the value to put back */
+typedef struct {
+    const char*  name;
+    GValue       old_value;
+} VimbaConfigUndo;
+
+static gboolean vimba_config_get_int (
+    VimbaCamera * camera, const char * name, VmbInt64_t * value
+) {
+    GValue read = G_VALUE_INIT;
+
+    if (!vimba_feature_get(camera->features, name, &read)) {
+        return FALSE;
+    }
+    *value = g_value_get_int64(&read);
+    g_value_unset(&read);
+    return TRUE;
+}
+
+/* the lower bound and step of an integer feature, its upper bound moves with
+ * the other dimension and is checked against the sensor size instead */
+static gboolean vimba_config_int_range (
+    VimbaCamera * camera, const char * name, VmbInt64_t * min, VmbInt64_t * inc
+) {
+    if (VmbErrorSuccess != VmbFeatureIntRangeQuery(camera->camera_handle,
+            name, min, NULL)) {
+        return FALSE;
+    }
+    if (VmbErrorSuccess != VmbFeatureIntIncrementQuery(camera->camera_handle,
+            name, inc) || *inc < 1) {
+        *inc = 1;
+    }
+    return TRUE;
+}
+
+/* pick and check the size and offset of one axis, nothing is written yet */
+static gboolean vimba_config_plan_axis (
+    VimbaCamera * camera, VimbaConfigAxis * axis, VmbInt64_t size,
+    VmbInt64_t offset, GError ** error
+) {
+    VmbInt64_t sensor, size_min, size_inc, offset_min = 0, offset_inc = 1;
+    gboolean has_offset;
+
+    if (!vimba_config_get_int(camera, axis->max_name, &sensor) ||
+        !vimba_config_get_int(camera, axis->size_name, &axis->current_size) ||
+        !vimba_config_int_range(camera, axis->size_name, &size_min, &size_inc)) {
+        g_set_error(error, GST_RESOURCE_ERROR, GST_RESOURCE_ERROR_READ,
+            "cannot read the range of %s on camera %s", axis->size_name,
+            camera->camera_id);
+        return FALSE;
+    }
+    if (size < size_min || size > sensor) {
+        g_set_error(error, GST_RESOURCE_ERROR, GST_RESOURCE_ERROR_SETTINGS,
+            "%s %" G_GINT64_FORMAT " is outside %" G_GINT64_FORMAT
+            "..%" G_GINT64_FORMAT " on camera %s", axis->size_name, size,
+            size_min, sensor, camera->camera_id);
+        return FALSE;
+    }
+    if ((size - size_min) % size_inc != 0) {
+        g_set_error(error, GST_RESOURCE_ERROR, GST_RESOURCE_ERROR_SETTINGS,
+            "%s %" G_GINT64_FORMAT " is not a step of %" G_GINT64_FORMAT
+            " from %" G_GINT64_FORMAT " on camera %s, nearest are %"
+            G_GINT64_FORMAT " and %" G_GINT64_FORMAT, axis->size_name, size,
+            size_inc, size_min, camera->camera_id,
+            size - (size - size_min) % size_inc,
+            size - (size - size_min) % size_inc + size_inc);
+        return FALSE;
+    }
+    axis->size = size;
+
+    /* cameras without a region of interest only have the full sensor */
+    has_offset = vimba_config_get_int(camera, axis->offset_name,
+        &axis->current_offset);
+    if (!has_offset) {
+        axis->current_offset = 0;
+        axis->offset = 0;
+        if (offset > 0) {
+            g_set_error(error, GST_RESOURCE_ERROR, GST_RESOURCE_ERROR_SETTINGS,
+                "camera %s has no %s", camera->camera_id, axis->offset_name);
+            return FALSE;
+        }
+        return TRUE;
+    }
+    vimba_config_int_range(camera, axis->offset_name, &offset_min, &offset_inc);
+    if (offset < 0) {
+        offset = axis->current_offset;
+        if (offset + size > sensor) {
+            /* the largest offset on the grid that keeps the region inside */
+            offset = offset_min +
+                (sensor - size - offset_min) / offset_inc * offset_inc;
+        }
+    }
+    if (offset < offset_min || offset + size > sensor ||
+        (offset - offset_min) % offset_inc != 0) {
+        g_set_error(error, GST_RESOURCE_ERROR, GST_RESOURCE_ERROR_SETTINGS,
+            "%s %" G_GINT64_FORMAT " with %s %" G_GINT64_FORMAT
+            " does not fit the %" G_GINT64_FORMAT " %s of camera %s in steps"
+            " of %" G_GINT64_FORMAT, axis->offset_name, offset,
+            axis->size_name, size, sensor, axis->max_name, camera->camera_id,
+            offset_inc);
+        return FALSE;
+    }
+    axis->offset = offset;
+    return TRUE;
+}
+
+/* write one feature and remember how to undo it */
+static gboolean vimba_config_write (
+    VimbaCamera * camera, GArray * undo, const char * name,
+    const GValue * value, GError ** error
+) {
+    VimbaConfigUndo entry = { name, G_VALUE_INIT };
+
+    if (!vimba_feature_get(camera->features, name, &entry.old_value)) {
+        g_set_error(error, GST_RESOURCE_ERROR, GST_RESOURCE_ERROR_READ,
+            "cannot read %s on camera %s", name, camera->camera_id);
+        return FALSE;
+    }
+    if (!vimba_feature_set(camera->features, name, value)) {
+        gchar * string = g_strdup_value_contents(value);
+        g_set_error(error, GST_RESOURCE_ERROR, GST_RESOURCE_ERROR_SETTINGS,
+            "camera %s rejected %s = %s", camera->camera_id, name, string);
+        g_free(string);
+        g_value_unset(&entry.old_value);
+        return FALSE;
+    }
+    g_array_append_val(undo, entry);
+    return TRUE;
+}
+
+static gboolean vimba_config_write_int (
+    VimbaCamera * camera, GArray * undo, const char * name, VmbInt64_t value,
+    GError ** error
+) {
+    GValue write = G_VALUE_INIT;
+    gboolean res;
+
+    g_value_init(&write, G_TYPE_INT64);
+    g_value_set_int64(&write, value);
+    res = vimba_config_write(camera, undo, name, &write, error);
+    g_value_unset(&write);
+    return res;
+}
+
+/* put back what was written, newest first, so each step is valid again */
+static void vimba_config_rollback (VimbaCamera * camera, GArray * undo) {
+    VimbaConfigUndo * entry;
+    guint i;
+
+    for (i = undo->len; i > 0; i--) {
+        entry = &g_array_index(undo, VimbaConfigUndo, i - 1);
+        if (!vimba_feature_set(camera->features, entry->name,
+                &entry->old_value)) {
+            GST_WARNING("camera %s: cannot restore %s", camera->camera_id,
+                entry->name);
+        }
+    }
+}
+
+static void vimba_config_undo_clear (gpointer data) {
+    g_value_unset(&((VimbaConfigUndo *) data)->old_value);
+}
+
+/*
+ * Move the camera to target, must be called with acquisition stopped and the
+ * camera lock held. On failure the camera keeps its previous configuration
+ * and error tells why.
+ */
+gboolean vimba_config_apply (
+    VimbaCamera * camera, const VimbaConfig * target,
+    VimbaConfigReport * report, GError ** error
+) {
+    VimbaConfigAxis axes[2] = {
+        { "Width", "OffsetX", "WidthMax", 0, 0, 0, 0 },
+        { "Height", "OffsetY", "HeightMax", 0, 0, 0, 0 }
+    };
+    GValue format = G_VALUE_INIT;
+    GArray * undo;
+    VmbBool_t available = VmbBoolFalse;
+    gboolean res = TRUE;
+    guint i;
+
+    memset(report, 0, sizeof(VimbaConfigReport));
+    if (!camera->open || camera->features == NULL) {
+        g_set_error(error, GST_RESOURCE_ERROR, GST_RESOURCE_ERROR_NOT_FOUND,
+            "no camera open");
+        return FALSE;
+    }
+    undo = g_array_new(FALSE, FALSE, sizeof(VimbaConfigUndo));
+    g_array_set_clear_func(undo, vimba_config_undo_clear);
+
+    /* the format goes first, the size ranges may depend on it */
+    if (target->format != NULL) {
+        if (VmbErrorSuccess != VmbFeatureEnumIsAvailable(camera->camera_handle,
+                "PixelFormat", target->format, &available) || !available) {
+            g_set_error(error, GST_RESOURCE_ERROR, GST_RESOURCE_ERROR_SETTINGS,
+                "camera %s cannot deliver PixelFormat %s", camera->camera_id,
+                target->format);
+            res = FALSE;
+        } else if (vimba_feature_get(camera->features, "PixelFormat", &format)) {
+            if (g_strcmp0(g_value_get_string(&format), target->format) != 0) {
+                g_value_set_string(&format, target->format);
+                res = vimba_config_write(camera, undo, "PixelFormat", &format,
+                    error);
+            }
+            g_value_unset(&format);
+        } else {
+            g_set_error(error, GST_RESOURCE_ERROR, GST_RESOURCE_ERROR_READ,
+                "cannot read PixelFormat on camera %s", camera->camera_id);
+            res = FALSE;
+        }
+    }
+
+    res = res &&
+        vimba_config_plan_axis(camera, &axes[0], target->width,
+            target->offset_x, error) &&
+        vimba_config_plan_axis(camera, &axes[1], target->height,
+            target->offset_y, error);
+
+    /* offsets that shrink make room for larger sizes */
+    for (i = 0; res && i < G_N_ELEMENTS(axes); i++) {
+        if (axes[i].offset < axes[i].current_offset) {
+            res = vimba_config_write_int(camera, undo, axes[i].offset_name,
+                axes[i].offset, error);
+        }
+    }
+    for (i = 0; res && i < G_N_ELEMENTS(axes); i++) {
+        if (axes[i].size != axes[i].current_size) {
+            res = vimba_config_write_int(camera, undo, axes[i].size_name,
+                axes[i].size, error);
+        }
+    }
+    /* and offsets that grow need the smaller sizes in place */
+    for (i = 0; res && i < G_N_ELEMENTS(axes); i++) {
+        if (axes[i].offset > axes[i].current_offset) {
+            res = vimba_config_write_int(camera, undo, axes[i].offset_name,
+                axes[i].offset, error);
+        }
+    }
+
+    report->writes = undo->len;
+    if (!res && undo->len > 0) {
+        vimba_config_rollback(camera, undo);
+        report->rolled_back = TRUE;
+    }
+    if (res) {
+        GST_DEBUG("camera %s configured to %s %" G_GINT64_FORMAT "x%"
+            G_GINT64_FORMAT "+%" G_GINT64_FORMAT "+%" G_GINT64_FORMAT
+            " in %u writes", camera->camera_id, GST_STR_NULL(target->format),
+            axes[0].size, axes[1].size, axes[0].offset, axes[1].offset,
+            report->writes);
+    }
+    g_array_free(undo, TRUE);
+    return res;
+}
@@ -0,0 +1,36 @@
+#ifndef _VIMBASRC_CONFIG_H_
+#define _VIMBASRC_CONFIG_H_
+
+#include <gst/gst.h>
+#include "vimbacamera.h"
+
+/*
+ * Moves the camera to a negotiated format and region of interest as one
+ * transaction. The target is checked against the ranges and increments the
+ * camera reports before anything is written, features that already have
+ * their value are left alone, and the writes are ordered so no intermediate
+ * state is out of range: offsets that shrink, then sizes, then offsets that
+ * grow. When the camera still rejects a write, everything written so far is
+ * put back and the error says which feature and value failed.
+ */
+
+typedef struct {
+    VmbInt64_t   width;
+    VmbInt64_t   height;
+    /* < 0 keeps the current offset, or the nearest one that still fits */
+    VmbInt64_t   offset_x;
+    VmbInt64_t   offset_y;
+    /* a vimba PixelFormat, NULL keeps the current one */
+    const char*  format;
+} VimbaConfig;
+
+/* what the last transaction did */
+typedef struct {
+    guint        writes;
+    gboolean     rolled_back;
+} VimbaConfigReport;
+
+gboolean vimba_config_apply (VimbaCamera * camera, const VimbaConfig * target,
+             VimbaConfigReport * report, GError ** error);
+
+#endif
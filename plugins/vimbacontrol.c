@@ -0,0 +1,299 @@
+#include "vimbacontrol.h"
+#include "vimbafeature.h"
+
+/* how long writes wait for a lost camera before looking again */
+#define CONTROL_LOST_POLL_US 50000
+
+typedef struct {
+    gchar*        name;
+    GValue        value;
+    guint64       generation;
+    GstClockTime  queued;
+} VimbaControlWrite;
+
+/* an acknowledged write, waiting for the first frame after it */
+typedef struct {
+    gchar*        name;
+    guint64       generation;
+    /* camera time latched after the write, 0 if the camera has no latch */
+    guint64       device_time;
+    /* monotonic time the write returned */
+    GstClockTime  host_time;
+} VimbaControlApplied;
+
+struct _VimbaControl {
+    VimbaCamera*        camera;
+    VimbaControlNotify  notify;
+    gpointer            user_data;
+
+    GThread*            thread;
+    GMutex              lock;
+    GCond               cond;
+    gboolean            running;
+    GQueue              pending;
+    GQueue              applied;
+    /* last value written of every feature, written again by restore */
+    GstStructure*       state;
+    guint64             generation;
+    /* generation the frames pushed so far carry */
+    guint64             frame_generation;
+
+    guint64             queued_count;
+    guint64             applied_count;
+    guint64             failed_count;
+    GstClockTime        max_latency;
+};
+
+static void vimba_control_write_free (VimbaControlWrite * write) {
+    g_free(write->name);
+    g_value_unset(&write->value);
+    g_slice_free(VimbaControlWrite, write);
+}
+
+static void vimba_control_applied_free (VimbaControlApplied * applied) {
+    g_free(applied->name);
+    g_slice_free(VimbaControlApplied, applied);
+}
+
+/*
+ * Write one feature, with the camera kept open meanwhile. Only the handle
+ * lock is held, so set_caps and get_caps do not wait for the control
+ * channel, only a close or reopen of the camera does.
+ */
+static void vimba_control_apply (VimbaControl * control, VimbaControlWrite * write) {
+    VimbaCamera * camera = control->camera;
+    VimbaControlApplied * applied;
+    GstClockTime latency;
+    guint64 device_time = 0;
+    gboolean ok;
+
+    g_rw_lock_reader_lock(&camera->handle_lock);
+    ok = camera->open &&
+        vimba_feature_set(camera->features, write->name, &write->value);
+    if (ok && !vimbacamera_latch_device_time(camera, &device_time)) {
+        device_time = 0;
+    }
+    g_rw_lock_reader_unlock(&camera->handle_lock);
+    latency = gst_util_get_timestamp() - write->queued;
+
+    g_mutex_lock(&control->lock);
+    if (ok) {
+        applied = g_slice_new0(VimbaControlApplied);
+        applied->name = g_strdup(write->name);
+        applied->generation = write->generation;
+        applied->device_time = device_time;
+        applied->host_time = gst_util_get_timestamp();
+        g_queue_push_tail(&control->applied, applied);
+        gst_structure_set_value(control->state, write->name, &write->value);
+        control->applied_count++;
+    } else {
+        control->failed_count++;
+    }
+    control->max_latency = MAX(control->max_latency, latency);
+    g_mutex_unlock(&control->lock);
+
+    if (control->notify != NULL) {
+        control->notify(write->name, write->generation, ok, control->user_data);
+    }
+}
+
+static gpointer vimba_control_thread (gpointer data) {
+    VimbaControl * control = data;
+    VimbaControlWrite * write;
+
+    g_mutex_lock(&control->lock);
+    while (control->running) {
+        /* writes to a lost camera wait until it is back */
+        if (vimbacamera_is_lost(control->camera)) {
+            g_cond_wait_until(&control->cond, &control->lock,
+                g_get_monotonic_time() + CONTROL_LOST_POLL_US);
+            continue;
+        }
+        write = g_queue_pop_head(&control->pending);
+        if (write == NULL) {
+            g_cond_wait(&control->cond, &control->lock);
+            continue;
+        }
+        g_mutex_unlock(&control->lock);
+        vimba_control_apply(control, write);
+        vimba_control_write_free(write);
+        g_mutex_lock(&control->lock);
+    }
+    g_mutex_unlock(&control->lock);
+    return NULL;
+}
+
+VimbaControl * vimba_control_new (
+    VimbaCamera * camera,
+    VimbaControlNotify notify, gpointer user_data
+) {
+    VimbaControl * control = g_new0(VimbaControl, 1);
+
+    control->camera = camera;
+    control->notify = notify;
+    control->user_data = user_data;
+    g_mutex_init(&control->lock);
+    g_cond_init(&control->cond);
+    g_queue_init(&control->pending);
+    g_queue_init(&control->applied);
+    control->state = gst_structure_new_empty("features");
+    control->running = TRUE;
+    control->thread = g_thread_new("vimbacontrol", vimba_control_thread, control);
+    return control;
+}
+
+/* pending writes are dropped, one in flight completes */
+void vimba_control_free (VimbaControl * control) {
+    if (control == NULL) {
+        return;
+    }
+    g_mutex_lock(&control->lock);
+    control->running = FALSE;
+    g_cond_signal(&control->cond);
+    g_mutex_unlock(&control->lock);
+    g_thread_join(control->thread);
+
+    g_queue_foreach(&control->pending, (GFunc) vimba_control_write_free, NULL);
+    g_queue_clear(&control->pending);
+    g_queue_foreach(&control->applied, (GFunc) vimba_control_applied_free, NULL);
+    g_queue_clear(&control->applied);
+    gst_structure_free(control->state);
+    g_cond_clear(&control->cond);
+    g_mutex_clear(&control->lock);
+    g_free(control);
+}
+
+static gint vimba_control_write_compare (gconstpointer a, gconstpointer b) {
+    return g_strcmp0(((const VimbaControlWrite *) a)->name, b);
+}
+
+/* returns the generation frames carry once the write is in effect */
+guint64 vimba_control_queue (
+    VimbaControl * control, const gchar * name, const GValue * value
+) {
+    VimbaControlWrite * write = g_slice_new0(VimbaControlWrite);
+    GList * superseded;
+    guint64 generation;
+
+    write->name = g_strdup(name);
+    g_value_init(&write->value, G_VALUE_TYPE(value));
+    g_value_copy(value, &write->value);
+    write->queued = gst_util_get_timestamp();
+
+    g_mutex_lock(&control->lock);
+    superseded = g_queue_find_custom(&control->pending, name,
+        vimba_control_write_compare);
+    if (superseded != NULL) {
+        vimba_control_write_free(superseded->data);
+        g_queue_delete_link(&control->pending, superseded);
+    }
+    generation = write->generation = ++control->generation;
+    g_queue_push_tail(&control->pending, write);
+    control->queued_count++;
+    g_cond_signal(&control->cond);
+    g_mutex_unlock(&control->lock);
+    return generation;
+}
+
+guint64 vimba_control_generation (VimbaControl * control) {
+    guint64 generation;
+
+    g_mutex_lock(&control->lock);
+    generation = control->generation;
+    g_mutex_unlock(&control->lock);
+    return generation;
+}
+
+/*
+ * Generation of the writes in effect for a frame, called for frames in the
+ * order they are pushed. When the frame is the first to carry some writes,
+ * their feature names are returned in applied, comma separated.
+ */
+guint64 vimba_control_frame_generation (
+    VimbaControl * control, VimbaCamera * camera, VmbFrame_t * frame,
+    gchar ** applied
+) {
+    guint64 device_time = vimbacamera_frame_device_time(camera, frame);
+    GstClockTime callback_time = vimbacamera_frame_callback_time(camera, frame);
+    GstClockTime period = camera->framerate > 0
+        ? (GstClockTime) (GST_SECOND / camera->framerate) : 0;
+    VimbaControlApplied * head;
+    GString * names = NULL;
+    guint64 generation;
+
+    g_mutex_lock(&control->lock);
+    while ((head = g_queue_peek_head(&control->applied)) != NULL) {
+        /* without a latch, a frame whose callback came a full period
+         * after the write was certainly exposed after it */
+        gboolean after = head->device_time > 0
+            ? device_time > head->device_time
+            : callback_time > head->host_time + period;
+        if (!after) {
+            break;
+        }
+        g_queue_pop_head(&control->applied);
+        control->frame_generation = MAX(control->frame_generation,
+            head->generation);
+        if (applied != NULL) {
+            if (names == NULL) {
+                names = g_string_new(head->name);
+            } else {
+                g_string_append_printf(names, ",%s", head->name);
+            }
+        }
+        vimba_control_applied_free(head);
+    }
+    generation = control->frame_generation;
+    g_mutex_unlock(&control->lock);
+
+    if (applied != NULL) {
+        *applied = names != NULL ? g_string_free(names, FALSE) : NULL;
+    }
+    return generation;
+}
+
+static gboolean vimba_control_restore_feature (
+    GQuark field_id, const GValue * value, gpointer user_data
+) {
+    VimbaControl * control = user_data;
+    const gchar * name = g_quark_to_string(field_id);
+
+    if (!vimba_feature_set(control->camera->features, name, value)) {
+        GST_WARNING("camera rejected feature %s on restore", name);
+    }
+    return TRUE;
+}
+
+/*
+ * Write the last value of every feature written so far again, in the order
+ * they were first written, to a camera that was reopened. Must be called
+ * with the camera lock held.
+ */
+void vimba_control_restore (VimbaControl * control) {
+    GstStructure * state;
+
+    g_mutex_lock(&control->lock);
+    state = gst_structure_copy(control->state);
+    g_mutex_unlock(&control->lock);
+    gst_structure_foreach(state, vimba_control_restore_feature, control);
+    gst_structure_free(state);
+}
+
+/* drop the value restore would write again */
+void vimba_control_forget (VimbaControl * control, const gchar * name) {
+    g_mutex_lock(&control->lock);
+    gst_structure_remove_field(control->state, name);
+    g_mutex_unlock(&control->lock);
+}
+
+void vimba_control_stats (
+    VimbaControl * control, guint64 * queued, guint64 * applied,
+    guint64 * failed, GstClockTime * max_latency
+) {
+    g_mutex_lock(&control->lock);
+    *queued = control->queued_count;
+    *applied = control->applied_count;
+    *failed = control->failed_count;
+    *max_latency = control->max_latency;
+    g_mutex_unlock(&control->lock);
+}
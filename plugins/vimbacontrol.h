@@ -0,0 +1,38 @@
+#ifndef _VIMBASRC_CONTROL_H_
+#define _VIMBASRC_CONTROL_H_
+
+#include <gst/gst.h>
+#include "vimbacamera.h"
+
+/*
+ * Feature writes off the streaming thread. Writes are queued, each with a
+ * new generation number, and applied in order by a control thread, so a
+ * control channel round trip never stalls streaming. A pending write of a
+ * feature is replaced by a newer one. Once the camera acknowledged a write,
+ * its time on the camera clock is latched, and the first frame timestamped
+ * after it is the first to carry the write's generation. Writes to a lost
+ * camera wait until it is back, and the last value of every feature is
+ * kept to be written again when the camera is reopened. Writes hold only
+ * the handle lock of the camera, not the element's camera lock, so caps
+ * negotiation on the streaming thread never waits for one.
+ */
+
+typedef struct _VimbaControl VimbaControl;
+
+/* called from the control thread after every write */
+typedef void (*VimbaControlNotify) (const gchar * name, guint64 generation,
+    gboolean ok, gpointer user_data);
+
+VimbaControl * vimba_control_new (VimbaCamera * camera,
+                 VimbaControlNotify notify, gpointer user_data);
+void     vimba_control_free (VimbaControl * control);
+guint64  vimba_control_queue (VimbaControl * control, const gchar * name, const GValue * value);
+guint64  vimba_control_generation (VimbaControl * control);
+void     vimba_control_restore (VimbaControl * control);
+void     vimba_control_forget (VimbaControl * control, const gchar * name);
+guint64  vimba_control_frame_generation (VimbaControl * control, VimbaCamera * camera,
+             VmbFrame_t * frame, gchar ** applied);
+void     vimba_control_stats (VimbaControl * control, guint64 * queued,
+             guint64 * applied, guint64 * failed, GstClockTime * max_latency);
+
+#endif
@@ -0,0 +1,416 @@
+#include <string.h>
+#include "vimbacorrect.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#define CORRECTION_MAGIC    "VIMBACAL"
+#define CORRECTION_VERSION  1
+/* 8.8 fixed point gains the flat field may ask for */
+#define CORRECTION_GAIN_ONE 256
+#define CORRECTION_GAIN_MIN (CORRECTION_GAIN_ONE / 4)
+#define CORRECTION_GAIN_MAX (CORRECTION_GAIN_ONE * 16 - 1)
+/* a pixel this far above the mean dark level is hot */
+#define CORRECTION_HOT_LEVEL 24
+/* a pixel off by more than this factor from its color's flat response is
+ * dead or stuck */
+#define CORRECTION_DEAD_FACTOR 2
+
+/* the header of a stored calibration, followed by the dark map, the gain
+ * map and the defect list, all little endian */
+typedef struct {
+    gchar         magic[8];
+    guint32       version;
+    guint32       width;
+    guint32       height;
+    guint32       offset_x;
+    guint32       offset_y;
+    gchar         format[32];
+    guint32       defect_count;
+} VimbaCorrectionHeader;
+
+gboolean vimba_correction_supported (const gchar * format) {
+    return format != NULL && (strcmp(format, "Mono8") == 0 ||
+        (g_str_has_prefix(format, "Bayer") && g_str_has_suffix(format, "8")));
+}
+
+static VimbaCorrection * vimba_correction_new (
+    gint width, gint height, gint offset_x, gint offset_y, const gchar * format
+) {
+    VimbaCorrection * correction = g_new0(VimbaCorrection, 1);
+
+    correction->width = width;
+    correction->height = height;
+    correction->offset_x = offset_x;
+    correction->offset_y = offset_y;
+    correction->format = g_strdup(format);
+    correction->bayer = g_str_has_prefix(format, "Bayer");
+    correction->dark = g_new0(guint8, (gsize) width * height);
+    correction->gain = g_new(guint16, (gsize) width * height);
+    return correction;
+}
+
+void vimba_correction_free (VimbaCorrection * correction) {
+    if (correction == NULL) {
+        return;
+    }
+    g_free(correction->format);
+    g_free(correction->dark);
+    g_free(correction->gain);
+    g_free(correction->defects);
+    g_free(correction);
+}
+
+/*
+ * Load the maps stored at path for a region of the sensor, which has to lie
+ * inside the region they were captured at, in the same format. For Bayer
+ * formats the region has to start on the same color.
+ */
+VimbaCorrection * vimba_correction_load (
+    const gchar * path, gint width, gint height, gint offset_x, gint offset_y,
+    const gchar * format, GError ** error
+) {
+    VimbaCorrectionHeader header;
+    VimbaCorrection * correction;
+    gchar * contents;
+    gsize length, pixels, i;
+    const guint8 * dark;
+    const guint16 * gain;
+    const guint32 * defects;
+    gint dx, dy, y, x;
+    guint count = 0;
+
+    if (!g_file_get_contents(path, &contents, &length, error)) {
+        return NULL;
+    }
+    if (length < sizeof(header)) {
+        goto corrupt;
+    }
+    memcpy(&header, contents, sizeof(header));
+    header.format[sizeof(header.format) - 1] = '\0';
+    if (memcmp(header.magic, CORRECTION_MAGIC, sizeof(header.magic)) != 0 ||
+        GUINT32_FROM_LE(header.version) != CORRECTION_VERSION) {
+        goto corrupt;
+    }
+    header.width = GUINT32_FROM_LE(header.width);
+    header.height = GUINT32_FROM_LE(header.height);
+    header.offset_x = GUINT32_FROM_LE(header.offset_x);
+    header.offset_y = GUINT32_FROM_LE(header.offset_y);
+    header.defect_count = GUINT32_FROM_LE(header.defect_count);
+    pixels = (gsize) header.width * header.height;
+    if (length != sizeof(header) + pixels * 3 +
+            (gsize) header.defect_count * sizeof(guint32)) {
+        goto corrupt;
+    }
+
+    dx = offset_x - (gint) header.offset_x;
+    dy = offset_y - (gint) header.offset_y;
+    if (g_strcmp0(header.format, format) != 0 || dx < 0 || dy < 0 ||
+        dx + width > (gint) header.width || dy + height > (gint) header.height ||
+        (g_str_has_prefix(format, "Bayer") && (dx % 2 != 0 || dy % 2 != 0))) {
+        g_set_error(error, GST_RESOURCE_ERROR, GST_RESOURCE_ERROR_SETTINGS,
+            "%s is calibrated for %ux%u+%u+%u %s, not %dx%d+%d+%d %s", path,
+            header.width, header.height, header.offset_x, header.offset_y,
+            header.format, width, height, offset_x, offset_y, format);
+        g_free(contents);
+        return NULL;
+    }
+
+    /* crop the maps to the region */
+    correction = vimba_correction_new(width, height, offset_x, offset_y, format);
+    dark = (const guint8 *) (contents + sizeof(header));
+    gain = (const guint16 *) (contents + sizeof(header) + pixels);
+    defects = (const guint32 *) (contents + sizeof(header) + pixels * 3);
+    for (y = 0; y < height; y++) {
+        gsize src = (gsize) (y + dy) * header.width + dx;
+        gsize dst = (gsize) y * width;
+
+        memcpy(correction->dark + dst, dark + src, width);
+        for (x = 0; x < width; x++) {
+            guint16 g;
+            memcpy(&g, gain + src + x, sizeof(g));
+            correction->gain[dst + x] = GUINT16_FROM_LE(g);
+        }
+    }
+    correction->defects = g_new(guint32, MAX(header.defect_count, 1));
+    for (i = 0; i < header.defect_count; i++) {
+        guint32 d;
+        memcpy(&d, defects + i, sizeof(d));
+        d = GUINT32_FROM_LE(d);
+        x = (gint) (d % header.width) - dx;
+        y = (gint) (d / header.width) - dy;
+        if (x >= 0 && x < width && y >= 0 && y < height) {
+            correction->defects[count++] = (guint32) y * width + x;
+        }
+    }
+    correction->defect_count = count;
+    g_free(contents);
+    return correction;
+
+corrupt:
+    g_set_error(error, GST_RESOURCE_ERROR, GST_RESOURCE_ERROR_READ,
+        "%s is not a camera calibration", path);
+    g_free(contents);
+    return NULL;
+}
+
+gboolean vimba_correction_save (
+    VimbaCorrection * correction, const gchar * path, GError ** error
+) {
+    VimbaCorrectionHeader header;
+    gsize pixels = (gsize) correction->width * correction->height, i;
+    GByteArray * data;
+    gchar * directory;
+    gboolean res;
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, CORRECTION_MAGIC, sizeof(header.magic));
+    header.version = GUINT32_TO_LE(CORRECTION_VERSION);
+    header.width = GUINT32_TO_LE(correction->width);
+    header.height = GUINT32_TO_LE(correction->height);
+    header.offset_x = GUINT32_TO_LE(correction->offset_x);
+    header.offset_y = GUINT32_TO_LE(correction->offset_y);
+    g_strlcpy(header.format, correction->format, sizeof(header.format));
+    header.defect_count = GUINT32_TO_LE(correction->defect_count);
+
+    data = g_byte_array_sized_new(sizeof(header) + pixels * 3 +
+        correction->defect_count * sizeof(guint32));
+    g_byte_array_append(data, (const guint8 *) &header, sizeof(header));
+    g_byte_array_append(data, correction->dark, pixels);
+    for (i = 0; i < pixels; i++) {
+        guint16 g = GUINT16_TO_LE(correction->gain[i]);
+        g_byte_array_append(data, (const guint8 *) &g, sizeof(g));
+    }
+    for (i = 0; i < correction->defect_count; i++) {
+        guint32 d = GUINT32_TO_LE(correction->defects[i]);
+        g_byte_array_append(data, (const guint8 *) &d, sizeof(d));
+    }
+
+    directory = g_path_get_dirname(path);
+    g_mkdir_with_parents(directory, 0755);
+    g_free(directory);
+    res = g_file_set_contents(path, (const gchar *) data->data, data->len,
+        error);
+    g_byte_array_unref(data);
+    return res;
+}
+
+#ifdef __SSE2__
+/* (v * gain + 128) >> 8 of eight 16 bit lanes, from the full 32 bit
+ * products; results above 32767 saturate, packus clamps them to 255 */
+static inline __m128i vimba_correction_scale (
+    __m128i v, __m128i gain, __m128i half
+) {
+    __m128i lo = _mm_mullo_epi16(v, gain);
+    __m128i hi = _mm_mulhi_epu16(v, gain);
+    __m128i p0 = _mm_srli_epi32(_mm_add_epi32(_mm_unpacklo_epi16(lo, hi), half), 8);
+    __m128i p1 = _mm_srli_epi32(_mm_add_epi32(_mm_unpackhi_epi16(lo, hi), half), 8);
+
+    return _mm_packs_epi32(p0, p1);
+}
+#endif
+
+/* subtract the dark level and scale by the gain, rounding to nearest */
+static void vimba_correction_flat (
+    const guint8 * dark, const guint16 * gain, guint8 * pixels, gsize n
+) {
+    gsize x = 0;
+
+#ifdef __SSE2__
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i half = _mm_set1_epi32(0x80);
+
+    for (; x + 16 <= n; x += 16) {
+        __m128i v = _mm_subs_epu8(
+            _mm_loadu_si128((const __m128i *) (pixels + x)),
+            _mm_loadu_si128((const __m128i *) (dark + x)));
+        __m128i lo = vimba_correction_scale(_mm_unpacklo_epi8(v, zero),
+            _mm_loadu_si128((const __m128i *) (gain + x)), half);
+        __m128i hi = vimba_correction_scale(_mm_unpackhi_epi8(v, zero),
+            _mm_loadu_si128((const __m128i *) (gain + x + 8)), half);
+        _mm_storeu_si128((__m128i *) (pixels + x), _mm_packus_epi16(lo, hi));
+    }
+#endif
+    /* rounds like the vector part */
+    for (; x < n; x++) {
+        guint v = pixels[x] > dark[x] ? pixels[x] - dark[x] : 0;
+        guint r = (v * gain[x] + 0x80) >> 8;
+        pixels[x] = MIN(r, 255);
+    }
+}
+
+void vimba_correction_apply (VimbaCorrection * correction, guint8 * frame) {
+    const gint distance = correction->bayer ? 2 : 1;
+    guint i;
+
+    vimba_correction_flat(correction->dark, correction->gain, frame,
+        (gsize) correction->width * correction->height);
+    for (i = 0; i < correction->defect_count; i++) {
+        guint32 pixel = correction->defects[i];
+        gint x = pixel % correction->width;
+        guint sum = 0, count = 0;
+
+        if (x >= distance) {
+            sum += frame[pixel - distance];
+            count++;
+        }
+        if (x + distance < correction->width) {
+            sum += frame[pixel + distance];
+            count++;
+        }
+        if (count > 0) {
+            frame[pixel] = (sum + count / 2) / count;
+        }
+    }
+}
+
+VimbaCalibration * vimba_calibration_new (
+    gint width, gint height, gint offset_x, gint offset_y, const gchar * format
+) {
+    VimbaCalibration * calibration = g_new0(VimbaCalibration, 1);
+
+    calibration->width = width;
+    calibration->height = height;
+    calibration->offset_x = offset_x;
+    calibration->offset_y = offset_y;
+    calibration->format = g_strdup(format);
+    calibration->bayer = g_str_has_prefix(format, "Bayer");
+    return calibration;
+}
+
+void vimba_calibration_free (VimbaCalibration * calibration) {
+    if (calibration == NULL) {
+        return;
+    }
+    g_free(calibration->format);
+    g_free(calibration->dark_sum);
+    g_free(calibration->flat_sum);
+    g_free(calibration);
+}
+
+/* start averaging frames of one kind, replacing an earlier capture of it */
+void vimba_calibration_begin (
+    VimbaCalibration * calibration, VimbaCalibrationKind kind, guint frames
+) {
+    gsize pixels = (gsize) calibration->width * calibration->height;
+
+    calibration->kind = kind;
+    calibration->remaining = frames;
+    if (kind == VIMBA_CALIBRATION_DARK) {
+        g_free(calibration->dark_sum);
+        calibration->dark_sum = g_new0(guint32, pixels);
+        calibration->dark_frames = 0;
+    } else {
+        g_free(calibration->flat_sum);
+        calibration->flat_sum = g_new0(guint32, pixels);
+        calibration->flat_frames = 0;
+    }
+}
+
+/* TRUE once the capture begun last is complete */
+gboolean vimba_calibration_add (
+    VimbaCalibration * calibration, const guint8 * frame
+) {
+    gsize pixels = (gsize) calibration->width * calibration->height, i;
+    guint32 * sum;
+
+    if (calibration->remaining == 0) {
+        return FALSE;
+    }
+    if (calibration->kind == VIMBA_CALIBRATION_DARK) {
+        sum = calibration->dark_sum;
+        calibration->dark_frames++;
+    } else {
+        sum = calibration->flat_sum;
+        calibration->flat_frames++;
+    }
+    for (i = 0; i < pixels; i++) {
+        sum[i] += frame[i];
+    }
+    return --calibration->remaining == 0;
+}
+
+/* color of a pixel, the position in its quad for Bayer formats */
+static guint vimba_calibration_color (
+    VimbaCalibration * calibration, gsize pixel
+) {
+    if (!calibration->bayer) {
+        return 0;
+    }
+    return (pixel / calibration->width % 2) * 2 + pixel % calibration->width % 2;
+}
+
+/*
+ * Maps from what was captured so far: without dark frames the dark level is
+ * 0, without flat frames every gain is 1. Hot pixels are found in the dark
+ * frames, dead and stuck ones in the flat frames.
+ */
+VimbaCorrection * vimba_calibration_finish (VimbaCalibration * calibration) {
+    gsize pixels = (gsize) calibration->width * calibration->height, i;
+    VimbaCorrection * correction;
+    guint64 dark_total = 0;
+    guint64 flat_total[4] = { 0, 0, 0, 0 };
+    guint64 flat_count[4] = { 0, 0, 0, 0 };
+    gdouble flat_mean[4];
+    guint dark_mean = 0, c;
+    GArray * defects;
+
+    correction = vimba_correction_new(calibration->width, calibration->height,
+        calibration->offset_x, calibration->offset_y, calibration->format);
+    defects = g_array_new(FALSE, FALSE, sizeof(guint32));
+
+    if (calibration->dark_frames > 0) {
+        for (i = 0; i < pixels; i++) {
+            correction->dark[i] = (calibration->dark_sum[i] +
+                calibration->dark_frames / 2) / calibration->dark_frames;
+            dark_total += correction->dark[i];
+        }
+        dark_mean = dark_total / pixels;
+    }
+    for (i = 0; i < pixels; i++) {
+        correction->gain[i] = CORRECTION_GAIN_ONE;
+    }
+    if (calibration->flat_frames > 0) {
+        /* the flat response of every pixel is stored in gain until the
+         * means of all colors are known */
+        for (i = 0; i < pixels; i++) {
+            guint flat = (calibration->flat_sum[i] +
+                calibration->flat_frames / 2) / calibration->flat_frames;
+
+            flat = flat > correction->dark[i] ? flat - correction->dark[i] : 0;
+            correction->gain[i] = flat;
+            c = vimba_calibration_color(calibration, i);
+            flat_total[c] += flat;
+            flat_count[c]++;
+        }
+        for (c = 0; c < 4; c++) {
+            flat_mean[c] = flat_count[c] > 0
+                ? (gdouble) flat_total[c] / flat_count[c] : 0;
+        }
+    }
+    for (i = 0; i < pixels; i++) {
+        gboolean defect = calibration->dark_frames > 0 &&
+            correction->dark[i] > dark_mean + CORRECTION_HOT_LEVEL;
+
+        if (calibration->flat_frames > 0) {
+            gdouble mean = flat_mean[vimba_calibration_color(calibration, i)];
+            guint flat = correction->gain[i];
+            gdouble gain = flat > 0
+                ? mean * CORRECTION_GAIN_ONE / flat : CORRECTION_GAIN_MAX;
+
+            defect = defect || flat * CORRECTION_DEAD_FACTOR < mean ||
+                flat > mean * CORRECTION_DEAD_FACTOR;
+            correction->gain[i] = (guint16) CLAMP(gain + 0.5,
+                CORRECTION_GAIN_MIN, CORRECTION_GAIN_MAX);
+        }
+        if (defect) {
+            guint32 pixel = i;
+            g_array_append_val(defects, pixel);
+        }
+    }
+
+    correction->defect_count = defects->len;
+    correction->defects = (guint32 *) g_array_free(defects, FALSE);
+    return correction;
+}
@@ -0,0 +1,71 @@
+#ifndef _VIMBASRC_CORRECT_H_
+#define _VIMBASRC_CORRECT_H_
+
+#include <gst/gst.h>
+
+/*
+ * Flat-field and defect pixel correction of 8 bit gray and Bayer frames,
+ * applied in place on the frame before it is handed on. Every pixel has the
+ * dark level subtracted and is scaled by its gain in 8.8 fixed point, then
+ * defect pixels are replaced by the mean of their nearest neighbors of the
+ * same color in the row. The maps come from the mean of captured dark frames
+ * (lens covered) and flat frames (uniformly lit), and are stored per camera
+ * with the region they were captured at, so any region inside it can use
+ * them.
+ */
+
+typedef enum {
+    VIMBA_CALIBRATION_DARK,
+    VIMBA_CALIBRATION_FLAT
+} VimbaCalibrationKind;
+
+typedef struct {
+    /* the sensor region the maps cover */
+    gint          width;
+    gint          height;
+    gint          offset_x;
+    gint          offset_y;
+    gchar*        format;
+    gboolean      bayer;
+
+    guint8*       dark;
+    /* 8.8 fixed point */
+    guint16*      gain;
+    guint32*      defects;
+    guint         defect_count;
+} VimbaCorrection;
+
+/* frames averaged into calibration maps */
+typedef struct {
+    gint          width;
+    gint          height;
+    gint          offset_x;
+    gint          offset_y;
+    gchar*        format;
+    gboolean      bayer;
+
+    VimbaCalibrationKind kind;
+    guint         remaining;
+    guint32*      dark_sum;
+    guint         dark_frames;
+    guint32*      flat_sum;
+    guint         flat_frames;
+} VimbaCalibration;
+
+gboolean          vimba_correction_supported (const gchar * format);
+VimbaCorrection * vimba_correction_load (const gchar * path, gint width, gint height,
+                      gint offset_x, gint offset_y, const gchar * format, GError ** error);
+gboolean          vimba_correction_save (VimbaCorrection * correction, const gchar * path,
+                      GError ** error);
+void              vimba_correction_free (VimbaCorrection * correction);
+void              vimba_correction_apply (VimbaCorrection * correction, guint8 * frame);
+
+VimbaCalibration * vimba_calibration_new (gint width, gint height, gint offset_x,
+                       gint offset_y, const gchar * format);
+void              vimba_calibration_free (VimbaCalibration * calibration);
+void              vimba_calibration_begin (VimbaCalibration * calibration,
+                      VimbaCalibrationKind kind, guint frames);
+gboolean          vimba_calibration_add (VimbaCalibration * calibration, const guint8 * frame);
+VimbaCorrection * vimba_calibration_finish (VimbaCalibration * calibration);
+
+#endif
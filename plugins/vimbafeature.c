@@ -0,0 +1,423 @@
+#include <stdlib.h>
+#include <string.h>
+#include "vimbafeature.h"
+
+#define FEATURE_STRING_SIZE 1024
+
+typedef struct {
+    gchar*            name;
+    VmbFeatureData_t  type;
+    GValue            value;
+    gboolean          valid;
+    /* bumped on every invalidation, a read racing with one is not cached */
+    guint             generation;
+    gboolean          registered;
+} VimbaFeatureEntry;
+
+struct _VimbaFeatureCache {
+    VmbHandle_t  handle;
+    GMutex       lock;
+    GHashTable*  entries;
+    guint64      hits;
+    guint64      misses;
+};
+
+/* drop the cached value of one feature, the next get reads it again */
+void vimba_feature_invalidate (VimbaFeatureCache * cache, const char * name) {
+    VimbaFeatureEntry * entry;
+
+    g_mutex_lock(&cache->lock);
+    entry = g_hash_table_lookup(cache->entries, name);
+    if (entry != NULL) {
+        entry->valid = FALSE;
+        entry->generation++;
+    }
+    g_mutex_unlock(&cache->lock);
+}
+
+static void VMB_CALL vimba_feature_invalidated (
+    const VmbHandle_t handle, const char * name, void * user_data
+) {
+    vimba_feature_invalidate(user_data, name);
+}
+
+static void vimba_feature_entry_free (gpointer data) {
+    VimbaFeatureEntry * entry = data;
+
+    if (G_IS_VALUE(&entry->value)) {
+        g_value_unset(&entry->value);
+    }
+    g_free(entry->name);
+    g_free(entry);
+}
+
+VimbaFeatureCache* vimba_feature_cache_new (VmbHandle_t handle) {
+    VimbaFeatureCache * cache = g_new0(VimbaFeatureCache, 1);
+
+    cache->handle = handle;
+    g_mutex_init(&cache->lock);
+    cache->entries = g_hash_table_new_full(
+        g_str_hash, g_str_equal, NULL, vimba_feature_entry_free
+    );
+    return cache;
+}
+
+void vimba_feature_cache_free (VimbaFeatureCache * cache) {
+    GHashTableIter iter;
+    VimbaFeatureEntry * entry;
+
+    if (cache == NULL) {
+        return;
+    }
+    g_hash_table_iter_init(&iter, cache->entries);
+    while (g_hash_table_iter_next(&iter, NULL, (gpointer *) &entry)) {
+        if (entry->registered) {
+            VmbFeatureInvalidationUnregister(
+                cache->handle, entry->name, vimba_feature_invalidated
+            );
+        }
+    }
+    g_hash_table_destroy(cache->entries);
+    g_mutex_clear(&cache->lock);
+    g_free(cache);
+}
+
+/* look up or create the entry of a feature, NULL if the camera lacks it */
+static VimbaFeatureEntry * vimba_feature_entry (
+    VimbaFeatureCache * cache, const char * name
+) {
+    VimbaFeatureEntry * entry;
+    VmbFeatureInfo_t info;
+
+    g_mutex_lock(&cache->lock);
+    entry = g_hash_table_lookup(cache->entries, name);
+    g_mutex_unlock(&cache->lock);
+    if (entry != NULL) {
+        return entry;
+    }
+
+    if (VmbErrorSuccess != VmbFeatureInfoQuery(
+            cache->handle, name, &info, sizeof(info))) {
+        return NULL;
+    }
+    entry = g_new0(VimbaFeatureEntry, 1);
+    entry->name = g_strdup(name);
+    entry->type = info.featureDataType;
+    entry->registered = VmbErrorSuccess == VmbFeatureInvalidationRegister(
+        cache->handle, name, vimba_feature_invalidated, cache
+    );
+
+    g_mutex_lock(&cache->lock);
+    if (g_hash_table_lookup(cache->entries, name) == NULL) {
+        g_hash_table_insert(cache->entries, entry->name, entry);
+    } else {
+        /*
+         * another thread was faster; its registration uses the same
+         * callback and context, so it stays in place
+         */
+        vimba_feature_entry_free(entry);
+        entry = g_hash_table_lookup(cache->entries, name);
+    }
+    g_mutex_unlock(&cache->lock);
+    return entry;
+}
+
+gboolean vimba_feature_exists (VimbaFeatureCache * cache, const char * name) {
+    return cache != NULL && vimba_feature_entry(cache, name) != NULL;
+}
+
+/* read the feature from the camera */
+static gboolean vimba_feature_read (
+    VimbaFeatureCache * cache, VimbaFeatureEntry * entry, GValue * value
+) {
+    VmbError_t err = VmbErrorWrongType;
+    VmbInt64_t int_value;
+    double float_value;
+    VmbBool_t bool_value;
+    const char * enum_value;
+    char string_value[FEATURE_STRING_SIZE];
+    VmbUint32_t string_size = 0;
+
+    switch (entry->type) {
+        case VmbFeatureDataInt:
+            err = VmbFeatureIntGet(cache->handle, entry->name, &int_value);
+            if (VmbErrorSuccess == err) {
+                g_value_init(value, G_TYPE_INT64);
+                g_value_set_int64(value, int_value);
+            }
+            break;
+        case VmbFeatureDataFloat:
+            err = VmbFeatureFloatGet(cache->handle, entry->name, &float_value);
+            if (VmbErrorSuccess == err) {
+                g_value_init(value, G_TYPE_DOUBLE);
+                g_value_set_double(value, float_value);
+            }
+            break;
+        case VmbFeatureDataBool:
+            err = VmbFeatureBoolGet(cache->handle, entry->name, &bool_value);
+            if (VmbErrorSuccess == err) {
+                g_value_init(value, G_TYPE_BOOLEAN);
+                g_value_set_boolean(value, bool_value == VmbBoolTrue);
+            }
+            break;
+        case VmbFeatureDataEnum:
+            err = VmbFeatureEnumGet(cache->handle, entry->name, &enum_value);
+            if (VmbErrorSuccess == err) {
+                g_value_init(value, G_TYPE_STRING);
+                g_value_set_string(value, enum_value);
+            }
+            break;
+        case VmbFeatureDataString:
+            err = VmbFeatureStringGet(cache->handle, entry->name,
+                string_value, FEATURE_STRING_SIZE, &string_size
+            );
+            if (VmbErrorSuccess == err) {
+                g_value_init(value, G_TYPE_STRING);
+                g_value_set_string(value, string_value);
+            }
+            break;
+        default:
+            break;
+    }
+    return VmbErrorSuccess == err;
+}
+
+gboolean vimba_feature_get (
+    VimbaFeatureCache * cache, const char * name, GValue * value
+) {
+    VimbaFeatureEntry * entry;
+    GValue read = G_VALUE_INIT;
+    guint generation;
+
+    if (cache == NULL || (entry = vimba_feature_entry(cache, name)) == NULL) {
+        return FALSE;
+    }
+
+    g_mutex_lock(&cache->lock);
+    if (entry->valid) {
+        cache->hits++;
+        g_value_init(value, G_VALUE_TYPE(&entry->value));
+        g_value_copy(&entry->value, value);
+        g_mutex_unlock(&cache->lock);
+        return TRUE;
+    }
+    cache->misses++;
+    generation = entry->generation;
+    g_mutex_unlock(&cache->lock);
+
+    if (!vimba_feature_read(cache, entry, &read)) {
+        return FALSE;
+    }
+
+    g_mutex_lock(&cache->lock);
+    /* only features that report invalidations can be cached */
+    if (entry->registered && generation == entry->generation) {
+        if (G_IS_VALUE(&entry->value)) {
+            g_value_unset(&entry->value);
+        }
+        g_value_init(&entry->value, G_VALUE_TYPE(&read));
+        g_value_copy(&read, &entry->value);
+        entry->valid = TRUE;
+    }
+    g_mutex_unlock(&cache->lock);
+
+    g_value_init(value, G_VALUE_TYPE(&read));
+    g_value_copy(&read, value);
+    g_value_unset(&read);
+    return TRUE;
+}
+
+/* convert a value of any fundamental type (or its string form) */
+static gboolean vimba_feature_convert (const GValue * src, GValue * dest) {
+    const gchar * str;
+    gchar * end = NULL;
+
+    if (!G_VALUE_HOLDS_STRING(src) || G_VALUE_HOLDS_STRING(dest)) {
+        return g_value_transform(src, dest);
+    }
+    str = g_value_get_string(src);
+    if (str == NULL) {
+        return FALSE;
+    }
+    if (G_VALUE_HOLDS_INT64(dest)) {
+        g_value_set_int64(dest, g_ascii_strtoll(str, &end, 0));
+    } else if (G_VALUE_HOLDS_DOUBLE(dest)) {
+        g_value_set_double(dest, g_ascii_strtod(str, &end));
+    } else if (G_VALUE_HOLDS_BOOLEAN(dest)) {
+        g_value_set_boolean(dest,
+            g_ascii_strcasecmp(str, "true") == 0 || strcmp(str, "1") == 0
+        );
+        return g_ascii_strcasecmp(str, "true") == 0 ||
+            g_ascii_strcasecmp(str, "false") == 0 ||
+            strcmp(str, "1") == 0 || strcmp(str, "0") == 0;
+    } else {
+        return FALSE;
+    }
+    return end != NULL && end != str && *end == '\0';
+}
+
+gboolean vimba_feature_set (
+    VimbaFeatureCache * cache, const char * name, const GValue * value
+) {
+    VimbaFeatureEntry * entry;
+    VmbError_t err = VmbErrorWrongType;
+    GValue converted = G_VALUE_INIT;
+
+    if (cache == NULL || (entry = vimba_feature_entry(cache, name)) == NULL) {
+        return FALSE;
+    }
+
+    switch (entry->type) {
+        case VmbFeatureDataInt:
+            g_value_init(&converted, G_TYPE_INT64);
+            if (vimba_feature_convert(value, &converted)) {
+                err = VmbFeatureIntSet(cache->handle, name,
+                    g_value_get_int64(&converted)
+                );
+            }
+            break;
+        case VmbFeatureDataFloat:
+            g_value_init(&converted, G_TYPE_DOUBLE);
+            if (vimba_feature_convert(value, &converted)) {
+                err = VmbFeatureFloatSet(cache->handle, name,
+                    g_value_get_double(&converted)
+                );
+            }
+            break;
+        case VmbFeatureDataBool:
+            g_value_init(&converted, G_TYPE_BOOLEAN);
+            if (vimba_feature_convert(value, &converted)) {
+                err = VmbFeatureBoolSet(cache->handle, name,
+                    g_value_get_boolean(&converted) ? VmbBoolTrue : VmbBoolFalse
+                );
+            }
+            break;
+        case VmbFeatureDataEnum:
+            g_value_init(&converted, G_TYPE_STRING);
+            if (vimba_feature_convert(value, &converted)) {
+                err = VmbFeatureEnumSet(cache->handle, name,
+                    g_value_get_string(&converted)
+                );
+            }
+            break;
+        case VmbFeatureDataString:
+            g_value_init(&converted, G_TYPE_STRING);
+            if (vimba_feature_convert(value, &converted)) {
+                err = VmbFeatureStringSet(cache->handle, name,
+                    g_value_get_string(&converted)
+                );
+            }
+            break;
+        case VmbFeatureDataCommand:
+            err = VmbFeatureCommandRun(cache->handle, name);
+            break;
+        default:
+            break;
+    }
+    if (G_IS_VALUE(&converted)) {
+        g_value_unset(&converted);
+    }
+
+    /* the camera may round the value, read it back on the next get */
+    g_mutex_lock(&cache->lock);
+    entry->valid = FALSE;
+    entry->generation++;
+    g_mutex_unlock(&cache->lock);
+
+    if (VmbErrorSuccess != err) {
+        g_warning("Unable to set feature %s: %d", name, err);
+        return FALSE;
+    }
+    return TRUE;
+}
+
+static gboolean vimba_feature_values_equal (const GValue * a, const GValue * b) {
+    gdouble x, y;
+
+    if (G_VALUE_HOLDS_INT64(a)) {
+        return g_value_get_int64(a) == g_value_get_int64(b);
+    }
+    if (G_VALUE_HOLDS_DOUBLE(a)) {
+        /* values saved with full precision compare equal */
+        x = g_value_get_double(a);
+        y = g_value_get_double(b);
+        return x == y || ABS(x - y) <= 1e-12 * MAX(ABS(x), ABS(y));
+    }
+    if (G_VALUE_HOLDS_BOOLEAN(a)) {
+        return !g_value_get_boolean(a) == !g_value_get_boolean(b);
+    }
+    return g_strcmp0(g_value_get_string(a), g_value_get_string(b)) == 0;
+}
+
+/*
+ * Write the value unless the feature already has it. Commands are never
+ * run, a feature that cannot be read is written blindly.
+ */
+VimbaFeatureUpdate vimba_feature_update (
+    VimbaFeatureCache * cache, const char * name, const GValue * value
+) {
+    VimbaFeatureEntry * entry;
+    GValue current = G_VALUE_INIT;
+    GValue converted = G_VALUE_INIT;
+    gboolean equal = FALSE;
+
+    if (cache == NULL || (entry = vimba_feature_entry(cache, name)) == NULL ||
+        entry->type == VmbFeatureDataCommand) {
+        return VIMBA_FEATURE_FAILED;
+    }
+    if (vimba_feature_get(cache, name, &current)) {
+        g_value_init(&converted, G_VALUE_TYPE(&current));
+        equal = vimba_feature_convert(value, &converted) &&
+            vimba_feature_values_equal(&current, &converted);
+        g_value_unset(&converted);
+        g_value_unset(&current);
+    }
+    if (equal) {
+        return VIMBA_FEATURE_UNCHANGED;
+    }
+    return vimba_feature_set(cache, name, value)
+        ? VIMBA_FEATURE_WRITTEN : VIMBA_FEATURE_FAILED;
+}
+
+gchar* vimba_feature_get_string (VimbaFeatureCache * cache, const char * name) {
+    GValue value = G_VALUE_INIT;
+    GValue string = G_VALUE_INIT;
+    gchar * result;
+
+    if (!vimba_feature_get(cache, name, &value)) {
+        return NULL;
+    }
+    g_value_init(&string, G_TYPE_STRING);
+    g_value_transform(&value, &string);
+    result = g_value_dup_string(&string);
+    g_value_unset(&string);
+    g_value_unset(&value);
+    return result;
+}
+
+gboolean vimba_feature_set_string (
+    VimbaFeatureCache * cache, const char * name, const char * value
+) {
+    GValue string = G_VALUE_INIT;
+    gboolean res;
+
+    g_value_init(&string, G_TYPE_STRING);
+    g_value_set_string(&string, value);
+    res = vimba_feature_set(cache, name, &string);
+    g_value_unset(&string);
+    return res;
+}
+
+void vimba_feature_cache_stats (
+    VimbaFeatureCache * cache, guint64 * hits, guint64 * misses
+) {
+    *hits = 0;
+    *misses = 0;
+    if (cache == NULL) {
+        return;
+    }
+    g_mutex_lock(&cache->lock);
+    *hits = cache->hits;
+    *misses = cache->misses;
+    g_mutex_unlock(&cache->lock);
+}
@@ -0,0 +1,32 @@
+#ifndef _VIMBASRC_FEATURE_H_
+#define _VIMBASRC_FEATURE_H_
+
+#include <VimbaC.h>
+#include <glib-object.h>
+
+/*
+ * Type agnostic access to the GenICam features of a camera. Values read
+ * through the cache are kept until the SDK reports the feature as
+ * invalidated, so repeated reads do not go over the control channel.
+ */
+
+typedef struct _VimbaFeatureCache VimbaFeatureCache;
+
+typedef enum {
+    VIMBA_FEATURE_UNCHANGED,
+    VIMBA_FEATURE_WRITTEN,
+    VIMBA_FEATURE_FAILED
+} VimbaFeatureUpdate;
+
+VimbaFeatureCache* vimba_feature_cache_new (VmbHandle_t handle);
+void     vimba_feature_cache_free (VimbaFeatureCache * cache);
+void     vimba_feature_invalidate (VimbaFeatureCache * cache, const char * name);
+gboolean vimba_feature_exists (VimbaFeatureCache * cache, const char * name);
+gboolean vimba_feature_get (VimbaFeatureCache * cache, const char * name, GValue * value);
+gboolean vimba_feature_set (VimbaFeatureCache * cache, const char * name, const GValue * value);
+VimbaFeatureUpdate vimba_feature_update (VimbaFeatureCache * cache, const char * name, const GValue * value);
+gchar*   vimba_feature_get_string (VimbaFeatureCache * cache, const char * name);
+gboolean vimba_feature_set_string (VimbaFeatureCache * cache, const char * name, const char * value);
+void     vimba_feature_cache_stats (VimbaFeatureCache * cache, guint64 * hits, guint64 * misses);
+
+#endif
@@ -0,0 +1,301 @@
+#include <string.h>
+#include "vimbahistogram.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+static const gchar * const channel_names[VIMBA_HISTOGRAM_CHANNELS] = {
+    "luma", "red", "green", "blue"
+};
+
+/* BT.601 luma weights in 1/256, a color quad has two greens to share the
+ * green weight */
+static const guint luma_weights[VIMBA_HISTOGRAM_CHANNELS] = { 0, 77, 150, 29 };
+static const guint quad_weights[VIMBA_HISTOGRAM_CHANNELS] = { 0, 77, 75, 29 };
+
+static inline guint vimba_histogram_bits (guint mask) {
+#ifdef __GNUC__
+    return __builtin_popcount(mask);
+#else
+    guint n = 0;
+    for (; mask != 0; mask &= mask - 1) {
+        n++;
+    }
+    return n;
+#endif
+}
+
+static gint vimba_histogram_channel (gchar c) {
+    switch (g_ascii_tolower(c)) {
+        case 'r': return VIMBA_HISTOGRAM_RED;
+        case 'g': return VIMBA_HISTOGRAM_GREEN;
+        case 'b': return VIMBA_HISTOGRAM_BLUE;
+        default: return -1;
+    }
+}
+
+/*
+ * Sums, saturated and black samples of a row whose even and odd columns
+ * belong to the given channels, the same one for gray rows. The histogram
+ * is left to the caller, bin updates do not vectorize.
+ */
+static void vimba_histogram_sums (
+    const guint8 * row, gint width, VimbaHistogramChannel * even,
+    VimbaHistogramChannel * odd
+) {
+    guint64 sums[2] = { 0, 0 };
+    guint64 clipped[2] = { 0, 0 };
+    guint64 dark[2] = { 0, 0 };
+    gint x = 0;
+
+#ifdef __SSE2__
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i full = _mm_set1_epi8((char) 0xff);
+    const __m128i low = _mm_set1_epi16(0x00ff);
+    __m128i even_sum = zero, odd_sum = zero;
+    guint64 lanes[2];
+
+    for (; x + 16 <= width; x += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *) (row + x));
+        guint hi = _mm_movemask_epi8(_mm_cmpeq_epi8(v, full));
+        guint lo = _mm_movemask_epi8(_mm_cmpeq_epi8(v, zero));
+
+        /* sum of absolute differences to zero adds up 8 bytes at once */
+        even_sum = _mm_add_epi64(even_sum,
+            _mm_sad_epu8(_mm_and_si128(v, low), zero));
+        odd_sum = _mm_add_epi64(odd_sum,
+            _mm_sad_epu8(_mm_srli_epi16(v, 8), zero));
+        clipped[0] += vimba_histogram_bits(hi & 0x5555);
+        clipped[1] += vimba_histogram_bits(hi & 0xaaaa);
+        dark[0] += vimba_histogram_bits(lo & 0x5555);
+        dark[1] += vimba_histogram_bits(lo & 0xaaaa);
+    }
+    _mm_storeu_si128((__m128i *) lanes, even_sum);
+    sums[0] = lanes[0] + lanes[1];
+    _mm_storeu_si128((__m128i *) lanes, odd_sum);
+    sums[1] = lanes[0] + lanes[1];
+#endif
+    for (; x < width; x++) {
+        sums[x & 1] += row[x];
+        clipped[x & 1] += row[x] == 0xff;
+        dark[x & 1] += row[x] == 0;
+    }
+
+    even->samples += (width + 1) / 2;
+    even->sum += sums[0];
+    even->clipped += clipped[0];
+    even->dark += dark[0];
+    odd->samples += width / 2;
+    odd->sum += sums[1];
+    odd->clipped += clipped[1];
+    odd->dark += dark[1];
+}
+
+static inline void vimba_histogram_add (VimbaHistogramChannel * channel, guint v) {
+    channel->samples++;
+    channel->sum += v;
+    channel->clipped += v == 0xff;
+    channel->dark += v == 0;
+    channel->bins[v]++;
+}
+
+static void vimba_histogram_gray_row (
+    VimbaHistogram * histogram, const guint8 * row
+) {
+    VimbaHistogramChannel * luma = &histogram->channels[VIMBA_HISTOGRAM_LUMA];
+    gint x;
+
+    vimba_histogram_sums(row, histogram->width, luma, luma);
+    for (x = 0; x < histogram->width; x++) {
+        luma->bins[row[x]]++;
+    }
+}
+
+/* one row of color quads, luma from each whole quad */
+static void vimba_histogram_bayer_rows (
+    VimbaHistogram * histogram, const guint8 * row0, const guint8 * row1
+) {
+    VimbaHistogramChannel * channels = histogram->channels;
+    const gint * order = histogram->order;
+    gint x;
+
+    vimba_histogram_sums(row0, histogram->width, &channels[order[0]],
+        &channels[order[1]]);
+    vimba_histogram_sums(row1, histogram->width, &channels[order[2]],
+        &channels[order[3]]);
+    for (x = 0; x + 1 < histogram->width; x += 2) {
+        guint luma = quad_weights[order[0]] * row0[x] +
+            quad_weights[order[1]] * row0[x + 1] +
+            quad_weights[order[2]] * row1[x] +
+            quad_weights[order[3]] * row1[x + 1];
+
+        channels[order[0]].bins[row0[x]]++;
+        channels[order[1]].bins[row0[x + 1]]++;
+        channels[order[2]].bins[row1[x]]++;
+        channels[order[3]].bins[row1[x + 1]]++;
+        vimba_histogram_add(&channels[VIMBA_HISTOGRAM_LUMA], luma >> 8);
+    }
+    if (x < histogram->width) {
+        channels[order[0]].bins[row0[x]]++;
+        channels[order[2]].bins[row1[x]]++;
+    }
+}
+
+static void vimba_histogram_color_row (
+    VimbaHistogram * histogram, const guint8 * row
+) {
+    VimbaHistogramChannel * channels = histogram->channels;
+    const gint * order = histogram->order;
+    gint x, i;
+
+    for (x = 0; x < histogram->width; x++) {
+        const guint8 * pixel = row + x * histogram->bpp;
+        guint luma = 0;
+
+        for (i = 0; i < histogram->bpp; i++) {
+            if (order[i] < 0) {
+                continue;
+            }
+            vimba_histogram_add(&channels[order[i]], pixel[i]);
+            luma += luma_weights[order[i]] * pixel[i];
+        }
+        vimba_histogram_add(&channels[VIMBA_HISTOGRAM_LUMA], luma >> 8);
+    }
+}
+
+VimbaHistogram * vimba_histogram_new (GstCaps * caps, guint step) {
+    GstStructure * structure = gst_caps_get_structure(caps, 0);
+    const gchar * format = gst_structure_get_string(structure, "format");
+    VimbaHistogram * histogram;
+    gint width, height, i;
+
+    if (format == NULL ||
+        !gst_structure_get_int(structure, "width", &width) ||
+        !gst_structure_get_int(structure, "height", &height)) {
+        return NULL;
+    }
+    histogram = g_new0(VimbaHistogram, 1);
+    histogram->width = width;
+    histogram->height = height;
+    histogram->step = MAX(step, 1);
+    for (i = 0; i < 4; i++) {
+        histogram->order[i] = -1;
+    }
+
+    if (gst_structure_has_name(structure, "video/x-bayer") &&
+        strlen(format) == 4) {
+        /* whole quads, so every color is sampled */
+        histogram->bayer = TRUE;
+        histogram->bpp = 1;
+        histogram->step = GST_ROUND_UP_2(histogram->step);
+        for (i = 0; i < 4; i++) {
+            histogram->order[i] = vimba_histogram_channel(format[i]);
+        }
+    } else if (!g_strcmp0(format, "GRAY8")) {
+        histogram->bpp = 1;
+        histogram->order[0] = VIMBA_HISTOGRAM_LUMA;
+    } else if (!g_strcmp0(format, "RGB") || !g_strcmp0(format, "BGR") ||
+        !g_strcmp0(format, "RGBA") || !g_strcmp0(format, "BGRA")) {
+        histogram->bpp = strlen(format);
+        for (i = 0; i < histogram->bpp; i++) {
+            histogram->order[i] = vimba_histogram_channel(format[i]);
+        }
+    } else {
+        g_free(histogram);
+        return NULL;
+    }
+    if (histogram->bayer && (histogram->order[0] < 0 ||
+            histogram->order[1] < 0 || histogram->order[2] < 0 ||
+            histogram->order[3] < 0)) {
+        /* 16 bit bayer like bggr16le */
+        g_free(histogram);
+        return NULL;
+    }
+    return histogram;
+}
+
+void vimba_histogram_free (VimbaHistogram * histogram) {
+    g_free(histogram);
+}
+
+gboolean vimba_histogram_process (
+    VimbaHistogram * histogram, const guint8 * frame, gsize size
+) {
+    const gsize row_bytes = (gsize) histogram->width * histogram->bpp;
+    GstClockTime start;
+    gint y;
+
+    if (size < row_bytes * histogram->height) {
+        return FALSE;
+    }
+    start = gst_util_get_timestamp();
+    memset(histogram->channels, 0, sizeof(histogram->channels));
+    for (y = 0; y < histogram->height; y += histogram->step) {
+        const guint8 * row = frame + y * row_bytes;
+
+        if (histogram->bayer) {
+            if (y + 1 < histogram->height) {
+                vimba_histogram_bayer_rows(histogram, row, row + row_bytes);
+            }
+        } else if (histogram->bpp == 1) {
+            vimba_histogram_gray_row(histogram, row);
+        } else {
+            vimba_histogram_color_row(histogram, row);
+        }
+    }
+    histogram->duration = gst_util_get_timestamp() - start;
+    return TRUE;
+}
+
+/* the statistics as fields "<channel>-mean", "-samples", "-clipped",
+ * "-dark" and "-histogram", an array of 256 counts */
+GstStructure * vimba_histogram_to_structure (
+    VimbaHistogram * histogram, const gchar * name
+) {
+    GstStructure * structure;
+    GValue bin = G_VALUE_INIT;
+    gchar * field;
+    guint c, i;
+
+    structure = gst_structure_new(name,
+        "step", G_TYPE_UINT, histogram->step,
+        "compute-time", G_TYPE_UINT64, histogram->duration,
+        NULL
+    );
+    g_value_init(&bin, G_TYPE_UINT);
+    for (c = 0; c < VIMBA_HISTOGRAM_CHANNELS; c++) {
+        VimbaHistogramChannel * channel = &histogram->channels[c];
+        GValue bins = G_VALUE_INIT;
+
+        if (channel->samples == 0) {
+            continue;
+        }
+        field = g_strdup_printf("%s-mean", channel_names[c]);
+        gst_structure_set(structure, field, G_TYPE_DOUBLE,
+            (gdouble) channel->sum / channel->samples, NULL);
+        g_free(field);
+        field = g_strdup_printf("%s-samples", channel_names[c]);
+        gst_structure_set(structure, field, G_TYPE_UINT64, channel->samples,
+            NULL);
+        g_free(field);
+        field = g_strdup_printf("%s-clipped", channel_names[c]);
+        gst_structure_set(structure, field, G_TYPE_UINT64, channel->clipped,
+            NULL);
+        g_free(field);
+        field = g_strdup_printf("%s-dark", channel_names[c]);
+        gst_structure_set(structure, field, G_TYPE_UINT64, channel->dark, NULL);
+        g_free(field);
+
+        g_value_init(&bins, GST_TYPE_ARRAY);
+        for (i = 0; i < G_N_ELEMENTS(channel->bins); i++) {
+            g_value_set_uint(&bin, channel->bins[i]);
+            gst_value_array_append_value(&bins, &bin);
+        }
+        field = g_strdup_printf("%s-histogram", channel_names[c]);
+        gst_structure_take_value(structure, field, &bins);
+        g_free(field);
+    }
+    g_value_unset(&bin);
+    return structure;
+}
@@ -0,0 +1,52 @@
+#ifndef _VIMBASRC_HISTOGRAM_H_
+#define _VIMBASRC_HISTOGRAM_H_
+
+#include <gst/gst.h>
+
+/*
+ * Image statistics for exposure control, computed from the frame right
+ * after it was copied, while it is still in cache. Every step-th row is
+ * sampled in full: skipping columns would not save memory traffic, whole
+ * cache lines are read either way. Each channel gets a 256 bin histogram,
+ * its mean and the number of saturated and black samples; color frames also
+ * get a BT.601 luma channel, from whole color quads for Bayer frames. 8 bit
+ * gray, RGB, BGR, RGBA, BGRA and Bayer frames are supported.
+ */
+
+typedef enum {
+    VIMBA_HISTOGRAM_LUMA,
+    VIMBA_HISTOGRAM_RED,
+    VIMBA_HISTOGRAM_GREEN,
+    VIMBA_HISTOGRAM_BLUE,
+    VIMBA_HISTOGRAM_CHANNELS
+} VimbaHistogramChannelId;
+
+typedef struct {
+    guint64       samples;
+    guint64       sum;
+    guint64       clipped;
+    guint64       dark;
+    guint32       bins[256];
+} VimbaHistogramChannel;
+
+typedef struct {
+    /* the captured frames, rows tightly packed */
+    gint          width;
+    gint          height;
+    gint          bpp;
+    guint         step;
+    gboolean      bayer;
+    /* channel of each byte of a pixel, or of each position of a color
+     * quad, -1 for bytes that are skipped */
+    gint          order[4];
+
+    VimbaHistogramChannel channels[VIMBA_HISTOGRAM_CHANNELS];
+    GstClockTime  duration;
+} VimbaHistogram;
+
+VimbaHistogram* vimba_histogram_new (GstCaps * caps, guint step);
+void          vimba_histogram_free (VimbaHistogram * histogram);
+gboolean      vimba_histogram_process (VimbaHistogram * histogram, const guint8 * frame, gsize size);
+GstStructure* vimba_histogram_to_structure (VimbaHistogram * histogram, const gchar * name);
+
+#endif
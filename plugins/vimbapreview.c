@@ -0,0 +1,172 @@
+#include <string.h>
+#include "vimbapreview.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/* 2x2 binning of one output row of 8 bit pixels */
+static void vimba_preview_bin2 (
+    const guint8 * row0, const guint8 * row1, gint out_width, guint8 * dst
+) {
+    gint x = 0;
+
+#ifdef __SSE2__
+    const __m128i low = _mm_set1_epi16(0x00ff);
+
+    for (; x + 16 <= out_width; x += 16) {
+        __m128i v0 = _mm_avg_epu8(
+            _mm_loadu_si128((const __m128i *) (row0 + 2 * x)),
+            _mm_loadu_si128((const __m128i *) (row1 + 2 * x)));
+        __m128i v1 = _mm_avg_epu8(
+            _mm_loadu_si128((const __m128i *) (row0 + 2 * x + 16)),
+            _mm_loadu_si128((const __m128i *) (row1 + 2 * x + 16)));
+        /* average the even and the odd pixels of the vertical means */
+        __m128i h0 = _mm_avg_epu16(_mm_and_si128(v0, low), _mm_srli_epi16(v0, 8));
+        __m128i h1 = _mm_avg_epu16(_mm_and_si128(v1, low), _mm_srli_epi16(v1, 8));
+        _mm_storeu_si128((__m128i *) (dst + x), _mm_packus_epi16(h0, h1));
+    }
+#endif
+    /* rounds like _mm_avg_epu8 so the tail matches the vector part */
+    for (; x < out_width; x++) {
+        guint v0 = (row0[2 * x] + row1[2 * x] + 1) >> 1;
+        guint v1 = (row0[2 * x + 1] + row1[2 * x + 1] + 1) >> 1;
+        dst[x] = (v0 + v1 + 1) >> 1;
+    }
+}
+
+/* mean of scale x scale boxes for one output row */
+static void vimba_preview_box (
+    VimbaPreview * preview, const guint8 * src, guint8 * dst
+) {
+    const gint row_bytes = preview->width * preview->bpp;
+    const gint out_width = GST_VIDEO_INFO_WIDTH(&preview->info);
+    const gint n = out_width * preview->scale * preview->bpp;
+    const guint area = preview->scale * preview->scale;
+    guint16 * acc = preview->acc;
+    guint r;
+    gint x;
+
+    memset(acc, 0, n * sizeof(guint16));
+    for (r = 0; r < preview->scale; r++) {
+        const guint8 * row = src + r * row_bytes;
+
+        x = 0;
+#ifdef __SSE2__
+        {
+            const __m128i zero = _mm_setzero_si128();
+            for (; x + 16 <= n; x += 16) {
+                __m128i pixels = _mm_loadu_si128((const __m128i *) (row + x));
+                __m128i *a = (__m128i *) (acc + x);
+                _mm_storeu_si128(a, _mm_add_epi16(_mm_loadu_si128(a),
+                    _mm_unpacklo_epi8(pixels, zero)));
+                _mm_storeu_si128(a + 1, _mm_add_epi16(_mm_loadu_si128(a + 1),
+                    _mm_unpackhi_epi8(pixels, zero)));
+            }
+        }
+#endif
+        for (; x < n; x++) {
+            acc[x] += row[x];
+        }
+    }
+
+    /* at most 16 x 16 x 255, no overflow in 16 bits */
+    for (x = 0; x < out_width; x++) {
+        gint c;
+        for (c = 0; c < preview->bpp; c++) {
+            const guint16 * box = acc + x * preview->scale * preview->bpp + c;
+            guint k, sum = 0;
+            for (k = 0; k < preview->scale; k++) {
+                sum += box[k * preview->bpp];
+            }
+            dst[x * preview->bpp + c] = (sum + area / 2) / area;
+        }
+    }
+}
+
+VimbaPreview * vimba_preview_new (GstCaps * caps, guint scale, guint decimation) {
+    GstStructure * structure = gst_caps_get_structure(caps, 0);
+    const gchar * format = gst_structure_get_string(structure, "format");
+    const gchar * out_format;
+    VimbaPreview * preview;
+    gint width, height, fps_n = 0, fps_d = 1, bpp;
+
+    if (format == NULL ||
+        !gst_structure_get_int(structure, "width", &width) ||
+        !gst_structure_get_int(structure, "height", &height)) {
+        return NULL;
+    }
+    if (gst_structure_has_name(structure, "video/x-bayer")) {
+        if (strlen(format) != 4) {
+            /* 16 bit bayer like bggr16le */
+            return NULL;
+        }
+        /* whole quads, so every box sees each color equally often */
+        scale = GST_ROUND_UP_2(scale);
+        out_format = "GRAY8";
+        bpp = 1;
+    } else if (!g_strcmp0(format, "GRAY8")) {
+        out_format = "GRAY8";
+        bpp = 1;
+    } else if (!g_strcmp0(format, "RGB") || !g_strcmp0(format, "BGR")) {
+        out_format = format;
+        bpp = 3;
+    } else {
+        return NULL;
+    }
+    if (width < (gint) scale || height < (gint) scale) {
+        return NULL;
+    }
+
+    preview = g_new0(VimbaPreview, 1);
+    preview->width = width;
+    preview->height = height;
+    preview->bpp = bpp;
+    preview->scale = scale;
+    gst_structure_get_fraction(structure, "framerate", &fps_n, &fps_d);
+    gst_video_info_set_format(&preview->info,
+        gst_video_format_from_string(out_format),
+        width / scale, height / scale);
+    GST_VIDEO_INFO_FPS_N(&preview->info) = fps_n;
+    GST_VIDEO_INFO_FPS_D(&preview->info) = fps_d * MAX(decimation, 1);
+    preview->caps = gst_video_info_to_caps(&preview->info);
+    preview->acc = g_new(guint16, width * bpp);
+    return preview;
+}
+
+void vimba_preview_free (VimbaPreview * preview) {
+    if (preview == NULL) {
+        return;
+    }
+    gst_caps_unref(preview->caps);
+    g_free(preview->acc);
+    g_free(preview);
+}
+
+GstBuffer * vimba_preview_process (
+    VimbaPreview * preview, const guint8 * frame, gsize size
+) {
+    const gint row_bytes = preview->width * preview->bpp;
+    const gint out_width = GST_VIDEO_INFO_WIDTH(&preview->info);
+    const gint out_height = GST_VIDEO_INFO_HEIGHT(&preview->info);
+    const gint stride = GST_VIDEO_INFO_PLANE_STRIDE(&preview->info, 0);
+    GstBuffer * buffer;
+    GstMapInfo map;
+    gint y;
+
+    if (size < (gsize) row_bytes * preview->height) {
+        return NULL;
+    }
+    buffer = gst_buffer_new_allocate(NULL, GST_VIDEO_INFO_SIZE(&preview->info), NULL);
+    gst_buffer_map(buffer, &map, GST_MAP_WRITE);
+    for (y = 0; y < out_height; y++) {
+        const guint8 * src = frame + (gsize) y * preview->scale * row_bytes;
+        if (preview->scale == 2 && preview->bpp == 1) {
+            vimba_preview_bin2(src, src + row_bytes, out_width, map.data + y * stride);
+        } else {
+            vimba_preview_box(preview, src, map.data + y * stride);
+        }
+    }
+    gst_buffer_unmap(buffer, &map);
+    return buffer;
+}
@@ -0,0 +1,32 @@
+#ifndef _VIMBASRC_PREVIEW_H_
+#define _VIMBASRC_PREVIEW_H_
+
+#include <gst/gst.h>
+#include <gst/video/video-info.h>
+
+/*
+ * Downscaled preview of the captured frames, computed from the frame right
+ * after it was copied, while it is still in cache. Every output pixel is
+ * the mean of a scale x scale box; Bayer frames are binned into gray over
+ * whole color quads. 8 bit gray, RGB, BGR and Bayer frames are supported.
+ */
+
+typedef struct {
+    /* the captured frames, rows tightly packed */
+    gint          width;
+    gint          height;
+    gint          bpp;
+    guint         scale;
+
+    GstCaps*      caps;
+    GstVideoInfo  info;
+
+    /* vertical sums of one output row */
+    guint16*      acc;
+} VimbaPreview;
+
+VimbaPreview* vimba_preview_new (GstCaps * caps, guint scale, guint decimation);
+void          vimba_preview_free (VimbaPreview * preview);
+GstBuffer*    vimba_preview_process (VimbaPreview * preview, const guint8 * frame, gsize size);
+
+#endif
@@ -0,0 +1,258 @@
+#include "vimbaptp.h"
+
+/* how often the lock state is read and the clock calibrated */
+#define PTP_POLL_US          500000
+/* latches per poll, the one with the shortest round trip is used */
+#define PTP_LATCH_SAMPLES    3
+/* a slower latch says too little about when the time was taken */
+#define PTP_MAX_LATCH        (2 * GST_MSECOND)
+/* observations the rate of the device clock is estimated from */
+#define PTP_WINDOW           32
+#define PTP_WINDOW_THRESHOLD 4
+/* a recalibration moving the clock further is a jump */
+#define PTP_REBASE_LIMIT     GST_MSECOND
+
+struct _VimbaPtp {
+    VimbaCamera*    camera;
+    GMutex*         camera_lock;
+    VimbaPtpNotify  notify;
+    gpointer        user_data;
+    /* monotonic internal time, calibrated to the device time */
+    GstClock*       clock;
+    gint            calibrated;
+
+    GThread*      thread;
+    GMutex        lock;
+    GCond         cond;
+    gboolean      running;
+
+    /* last poll, protected by lock */
+    gchar*        status;
+    gboolean      locked;
+    gboolean      has_offset;
+    gint64        offset;
+    guint         lock_changes;
+    GstClockTime  latch_time;
+    guint64       observations;
+};
+
+static const gchar * const ptp_mode_features[] = {
+    NULL, "Off", "Slave", "Master", "Auto"
+};
+
+const gchar * vimba_ptp_mode_feature (VimbaPtpMode mode) {
+    if (mode > VIMBA_PTP_MODE_AUTO) {
+        return NULL;
+    }
+    return ptp_mode_features[mode];
+}
+
+static gboolean vimba_ptp_status_locked (const gchar * status) {
+    return g_strcmp0(status, "Slave") == 0 || g_strcmp0(status, "Master") == 0;
+}
+
+/* the device time runs steadily, while listening or syncing it may jump */
+static gboolean vimba_ptp_status_steady (const gchar * status) {
+    return status == NULL || g_strcmp0(status, "Disabled") == 0 ||
+        vimba_ptp_status_locked(status);
+}
+
+/* start the calibration over from the device time now, TRUE when that
+ * moves the clock by more than PTP_REBASE_LIMIT */
+static gboolean vimba_ptp_recalibrate (
+    VimbaPtp * ptp, GstClockTime internal, GstClockTime device
+) {
+    GstClockTime cinternal, cexternal, rate_num, rate_denom, now;
+
+    gst_clock_get_calibration(ptp->clock, &cinternal, &cexternal, &rate_num,
+        &rate_denom);
+    now = gst_clock_adjust_with_calibration(ptp->clock, internal, cinternal,
+        cexternal, rate_num, rate_denom);
+    g_object_set(ptp->clock, "window-size", PTP_WINDOW, NULL);
+    gst_clock_set_calibration(ptp->clock, internal, device, 1, 1);
+    return (GstClockTime) ABS(GST_CLOCK_DIFF(now, device)) > PTP_REBASE_LIMIT;
+}
+
+/* the device time and the internal time of the clock halfway through
+ * latching it, from the quickest of a few latches */
+static gboolean vimba_ptp_latch (
+    VimbaPtp * ptp, GstClockTime * internal, GstClockTime * device,
+    GstClockTime * latch_time
+) {
+    GstClockTime before, after;
+    guint64 time;
+    gint i;
+
+    *latch_time = GST_CLOCK_TIME_NONE;
+    for (i = 0; i < PTP_LATCH_SAMPLES; i++) {
+        before = gst_clock_get_internal_time(ptp->clock);
+        if (!vimbacamera_latch_device_time(ptp->camera, &time)) {
+            break;
+        }
+        after = gst_clock_get_internal_time(ptp->clock);
+        if (after - before < *latch_time) {
+            *latch_time = after - before;
+            *internal = before + *latch_time / 2;
+            *device = time;
+        }
+    }
+    return GST_CLOCK_TIME_IS_VALID(*latch_time);
+}
+
+static void vimba_ptp_poll (VimbaPtp * ptp) {
+    VimbaCamera * camera = ptp->camera;
+    const char * value = NULL;
+    VmbInt64_t offset = 0;
+    gchar * status = NULL;
+    gboolean has_offset = FALSE, latched, locked, changed, rebased = FALSE;
+    GstClockTime internal = 0, device = 0, latch_time;
+    gdouble r_squared;
+
+    g_mutex_lock(ptp->camera_lock);
+    if (!camera->open || vimbacamera_is_lost(camera)) {
+        g_mutex_unlock(ptp->camera_lock);
+        return;
+    }
+    /* volatile, read past the feature cache */
+    if (VmbErrorSuccess == VmbFeatureEnumGet(camera->camera_handle,
+            "PtpStatus", &value)) {
+        status = g_strdup(value);
+    }
+    if (status != NULL) {
+        /* cameras without the latch update the offset on their own */
+        VmbFeatureCommandRun(camera->camera_handle, "PtpDataSetLatch");
+        has_offset = VmbErrorSuccess == VmbFeatureIntGet(
+            camera->camera_handle, "PtpOffsetFromMaster", &offset);
+    }
+    latched = vimba_ptp_latch(ptp, &internal, &device, &latch_time);
+    g_mutex_unlock(ptp->camera_lock);
+
+    locked = vimba_ptp_status_locked(status);
+    g_mutex_lock(&ptp->lock);
+    changed = g_strcmp0(status, ptp->status) != 0;
+    if (locked != ptp->locked) {
+        ptp->lock_changes++;
+    }
+    g_free(ptp->status);
+    ptp->status = status;
+    ptp->locked = locked;
+    ptp->has_offset = has_offset;
+    ptp->offset = offset;
+    if (latched) {
+        ptp->latch_time = latch_time;
+    }
+    g_mutex_unlock(&ptp->lock);
+
+    if (latched && (!g_atomic_int_get(&ptp->calibrated) ||
+            (changed && vimba_ptp_status_steady(status)))) {
+        rebased = vimba_ptp_recalibrate(ptp, internal, device);
+        g_atomic_int_set(&ptp->calibrated, 1);
+    } else if (latched && latch_time <= PTP_MAX_LATCH &&
+            vimba_ptp_status_steady(status)) {
+        gst_clock_add_observation(ptp->clock, internal, device, &r_squared);
+        g_mutex_lock(&ptp->lock);
+        ptp->observations++;
+        g_mutex_unlock(&ptp->lock);
+    }
+
+    if (changed) {
+        GST_INFO("camera %s PtpStatus %s", camera->camera_id,
+            status != NULL ? status : "unavailable");
+    }
+    if ((changed || rebased) && ptp->notify != NULL) {
+        ptp->notify(status, locked, rebased, ptp->user_data);
+    }
+}
+
+static gpointer vimba_ptp_thread (gpointer data) {
+    VimbaPtp * ptp = data;
+
+    g_mutex_lock(&ptp->lock);
+    while (ptp->running) {
+        g_cond_wait_until(&ptp->cond, &ptp->lock,
+            g_get_monotonic_time() + PTP_POLL_US);
+        if (!ptp->running) {
+            break;
+        }
+        g_mutex_unlock(&ptp->lock);
+        vimba_ptp_poll(ptp);
+        g_mutex_lock(&ptp->lock);
+    }
+    g_mutex_unlock(&ptp->lock);
+    return NULL;
+}
+
+/* a clock for vimba_ptp_new to calibrate, monotonic until then */
+GstClock * vimba_ptp_clock_new (void) {
+    GstClock * clock = g_object_new(GST_TYPE_SYSTEM_CLOCK,
+        "name", "vimbaptpclock",
+        "clock-type", GST_CLOCK_TYPE_MONOTONIC,
+        "window-size", PTP_WINDOW,
+        "window-threshold", PTP_WINDOW_THRESHOLD,
+        NULL);
+
+    return gst_object_ref_sink(clock);
+}
+
+/* the clock is calibrated from a first poll before this returns */
+VimbaPtp * vimba_ptp_new (
+    VimbaCamera * camera, GMutex * camera_lock, GstClock * clock,
+    VimbaPtpNotify notify, gpointer user_data
+) {
+    VimbaPtp * ptp = g_new0(VimbaPtp, 1);
+
+    ptp->camera = camera;
+    ptp->camera_lock = camera_lock;
+    ptp->notify = notify;
+    ptp->user_data = user_data;
+    ptp->latch_time = GST_CLOCK_TIME_NONE;
+    ptp->clock = gst_object_ref(clock);
+    g_mutex_init(&ptp->lock);
+    g_cond_init(&ptp->cond);
+
+    vimba_ptp_poll(ptp);
+    ptp->running = TRUE;
+    ptp->thread = g_thread_new("vimbaptp", vimba_ptp_thread, ptp);
+    return ptp;
+}
+
+/* the clock keeps its last calibration until the next vimba_ptp_new */
+void vimba_ptp_free (VimbaPtp * ptp) {
+    if (ptp == NULL) {
+        return;
+    }
+    g_mutex_lock(&ptp->lock);
+    ptp->running = FALSE;
+    g_cond_broadcast(&ptp->cond);
+    g_mutex_unlock(&ptp->lock);
+    g_thread_join(ptp->thread);
+
+    gst_object_unref(ptp->clock);
+    g_free(ptp->status);
+    g_cond_clear(&ptp->cond);
+    g_mutex_clear(&ptp->lock);
+    g_free(ptp);
+}
+
+/* the clock following the device time */
+GstClock * vimba_ptp_get_clock (VimbaPtp * ptp) {
+    return ptp->clock;
+}
+
+/* FALSE until the device time could be latched once */
+gboolean vimba_ptp_calibrated (VimbaPtp * ptp) {
+    return g_atomic_int_get(&ptp->calibrated) != 0;
+}
+
+/* stats->status is to be freed */
+void vimba_ptp_stats (VimbaPtp * ptp, VimbaPtpStats * stats) {
+    g_mutex_lock(&ptp->lock);
+    stats->status = g_strdup(ptp->status);
+    stats->locked = ptp->locked;
+    stats->has_offset = ptp->has_offset;
+    stats->offset = ptp->offset;
+    stats->lock_changes = ptp->lock_changes;
+    stats->latch_time = ptp->latch_time;
+    stats->observations = ptp->observations;
+    g_mutex_unlock(&ptp->lock);
+}
@@ -0,0 +1,68 @@
+#ifndef _VIMBASRC_PTP_H_
+#define _VIMBASRC_PTP_H_
+
+#include <gst/gst.h>
+#include "vimbacamera.h"
+
+/*
+ * Cameras on one network can synchronize their device clocks over IEEE 1588
+ * (PtpMode). A monitor thread follows the lock state of the camera
+ * (PtpStatus) and the offset from the master it reports, and keeps a
+ * GstClock calibrated to the device clock by latching the device time
+ * against the monotonic host time. With every host of a multi-host rig
+ * using this clock as the pipeline clock, the running times of frames
+ * captured at the same instant match across hosts. The calibration starts
+ * over whenever the lock state changes, as the device time jumps then; a
+ * jump of a clock in use is reported so the pipeline can pick it again.
+ * The clock belongs to the caller and outlives the monitor, so a pipeline
+ * keeps the same clock object across restarts.
+ */
+
+/* what PtpMode is set to, VIMBA_PTP_MODE_NONE leaves it as it is */
+typedef enum {
+    VIMBA_PTP_MODE_NONE,
+    VIMBA_PTP_MODE_OFF,
+    VIMBA_PTP_MODE_SLAVE,
+    VIMBA_PTP_MODE_MASTER,
+    VIMBA_PTP_MODE_AUTO
+} VimbaPtpMode;
+
+/* where buffer timestamps are taken from */
+typedef enum {
+    /* the pipeline clock when the frame is handed downstream */
+    VIMBA_TIMESTAMP_HOST,
+    /* the device time of the exposure, mapped to the pipeline clock */
+    VIMBA_TIMESTAMP_DEVICE
+} VimbaTimestampMode;
+
+typedef struct _VimbaPtp VimbaPtp;
+
+/* called when PtpStatus changed or the clock jumped to a new device time
+ * (rebased), on the monitor thread or, for the first poll, in vimba_ptp_new */
+typedef void (*VimbaPtpNotify) (const gchar * status, gboolean locked,
+                 gboolean rebased, gpointer user_data);
+
+typedef struct {
+    /* PtpStatus, NULL for cameras without PTP */
+    gchar*        status;
+    gboolean      locked;
+    /* PtpOffsetFromMaster in ns, if the camera reports it */
+    gboolean      has_offset;
+    gint64        offset;
+    guint         lock_changes;
+    /* round trip of the last device time latch, bounds the clock error */
+    GstClockTime  latch_time;
+    guint64       observations;
+} VimbaPtpStats;
+
+const gchar * vimba_ptp_mode_feature (VimbaPtpMode mode);
+
+GstClock * vimba_ptp_clock_new (void);
+VimbaPtp * vimba_ptp_new (VimbaCamera * camera, GMutex * camera_lock,
+               GstClock * clock, VimbaPtpNotify notify, gpointer user_data);
+void       vimba_ptp_free (VimbaPtp * ptp);
+GstClock * vimba_ptp_get_clock (VimbaPtp * ptp);
+gboolean   vimba_ptp_calibrated (VimbaPtp * ptp);
+void       vimba_ptp_stats (VimbaPtp * ptp, VimbaPtpStats * stats);
+
+#endif
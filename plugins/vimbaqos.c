@@ -0,0 +1,107 @@
+#include "vimbaqos.h"
+
+/* downstream is overloaded above this proportion, has headroom below */
+#define QOS_OVERLOAD        1.05
+#define QOS_HEADROOM        0.8
+/* how long either has to last before the rate is changed */
+#define QOS_OVERLOAD_TIME   (500 * GST_MSECOND)
+#define QOS_HEADROOM_TIME   (2 * GST_SECOND)
+/* reports right after a change still describe the old rate */
+#define QOS_SETTLE_TIME     GST_SECOND
+/* a lowered rate leaves this much margin below what downstream managed */
+#define QOS_MARGIN          0.9
+/* share of the nominal rate added per step when recovering */
+#define QOS_RAMP_STEP       0.1
+/* smaller changes are not worth a write */
+#define QOS_MIN_CHANGE      0.02
+
+void vimba_qos_reset (VimbaQos * qos) {
+    qos->nominal = 0;
+    qos->minimum = 0;
+    qos->rate = 0;
+    qos->overload_since = GST_CLOCK_TIME_NONE;
+    qos->headroom_since = GST_CLOCK_TIME_NONE;
+    qos->worst_proportion = 0;
+    qos->last_change = GST_CLOCK_TIME_NONE;
+}
+
+gboolean vimba_qos_active (VimbaQos * qos) {
+    return qos->nominal > 0;
+}
+
+/* begin tracking a camera running at nominal, counters are kept */
+void vimba_qos_start (VimbaQos * qos, gdouble nominal, gdouble minimum) {
+    vimba_qos_reset(qos);
+    qos->nominal = nominal;
+    qos->minimum = CLAMP(minimum, 0, nominal);
+    qos->rate = nominal;
+}
+
+static gdouble vimba_qos_change (VimbaQos * qos, gdouble rate, GstClockTime now) {
+    rate = CLAMP(rate, qos->minimum, qos->nominal);
+    if (ABS(rate - qos->rate) < qos->nominal * QOS_MIN_CHANGE &&
+        rate != qos->nominal) {
+        return 0;
+    }
+    if (rate < qos->rate) {
+        qos->lowered++;
+    } else if (rate > qos->rate) {
+        qos->raised++;
+    } else {
+        return 0;
+    }
+    qos->rate = rate;
+    qos->last_change = now;
+    qos->overload_since = GST_CLOCK_TIME_NONE;
+    qos->headroom_since = GST_CLOCK_TIME_NONE;
+    qos->worst_proportion = 0;
+    return rate;
+}
+
+/*
+ * Feed one QoS event, now on a monotonic clock. Returns the rate to write to
+ * the camera, or 0 to leave it as it is.
+ */
+gdouble vimba_qos_observe (
+    VimbaQos * qos, GstQOSType type, gdouble proportion,
+    GstClockTimeDiff diff, GstClockTime now
+) {
+    if (!vimba_qos_active(qos) || (GST_CLOCK_TIME_IS_VALID(qos->last_change)
+            && now < qos->last_change + QOS_SETTLE_TIME)) {
+        return 0;
+    }
+    /* downstream names the interval it wants between buffers */
+    if (type == GST_QOS_TYPE_THROTTLE) {
+        if (diff <= 0) {
+            return vimba_qos_change(qos, qos->nominal, now);
+        }
+        return vimba_qos_change(qos, (gdouble) GST_SECOND / diff, now);
+    }
+
+    if (proportion > QOS_OVERLOAD) {
+        qos->headroom_since = GST_CLOCK_TIME_NONE;
+        if (!GST_CLOCK_TIME_IS_VALID(qos->overload_since)) {
+            qos->overload_since = now;
+        }
+        qos->worst_proportion = MAX(qos->worst_proportion, proportion);
+        if (now >= qos->overload_since + QOS_OVERLOAD_TIME) {
+            return vimba_qos_change(qos,
+                qos->rate / qos->worst_proportion * QOS_MARGIN, now);
+        }
+    } else if (proportion < QOS_HEADROOM && qos->rate < qos->nominal) {
+        qos->overload_since = GST_CLOCK_TIME_NONE;
+        qos->worst_proportion = 0;
+        if (!GST_CLOCK_TIME_IS_VALID(qos->headroom_since)) {
+            qos->headroom_since = now;
+        }
+        if (now >= qos->headroom_since + QOS_HEADROOM_TIME) {
+            return vimba_qos_change(qos,
+                qos->rate + qos->nominal * QOS_RAMP_STEP, now);
+        }
+    } else {
+        qos->overload_since = GST_CLOCK_TIME_NONE;
+        qos->headroom_since = GST_CLOCK_TIME_NONE;
+        qos->worst_proportion = 0;
+    }
+    return 0;
+}
@@ -0,0 +1,38 @@
+#ifndef _VIMBASRC_QOS_H_
+#define _VIMBASRC_QOS_H_
+
+#include <gst/gst.h>
+
+/*
+ * Frame rate throttling from downstream QoS. A camera in free run keeps
+ * sending frames a slow consumer drops anyway, costing link and memory
+ * bandwidth. When QoS events report overload for a while the rate asked of
+ * the camera is lowered to what downstream keeps up with, and once they
+ * report headroom for a while it is raised again in steps, up to the rate
+ * the camera was configured for. After each change the QoS reports are
+ * given time to reflect it before the next one.
+ */
+
+typedef struct {
+    /* configured rate, 0 until the first QoS event after a reset */
+    gdouble       nominal;
+    gdouble       minimum;
+    /* rate currently asked of the camera */
+    gdouble       rate;
+
+    GstClockTime  overload_since;
+    GstClockTime  headroom_since;
+    gdouble       worst_proportion;
+    GstClockTime  last_change;
+
+    guint         lowered;
+    guint         raised;
+} VimbaQos;
+
+void    vimba_qos_reset (VimbaQos * qos);
+gboolean vimba_qos_active (VimbaQos * qos);
+void    vimba_qos_start (VimbaQos * qos, gdouble nominal, gdouble minimum);
+gdouble vimba_qos_observe (VimbaQos * qos, GstQOSType type, gdouble proportion,
+            GstClockTimeDiff diff, GstClockTime now);
+
+#endif
@@ -0,0 +1,66 @@
+#ifndef _VIMBASRC_RAW_FORMAT_H_
+#define _VIMBASRC_RAW_FORMAT_H_
+
+#include <glib.h>
+
+/*
+ * On-disk layout of recordings written by vimbarawsink and read by
+ * vimbareplaysrc. A recording is a directory holding
+ *
+ *   index              VimbaRawHeader, then one VimbaRawIndexEntry per frame
+ *   segment-NNNNN.raw  frame data, every frame starts at a multiple of
+ *                      VIMBA_RAW_ALIGN so segments can be written with
+ *                      O_DIRECT and frames mapped in place
+ *
+ * All fields are little endian, as written by the host.
+ */
+
+#define VIMBA_RAW_MAGIC          "VIMBARAW"
+#define VIMBA_RAW_VERSION        1
+#define VIMBA_RAW_ALIGN          4096
+#define VIMBA_RAW_HEADER_SIZE    4096
+#define VIMBA_RAW_INDEX_NAME     "index"
+#define VIMBA_RAW_SEGMENT_FORMAT "segment-%05u.raw"
+
+/* header flags */
+#define VIMBA_RAW_FLAG_LZ4       (1 << 0)
+
+/* entry status, the VmbFrameStatus_t values of the frames */
+#define VIMBA_RAW_STATUS_COMPLETE    0
+#define VIMBA_RAW_STATUS_INCOMPLETE  (-1)
+
+/* entry flags */
+#define VIMBA_RAW_ENTRY_LZ4      (1 << 0)
+#define VIMBA_RAW_ENTRY_DISCONT  (1 << 1)
+
+typedef struct {
+    gchar    magic[8];
+    guint32  version;
+    guint32  flags;
+    guint64  segment_size;
+    guint32  entry_size;
+    guint32  reserved;
+    /* caps of the recorded stream, nul terminated */
+    gchar    caps[VIMBA_RAW_HEADER_SIZE - 32];
+} VimbaRawHeader;
+
+typedef struct {
+    guint64  frame_id;
+    guint64  device_timestamp;
+    guint64  pts;
+    guint64  duration;
+    guint64  offset;
+    guint32  segment;
+    /* bytes stored in the segment and bytes of the frame itself */
+    guint32  size;
+    guint32  raw_size;
+    /* VmbFrameStatus_t of the frame */
+    gint32   status;
+    guint32  flags;
+    guint32  reserved;
+} VimbaRawIndexEntry;
+
+G_STATIC_ASSERT (sizeof (VimbaRawHeader) == VIMBA_RAW_HEADER_SIZE);
+G_STATIC_ASSERT (sizeof (VimbaRawIndexEntry) == 64);
+
+#endif
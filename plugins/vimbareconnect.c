@@ -0,0 +1,189 @@
+#include "vimbareconnect.h"
+
+/* how often the watchdog looks at the camera */
+#define RECONNECT_POLL_US   50000
+/* pause between attempts to open a camera that is not back yet */
+#define RECONNECT_RETRY_US  100000
+/* a started camera without frames for longer is probed */
+#define RECONNECT_SILENCE   (500 * GST_MSECOND)
+
+struct _VimbaReconnect {
+    VimbaCamera*           camera;
+    GMutex*                camera_lock;
+    VimbaReconnectRestore  restore;
+    gpointer               user_data;
+
+    GThread*      thread;
+    GMutex        lock;
+    GCond         cond;
+    gboolean      running;
+    /* the lost camera is open and configured, waiting to be resumed */
+    gboolean      reopened;
+    GstClockTime  last_probe;
+
+    guint         reconnects;
+    GstClockTime  last_recovery;
+    GstClockTime  max_recovery;
+};
+
+/* a camera that went silent is asked whether it is still there */
+static void vimba_reconnect_watch (VimbaReconnect * reconnect) {
+    VimbaCamera * camera = reconnect->camera;
+    GstClockTime now = gst_util_get_timestamp();
+    GstClockTime last = MAX(camera->last_callback_time, reconnect->last_probe);
+
+    if (!camera->started || now < last + RECONNECT_SILENCE) {
+        return;
+    }
+    reconnect->last_probe = now;
+    if (!vimbacamera_probe(camera)) {
+        vimbacamera_mark_lost(camera);
+    }
+}
+
+/* open the lost camera again and write back its configuration */
+static gboolean vimba_reconnect_reopen (VimbaReconnect * reconnect) {
+    VimbaCamera * camera = reconnect->camera;
+    gboolean reopened;
+
+    g_mutex_lock(reconnect->camera_lock);
+    reopened = vimbacamera_reopen(camera);
+    if (reopened && reconnect->restore != NULL) {
+        reconnect->restore(camera, reconnect->user_data);
+    }
+    g_mutex_unlock(reconnect->camera_lock);
+    if (reopened) {
+        g_message("Camera %s reopened", camera->camera_id);
+    }
+    return reopened;
+}
+
+static gpointer vimba_reconnect_thread (gpointer data) {
+    VimbaReconnect * reconnect = data;
+    gint64 wait = RECONNECT_POLL_US;
+    gboolean lost, reopened;
+
+    g_mutex_lock(&reconnect->lock);
+    while (reconnect->running) {
+        g_cond_wait_until(&reconnect->cond, &reconnect->lock,
+            g_get_monotonic_time() + wait);
+        wait = RECONNECT_POLL_US;
+        /* a reopened camera is up to the streaming thread */
+        if (!reconnect->running || reconnect->reopened) {
+            continue;
+        }
+        g_mutex_unlock(&reconnect->lock);
+        lost = vimbacamera_is_lost(reconnect->camera);
+        reopened = FALSE;
+        if (lost) {
+            reopened = vimba_reconnect_reopen(reconnect);
+        } else {
+            vimba_reconnect_watch(reconnect);
+        }
+        g_mutex_lock(&reconnect->lock);
+        if (reopened) {
+            reconnect->reopened = TRUE;
+            g_cond_broadcast(&reconnect->cond);
+        } else if (lost) {
+            wait = RECONNECT_RETRY_US;
+        }
+    }
+    g_mutex_unlock(&reconnect->lock);
+    return NULL;
+}
+
+VimbaReconnect * vimba_reconnect_new (
+    VimbaCamera * camera, GMutex * camera_lock,
+    VimbaReconnectRestore restore, gpointer user_data
+) {
+    VimbaReconnect * reconnect = g_new0(VimbaReconnect, 1);
+
+    reconnect->camera = camera;
+    reconnect->camera_lock = camera_lock;
+    reconnect->restore = restore;
+    reconnect->user_data = user_data;
+    g_mutex_init(&reconnect->lock);
+    g_cond_init(&reconnect->cond);
+    reconnect->running = TRUE;
+    reconnect->thread = g_thread_new("vimbareconnect", vimba_reconnect_thread,
+        reconnect);
+    return reconnect;
+}
+
+/* an attempt to reopen in progress completes first */
+void vimba_reconnect_free (VimbaReconnect * reconnect) {
+    if (reconnect == NULL) {
+        return;
+    }
+    g_mutex_lock(&reconnect->lock);
+    reconnect->running = FALSE;
+    g_cond_broadcast(&reconnect->cond);
+    g_mutex_unlock(&reconnect->lock);
+    g_thread_join(reconnect->thread);
+
+    g_cond_clear(&reconnect->cond);
+    g_mutex_clear(&reconnect->lock);
+    g_free(reconnect);
+}
+
+/* TRUE once the lost camera is open again, to be resumed */
+gboolean vimba_reconnect_wait (VimbaReconnect * reconnect, guint64 timeout_us) {
+    gint64 deadline = g_get_monotonic_time() + (gint64) timeout_us;
+    gboolean reopened;
+
+    g_mutex_lock(&reconnect->lock);
+    while (!reconnect->reopened && reconnect->running &&
+        g_cond_wait_until(&reconnect->cond, &reconnect->lock, deadline)) {
+    }
+    reopened = reconnect->reopened;
+    g_mutex_unlock(&reconnect->lock);
+    return reopened;
+}
+
+/*
+ * Restart acquisition of the reopened camera, from the streaming thread as
+ * it consumes the frame queue start replaces. FALSE when the camera went
+ * away again, recovery_time is the time since the loss was noticed.
+ */
+gboolean vimba_reconnect_resume (
+    VimbaReconnect * reconnect, GstClockTime * recovery_time
+) {
+    VimbaCamera * camera = reconnect->camera;
+    GstClockTime lost_time = camera->lost_time;
+    GstClockTime recovery;
+    gboolean started;
+
+    g_mutex_lock(reconnect->camera_lock);
+    started = vimbacamera_start(camera);
+    g_mutex_unlock(reconnect->camera_lock);
+    if (!started) {
+        vimbacamera_mark_lost(camera);
+        camera->lost_time = lost_time;
+    }
+    recovery = gst_util_get_timestamp() - lost_time;
+
+    g_mutex_lock(&reconnect->lock);
+    reconnect->reopened = FALSE;
+    if (started) {
+        reconnect->reconnects++;
+        reconnect->last_recovery = recovery;
+        reconnect->max_recovery = MAX(reconnect->max_recovery, recovery);
+    }
+    g_mutex_unlock(&reconnect->lock);
+
+    if (started && recovery_time != NULL) {
+        *recovery_time = recovery;
+    }
+    return started;
+}
+
+void vimba_reconnect_stats (
+    VimbaReconnect * reconnect, guint * reconnects,
+    GstClockTime * last_recovery, GstClockTime * max_recovery
+) {
+    g_mutex_lock(&reconnect->lock);
+    *reconnects = reconnect->reconnects;
+    *last_recovery = reconnect->last_recovery;
+    *max_recovery = reconnect->max_recovery;
+    g_mutex_unlock(&reconnect->lock);
+}
@@ -0,0 +1,30 @@
+#ifndef _VIMBASRC_RECONNECT_H_
+#define _VIMBASRC_RECONNECT_H_
+
+#include <gst/gst.h>
+#include "vimbacamera.h"
+
+/*
+ * Recovery from a camera that went away, a GigE link blip or a power cycle.
+ * A watchdog thread notices the loss, from a failed sdk call or from a
+ * camera that went silent and no longer answers a probe, and reopens the
+ * camera in the background until it is back. The frame ring and the
+ * configuration survive, so the streaming thread only restarts acquisition
+ * once vimba_reconnect_wait tells it the camera is open again.
+ */
+
+typedef struct _VimbaReconnect VimbaReconnect;
+
+/* called on the watchdog thread with the camera lock held, after the camera
+ * was reopened, to write back what vimbacamera_reopen does not */
+typedef void (*VimbaReconnectRestore) (VimbaCamera * camera, gpointer user_data);
+
+VimbaReconnect * vimba_reconnect_new (VimbaCamera * camera, GMutex * camera_lock,
+                     VimbaReconnectRestore restore, gpointer user_data);
+void     vimba_reconnect_free (VimbaReconnect * reconnect);
+gboolean vimba_reconnect_wait (VimbaReconnect * reconnect, guint64 timeout_us);
+gboolean vimba_reconnect_resume (VimbaReconnect * reconnect, GstClockTime * recovery_time);
+void     vimba_reconnect_stats (VimbaReconnect * reconnect, guint * reconnects,
+             GstClockTime * last_recovery, GstClockTime * max_recovery);
+
+#endif
@@ -0,0 +1,170 @@
+#include <string.h>
+#include "vimbasettings.h"
+
+/* passes over the features still to be written before giving up */
+#define SETTINGS_MAX_PASSES 5
+
+/* the form a value is saved in, NULL for types that are not saved */
+static gchar * vimba_settings_value_string (const GValue * value) {
+    gchar buffer[G_ASCII_DTOSTR_BUF_SIZE];
+
+    if (G_VALUE_HOLDS_INT64(value)) {
+        return g_strdup_printf("%" G_GINT64_FORMAT, g_value_get_int64(value));
+    }
+    if (G_VALUE_HOLDS_DOUBLE(value)) {
+        /* round trips exactly, so an unchanged value is skipped on load */
+        return g_strdup(g_ascii_dtostr(buffer, sizeof(buffer),
+            g_value_get_double(value)));
+    }
+    if (G_VALUE_HOLDS_BOOLEAN(value)) {
+        return g_strdup(g_value_get_boolean(value) ? "true" : "false");
+    }
+    if (G_VALUE_HOLDS_STRING(value)) {
+        return g_value_dup_string(value);
+    }
+    return NULL;
+}
+
+static gboolean vimba_settings_saved_type (VmbFeatureData_t type) {
+    return type == VmbFeatureDataInt || type == VmbFeatureDataFloat ||
+        type == VmbFeatureDataBool || type == VmbFeatureDataEnum ||
+        type == VmbFeatureDataString;
+}
+
+gboolean vimba_settings_save (
+    VimbaCamera * camera, const gchar * path, GError ** error
+) {
+    VmbFeatureInfo_t * features;
+    VmbUint32_t count = 0, i;
+    GValue value = G_VALUE_INIT;
+    GKeyFile * file;
+    gchar * string;
+    gboolean res;
+
+    if (!camera->open) {
+        g_set_error(error, GST_RESOURCE_ERROR, GST_RESOURCE_ERROR_NOT_FOUND,
+            "no camera open");
+        return FALSE;
+    }
+    if (VmbErrorSuccess != VmbFeaturesList(camera->camera_handle, NULL, 0,
+            &count, sizeof(VmbFeatureInfo_t)) || count == 0) {
+        g_set_error(error, GST_RESOURCE_ERROR, GST_RESOURCE_ERROR_READ,
+            "cannot list the features of camera %s", camera->camera_id);
+        return FALSE;
+    }
+    features = g_new0(VmbFeatureInfo_t, count);
+    VmbFeaturesList(camera->camera_handle, features, count, &count,
+        sizeof(VmbFeatureInfo_t));
+
+    file = g_key_file_new();
+    g_key_file_set_string(file, "camera", "id", camera->camera_id);
+    for (i = 0; i < count; i++) {
+        if (!vimba_settings_saved_type(features[i].featureDataType) ||
+            !(features[i].featureFlags & VmbFeatureFlagsWrite) ||
+            (features[i].featureFlags & VmbFeatureFlagsVolatile)) {
+            continue;
+        }
+        if (!vimba_feature_get(camera->features, features[i].name, &value)) {
+            continue;
+        }
+        string = vimba_settings_value_string(&value);
+        g_value_unset(&value);
+        if (string != NULL) {
+            g_key_file_set_string(file, VIMBA_SETTINGS_GROUP,
+                features[i].name, string);
+            g_free(string);
+        }
+    }
+    g_free(features);
+
+    res = g_key_file_save_to_file(file, path, error);
+    g_key_file_free(file);
+    if (res) {
+        g_message("Camera %s settings saved to %s", camera->camera_id, path);
+    }
+    return res;
+}
+
+/*
+ * Apply a settings file in one go, skipping features that already have
+ * their value. Must be called with the camera lock held, preferably before
+ * acquisition starts, while geometry and format are still writable.
+ */
+gboolean vimba_settings_load (
+    VimbaCamera * camera, const gchar * path, VimbaSettingsReport * report,
+    GError ** error
+) {
+    GstClockTime start = gst_util_get_timestamp();
+    GValue value = G_VALUE_INIT;
+    GKeyFile * file;
+    gchar ** keys;
+    gboolean * done;
+    gboolean progress = TRUE;
+    gsize count, remaining, i;
+
+    memset(report, 0, sizeof(VimbaSettingsReport));
+    if (!camera->open) {
+        g_set_error(error, GST_RESOURCE_ERROR, GST_RESOURCE_ERROR_NOT_FOUND,
+            "no camera open");
+        return FALSE;
+    }
+    file = g_key_file_new();
+    if (!g_key_file_load_from_file(file, path, G_KEY_FILE_NONE, error)) {
+        g_key_file_free(file);
+        return FALSE;
+    }
+    keys = g_key_file_get_keys(file, VIMBA_SETTINGS_GROUP, &count, error);
+    if (keys == NULL) {
+        g_key_file_free(file);
+        return FALSE;
+    }
+
+    done = g_new0(gboolean, count);
+    remaining = count;
+    while (remaining > 0 && progress && report->passes < SETTINGS_MAX_PASSES) {
+        report->passes++;
+        progress = FALSE;
+        for (i = 0; i < count; i++) {
+            if (done[i]) {
+                continue;
+            }
+            g_value_init(&value, G_TYPE_STRING);
+            g_value_take_string(&value,
+                g_key_file_get_string(file, VIMBA_SETTINGS_GROUP, keys[i], NULL));
+            switch (vimba_feature_update(camera->features, keys[i], &value)) {
+                case VIMBA_FEATURE_UNCHANGED:
+                    report->unchanged++;
+                    done[i] = TRUE;
+                    break;
+                case VIMBA_FEATURE_WRITTEN:
+                    report->written++;
+                    done[i] = TRUE;
+                    break;
+                case VIMBA_FEATURE_FAILED:
+                default:
+                    break;
+            }
+            g_value_unset(&value);
+            if (done[i]) {
+                remaining--;
+                progress = TRUE;
+            }
+        }
+    }
+    for (i = 0; i < count; i++) {
+        if (!done[i]) {
+            GST_WARNING("camera %s rejected %s from %s", camera->camera_id,
+                keys[i], path);
+        }
+    }
+    report->failed = (guint) remaining;
+    report->duration = gst_util_get_timestamp() - start;
+    g_message("Camera %s settings from %s: %u written, %u unchanged, "
+        "%u failed in %u passes", camera->camera_id, path, report->written,
+        report->unchanged, report->failed, report->passes);
+
+    g_free(done);
+    g_strfreev(keys);
+    g_key_file_free(file);
+    return TRUE;
+}
@@ -0,0 +1,31 @@
+#ifndef _VIMBASRC_SETTINGS_H_
+#define _VIMBASRC_SETTINGS_H_
+
+#include <gst/gst.h>
+#include "vimbacamera.h"
+
+/*
+ * Camera settings files: the writable features of a camera as a key file,
+ * one key per feature in the order the camera lists them. Loading compares
+ * every value with what the camera has and only writes the ones that
+ * differ. Writes the camera rejects are retried in further passes, as long
+ * as they make progress, for features that depend on others later in the
+ * file.
+ */
+
+#define VIMBA_SETTINGS_GROUP "features"
+
+/* what loading a settings file did */
+typedef struct {
+    guint         written;
+    guint         unchanged;
+    guint         failed;
+    guint         passes;
+    GstClockTime  duration;
+} VimbaSettingsReport;
+
+gboolean vimba_settings_save (VimbaCamera * camera, const gchar * path, GError ** error);
+gboolean vimba_settings_load (VimbaCamera * camera, const gchar * path,
+             VimbaSettingsReport * report, GError ** error);
+
+#endif
@@ -0,0 +1,509 @@
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include "vimbashm.h"
+
+/* how long the producer waits for a pinned slot with VIMBA_SHM_WAIT */
+#define VIMBA_SHM_WAIT_US G_USEC_PER_SEC
+
+typedef struct {
+    gint32   pid;
+    gint32   active;
+    guint64  read_seq;
+    guint64  received;
+    guint64  dropped;
+} VimbaShmCursor;
+
+typedef struct {
+    /* sequence number of the frame in the slot, 0 while it is written */
+    guint64            seq;
+    guint64            size;
+    /* consumers holding the slot, one bit each */
+    guint64            pins;
+    VimbaShmFrameInfo  info;
+} VimbaShmSlot;
+
+/* start of the shared memory, the slot data follows at data_offset */
+typedef struct {
+    gchar            magic[8];
+    guint32          version;
+    guint32          slot_count;
+    guint64          slot_size;
+    guint64          data_offset;
+    guint64          total_size;
+    gint32           producer_pid;
+    /* set when the producer goes away, consumers reopen the name */
+    gint32           closed;
+    guint32          caps_seq;
+    guint32          reserved;
+    guint64          write_seq;
+    guint64          published;
+    guint64          dropped;
+    pthread_mutex_t  lock;
+    pthread_cond_t   cond;
+    gchar            caps[VIMBA_SHM_CAPS_SIZE];
+    VimbaShmCursor   consumers[VIMBA_SHM_MAX_CONSUMERS];
+    VimbaShmSlot     slots[];
+} VimbaShmHeader;
+
+struct _VimbaShmProducer {
+    gchar*           path;
+    VimbaShmHeader*  header;
+};
+
+struct _VimbaShmConsumer {
+    gint             refcount;
+    VimbaShmHeader*  header;
+    guint            index;
+};
+
+static gsize vimba_shm_round (gsize size, gsize align) {
+    return (size + align - 1) / align * align;
+}
+
+/* shm_open wants a name with a single leading slash */
+static gchar * vimba_shm_path (const gchar * name) {
+    return name[0] == '/' ? g_strdup(name) : g_strconcat("/", name, NULL);
+}
+
+static void vimba_shm_lock (VimbaShmHeader * header) {
+    if (pthread_mutex_lock(&header->lock) == EOWNERDEAD) {
+        /* a process died holding it, every update under it is a few stores */
+        pthread_mutex_consistent(&header->lock);
+    }
+}
+
+static void vimba_shm_unlock (VimbaShmHeader * header) {
+    pthread_mutex_unlock(&header->lock);
+}
+
+/* wait for a broadcast until deadline (monotonic), FALSE on timeout */
+static gboolean vimba_shm_wait (VimbaShmHeader * header, gint64 deadline) {
+    struct timespec ts;
+    int err;
+
+    ts.tv_sec = deadline / G_USEC_PER_SEC;
+    ts.tv_nsec = (deadline % G_USEC_PER_SEC) * 1000;
+    err = pthread_cond_timedwait(&header->cond, &header->lock, &ts);
+    if (err == EOWNERDEAD) {
+        pthread_mutex_consistent(&header->lock);
+    }
+    return err != ETIMEDOUT;
+}
+
+static guint8 * vimba_shm_slot_data (VimbaShmHeader * header, guint slot) {
+    return (guint8 *) header + header->data_offset + slot * header->slot_size;
+}
+
+static gboolean vimba_shm_pid_dead (gint32 pid) {
+    return pid > 0 && kill(pid, 0) != 0 && errno == ESRCH;
+}
+
+/* the producer closed the ring or died without closing it */
+static gboolean vimba_shm_orphaned (VimbaShmHeader * header) {
+    return header->closed || vimba_shm_pid_dead(header->producer_pid);
+}
+
+/* drop a consumer and the pins it holds */
+static void vimba_shm_detach (VimbaShmHeader * header, guint index) {
+    guint64 mask = ~(G_GUINT64_CONSTANT(1) << index);
+    guint i;
+
+    for (i = 0; i < header->slot_count; i++) {
+        header->slots[i].pins &= mask;
+    }
+    header->consumers[index].active = 0;
+    header->consumers[index].pid = 0;
+}
+
+/* release pins of consumers whose process is gone */
+static void vimba_shm_reap (VimbaShmHeader * header, guint64 pins) {
+    guint i;
+
+    for (i = 0; i < VIMBA_SHM_MAX_CONSUMERS; i++) {
+        if ((pins & (G_GUINT64_CONSTANT(1) << i)) &&
+            vimba_shm_pid_dead(header->consumers[i].pid)) {
+            g_message("shared frame ring: consumer %d is gone",
+                header->consumers[i].pid);
+            vimba_shm_detach(header, i);
+        }
+    }
+}
+
+/* a ring left behind by a producer that no longer runs */
+static gboolean vimba_shm_stale (const gchar * path) {
+    VimbaShmHeader * header;
+    struct stat st;
+    gboolean stale = TRUE;
+    int fd = shm_open(path, O_RDONLY, 0);
+
+    if (fd < 0) {
+        return errno == ENOENT;
+    }
+    if (fstat(fd, &st) == 0 && (gsize) st.st_size >= sizeof(VimbaShmHeader)) {
+        header = mmap(NULL, sizeof(VimbaShmHeader), PROT_READ, MAP_SHARED, fd, 0);
+        if (header != MAP_FAILED) {
+            stale = memcmp(header->magic, VIMBA_SHM_MAGIC, 8) != 0 ||
+                header->closed ||
+                vimba_shm_pid_dead(header->producer_pid);
+            munmap(header, sizeof(VimbaShmHeader));
+        }
+    }
+    close(fd);
+    return stale;
+}
+
+VimbaShmProducer * vimba_shm_producer_new (
+    const gchar * name, guint slots, gsize slot_size
+) {
+    VimbaShmProducer * producer;
+    VimbaShmHeader * header;
+    pthread_mutexattr_t mutex_attr;
+    pthread_condattr_t cond_attr;
+    gchar * path = vimba_shm_path(name);
+    gsize header_size, size;
+    int fd;
+
+    slot_size = vimba_shm_round(slot_size, VIMBA_SHM_ALIGN);
+    header_size = vimba_shm_round(
+        sizeof(VimbaShmHeader) + slots * sizeof(VimbaShmSlot), VIMBA_SHM_ALIGN
+    );
+    size = header_size + slots * slot_size;
+
+    fd = shm_open(path, O_RDWR | O_CREAT | O_EXCL, 0660);
+    if (fd < 0 && errno == EEXIST && vimba_shm_stale(path)) {
+        shm_unlink(path);
+        fd = shm_open(path, O_RDWR | O_CREAT | O_EXCL, 0660);
+    }
+    if (fd < 0) {
+        g_warning("cannot create shared frame ring %s: %s", path,
+            g_strerror(errno));
+        g_free(path);
+        return NULL;
+    }
+    if (ftruncate(fd, size) != 0 ||
+        (header = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0))
+            == MAP_FAILED) {
+        g_warning("cannot map %" G_GSIZE_FORMAT " bytes of shared memory: %s",
+            size, g_strerror(errno));
+        close(fd);
+        shm_unlink(path);
+        g_free(path);
+        return NULL;
+    }
+    close(fd);
+
+    /* the memory comes zeroed, so do all cursors and slots */
+    header->version = VIMBA_SHM_VERSION;
+    header->slot_count = slots;
+    header->slot_size = slot_size;
+    header->data_offset = header_size;
+    header->total_size = size;
+    header->producer_pid = getpid();
+
+    pthread_mutexattr_init(&mutex_attr);
+    pthread_mutexattr_setpshared(&mutex_attr, PTHREAD_PROCESS_SHARED);
+    pthread_mutexattr_setrobust(&mutex_attr, PTHREAD_MUTEX_ROBUST);
+    pthread_mutex_init(&header->lock, &mutex_attr);
+    pthread_mutexattr_destroy(&mutex_attr);
+    pthread_condattr_init(&cond_attr);
+    pthread_condattr_setpshared(&cond_attr, PTHREAD_PROCESS_SHARED);
+    pthread_condattr_setclock(&cond_attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&header->cond, &cond_attr);
+    pthread_condattr_destroy(&cond_attr);
+
+    /* consumers attach once the magic is there */
+    __sync_synchronize();
+    memcpy(header->magic, VIMBA_SHM_MAGIC, sizeof(header->magic));
+
+    g_message("shared frame ring %s: %u x %" G_GSIZE_FORMAT " bytes", path,
+        slots, slot_size);
+
+    producer = g_new0(VimbaShmProducer, 1);
+    producer->path = path;
+    producer->header = header;
+    return producer;
+}
+
+void vimba_shm_producer_free (VimbaShmProducer * producer) {
+    VimbaShmHeader * header;
+
+    if (producer == NULL) {
+        return;
+    }
+    header = producer->header;
+    vimba_shm_lock(header);
+    header->closed = 1;
+    pthread_cond_broadcast(&header->cond);
+    vimba_shm_unlock(header);
+
+    /* consumers keep their mapping until they reopen the name */
+    shm_unlink(producer->path);
+    munmap(header, header->total_size);
+    g_free(producer->path);
+    g_free(producer);
+}
+
+gsize vimba_shm_producer_slot_size (VimbaShmProducer * producer) {
+    return producer->header->slot_size;
+}
+
+void vimba_shm_producer_set_caps (VimbaShmProducer * producer, const gchar * caps) {
+    VimbaShmHeader * header = producer->header;
+
+    vimba_shm_lock(header);
+    if (strncmp(header->caps, caps, VIMBA_SHM_CAPS_SIZE) != 0) {
+        g_strlcpy(header->caps, caps, VIMBA_SHM_CAPS_SIZE);
+        header->caps_seq++;
+    }
+    vimba_shm_unlock(header);
+}
+
+/*
+ * Copy a frame into the next slot. Returns FALSE when the frame was dropped
+ * because a consumer still pins that slot or the frame does not fit.
+ */
+gboolean vimba_shm_producer_write (
+    VimbaShmProducer * producer, const guint8 * data, gsize size,
+    VimbaShmFrameInfo * info, VimbaShmDropPolicy policy
+) {
+    VimbaShmHeader * header = producer->header;
+    gint64 deadline = g_get_monotonic_time() + VIMBA_SHM_WAIT_US;
+    VimbaShmSlot * slot;
+    guint64 seq;
+    guint index;
+
+    vimba_shm_lock(header);
+    seq = header->write_seq + 1;
+    index = seq % header->slot_count;
+    slot = &header->slots[index];
+    while (slot->pins != 0) {
+        vimba_shm_reap(header, slot->pins);
+        if (slot->pins == 0 || policy != VIMBA_SHM_WAIT ||
+            !vimba_shm_wait(header, deadline)) {
+            break;
+        }
+    }
+    if (slot->pins != 0 || size > header->slot_size) {
+        header->dropped++;
+        vimba_shm_unlock(header);
+        return FALSE;
+    }
+    /* readers skip the slot until it is published again */
+    slot->seq = 0;
+    vimba_shm_unlock(header);
+
+    memcpy(vimba_shm_slot_data(header, index), data, size);
+
+    vimba_shm_lock(header);
+    info->caps_seq = header->caps_seq;
+    slot->info = *info;
+    slot->size = size;
+    slot->seq = seq;
+    header->write_seq = seq;
+    header->published++;
+    pthread_cond_broadcast(&header->cond);
+    vimba_shm_unlock(header);
+    return TRUE;
+}
+
+void vimba_shm_producer_stats (
+    VimbaShmProducer * producer,
+    guint64 * published, guint64 * dropped, guint * consumers
+) {
+    VimbaShmHeader * header = producer->header;
+    guint i;
+
+    vimba_shm_lock(header);
+    *published = header->published;
+    *dropped = header->dropped;
+    *consumers = 0;
+    for (i = 0; i < VIMBA_SHM_MAX_CONSUMERS; i++) {
+        if (header->consumers[i].active) {
+            (*consumers)++;
+        }
+    }
+    vimba_shm_unlock(header);
+}
+
+/* NULL while there is no producer for the name */
+VimbaShmConsumer * vimba_shm_consumer_open (const gchar * name) {
+    VimbaShmConsumer * consumer;
+    VimbaShmHeader * header;
+    gchar * path = vimba_shm_path(name);
+    struct stat st;
+    guint index;
+    int fd;
+
+    fd = shm_open(path, O_RDWR, 0);
+    g_free(path);
+    if (fd < 0) {
+        return NULL;
+    }
+    if (fstat(fd, &st) != 0 || (gsize) st.st_size < sizeof(VimbaShmHeader) ||
+        (header = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED,
+            fd, 0)) == MAP_FAILED) {
+        close(fd);
+        return NULL;
+    }
+    close(fd);
+
+    if (memcmp(header->magic, VIMBA_SHM_MAGIC, sizeof(header->magic)) != 0 ||
+        header->version != VIMBA_SHM_VERSION ||
+        header->total_size != (guint64) st.st_size) {
+        munmap(header, st.st_size);
+        return NULL;
+    }
+    __sync_synchronize();
+
+    vimba_shm_lock(header);
+    for (index = 0; index < VIMBA_SHM_MAX_CONSUMERS; index++) {
+        VimbaShmCursor * cursor = &header->consumers[index];
+        if (!cursor->active || vimba_shm_pid_dead(cursor->pid)) {
+            break;
+        }
+    }
+    if (vimba_shm_orphaned(header) || index == VIMBA_SHM_MAX_CONSUMERS) {
+        vimba_shm_unlock(header);
+        if (index == VIMBA_SHM_MAX_CONSUMERS) {
+            g_warning("shared frame ring %s has %u consumers already", name,
+                VIMBA_SHM_MAX_CONSUMERS);
+        }
+        munmap(header, st.st_size);
+        return NULL;
+    }
+    vimba_shm_detach(header, index);
+    header->consumers[index].pid = getpid();
+    header->consumers[index].active = 1;
+    /* start with the next frame */
+    header->consumers[index].read_seq = header->write_seq + 1;
+    header->consumers[index].received = 0;
+    header->consumers[index].dropped = 0;
+    vimba_shm_unlock(header);
+
+    consumer = g_new0(VimbaShmConsumer, 1);
+    consumer->refcount = 1;
+    consumer->header = header;
+    consumer->index = index;
+    return consumer;
+}
+
+VimbaShmConsumer * vimba_shm_consumer_ref (VimbaShmConsumer * consumer) {
+    g_atomic_int_inc(&consumer->refcount);
+    return consumer;
+}
+
+/* the mapping stays until the last frame read from it is released */
+void vimba_shm_consumer_unref (VimbaShmConsumer * consumer) {
+    VimbaShmHeader * header;
+
+    if (consumer == NULL || !g_atomic_int_dec_and_test(&consumer->refcount)) {
+        return;
+    }
+    header = consumer->header;
+    vimba_shm_lock(header);
+    if (header->consumers[consumer->index].pid == getpid()) {
+        vimba_shm_detach(header, consumer->index);
+    }
+    vimba_shm_unlock(header);
+    munmap(header, header->total_size);
+    g_free(consumer);
+}
+
+/*
+ * Pin and return the next frame. Frames that were overwritten before the
+ * consumer got to them are skipped and counted as dropped.
+ */
+VimbaShmResult vimba_shm_consumer_read (
+    VimbaShmConsumer * consumer, guint64 timeout_us, VimbaShmFrame * frame
+) {
+    VimbaShmHeader * header = consumer->header;
+    VimbaShmCursor * cursor = &header->consumers[consumer->index];
+    gint64 deadline = g_get_monotonic_time() + timeout_us;
+    VimbaShmSlot * slot;
+    guint index;
+
+    vimba_shm_lock(header);
+    for (;;) {
+        if (header->closed || !cursor->active) {
+            vimba_shm_unlock(header);
+            return VIMBA_SHM_CLOSED;
+        }
+        if (cursor->read_seq <= header->write_seq) {
+            guint64 oldest = header->write_seq >= header->slot_count
+                ? header->write_seq - header->slot_count + 1 : 1;
+
+            if (cursor->read_seq < oldest) {
+                cursor->dropped += oldest - cursor->read_seq;
+                cursor->read_seq = oldest;
+            }
+            index = cursor->read_seq % header->slot_count;
+            slot = &header->slots[index];
+            if (slot->seq == cursor->read_seq) {
+                break;
+            }
+            /* the producer is overwriting it right now */
+            cursor->dropped++;
+            cursor->read_seq++;
+            continue;
+        }
+        if (!vimba_shm_wait(header, deadline)) {
+            /* a producer that crashed never sets closed */
+            gboolean dead = vimba_shm_pid_dead(header->producer_pid);
+
+            vimba_shm_unlock(header);
+            return dead ? VIMBA_SHM_CLOSED : VIMBA_SHM_TIMEOUT;
+        }
+    }
+
+    slot->pins |= G_GUINT64_CONSTANT(1) << consumer->index;
+    frame->slot = index;
+    frame->seq = slot->seq;
+    frame->data = vimba_shm_slot_data(header, index);
+    frame->size = slot->size;
+    frame->info = slot->info;
+    cursor->read_seq++;
+    cursor->received++;
+    vimba_shm_unlock(header);
+    return VIMBA_SHM_OK;
+}
+
+void vimba_shm_consumer_release (VimbaShmConsumer * consumer, guint slot) {
+    VimbaShmHeader * header = consumer->header;
+
+    vimba_shm_lock(header);
+    header->slots[slot].pins &= ~(G_GUINT64_CONSTANT(1) << consumer->index);
+    /* the producer may be waiting for it */
+    pthread_cond_broadcast(&header->cond);
+    vimba_shm_unlock(header);
+}
+
+gchar * vimba_shm_consumer_caps (VimbaShmConsumer * consumer, guint32 * caps_seq) {
+    VimbaShmHeader * header = consumer->header;
+    gchar * caps;
+
+    vimba_shm_lock(header);
+    caps = g_strndup(header->caps, VIMBA_SHM_CAPS_SIZE);
+    *caps_seq = header->caps_seq;
+    vimba_shm_unlock(header);
+    return caps;
+}
+
+void vimba_shm_consumer_stats (
+    VimbaShmConsumer * consumer, guint64 * received, guint64 * dropped
+) {
+    VimbaShmHeader * header = consumer->header;
+
+    vimba_shm_lock(header);
+    *received = header->consumers[consumer->index].received;
+    *dropped = header->consumers[consumer->index].dropped;
+    vimba_shm_unlock(header);
+}
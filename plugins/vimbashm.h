@@ -0,0 +1,79 @@
+#ifndef _VIMBASRC_SHM_H_
+#define _VIMBASRC_SHM_H_
+
+#include <glib.h>
+
+/*
+ * A frame ring in POSIX shared memory, so the one process that owns a camera
+ * can hand its frames to others. The producer copies every frame once into
+ * the next slot; each consumer has its own read cursor and reads slots in
+ * place. A slot read by a consumer stays pinned until the consumer releases
+ * it, the producer drops frames (or waits) rather than overwriting it. A
+ * consumer that falls more than a ring behind skips the frames it missed.
+ */
+
+#define VIMBA_SHM_MAGIC          "VIMBASHM"
+#define VIMBA_SHM_VERSION        1
+#define VIMBA_SHM_ALIGN          4096
+#define VIMBA_SHM_CAPS_SIZE      2048
+/* one bit per consumer in the pins of a slot */
+#define VIMBA_SHM_MAX_CONSUMERS  64
+
+/* what the producer does when the next slot is still pinned */
+typedef enum {
+    VIMBA_SHM_DROP_FRAME,
+    VIMBA_SHM_WAIT
+} VimbaShmDropPolicy;
+
+typedef enum {
+    VIMBA_SHM_OK,
+    VIMBA_SHM_TIMEOUT,
+    /* the producer closed the ring or its process is gone */
+    VIMBA_SHM_CLOSED
+} VimbaShmResult;
+
+/* what travels with a frame besides its data */
+typedef struct {
+    guint64  frame_id;
+    guint64  trigger_id;
+    guint64  device_timestamp;
+    /* monotonic time (gst_util_get_timestamp()) the frame reached the host */
+    guint64  capture_time;
+    guint64  duration;
+    gint32   status;
+    guint32  caps_seq;
+} VimbaShmFrameInfo;
+
+/* a frame read by a consumer, valid until it is released */
+typedef struct {
+    guint              slot;
+    guint64            seq;
+    const guint8*      data;
+    gsize              size;
+    VimbaShmFrameInfo  info;
+} VimbaShmFrame;
+
+typedef struct _VimbaShmProducer VimbaShmProducer;
+typedef struct _VimbaShmConsumer VimbaShmConsumer;
+
+VimbaShmProducer * vimba_shm_producer_new (const gchar * name, guint slots, gsize slot_size);
+void         vimba_shm_producer_free (VimbaShmProducer * producer);
+gsize        vimba_shm_producer_slot_size (VimbaShmProducer * producer);
+void         vimba_shm_producer_set_caps (VimbaShmProducer * producer, const gchar * caps);
+gboolean     vimba_shm_producer_write (VimbaShmProducer * producer,
+                 const guint8 * data, gsize size, VimbaShmFrameInfo * info,
+                 VimbaShmDropPolicy policy);
+void         vimba_shm_producer_stats (VimbaShmProducer * producer,
+                 guint64 * published, guint64 * dropped, guint * consumers);
+
+VimbaShmConsumer * vimba_shm_consumer_open (const gchar * name);
+VimbaShmConsumer * vimba_shm_consumer_ref (VimbaShmConsumer * consumer);
+void         vimba_shm_consumer_unref (VimbaShmConsumer * consumer);
+VimbaShmResult vimba_shm_consumer_read (VimbaShmConsumer * consumer,
+                 guint64 timeout_us, VimbaShmFrame * frame);
+void         vimba_shm_consumer_release (VimbaShmConsumer * consumer, guint slot);
+gchar *      vimba_shm_consumer_caps (VimbaShmConsumer * consumer, guint32 * caps_seq);
+void         vimba_shm_consumer_stats (VimbaShmConsumer * consumer,
+                 guint64 * received, guint64 * dropped);
+
+#endif
@@ -0,0 +1,205 @@
+#include "vimbasync.h"
+
+typedef struct _VimbaSyncGroup VimbaSyncGroup;
+struct _VimbaSyncGroup {
+    guint32  device_key;
+    guint32  group_key;
+    guint32  group_mask;
+    GList*   cameras;
+    guint64  trigger_id;
+
+    /* free running action commands, 0 = only on request */
+    gdouble  rate;
+    GThread* timer;
+    gboolean running;
+};
+
+static GMutex      sync_lock;
+static GCond       sync_cond;
+static GHashTable* sync_groups = NULL;
+
+static VimbaSyncGroup * vimba_sync_get_group (guint32 group_key, gboolean create) {
+    VimbaSyncGroup * group;
+
+    if (sync_groups == NULL) {
+        if (!create) {
+            return NULL;
+        }
+        sync_groups = g_hash_table_new(g_direct_hash, g_direct_equal);
+    }
+    group = g_hash_table_lookup(sync_groups, GUINT_TO_POINTER(group_key));
+    if (group == NULL && create) {
+        group = g_new0(VimbaSyncGroup, 1);
+        group->group_key = group_key;
+        g_hash_table_insert(sync_groups, GUINT_TO_POINTER(group_key), group);
+    }
+    return group;
+}
+
+/* must be called with sync_lock held */
+static guint64 vimba_sync_fire_locked (VimbaSyncGroup * group) {
+    VmbError_t err;
+
+    if (group->cameras == NULL) {
+        return group->trigger_id;
+    }
+    VmbFeatureIntSet(gVimbaHandle, "ActionDeviceKey", group->device_key);
+    VmbFeatureIntSet(gVimbaHandle, "ActionGroupKey", group->group_key);
+    VmbFeatureIntSet(gVimbaHandle, "ActionGroupMask", group->group_mask);
+    err = VmbFeatureCommandRun(gVimbaHandle, "ActionCommand");
+    if (VmbErrorSuccess != err) {
+        g_warning("Unable to send action command to group %u: %d",
+            group->group_key, err
+        );
+        return group->trigger_id;
+    }
+    return ++group->trigger_id;
+}
+
+static gpointer vimba_sync_timer (gpointer data) {
+    VimbaSyncGroup * group = data;
+    gint64 next = g_get_monotonic_time();
+
+    g_mutex_lock(&sync_lock);
+    while (group->running) {
+        if (group->rate <= 0) {
+            g_cond_wait(&sync_cond, &sync_lock);
+            next = g_get_monotonic_time();
+            continue;
+        }
+        next += (gint64) (G_USEC_PER_SEC / group->rate);
+        while (group->running &&
+            g_cond_wait_until(&sync_cond, &sync_lock, next)) {
+            /* woken up early, wait for the deadline */
+        }
+        if (group->running) {
+            vimba_sync_fire_locked(group);
+        }
+    }
+    g_mutex_unlock(&sync_lock);
+    return NULL;
+}
+
+/* must be called with sync_lock held */
+static void vimba_sync_update_timer (VimbaSyncGroup * group) {
+    gboolean wanted = group->cameras != NULL && group->rate > 0;
+    GThread * timer = NULL;
+
+    if (wanted && group->timer == NULL) {
+        group->running = TRUE;
+        group->timer = g_thread_new("vimbasync", vimba_sync_timer, group);
+    } else if (!wanted && group->timer != NULL) {
+        group->running = FALSE;
+        timer = group->timer;
+        group->timer = NULL;
+    }
+    g_cond_broadcast(&sync_cond);
+
+    if (timer != NULL) {
+        g_mutex_unlock(&sync_lock);
+        g_thread_join(timer);
+        g_mutex_lock(&sync_lock);
+    }
+}
+
+/*
+ * Acquisition starts under the sync lock, so the first frame of the camera
+ * answers the first action command fired after trigger_base.
+ */
+VmbError_t vimba_sync_join (VimbaCamera * camera, VimbaSyncStart start) {
+    VimbaSyncGroup * group;
+    VmbError_t err;
+
+    g_mutex_lock(&sync_lock);
+    err = start(camera);
+    if (VmbErrorSuccess != err) {
+        g_mutex_unlock(&sync_lock);
+        return err;
+    }
+    group = vimba_sync_get_group(camera->action_group_key, TRUE);
+    if (group->cameras == NULL) {
+        group->device_key = camera->action_device_key;
+        group->group_mask = camera->action_group_mask;
+    } else if (group->device_key != camera->action_device_key ||
+        group->group_mask != camera->action_group_mask) {
+        g_warning(
+            "Camera %s uses different action keys than its sync group %u",
+            camera->camera_id, group->group_key
+        );
+    }
+    if (g_list_find(group->cameras, camera) == NULL) {
+        group->cameras = g_list_append(group->cameras, camera);
+    }
+    /* the first frame of this camera answers the next action command */
+    camera->trigger_base = group->trigger_id;
+    g_message("Camera %s joined sync group %u (%u cameras)",
+        camera->camera_id, group->group_key, g_list_length(group->cameras)
+    );
+    vimba_sync_update_timer(group);
+    g_mutex_unlock(&sync_lock);
+    return VmbErrorSuccess;
+}
+
+void vimba_sync_leave (VimbaCamera * camera) {
+    VimbaSyncGroup * group;
+
+    g_mutex_lock(&sync_lock);
+    group = vimba_sync_get_group(camera->action_group_key, FALSE);
+    if (group != NULL && g_list_find(group->cameras, camera) != NULL) {
+        group->cameras = g_list_remove(group->cameras, camera);
+        g_message("Camera %s left sync group %u",
+            camera->camera_id, group->group_key
+        );
+        vimba_sync_update_timer(group);
+    }
+    g_mutex_unlock(&sync_lock);
+}
+
+guint64 vimba_sync_fire (guint32 group_key) {
+    VimbaSyncGroup * group;
+    guint64 trigger_id = 0;
+
+    g_mutex_lock(&sync_lock);
+    group = vimba_sync_get_group(group_key, FALSE);
+    if (group != NULL) {
+        trigger_id = vimba_sync_fire_locked(group);
+    }
+    g_mutex_unlock(&sync_lock);
+    return trigger_id;
+}
+
+void vimba_sync_set_rate (guint32 group_key, gdouble rate) {
+    VimbaSyncGroup * group;
+
+    g_mutex_lock(&sync_lock);
+    group = vimba_sync_get_group(group_key, TRUE);
+    group->rate = rate;
+    vimba_sync_update_timer(group);
+    g_mutex_unlock(&sync_lock);
+}
+
+guint64 vimba_sync_trigger_id (guint32 group_key) {
+    VimbaSyncGroup * group;
+    guint64 trigger_id = 0;
+
+    g_mutex_lock(&sync_lock);
+    group = vimba_sync_get_group(group_key, FALSE);
+    if (group != NULL) {
+        trigger_id = group->trigger_id;
+    }
+    g_mutex_unlock(&sync_lock);
+    return trigger_id;
+}
+
+guint vimba_sync_participants (guint32 group_key) {
+    VimbaSyncGroup * group;
+    guint count = 0;
+
+    g_mutex_lock(&sync_lock);
+    group = vimba_sync_get_group(group_key, FALSE);
+    if (group != NULL) {
+        count = g_list_length(group->cameras);
+    }
+    g_mutex_unlock(&sync_lock);
+    return count;
+}
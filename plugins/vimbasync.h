@@ -0,0 +1,24 @@
+#ifndef _VIMBASRC_SYNC_H_
+#define _VIMBASRC_SYNC_H_
+
+#include "vimbacamera.h"
+
+/*
+ * Process wide coordinator for cameras in action command trigger mode.
+ * Cameras sharing an action group key form a sync group; one action command
+ * exposes a frame on all of them, so frames with the same trigger id
+ * belong to the same set.
+ */
+
+/* starts acquisition of a joining camera, with no action command fired
+ * meanwhile */
+typedef VmbError_t (*VimbaSyncStart) (VimbaCamera * camera);
+
+VmbError_t vimba_sync_join (VimbaCamera * camera, VimbaSyncStart start);
+void     vimba_sync_leave (VimbaCamera * camera);
+guint64  vimba_sync_fire (guint32 group_key);
+void     vimba_sync_set_rate (guint32 group_key, gdouble rate);
+guint64  vimba_sync_trigger_id (guint32 group_key);
+guint    vimba_sync_participants (guint32 group_key);
+
+#endif
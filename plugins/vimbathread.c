@@ -0,0 +1,269 @@
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include "vimbathread.h"
+
+/* params are written by the application and read by the capture threads */
+static GMutex params_lock;
+
+/* what a thread had before vimba_thread_apply_pending changed it */
+typedef struct {
+    cpu_set_t          cpus;
+    gboolean           cpus_valid;
+    gint               policy;
+    struct sched_param param;
+    gboolean           sched_valid;
+} VimbaThreadSaved;
+
+/* "0-3,8" into a cpu set, FALSE on a malformed list */
+static gboolean vimba_thread_parse_cpus (const gchar * list, cpu_set_t * set) {
+    gchar ** ranges = g_strsplit(list, ",", -1);
+    gboolean valid = TRUE;
+    guint i;
+
+    CPU_ZERO(set);
+    for (i = 0; ranges[i] != NULL && valid; i++) {
+        gchar * end;
+        glong first, last;
+
+        first = last = strtol(ranges[i], &end, 10);
+        if (end == ranges[i]) {
+            valid = FALSE;
+            break;
+        }
+        if (*end == '-') {
+            const gchar * start = end + 1;
+            last = strtol(start, &end, 10);
+            valid = end != start;
+        }
+        valid = valid && *end == '\0' && first >= 0 && first <= last &&
+            last < CPU_SETSIZE;
+        for (; valid && first <= last; first++) {
+            CPU_SET(first, set);
+        }
+    }
+    g_strfreev(ranges);
+    return valid && CPU_COUNT(set) > 0;
+}
+
+static gchar * vimba_thread_format_cpus (const cpu_set_t * set) {
+    GString * list = g_string_new(NULL);
+    gint cpu = 0;
+
+    while (cpu < CPU_SETSIZE) {
+        gint first;
+
+        if (!CPU_ISSET(cpu, set)) {
+            cpu++;
+            continue;
+        }
+        first = cpu;
+        while (cpu + 1 < CPU_SETSIZE && CPU_ISSET(cpu + 1, set)) {
+            cpu++;
+        }
+        if (list->len > 0) {
+            g_string_append_c(list, ',');
+        }
+        if (cpu == first) {
+            g_string_append_printf(list, "%d", first);
+        } else {
+            g_string_append_printf(list, "%d-%d", first, cpu);
+        }
+        cpu++;
+    }
+    return g_string_free(list, FALSE);
+}
+
+void vimba_thread_params_init (VimbaThreadParams * params) {
+    params->cpus = NULL;
+    params->priority = 0;
+    params->requested = FALSE;
+    /* differs from applied, so the first run reports what the thread has */
+    params->generation = 1;
+    params->applied = 0;
+    params->saved = NULL;
+}
+
+void vimba_thread_params_set_cpus (
+    VimbaThreadParams * params, const gchar * cpus
+) {
+    gchar * copy = g_strdup(cpus);
+
+    g_mutex_lock(&params_lock);
+    g_free(params->cpus);
+    params->cpus = copy;
+    params->requested = TRUE;
+    g_atomic_int_inc(&params->generation);
+    g_mutex_unlock(&params_lock);
+}
+
+void vimba_thread_params_set_priority (
+    VimbaThreadParams * params, gint priority
+) {
+    g_mutex_lock(&params_lock);
+    params->priority = priority;
+    params->requested = TRUE;
+    g_atomic_int_inc(&params->generation);
+    g_mutex_unlock(&params_lock);
+}
+
+/* the requested cpu list, to be freed */
+gchar * vimba_thread_params_dup_cpus (VimbaThreadParams * params) {
+    gchar * cpus;
+
+    g_mutex_lock(&params_lock);
+    cpus = g_strdup(params->cpus);
+    g_mutex_unlock(&params_lock);
+    return cpus;
+}
+
+void vimba_thread_params_clear (VimbaThreadParams * params) {
+    g_mutex_lock(&params_lock);
+    g_free(params->cpus);
+    params->cpus = NULL;
+    g_mutex_unlock(&params_lock);
+    g_free(params->saved);
+    params->saved = NULL;
+}
+
+/* on start, the thread that runs next may not be the one that applied, so
+ * it applies again and the stats wait for it */
+void vimba_thread_params_reset (
+    VimbaThreadParams * params, VimbaThreadReport * report
+) {
+    g_atomic_int_set(&params->applied, 0);
+    g_mutex_lock(&report->lock);
+    report->valid = FALSE;
+    g_mutex_unlock(&report->lock);
+}
+
+/* called from the thread to configure, does nothing if nothing changed */
+void vimba_thread_apply_pending (
+    VimbaThreadParams * params, VimbaThreadReport * report
+) {
+    gint generation = g_atomic_int_get(&params->generation);
+    struct sched_param param = { 0 };
+    cpu_set_t set;
+    gint policy, res, error = 0;
+    gboolean requested;
+    gchar * cpus;
+
+    if (generation == g_atomic_int_get(&params->applied)) {
+        return;
+    }
+    g_atomic_int_set(&params->applied, generation);
+
+    g_mutex_lock(&params_lock);
+    requested = params->requested;
+    cpus = g_strdup(params->cpus);
+    param.sched_priority = CLAMP(params->priority, 0, VIMBA_THREAD_MAX_PRIORITY);
+    g_mutex_unlock(&params_lock);
+
+    if (!requested) {
+        goto report;
+    }
+    if (params->saved == NULL) {
+        VimbaThreadSaved * saved = g_new0(VimbaThreadSaved, 1);
+
+        saved->cpus_valid = pthread_getaffinity_np(pthread_self(),
+            sizeof(saved->cpus), &saved->cpus) == 0;
+        saved->sched_valid = pthread_getschedparam(pthread_self(),
+            &saved->policy, &saved->param) == 0;
+        params->saved = saved;
+    }
+    if (cpus != NULL) {
+        if (!vimba_thread_parse_cpus(cpus, &set)) {
+            GST_WARNING("invalid cpu list \"%s\"", cpus);
+            error = EINVAL;
+        } else {
+            error = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+        }
+    }
+    policy = param.sched_priority > 0 ? SCHED_FIFO : SCHED_OTHER;
+    /* SCHED_FIFO needs CAP_SYS_NICE or an RLIMIT_RTPRIO, EPERM otherwise */
+    res = pthread_setschedparam(pthread_self(), policy, &param);
+    error = res != 0 ? res : error;
+    if (error != 0) {
+        GST_WARNING("cannot apply cpus \"%s\", priority %d: %s",
+            cpus ? cpus : "", param.sched_priority, g_strerror(error));
+    }
+
+report:
+    g_free(cpus);
+    g_mutex_lock(&report->lock);
+    report->valid = TRUE;
+    report->error = error;
+    g_free(report->cpus);
+    report->cpus = pthread_getaffinity_np(pthread_self(), sizeof(set), &set) == 0
+        ? vimba_thread_format_cpus(&set) : NULL;
+    if (pthread_getschedparam(pthread_self(), &policy, &param) == 0) {
+        report->policy = policy;
+        report->priority = param.sched_priority;
+    }
+    g_mutex_unlock(&report->lock);
+}
+
+/* called from the thread before it leaves, puts back what applying changed */
+void vimba_thread_restore (
+    VimbaThreadParams * params, VimbaThreadReport * report
+) {
+    VimbaThreadSaved * saved = params->saved;
+
+    if (saved != NULL) {
+        if (saved->cpus_valid) {
+            pthread_setaffinity_np(pthread_self(), sizeof(saved->cpus),
+                &saved->cpus);
+        }
+        if (saved->sched_valid) {
+            pthread_setschedparam(pthread_self(), saved->policy, &saved->param);
+        }
+        params->saved = NULL;
+        g_free(saved);
+    }
+    vimba_thread_params_reset(params, report);
+}
+
+void vimba_thread_report_init (VimbaThreadReport * report) {
+    g_mutex_init(&report->lock);
+    report->valid = FALSE;
+    report->cpus = NULL;
+}
+
+void vimba_thread_report_clear (VimbaThreadReport * report) {
+    g_free(report->cpus);
+    report->cpus = NULL;
+    g_mutex_clear(&report->lock);
+}
+
+/* adds <prefix>-cpus, -policy, -priority and -error once the thread applied */
+void vimba_thread_report_to_structure (
+    VimbaThreadReport * report, GstStructure * structure, const gchar * prefix
+) {
+    gchar * cpus = g_strconcat(prefix, "-cpus", NULL);
+    gchar * policy = g_strconcat(prefix, "-policy", NULL);
+    gchar * priority = g_strconcat(prefix, "-priority", NULL);
+    gchar * error = g_strconcat(prefix, "-error", NULL);
+
+    g_mutex_lock(&report->lock);
+    if (report->valid) {
+        gst_structure_set(structure,
+            cpus, G_TYPE_STRING, report->cpus,
+            policy, G_TYPE_STRING,
+                report->policy == SCHED_FIFO ? "fifo" :
+                report->policy == SCHED_RR ? "rr" : "other",
+            priority, G_TYPE_INT, report->priority,
+            error, G_TYPE_STRING,
+                report->error != 0 ? g_strerror(report->error) : "",
+            NULL
+        );
+    }
+    g_mutex_unlock(&report->lock);
+
+    g_free(cpus);
+    g_free(policy);
+    g_free(priority);
+    g_free(error);
+}
@@ -0,0 +1,53 @@
+#ifndef _VIMBASRC_THREAD_H_
+#define _VIMBASRC_THREAD_H_
+
+#include <gst/gst.h>
+
+/*
+ * CPU affinity and real-time scheduling of the capture threads. Settings
+ * are requested by the thread itself, the first time it runs after they
+ * changed, and what the kernel granted is kept for the element stats. A
+ * pooled thread puts its own settings back before it returns to the pool.
+ */
+
+/* highest SCHED_FIFO priority that may be requested */
+#define VIMBA_THREAD_MAX_PRIORITY 99
+
+typedef struct {
+    /* requested cpu list ("0-3,8"), NULL = leave the affinity */
+    gchar*   cpus;
+    /* SCHED_FIFO priority, 0 = SCHED_OTHER */
+    gint     priority;
+    /* whether anything was requested, else the settings are only read */
+    gboolean requested;
+    /* bumped on every change, the thread applies when it differs */
+    gint     generation;
+    gint     applied;
+    /* the thread's settings before the first request, for restoring */
+    gpointer saved;
+} VimbaThreadParams;
+
+typedef struct {
+    GMutex   lock;
+    gboolean valid;
+    /* effective settings, read back after applying */
+    gchar*   cpus;
+    gint     policy;
+    gint     priority;
+    /* errno of the last request the kernel refused, 0 = none */
+    gint     error;
+} VimbaThreadReport;
+
+void     vimba_thread_params_init (VimbaThreadParams * params);
+void     vimba_thread_params_set_cpus (VimbaThreadParams * params, const gchar * cpus);
+void     vimba_thread_params_set_priority (VimbaThreadParams * params, gint priority);
+gchar *  vimba_thread_params_dup_cpus (VimbaThreadParams * params);
+void     vimba_thread_params_clear (VimbaThreadParams * params);
+void     vimba_thread_params_reset (VimbaThreadParams * params, VimbaThreadReport * report);
+void     vimba_thread_apply_pending (VimbaThreadParams * params, VimbaThreadReport * report);
+void     vimba_thread_restore (VimbaThreadParams * params, VimbaThreadReport * report);
+void     vimba_thread_report_init (VimbaThreadReport * report);
+void     vimba_thread_report_clear (VimbaThreadReport * report);
+void     vimba_thread_report_to_structure (VimbaThreadReport * report, GstStructure * structure, const gchar * prefix);
+
+#endif
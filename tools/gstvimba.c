@@ -1,11 +1,684 @@
-/* This file should be replaced by application source generated by
- * gst-app-maker, or by your own source code.  To generate suitable
- * app source using gst-app-maker, run:
+/* GStreamer
+ * Copyright (C) 2015 Art+Com AG <info@artcom.de>
  *
- *   gst-app-maker  vimba
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
  *
- * Then copy the resulting gstvimba.c file over this file.
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Suite 500,
+ * Boston, MA 02110-1335, USA.
  */
-/* The rest of this file is shim code to allow the project to compile */
+/*
+ * gst-vimba: camera diagnostics and capture benchmark
+ *
+ *   gst-vimba list
+ *       cameras and their capabilities
+ *   gst-vimba bench [--camera ID] [--duration S] [--caps CAPS] [--pipeline P]
+ *       timed capture through vimbasrc
+ *
+ * Results are printed as JSON so runs can be compared across releases and
+ * hosts. Both commands work the same against a synthetic libVimbaC
+ * (--enable-vimba-mock).
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
 #include <stdio.h>
-int main (void) { printf ("FIXME\n"); return 0; }
+#include <string.h>
+#include <sys/resource.h>
+#include <glib.h>
+#include <gst/gst.h>
+#include <VimbaC.h>
+#include "../plugins/gstvimbameta.h"
+
+/* latency histograms use power of two buckets in microseconds */
+#define HISTOGRAM_BUCKETS 32
+/* push times are looked up by frame id in sink, enough for a deep queue */
+#define PUSH_TIME_SLOTS 4096
+
+typedef struct {
+    guint64  buckets[HISTOGRAM_BUCKETS];
+    GArray  *samples;
+} Histogram;
+
+typedef struct {
+    GMainLoop    *loop;
+    GstElement   *pipeline;
+    GstElement   *src;
+    GMutex        lock;
+
+    GstClockTime  first_push;
+    GstClockTime  last_push;
+    guint64       frames;
+    guint64       bytes;
+    GstClockTime  push_times[PUSH_TIME_SLOTS];
+
+    Histogram     callback_to_push;
+    Histogram     push_to_sink;
+    gchar        *error;
+} Bench;
+
+/*
+ * The meta type is registered by the plugin, so it is looked up by name once
+ * the pipeline has loaded vimbasrc. Only the struct layout comes from the
+ * header.
+ */
+static GType frame_meta_api = 0;
+#define get_frame_meta(b) ((GstVimbaFrameMeta *) (frame_meta_api != 0 \
+    ? gst_buffer_get_meta((b), frame_meta_api) : NULL))
+
+static gchar *camera_id = NULL;
+static gint duration = 10;
+static gchar *caps_string = NULL;
+static gchar *pipeline_string = NULL;
+static gchar *output_file = NULL;
+
+static GOptionEntry entries[] = {
+    { "camera", 'c', 0, G_OPTION_ARG_STRING, &camera_id,
+        "Camera id (default: first camera)", "ID" },
+    { "duration", 'd', 0, G_OPTION_ARG_INT, &duration,
+        "Capture duration in seconds (default: 10)", "S" },
+    { "caps", 0, 0, G_OPTION_ARG_STRING, &caps_string,
+        "Caps filter after vimbasrc", "CAPS" },
+    { "pipeline", 'p', 0, G_OPTION_ARG_STRING, &pipeline_string,
+        "Pipeline to measure, needs elements named src (vimbasrc) and sink "
+        "(fakesink)", "PIPELINE" },
+    { "output", 'o', 0, G_OPTION_ARG_FILENAME, &output_file,
+        "Write the JSON report to a file instead of stdout", "FILE" },
+    { NULL }
+};
+
+/* json helpers */
+
+/* quotes, backslashes and control characters escaped, UTF-8 passes as is */
+static void
+json_string (GString * json, const gchar * value)
+{
+    const guchar *c;
+
+    if (value == NULL) {
+        g_string_append(json, "null");
+        return;
+    }
+    g_string_append_c(json, '"');
+    for (c = (const guchar *) value; *c != '\0'; c++) {
+        switch (*c) {
+            case '"':
+                g_string_append(json, "\\\"");
+                break;
+            case '\\':
+                g_string_append(json, "\\\\");
+                break;
+            case '\n':
+                g_string_append(json, "\\n");
+                break;
+            case '\r':
+                g_string_append(json, "\\r");
+                break;
+            case '\t':
+                g_string_append(json, "\\t");
+                break;
+            default:
+                if (*c < 0x20) {
+                    g_string_append_printf(json, "\\u%04x", *c);
+                } else {
+                    g_string_append_c(json, *c);
+                }
+        }
+    }
+    g_string_append_c(json, '"');
+}
+
+static void
+json_key (GString * json, const gchar * key, gboolean first)
+{
+    g_string_append_printf(json, "%s\"%s\": ", first ? "" : ", ", key);
+}
+
+/* histograms */
+
+static void
+histogram_init (Histogram * histogram)
+{
+    memset(histogram->buckets, 0, sizeof(histogram->buckets));
+    histogram->samples = g_array_new(FALSE, FALSE, sizeof(guint64));
+}
+
+static void
+histogram_clear (Histogram * histogram)
+{
+    g_array_free(histogram->samples, TRUE);
+}
+
+static void
+histogram_add (Histogram * histogram, GstClockTimeDiff latency)
+{
+    guint64 us = latency > 0 ? (guint64) latency / GST_USECOND : 0;
+    guint bucket = 0;
+
+    while (bucket < HISTOGRAM_BUCKETS - 1 && (us >> (bucket + 1)) > 0) {
+        bucket++;
+    }
+    histogram->buckets[bucket]++;
+    g_array_append_val(histogram->samples, us);
+}
+
+static gint
+compare_uint64 (gconstpointer a, gconstpointer b)
+{
+    guint64 x = *(const guint64 *) a, y = *(const guint64 *) b;
+    return x < y ? -1 : x > y;
+}
+
+static guint64
+histogram_percentile (Histogram * histogram, gdouble percentile)
+{
+    guint index;
+
+    if (histogram->samples->len == 0) {
+        return 0;
+    }
+    index = (guint) ((histogram->samples->len - 1) * percentile / 100.0);
+    return g_array_index(histogram->samples, guint64, index);
+}
+
+static void
+histogram_json (GString * json, Histogram * histogram)
+{
+    guint i, last = 0;
+
+    g_array_sort(histogram->samples, compare_uint64);
+    g_string_append(json, "{");
+    json_key(json, "count", TRUE);
+    g_string_append_printf(json, "%u", histogram->samples->len);
+    json_key(json, "p50_us", FALSE);
+    g_string_append_printf(json, "%" G_GUINT64_FORMAT,
+        histogram_percentile(histogram, 50));
+    json_key(json, "p99_us", FALSE);
+    g_string_append_printf(json, "%" G_GUINT64_FORMAT,
+        histogram_percentile(histogram, 99));
+    json_key(json, "max_us", FALSE);
+    g_string_append_printf(json, "%" G_GUINT64_FORMAT,
+        histogram_percentile(histogram, 100));
+
+    /* bucket i counts latencies in [2^i, 2^(i+1)) us, trailing zeros cut */
+    for (i = 0; i < HISTOGRAM_BUCKETS; i++) {
+        if (histogram->buckets[i] > 0) {
+            last = i + 1;
+        }
+    }
+    json_key(json, "log2_us_buckets", FALSE);
+    g_string_append(json, "[");
+    for (i = 0; i < last; i++) {
+        g_string_append_printf(json, "%s%" G_GUINT64_FORMAT,
+            i > 0 ? ", " : "", histogram->buckets[i]);
+    }
+    g_string_append(json, "]}");
+}
+
+static gboolean
+write_report (GString * json)
+{
+    GError *error = NULL;
+
+    g_string_append(json, "\n");
+    if (output_file == NULL) {
+        fputs(json->str, stdout);
+        return TRUE;
+    }
+    if (!g_file_set_contents(output_file, json->str, json->len, &error)) {
+        g_printerr("cannot write %s: %s\n", output_file, error->message);
+        g_error_free(error);
+        return FALSE;
+    }
+    return TRUE;
+}
+
+/* list */
+
+static void
+list_int_range (GString * json, VmbHandle_t handle, const char * name,
+        const char * key)
+{
+    VmbInt64_t min, max;
+
+    if (VmbErrorSuccess == VmbFeatureIntRangeQuery(handle, name, &min, &max)) {
+        json_key(json, key, FALSE);
+        g_string_append_printf(json, "[%lld, %lld]", min, max);
+    }
+}
+
+static void
+list_camera (GString * json, VmbCameraInfo_t * info)
+{
+    VmbHandle_t handle;
+    const char *formats[64];
+    VmbUint32_t count = 0, i;
+    VmbInt64_t int_value;
+    double min, max;
+
+    g_string_append(json, "{");
+    json_key(json, "id", TRUE);
+    json_string(json, info->cameraIdString);
+    json_key(json, "name", FALSE);
+    json_string(json, info->cameraName);
+    json_key(json, "model", FALSE);
+    json_string(json, info->modelName);
+    json_key(json, "serial", FALSE);
+    json_string(json, info->serialString);
+    json_key(json, "interface", FALSE);
+    json_string(json, info->interfaceIdString);
+
+    /* read access works even while another process streams */
+    if (VmbErrorSuccess != VmbCameraOpen(info->cameraIdString,
+            VmbAccessModeRead, &handle)) {
+        json_key(json, "accessible", FALSE);
+        g_string_append(json, "false}");
+        return;
+    }
+    json_key(json, "accessible", FALSE);
+    g_string_append(json, "true");
+
+    if (VmbErrorSuccess == VmbFeatureIntGet(handle, "WidthMax", &int_value)) {
+        json_key(json, "width_max", FALSE);
+        g_string_append_printf(json, "%lld", int_value);
+    }
+    if (VmbErrorSuccess == VmbFeatureIntGet(handle, "HeightMax", &int_value)) {
+        json_key(json, "height_max", FALSE);
+        g_string_append_printf(json, "%lld", int_value);
+    }
+    list_int_range(json, handle, "Width", "width_range");
+    list_int_range(json, handle, "Height", "height_range");
+    if (VmbErrorSuccess == VmbFeatureFloatRangeQuery(handle,
+            "AcquisitionFrameRateAbs", &min, &max)) {
+        json_key(json, "framerate_range", FALSE);
+        g_string_append_printf(json, "[%g, %g]", min, max);
+    }
+    if (VmbErrorSuccess == VmbFeatureIntGet(handle, "StreamBytesPerSecond",
+            &int_value)) {
+        json_key(json, "stream_bytes_per_second", FALSE);
+        g_string_append_printf(json, "%lld", int_value);
+    }
+    if (VmbErrorSuccess == VmbFeatureEnumRangeQuery(handle, "PixelFormat",
+            formats, G_N_ELEMENTS(formats), &count)) {
+        json_key(json, "pixel_formats", FALSE);
+        g_string_append(json, "[");
+        for (i = 0; i < count; i++) {
+            if (i > 0) {
+                g_string_append(json, ", ");
+            }
+            json_string(json, formats[i]);
+        }
+        g_string_append(json, "]");
+    }
+    VmbCameraClose(handle);
+    g_string_append(json, "}");
+}
+
+static int
+command_list (void)
+{
+    VmbCameraInfo_t *cameras = NULL;
+    VmbUint32_t count = 0, i;
+    VmbBool_t gige = VmbBoolFalse;
+    GString *json;
+    gboolean ok;
+
+    if (VmbErrorSuccess != VmbStartup()) {
+        g_printerr("cannot start the Vimba API\n");
+        return 1;
+    }
+    if (VmbErrorSuccess == VmbFeatureBoolGet(gVimbaHandle, "GeVTLIsPresent",
+            &gige) && gige) {
+        VmbFeatureCommandRun(gVimbaHandle, "GeVDiscoveryAllOnce");
+    }
+    VmbCamerasList(NULL, 0, &count, sizeof(VmbCameraInfo_t));
+    if (count > 0) {
+        cameras = g_new0(VmbCameraInfo_t, count);
+        VmbCamerasList(cameras, count, &count, sizeof(VmbCameraInfo_t));
+    }
+
+    json = g_string_new("{\"cameras\": [");
+    for (i = 0; i < count; i++) {
+        if (i > 0) {
+            g_string_append(json, ", ");
+        }
+        list_camera(json, &cameras[i]);
+    }
+    g_string_append(json, "]}");
+    ok = write_report(json);
+
+    g_string_free(json, TRUE);
+    g_free(cameras);
+    VmbShutdown();
+    return ok ? 0 : 1;
+}
+
+/* bench */
+
+static GstPadProbeReturn
+bench_src_probe (GstPad * pad, GstPadProbeInfo * info, gpointer user_data)
+{
+    Bench *bench = user_data;
+    GstBuffer *buffer = GST_PAD_PROBE_INFO_BUFFER(info);
+    GstVimbaFrameMeta *meta = get_frame_meta(buffer);
+    GstClockTime now = gst_util_get_timestamp();
+
+    g_mutex_lock(&bench->lock);
+    if (bench->frames == 0) {
+        bench->first_push = now;
+    }
+    bench->last_push = now;
+    bench->frames++;
+    bench->bytes += gst_buffer_get_size(buffer);
+    if (meta != NULL) {
+        if (meta->callback_time > 0) {
+            histogram_add(&bench->callback_to_push,
+                GST_CLOCK_DIFF(meta->callback_time, now));
+        }
+        bench->push_times[meta->frame_id % PUSH_TIME_SLOTS] = now;
+    }
+    g_mutex_unlock(&bench->lock);
+    return GST_PAD_PROBE_OK;
+}
+
+static void
+bench_handoff (GstElement * sink, GstBuffer * buffer, GstPad * pad,
+        gpointer user_data)
+{
+    Bench *bench = user_data;
+    GstVimbaFrameMeta *meta = get_frame_meta(buffer);
+    GstClockTime now = gst_util_get_timestamp();
+    GstClockTime pushed;
+
+    if (meta == NULL) {
+        return;
+    }
+    g_mutex_lock(&bench->lock);
+    pushed = bench->push_times[meta->frame_id % PUSH_TIME_SLOTS];
+    if (pushed > 0) {
+        histogram_add(&bench->push_to_sink, GST_CLOCK_DIFF(pushed, now));
+    }
+    g_mutex_unlock(&bench->lock);
+}
+
+static gboolean
+bench_bus (GstBus * bus, GstMessage * message, gpointer user_data)
+{
+    Bench *bench = user_data;
+    GError *error = NULL;
+    gchar *debug = NULL;
+
+    switch (GST_MESSAGE_TYPE(message)) {
+        case GST_MESSAGE_ERROR:
+            gst_message_parse_error(message, &error, &debug);
+            bench->error = g_strdup(error->message);
+            g_error_free(error);
+            g_free(debug);
+            g_main_loop_quit(bench->loop);
+            break;
+        case GST_MESSAGE_EOS:
+            g_main_loop_quit(bench->loop);
+            break;
+        default:
+            break;
+    }
+    return TRUE;
+}
+
+static gboolean
+bench_timeout (gpointer user_data)
+{
+    Bench *bench = user_data;
+
+    g_main_loop_quit(bench->loop);
+    return G_SOURCE_REMOVE;
+}
+
+static gchar *
+bench_default_pipeline (void)
+{
+    GString *description = g_string_new("vimbasrc name=src");
+
+    if (camera_id != NULL) {
+        g_string_append_printf(description, " camera=%s", camera_id);
+    } else {
+        /* vimbasrc has no default camera, use the first one found */
+        VmbCameraInfo_t info;
+        VmbUint32_t count = 0;
+
+        if (VmbErrorSuccess == VmbStartup()) {
+            VmbCamerasList(&info, 1, &count, sizeof(info));
+            if (count > 0) {
+                g_string_append_printf(description, " camera=%s",
+                    info.cameraIdString);
+            }
+            /* vimbasrc starts the API again for itself */
+            VmbShutdown();
+        }
+    }
+    if (caps_string != NULL) {
+        g_string_append_printf(description, " ! %s", caps_string);
+    }
+    g_string_append(description,
+        " ! queue max-size-buffers=64 ! fakesink name=sink sync=false");
+    return g_string_free(description, FALSE);
+}
+
+static guint
+stats_uint (const GstStructure * stats, const gchar * field)
+{
+    guint value = 0;
+
+    if (stats != NULL) {
+        gst_structure_get_uint(stats, field, &value);
+    }
+    return value;
+}
+
+static gdouble
+rusage_seconds (void)
+{
+    struct rusage usage;
+
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6 +
+        usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+}
+
+static void
+bench_report (Bench * bench, const gchar * description, gdouble cpu_seconds,
+        GstStructure * stats)
+{
+    GString *json = g_string_new("{");
+    gdouble seconds = 0, fps = 0;
+    guint triggers, received, incomplete, dropped, delivered;
+    gchar *stats_string;
+
+    if (bench->frames > 1) {
+        seconds = (gdouble) (bench->last_push - bench->first_push) / GST_SECOND;
+    }
+    if (seconds > 0) {
+        fps = (bench->frames - 1) / seconds;
+    }
+    triggers = stats_uint(stats, "trigger-count");
+    received = stats_uint(stats, "frames-received");
+    incomplete = stats_uint(stats, "frames-incomplete");
+    dropped = stats_uint(stats, "frames-dropped");
+    /* frames the camera produced: the received ones plus the lost ones */
+    delivered = received + dropped;
+
+    json_key(json, "pipeline", TRUE);
+    json_string(json, description);
+    json_key(json, "duration_s", FALSE);
+    g_string_append_printf(json, "%.3f", seconds);
+    json_key(json, "frames", FALSE);
+    g_string_append_printf(json, "%" G_GUINT64_FORMAT, bench->frames);
+    json_key(json, "bytes", FALSE);
+    g_string_append_printf(json, "%" G_GUINT64_FORMAT, bench->bytes);
+    json_key(json, "fps", FALSE);
+    g_string_append_printf(json, "%.3f", fps);
+    json_key(json, "mb_per_s", FALSE);
+    g_string_append_printf(json, "%.3f",
+        seconds > 0 ? bench->bytes / seconds / 1e6 : 0);
+    json_key(json, "trigger_count", FALSE);
+    g_string_append_printf(json, "%u", triggers);
+    json_key(json, "frames_received", FALSE);
+    g_string_append_printf(json, "%u", received);
+    json_key(json, "frames_incomplete", FALSE);
+    g_string_append_printf(json, "%u", incomplete);
+    json_key(json, "frames_dropped", FALSE);
+    g_string_append_printf(json, "%u", dropped);
+    json_key(json, "drop_rate", FALSE);
+    g_string_append_printf(json, "%.6f",
+        delivered > 0 ? (gdouble) dropped / delivered : 0);
+    json_key(json, "incomplete_rate", FALSE);
+    g_string_append_printf(json, "%.6f",
+        received > 0 ? (gdouble) incomplete / received : 0);
+    json_key(json, "cpu_s", FALSE);
+    g_string_append_printf(json, "%.3f", cpu_seconds);
+    json_key(json, "cpu_us_per_frame", FALSE);
+    g_string_append_printf(json, "%.3f",
+        bench->frames > 0 ? cpu_seconds * 1e6 / bench->frames : 0);
+    json_key(json, "callback_to_push", FALSE);
+    histogram_json(json, &bench->callback_to_push);
+    json_key(json, "push_to_sink", FALSE);
+    histogram_json(json, &bench->push_to_sink);
+    json_key(json, "vimbasrc_stats", FALSE);
+    stats_string = stats != NULL ? gst_structure_to_string(stats) : NULL;
+    json_string(json, stats_string);
+    g_free(stats_string);
+    if (bench->error != NULL) {
+        json_key(json, "error", FALSE);
+        json_string(json, bench->error);
+    }
+    g_string_append(json, "}");
+
+    write_report(json);
+    g_string_free(json, TRUE);
+}
+
+static int
+command_bench (void)
+{
+    Bench bench;
+    GstElement *sink;
+    GstPad *pad;
+    GstBus *bus;
+    GstStructure *stats = NULL;
+    GError *error = NULL;
+    gchar *description;
+    gdouble cpu_start;
+    int result = 0;
+
+    memset(&bench, 0, sizeof(Bench));
+    g_mutex_init(&bench.lock);
+    histogram_init(&bench.callback_to_push);
+    histogram_init(&bench.push_to_sink);
+
+    description = pipeline_string != NULL
+        ? g_strdup(pipeline_string) : bench_default_pipeline();
+    bench.pipeline = gst_parse_launch(description, &error);
+    if (bench.pipeline == NULL) {
+        g_printerr("cannot create pipeline: %s\n", error->message);
+        g_error_free(error);
+        g_free(description);
+        return 1;
+    }
+    frame_meta_api = g_type_from_name("GstVimbaFrameMetaAPI");
+    bench.src = gst_bin_get_by_name(GST_BIN(bench.pipeline), "src");
+    sink = gst_bin_get_by_name(GST_BIN(bench.pipeline), "sink");
+    if (bench.src == NULL || sink == NULL) {
+        g_printerr("pipeline needs elements named src and sink\n");
+        result = 1;
+        goto done;
+    }
+
+    pad = gst_element_get_static_pad(bench.src, "src");
+    gst_pad_add_probe(pad, GST_PAD_PROBE_TYPE_BUFFER, bench_src_probe,
+        &bench, NULL);
+    gst_object_unref(pad);
+    g_object_set(sink, "signal-handoffs", TRUE, NULL);
+    g_signal_connect(sink, "handoff", G_CALLBACK(bench_handoff), &bench);
+
+    bench.loop = g_main_loop_new(NULL, FALSE);
+    bus = gst_element_get_bus(bench.pipeline);
+    gst_bus_add_watch(bus, bench_bus, &bench);
+    gst_object_unref(bus);
+
+    cpu_start = rusage_seconds();
+    gst_element_set_state(bench.pipeline, GST_STATE_PLAYING);
+    g_timeout_add_seconds(duration, bench_timeout, &bench);
+    g_main_loop_run(bench.loop);
+
+    g_object_get(bench.src, "stats", &stats, NULL);
+    gst_element_set_state(bench.pipeline, GST_STATE_NULL);
+    bench_report(&bench, description, rusage_seconds() - cpu_start, stats);
+    result = bench.error != NULL ? 1 : 0;
+
+    if (stats != NULL) {
+        gst_structure_free(stats);
+    }
+    g_main_loop_unref(bench.loop);
+
+done:
+    if (sink != NULL) {
+        gst_object_unref(sink);
+    }
+    if (bench.src != NULL) {
+        gst_object_unref(bench.src);
+    }
+    gst_object_unref(bench.pipeline);
+    histogram_clear(&bench.callback_to_push);
+    histogram_clear(&bench.push_to_sink);
+    g_mutex_clear(&bench.lock);
+    g_free(bench.error);
+    g_free(description);
+    return result;
+}
+
+int
+main (int argc, char *argv[])
+{
+    GOptionContext *context;
+    GError *error = NULL;
+    int result;
+
+    context = g_option_context_new("list|bench - Vimba camera diagnostics");
+    g_option_context_add_main_entries(context, entries, NULL);
+    g_option_context_add_group(context, gst_init_get_option_group());
+    if (!g_option_context_parse(context, &argc, &argv, &error)) {
+        g_printerr("%s\n", error->message);
+        g_error_free(error);
+        g_option_context_free(context);
+        return 1;
+    }
+    if (argc < 2) {
+        gchar *help = g_option_context_get_help(context, TRUE, NULL);
+        g_printerr("%s", help);
+        g_free(help);
+        g_option_context_free(context);
+        return 1;
+    }
+    g_option_context_free(context);
+
+    if (strcmp(argv[1], "list") == 0) {
+        result = command_list();
+    } else if (strcmp(argv[1], "bench") == 0) {
+        result = command_bench();
+    } else {
+        g_printerr("unknown command %s\n", argv[1]);
+        result = 1;
+    }
+    return result;
+}